@@ -0,0 +1,80 @@
+/**
+ *  Compares the cost of many mostly idle connections with one thread per connection against
+ *  the epoll server with a worker pool (messageServerWorkerThreads).
+ *
+ *  Reports the mongod's thread count, resident and virtual memory with all connections open
+ *  and idle, then the context switches and time taken to send one command over each of them.
+ *
+ *  Linux only.  Both this shell and the mongod need an open files limit above nConns.
+ */
+
+var nConns = 10000;
+var nWorkers = 16;
+
+function procStatus(dir) {
+    var stats = {};
+    cat(dir + "status").split("\n").forEach(function(line) {
+        var m = line.match(/^(\w+):\s+(\d+)/);
+        if (m)
+            stats[m[1]] = parseInt(m[2]);
+    });
+    return stats;
+}
+
+// /proc/<pid>/status only counts the main thread's context switches, so sum over every thread
+function contextSwitches(pid) {
+    var total = 0;
+    ls("/proc/" + pid + "/task").forEach(function(taskDir) {
+        try {
+            var s = procStatus(taskDir);
+            total += s.voluntary_ctxt_switches + s.nonvoluntary_ctxt_switches;
+        }
+        catch (e) {
+            // thread exited while we were looking
+        }
+    });
+    return total;
+}
+
+function run(name, options) {
+    var mongod = MongoRunner.runMongod(options);
+    var host = mongod.host;
+    var pid = Number(mongod.getDB("admin").serverStatus().pid);
+
+    var conns = [];
+    for (var i = 0; i < nConns; i++) {
+        conns.push(new Mongo(host));
+    }
+
+    sleep(5000);
+    var idle = procStatus("/proc/" + pid + "/");
+
+    var before = contextSwitches(pid);
+    var elapsed = Date.timeFunc(function() {
+        for (var i = 0; i < conns.length; i++) {
+            assert.commandWorked(conns[i].getDB("admin").runCommand({ ping: 1 }));
+        }
+    });
+    var after = contextSwitches(pid);
+
+    var result = { server: name,
+                   connections: conns.length,
+                   threads: idle.Threads,
+                   residentKB: idle.VmRSS,
+                   virtualKB: idle.VmSize,
+                   pingAllMillis: elapsed,
+                   contextSwitches: after - before };
+    printjson(result);
+
+    conns = null;
+    gc();
+    MongoRunner.stopMongod(mongod);
+    return result;
+}
+
+var threadPerConn = run("thread per connection", {});
+var pooled = run("epoll", { setParameter: "messageServerWorkerThreads=" + nWorkers });
+
+assert.lt(pooled.threads, threadPerConn.threads);
+print("resident memory reduction: " + (threadPerConn.residentKB - pooled.residentKB) + "KB");
+print("context switch reduction: " + (threadPerConn.contextSwitches - pooled.contextSwitches));
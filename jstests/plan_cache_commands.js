@@ -49,8 +49,19 @@ assert.commandFailed(missingCollection.runCommand('planCacheListQueryShapes'));
 // Number of shapes should match queries executed by multi-plan runner.
 var shapes = getShapes();
 assert.eq(1, shapes.length, 'unexpected number of shapes in planCacheListQueryShapes result');
-assert.eq({query: queryA1, sort: sortA1, projection: projectionA1}, shapes[0],
+assert.eq({query: queryA1, sort: sortA1, projection: projectionA1},
+          {query: shapes[0].query, sort: shapes[0].sort, projection: shapes[0].projection},
           'unexpected query shape returned from planCacheListQueryShapes');
+assert(shapes[0].hasOwnProperty('hits'), 'hits missing from query shape');
+
+// Cache-wide counters are reported next to the shapes.
+var stats = t.runCommand('planCacheListQueryShapes').stats;
+assert(stats, 'stats missing from planCacheListQueryShapes result');
+assert.eq(1, stats.size, 'unexpected plan cache size in stats');
+assert.lte(stats.size, stats.maxSize, 'plan cache larger than its bound');
+['hits', 'misses', 'replans', 'evictions'].forEach(function(field) {
+    assert(stats.hasOwnProperty(field), field + ' missing from plan cache stats');
+});
 
 
 
@@ -114,23 +125,24 @@ assert.eq(0, getShapes().length, 'plan cache should be empty after successful pl
 // http://docs.mongodb.org/manual/core/query-plans/#query-plan-revision
 // As collections change over time, the query optimizer deletes the query plan and re-evaluates
 // after any of the following events:
-// - The collection receives 1,000 write operations.
 // - The reIndex rebuilds the index.
-// - You add or drop an index.
+// - You add an index the query could use, or drop or change an index the plan uses.
+// - The cached plan does much more work per result than it did when it was picked.
 // - The mongod process restarts.
+// Entries are also evicted least recently used first once the cache is full.
 //
 
-// Case 1: The collection receives 1,000 write operations.
+// Case 1: Writes alone do not clear the cache.
 // Steps:
 //     Populate cache. Cache should contain 1 key after running query.
 //     Insert 1000 documents.
-//     Cache should be cleared.
+//     Cache should still hold the entry.
 assert.eq(1, t.find(queryA1, projectionA1).sort(sortA1).itcount(), 'unexpected document count');
 assert.eq(1, getShapes().length, 'plan cache should not be empty after query');
 for (var i = 0; i < 1000; i++) {
     t.save({b: i});
 }
-assert.eq(0, getShapes().length, 'plan cache should be empty after adding 1000 documents.');
+assert.eq(1, getShapes().length, 'plan cache should survive adding 1000 documents.');
 
 // Case 2: The reIndex rebuilds the index.
 // Steps:
@@ -146,11 +158,13 @@ assert.eq(0, getShapes().length, 'plan cache should be empty after reIndex opera
 // Case 3: You add or drop an index.
 // Steps:
 //     Populate the cache with 1 entry.
-//     Add an index.
-//     Confirm that cache is empty.
+//     Add an index the query cannot use. Confirm the entry is kept.
+//     Add an index on the queried field. Confirm that cache is empty.
 assert.eq(1, t.find(queryA1, projectionA1).sort(sortA1).itcount(), 'unexpected document count');
 assert.eq(1, getShapes().length, 'plan cache should not be empty after query');
 t.ensureIndex({b: 1});
+assert.eq(1, getShapes().length, 'plan cache should keep entries an unrelated index cannot help');
+t.ensureIndex({a: 1, b: 1});
 assert.eq(0, getShapes().length, 'plan cache should be empty after adding index');
 
 // Case 4: The mongod process restarts
@@ -0,0 +1,60 @@
+// Initial sync with collections cloned on several threads.  Checks every collection and its
+// indexes arrive, and that replSetGetStatus reports progress per collection while cloning.
+
+var basename = "initial_sync_parallel";
+
+print("1. Bring up set");
+var replTest = new ReplSetTest( {name: basename, nodes: 1} );
+replTest.startSet();
+replTest.initiate();
+
+var master = replTest.getMaster();
+var mdb = master.getDB("d");
+
+print("2. Insert some data into several collections");
+var nColls = 8;
+var N = 20000;
+for (var c = 0; c < nColls; c++) {
+    var coll = mdb["c" + c];
+    for (var i = 0; i < N; i++) {
+        coll.insert({_id: i, x: i % 100, y: "c" + c + "_" + i});
+    }
+    coll.ensureIndex({x: 1});
+    coll.ensureIndex({y: 1}, {unique: true});
+}
+assert.eq(null, mdb.getLastError());
+
+print("3. Bring up a new node that clones 4 collections at a time");
+var slave = replTest.add({setParameter: "initialSyncCloneThreads=4"});
+replTest.reInitiate();
+
+print("4. Look for per collection progress while it is cloning");
+var sawProgress = false;
+assert.soon(function() {
+    var status = slave.getDB("admin").runCommand({replSetGetStatus: 1});
+    if (status.ok && status.members) {
+        status.members.forEach(function(m) {
+            if (m.self && m.initialSyncCollections) {
+                printjson(m.initialSyncCollections);
+                sawProgress = true;
+            }
+        });
+    }
+    return sawProgress || slave.getDB("admin").isMaster().secondary;
+}, "new node never finished initial sync", 5 * 60 * 1000, 100);
+
+replTest.awaitSecondaryNodes();
+replTest.awaitReplication();
+
+print("5. Check the data and indexes arrived");
+slave.setSlaveOk();
+var sdb = slave.getDB("d");
+for (var c = 0; c < nColls; c++) {
+    assert.eq(N, sdb["c" + c].count(), "c" + c);
+    assert.eq(3, sdb["c" + c].getIndexes().length, "c" + c);
+}
+if (!sawProgress) {
+    print("initial sync finished before its progress could be seen");
+}
+
+replTest.stopSet();
@@ -0,0 +1,86 @@
+//
+// Tests that a migration whose initial clone spans several windows of the donor's scan moves
+// every document exactly once, including runs of equal shard keys that straddle a window and
+// documents deleted or updated while the clone is in progress
+//
+
+var options = { separateConfig : true };
+
+var st = new ShardingTest({ shards : 2, mongos : 1, other : options });
+st.stopBalancer();
+
+var mongos = st.s0;
+var shards = mongos.getDB( "config" ).shards.find().toArray();
+shards[0].conn = st.shard0;
+shards[1].conn = st.shard1;
+var admin = mongos.getDB( "admin" );
+var coll = mongos.getCollection( "foo.bar" );
+
+assert( admin.runCommand({ enableSharding : coll.getDB() + "" }).ok );
+printjson( admin.runCommand({ movePrimary : coll.getDB() + "", to : shards[0]._id }) );
+assert( admin.runCommand({ shardCollection : coll + "", key : { skey : 1 } }).ok );
+
+// Runs of 7 equal shard keys, so most runs cross a boundary between windows of 5 documents
+var numDocs = 300;
+for ( var i = 0; i < numDocs; i++ ) {
+    coll.insert({ _id : i, skey : Math.floor( i / 7 ) });
+}
+assert.eq( null, coll.getDB().getLastError() );
+
+jsTest.log( "Shrinking the donor's clone window and pausing the recipient between batches..." );
+
+assert( shards[0].conn.getDB( "admin" ).runCommand({ setParameter : 1,
+                                                     internalMigrateCloneWindowDocs : 5 }).ok );
+assert( shards[1].conn.getDB( "admin" ).runCommand({ configureFailPoint :
+                                                         "migrateThreadHangAfterCloneBatch",
+                                                     mode : "alwaysOn" }).ok );
+
+var db = coll.getDB();  // db variable name is required due to startParallelShell()
+var join = startParallelShell( "assert( db.getSiblingDB( 'admin' ).runCommand({ " +
+                               "moveChunk : '" + coll + "', find : { skey : 0 }, " +
+                               "to : '" + shards[1]._id + "' }).ok );" );
+
+assert.soon( function() {
+    var status = shards[1].conn.getDB( "admin" ).runCommand({ _recvChunkStatus : 1 });
+    printjson( status );
+    return status.active && status.counts.cloned > 0;
+}, "recipient never cloned its first batch" );
+
+jsTest.log( "Deleting and updating documents while the clone is paused..." );
+
+var removed = [ 2, 6, 8, 40, 200 ];
+var updated = [ 0, 5, 9, 41, 201 ];
+var grown = [ 3, 7, 202 ];
+var pad = new Array( 4 * 1024 ).join( "x" );
+
+removed.forEach( function( id ) { coll.remove({ _id : id }); } );
+updated.forEach( function( id ) { coll.update({ _id : id }, { $set : { updated : true } }); } );
+grown.forEach( function( id ) { coll.update({ _id : id }, { $set : { pad : pad } }); } );
+assert.eq( null, coll.getDB().getLastError() );
+
+assert( shards[1].conn.getDB( "admin" ).runCommand({ configureFailPoint :
+                                                         "migrateThreadHangAfterCloneBatch",
+                                                     mode : "off" }).ok );
+join();
+
+jsTest.log( "Checking the documents on the recipient..." );
+
+var recipColl = shards[1].conn.getCollection( coll + "" );
+assert.eq( numDocs - removed.length, recipColl.count() );
+assert.eq( 0, shards[0].conn.getCollection( coll + "" ).count() );
+
+var ids = recipColl.find( {}, { _id : 1 } ).sort({ _id : 1 }).toArray().map(
+    function( doc ) { return doc._id; } );
+var expected = [];
+for ( var i = 0; i < numDocs; i++ ) {
+    if ( removed.indexOf( i ) < 0 ) expected.push( i );
+}
+assert.eq( expected, ids );
+
+updated.forEach( function( id ) { assert( recipColl.findOne({ _id : id }).updated, id ); } );
+grown.forEach( function( id ) { assert.eq( pad, recipColl.findOne({ _id : id }).pad, id ); } );
+
+assert.eq( shards[1]._id,
+           mongos.getDB( "config" ).chunks.findOne({ ns : coll + "" }).shard );
+
+st.stop();
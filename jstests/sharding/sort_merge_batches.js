@@ -0,0 +1,64 @@
+// Sorted queries through mongos merge results from several shards over many getMore batches.
+// Checks the merged order and that abandoning a cursor part way through leaves mongos usable.
+
+var s = new ShardingTest( "sort_merge_batches" , 3 , 0 , 1 );
+s.stopBalancer();
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+var db = s.getDB( "test" );
+
+var N = 3000;
+for ( var i = 0; i < N; i++ ) {
+    // x interleaves across the _id ranges so every shard contributes to every part of the sort
+    db.data.insert( { _id : i , x : ( i * 7919 ) % N , pad : "xxxxxxxxxxxxxxxxxxxx" } );
+}
+assert.eq( null , db.getLastError() );
+
+s.adminCommand( { split : "test.data" , middle : { _id : N / 3 } } );
+s.adminCommand( { split : "test.data" , middle : { _id : 2 * N / 3 } } );
+
+var shards = s.config.shards.find().toArray();
+s.adminCommand( { movechunk : "test.data" , find : { _id : N / 3 } ,
+                  to : shards[1]._id , _waitForDelete : true } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : 2 * N / 3 } ,
+                  to : shards[2]._id , _waitForDelete : true } );
+assert.eq( 3 , s.config.chunks.distinct( "shard" ).length , "chunks not spread" );
+
+function checkSorted( dir , batchSize ) {
+    var c = db.data.find().sort( { x : dir } ).batchSize( batchSize );
+    var n = 0;
+    var last = null;
+    while ( c.hasNext() ) {
+        var o = c.next();
+        if ( last != null ) {
+            assert( dir > 0 ? last < o.x : last > o.x ,
+                    "out of order at " + n + ": " + last + " then " + o.x );
+        }
+        last = o.x;
+        n++;
+    }
+    assert.eq( N , n , "wrong count sorting " + dir + " with batch size " + batchSize );
+}
+
+checkSorted( 1 , 7 );
+checkSorted( -1 , 7 );
+checkSorted( 1 , 100 );
+checkSorted( -1 , 0 );
+
+// Unsorted queries still see every document
+assert.eq( N , db.data.find().batchSize( 11 ).itcount() );
+
+// Abandon sorted cursors part way through, then make sure mongos still answers
+for ( var j = 0; j < 20; j++ ) {
+    var c = db.data.find().sort( { x : 1 } ).batchSize( 5 );
+    for ( var k = 0; k < 12 && c.hasNext(); k++ ) {
+        c.next();
+    }
+    c.close();
+}
+assert.eq( N , db.data.find().sort( { x : -1 } ).itcount() );
+assert.eq( 0 , db.data.find().sort( { x : 1 } ).limit( 1 ).next().x );
+
+s.stop();
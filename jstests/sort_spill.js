@@ -0,0 +1,44 @@
+// Unindexed sorts bigger than the sort memory budget spill to disk when
+// internalQueryExecSortAllowDiskUse is set, and fail when it isn't.
+
+t = db.jstests_sort_spill;
+t.drop();
+
+function setSortParameters( allowDiskUse, maxBytes ) {
+    assert.commandWorked( db.adminCommand( { setParameter : 1,
+                                             internalQueryExecSortAllowDiskUse : allowDiskUse,
+                                             internalQueryExecSortMaxBytes : maxBytes } ) );
+}
+
+var pad = new Array( 1000 ).toString();
+var N = 5000;
+for( i = 0; i < N; ++i ) {
+    t.save( { a : ( i * 7919 ) % N , pad : pad } );
+}
+assert.eq( null , db.getLastError() );
+
+// About 5MB of documents against a 1MB budget.
+setSortParameters( false, 1024 * 1024 );
+assert.throws( function() { t.find().sort( { a : 1 } ).itcount(); } );
+
+setSortParameters( true, 1024 * 1024 );
+[ 1, -1 ].forEach( function( dir ) {
+    var c = t.find().sort( { a : dir } ).batchSize( 1000 );
+    var n = 0;
+    var last = null;
+    while ( c.hasNext() ) {
+        var o = c.next();
+        if ( last != null ) {
+            assert( dir > 0 ? last < o.a : last > o.a , "out of order at " + n );
+        }
+        last = o.a;
+        n++;
+    }
+    assert.eq( N , n );
+} );
+
+// A limited sort keeps its top results in memory and never spills.
+assert.eq( 0 , t.find().sort( { a : 1 } ).limit( 10 ).next().a );
+
+setSortParameters( false, 32 * 1024 * 1024 );
+t.drop();
@@ -15,8 +15,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
+#include "mongo/platform/cstdint.h"
+
 namespace mongo {
 namespace mutablebson {
 
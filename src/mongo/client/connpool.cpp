@@ -24,6 +24,7 @@
 #include "mongo/client/dbclient_rs.h"
 #include "mongo/client/syncclusterconnection.h"
 #include "mongo/s/shard.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -42,6 +43,8 @@ namespace mongo {
     }
 
     void PoolForHost::done( DBConnectionPool * pool, DBClientBase * c ) {
+        decrementEgress();
+
         if (c->isFailed()) {
             reportBadConnectionAt(c->getSockCreationMicroSec());
             pool->onDestroy(c);
@@ -73,8 +76,70 @@ namespace mongo {
                 microSec <= _minValidCreationTimeMicroSec;
     }
 
+    long long PoolForHost::waitForFreeConnection( mongo::mutex::scoped_lock& lk ) {
+        if ( _maxInUse <= 0 || ( _waiters.empty() && _checkedOut < _maxInUse ) )
+            return 0;
+
+        Timer t;
+        _waited++;
+
+        boost::condition cv;
+        std::list<boost::condition*>::iterator me = _waiters.insert( _waiters.end(), &cv );
+        const boost::system_time deadline =
+            boost::get_system_time() + boost::posix_time::milliseconds( _waitTimeoutMillis );
+
+        while ( _waiters.front() != &cv || ( _maxInUse > 0 && _checkedOut >= _maxInUse ) ) {
+            if ( _waitTimeoutMillis <= 0 ) {
+                cv.wait( lk.boost() );
+            }
+            else if ( ! cv.timed_wait( lk.boost(), deadline ) ) {
+                if ( _waiters.front() == &cv && ( _maxInUse <= 0 || _checkedOut < _maxInUse ) )
+                    break;
+
+                _waitTimeouts++;
+                _waiters.erase( me );
+                _notifyNextWaiter();
+                uasserted( 17363, str::stream() << "timed out after " << t.millis()
+                                                << "ms waiting for a connection to " << _hostName
+                                                << ", " << _checkedOut << " in use" );
+            }
+        }
+
+        _waiters.erase( me );
+        // There may be room for the next caller too; it checks once we let go of the lock
+        _notifyNextWaiter();
+        return t.micros();
+    }
+
+    void PoolForHost::_notifyNextWaiter() {
+        if ( ! _waiters.empty() )
+            _waiters.front()->notify_one();
+    }
+
+    void PoolForHost::decrementEgress() {
+        // Connections bound to a ScopedDbConnection from outside the pool were never counted
+        if ( _checkedOut > 0 )
+            _checkedOut--;
+        _notifyNextWaiter();
+    }
+
+    int PoolForHost::reserveWarmup() {
+        int target = std::min( _minPerHost, static_cast<int>( _maxPerHost ) );
+        if ( _maxInUse > 0 )
+            target = std::min( target, _maxInUse );
+
+        int needed = target - numAvailable() - _checkedOut;
+        if ( needed <= 0 || ! _waiters.empty() )
+            return 0;
+
+        _checkedOut += needed;
+        return needed;
+    }
+
     DBClientBase * PoolForHost::get( DBConnectionPool * pool , double socketTimeout ) {
 
+        _checkedOut++;
+
         time_t now = time(0);
         
         while ( ! _pool.empty() ) {
@@ -167,14 +232,29 @@ namespace mongo {
     }
 
     unsigned PoolForHost::_maxPerHost = 50;
+    int PoolForHost::_maxInUse = 0;
+    int PoolForHost::_waitTimeoutMillis = 30 * 1000;
+    int PoolForHost::_minPerHost = 0;
 
     // ------ DBConnectionPool ------
 
     DBConnectionPool pool;
 
+    namespace {
+        Histogram::Options checkoutWaitOptions() {
+            // [0..100], [101..200], [201..400] ... microseconds, the last bucket takes the rest
+            Histogram::Options opts;
+            opts.numBuckets = 18;
+            opts.bucketSize = 100;
+            opts.exponential = true;
+            return opts;
+        }
+    }
+
     DBConnectionPool::DBConnectionPool() 
         : _mutex("DBConnectionPool") , 
           _name( "dbconnectionpool" ) , 
+          _checkoutWaitMicros( checkoutWaitOptions() ) ,
           _hooks( new list<DBConnectionHook*>() ) { 
     }
 
@@ -183,9 +263,19 @@ namespace mongo {
         scoped_lock L(_mutex);
         PoolForHost& p = _pools[PoolKey(ident,socketTimeout)];
         p.initializeHostName(ident);
+
+        long long waitMicros = p.waitForFreeConnection( L );
+        _checkoutWaitMicros.insert( static_cast<uint32_t>(
+            std::min( waitMicros, static_cast<long long>( 0xffffffff ) ) ) );
+
         return p.get( this , socketTimeout );
     }
 
+    void DBConnectionPool::_cancelCreate( const string& ident , double socketTimeout ) {
+        scoped_lock L(_mutex);
+        _pools[PoolKey(ident,socketTimeout)].decrementEgress();
+    }
+
     DBClientBase* DBConnectionPool::_finishCreate( const string& host , double socketTimeout , DBClientBase* conn ) {
         {
             scoped_lock L(_mutex);
@@ -199,6 +289,7 @@ namespace mongo {
             onHandedOut( conn );
         }
         catch ( std::exception & ) {
+            _cancelCreate( host , socketTimeout );
             delete conn;
             throw;
         }
@@ -213,6 +304,7 @@ namespace mongo {
                 onHandedOut( c );
             }
             catch ( std::exception& ) {
+                decrementEgress( url.toString() , c );
                 delete c;
                 throw;
             }
@@ -220,8 +312,17 @@ namespace mongo {
         }
 
         string errmsg;
-        c = url.connect( errmsg, socketTimeout );
-        uassert( 13328 ,  _name + ": connect failed " + url.toString() + " : " + errmsg , c );
+        try {
+            c = url.connect( errmsg, socketTimeout );
+        }
+        catch ( std::exception& ) {
+            _cancelCreate( url.toString() , socketTimeout );
+            throw;
+        }
+        if ( ! c ) {
+            _cancelCreate( url.toString() , socketTimeout );
+            uasserted( 13328 , _name + ": connect failed " + url.toString() + " : " + errmsg );
+        }
 
         return _finishCreate( url.toString() , socketTimeout , c );
     }
@@ -233,6 +334,7 @@ namespace mongo {
                 onHandedOut( c );
             }
             catch ( std::exception& ) {
+                decrementEgress( host , c );
                 delete c;
                 throw;
             }
@@ -241,11 +343,22 @@ namespace mongo {
 
         string errmsg;
         ConnectionString cs = ConnectionString::parse( host , errmsg );
-        uassert( 13071 , (string)"invalid hostname [" + host + "]" + errmsg , cs.isValid() );
+        if ( ! cs.isValid() ) {
+            _cancelCreate( host , socketTimeout );
+            uasserted( 13071 , (string)"invalid hostname [" + host + "]" + errmsg );
+        }
 
-        c = cs.connect( errmsg, socketTimeout );
-        if ( ! c )
+        try {
+            c = cs.connect( errmsg, socketTimeout );
+        }
+        catch ( std::exception& ) {
+            _cancelCreate( host , socketTimeout );
+            throw;
+        }
+        if ( ! c ) {
+            _cancelCreate( host , socketTimeout );
             throw SocketException( SocketException::CONNECT_ERROR , host , 11002 , str::stream() << _name << " error: " << errmsg );
+        }
         return _finishCreate( host , socketTimeout , c );
     }
 
@@ -254,6 +367,13 @@ namespace mongo {
         _pools[PoolKey(host,c->getSoTimeout())].done(this,c);
     }
 
+    void DBConnectionPool::decrementEgress(const string& host, DBClientBase* c) {
+        scoped_lock L(_mutex);
+        PoolMap::iterator i = _pools.find( PoolKey( host, c->getSoTimeout() ) );
+        if ( i != _pools.end() )
+            i->second.decrementEgress();
+    }
+
 
     DBConnectionPool::~DBConnectionPool() {
         // connection closing is handled by ~PoolForHost
@@ -322,6 +442,9 @@ namespace mongo {
 
         int avail = 0;
         long long created = 0;
+        int inUse = 0;
+        long long waited = 0;
+        long long waitTimeouts = 0;
 
 
         map<ConnectionString::ConnectionType,long long> createdByType;
@@ -340,10 +463,15 @@ namespace mongo {
                 BSONObjBuilder temp( bb.subobjStart( s ) );
                 temp.append( "available" , i->second.numAvailable() );
                 temp.appendNumber( "created" , i->second.numCreated() );
+                temp.append( "inUse" , i->second.numInUse() );
+                temp.append( "waiting" , i->second.numWaiting() );
                 temp.done();
 
                 avail += i->second.numAvailable();
                 created += i->second.numCreated();
+                inUse += i->second.numInUse();
+                waited += i->second.numWaited();
+                waitTimeouts += i->second.numWaitTimeouts();
 
                 long long& x = createdByType[i->second.type()];
                 x += i->second.numCreated();
@@ -379,6 +507,23 @@ namespace mongo {
 
         b.append( "totalAvailable" , avail );
         b.appendNumber( "totalCreated" , created );
+        b.append( "totalInUse" , inUse );
+        b.appendNumber( "totalWaited" , waited );
+        b.appendNumber( "totalWaitTimeouts" , waitTimeouts );
+
+        {
+            BSONObjBuilder temp( b.subobjStart( "checkoutWaitMicros" ) );
+            scoped_lock lk( _mutex );
+            const uint32_t n = _checkoutWaitMicros.getBucketsNum();
+            for ( uint32_t i = 0; i < n; i++ ) {
+                string bucket = i + 1 < n
+                    ? str::stream() << "<=" << _checkoutWaitMicros.getBoundary( i )
+                    : str::stream() << ">" << _checkoutWaitMicros.getBoundary( i - 1 );
+                temp.appendNumber( bucket ,
+                                   static_cast<long long>( _checkoutWaitMicros.getCount( i ) ) );
+            }
+            temp.done();
+        }
     }
 
     bool DBConnectionPool::serverNameCompare::operator()( const string& a , const string& b ) const{
@@ -458,6 +603,65 @@ namespace mongo {
                 // we don't care if there was a socket error
             }
         }
+
+        _warmPools();
+    }
+
+    void DBConnectionPool::_warmPools() {
+        if ( PoolForHost::getMinPerHost() <= 0 )
+            return;
+
+        vector< pair<PoolKey,int> > toWarm;
+        {
+            scoped_lock lk( _mutex );
+            for ( PoolMap::iterator i=_pools.begin(); i!=_pools.end(); ++i ) {
+                int needed = i->second.reserveWarmup();
+                if ( needed > 0 )
+                    toWarm.push_back( make_pair( i->first, needed ) );
+            }
+        }
+
+        for ( size_t i=0; i<toWarm.size(); i++ ) {
+            const PoolKey& key = toWarm[i].first;
+            int remaining = toWarm[i].second;
+
+            LOG(1) << "warming " << remaining << " connections to " << key.ident << endl;
+            while ( remaining > 0 && ! inShutdown() ) {
+                string errmsg;
+                ConnectionString cs = ConnectionString::parse( key.ident , errmsg );
+                DBClientBase* c = NULL;
+                try {
+                    if ( cs.isValid() )
+                        c = cs.connect( errmsg, key.timeout );
+                    if ( c ) {
+                        {
+                            scoped_lock lk( _mutex );
+                            _pools[key].createdOne( c );
+                        }
+                        onCreate( c );
+                    }
+                }
+                catch ( std::exception& e ) {
+                    errmsg = e.what();
+                    delete c;
+                    c = NULL;
+                }
+
+                if ( ! c ) {
+                    LOG(1) << "could not warm connection to " << key.ident
+                           << causedBy( errmsg ) << endl;
+                    break;
+                }
+
+                release( key.ident, c );
+                remaining--;
+            }
+
+            // Hand back the slots of connections we gave up on
+            scoped_lock lk( _mutex );
+            for ( ; remaining > 0; remaining-- )
+                _pools[key].decrementEgress();
+        }
     }
 
     // ------ ScopedDbConnection ------
@@ -17,12 +17,15 @@
 
 #pragma once
 
+#include <boost/thread/condition.hpp>
+#include <list>
 #include <stack>
 
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/client/export_macros.h"
 #include "mongo/platform/cstdint.h"
 #include "mongo/util/background.h"
+#include "mongo/util/histogram.h"
 
 namespace mongo {
 
@@ -36,12 +39,17 @@ namespace mongo {
     class MONGO_CLIENT_API PoolForHost {
     public:
         PoolForHost()
-            : _created(0), _minValidCreationTimeMicroSec(0) {}
+            : _created(0), _minValidCreationTimeMicroSec(0), _checkedOut(0),
+              _waited(0), _waitTimeouts(0) {}
 
         PoolForHost( const PoolForHost& other ) {
             verify(other._pool.size() == 0);
+            verify(other._waiters.empty());
             _created = other._created;
             _minValidCreationTimeMicroSec = other._minValidCreationTimeMicroSec;
+            _checkedOut = other._checkedOut;
+            _waited = other._waited;
+            _waitTimeouts = other._waitTimeouts;
             verify( _created == 0 );
         }
 
@@ -52,13 +60,42 @@ namespace mongo {
         void createdOne( DBClientBase * base );
         long long numCreated() const { return _created; }
 
+        /** connections handed out, or being created, that have not come back yet */
+        int numInUse() const { return _checkedOut; }
+        int numWaiting() const { return (int)_waiters.size(); }
+        long long numWaited() const { return _waited; }
+        long long numWaitTimeouts() const { return _waitTimeouts; }
+
         ConnectionString::ConnectionType type() const { verify(_created); return _type; }
 
         /**
-         * gets a connection or return NULL
+         * Blocks until this host is below the in use cap and every caller that started waiting
+         * before this one has been served, releasing 'lk' while it waits.  Throws if that takes
+         * longer than the wait timeout.
+         * @return microseconds spent waiting
+         */
+        long long waitForFreeConnection( mongo::mutex::scoped_lock& lk );
+
+        /**
+         * gets a connection or return NULL.  Either way the caller now holds one of this host's
+         * in use slots, for the returned connection or for the one it is about to create, and
+         * gives it back with done() or decrementEgress().
          */
         DBClientBase * get( DBConnectionPool * pool , double socketTimeout );
 
+        /**
+         * Gives back an in use slot whose connection was deleted, or never created, instead of
+         * being returned with done().
+         */
+        void decrementEgress();
+
+        /**
+         * Takes in use slots for the connections needed to bring this host up to the minimum
+         * pool size.  Each is given back with done() or decrementEgress().
+         * @return the number of connections to create
+         */
+        int reserveWarmup();
+
         // Deletes all connections in the pool
         void clear();
 
@@ -87,6 +124,18 @@ namespace mongo {
 
         static void setMaxPerHost( unsigned max ) { _maxPerHost = max; }
         static unsigned getMaxPerHost() { return _maxPerHost; }
+
+        /** caps the connections to one host that are in use at once, 0 for no cap */
+        static void setMaxInUse( int max ) { _maxInUse = max; }
+        static int getMaxInUse() { return _maxInUse; }
+
+        /** how long get() waits for a connection under the in use cap, 0 to wait forever */
+        static void setWaitTimeoutMillis( int millis ) { _waitTimeoutMillis = millis; }
+        static int getWaitTimeoutMillis() { return _waitTimeoutMillis; }
+
+        /** connections the pool cleaner keeps open to each host it has been used for */
+        static void setMinPerHost( int min ) { _minPerHost = min; }
+        static int getMinPerHost() { return _minPerHost; }
     private:
 
         struct StoredConnection {
@@ -98,6 +147,8 @@ namespace mongo {
             time_t when;
         };
 
+        void _notifyNextWaiter();
+
         std::string _hostName;
         std::stack<StoredConnection> _pool;
 
@@ -105,7 +156,17 @@ namespace mongo {
         uint64_t _minValidCreationTimeMicroSec;
         ConnectionString::ConnectionType _type;
 
+        int _checkedOut;
+        long long _waited;
+        long long _waitTimeouts;
+
+        // callers blocked in waitForFreeConnection(), first come first served
+        std::list<boost::condition*> _waiters;
+
         static unsigned _maxPerHost;
+        static int _maxInUse;
+        static int _waitTimeoutMillis;
+        static int _minPerHost;
     };
 
     class DBConnectionHook {
@@ -152,6 +213,12 @@ namespace mongo {
 
         void release(const string& host, DBClientBase *c);
 
+        /**
+         * Call instead of release() when a connection from get() is deleted rather than handed
+         * back, so it stops counting against the host's in use cap.
+         */
+        void decrementEgress(const string& host, DBClientBase* c);
+
         void addHook( DBConnectionHook * hook ); // we take ownership
         void appendInfo( BSONObjBuilder& b );
 
@@ -189,6 +256,12 @@ namespace mongo {
 
         DBClientBase* _finishCreate( const string& ident , double socketTimeout, DBClientBase* conn );
 
+        /** gives back the in use slot _get() reserved for a connection that could not be made */
+        void _cancelCreate( const string& ident , double socketTimeout );
+
+        /** opens connections to hosts below the minimum pool size, outside the lock */
+        void _warmPools();
+
         struct PoolKey {
             PoolKey( const std::string& i , double t ) : ident( i ) , timeout( t ) {}
             string ident;
@@ -206,6 +279,9 @@ namespace mongo {
 
         PoolMap _pools;
 
+        // time get() callers spent waiting for the in use cap, guarded by _mutex
+        Histogram _checkoutWaitMicros;
+
         // pointers owned by me, right now they leak on shutdown
         // _hooks itself also leaks because it creates a shutdown race condition
         list<DBConnectionHook*> * _hooks;
@@ -291,6 +367,8 @@ namespace mongo {
             a bad state.  Destructor will do this too, but it is verbose.
         */
         void kill() {
+            if ( _conn )
+                pool.decrementEgress( _host, _conn );
             delete _conn;
             _conn = 0;
         }
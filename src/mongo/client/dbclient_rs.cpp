@@ -20,6 +20,7 @@
 #include "mongo/client/dbclient_rs.h"
 
 #include <fstream>
+#include <limits>
 #include <memory>
 
 #include "mongo/base/init.h"
@@ -181,14 +182,16 @@ namespace mongo {
      * @param nodes the nodes to select from
      * @param readPreferenceTag the tags to use for choosing the right node
      * @param secOnly never select a primary if true
-     * @param localThresholdMillis the exclusive upper bound of ping time to be
-     *     considered as a local node. Local nodes are favored over non-local
-     *     nodes if multiple nodes matches the other criteria.
+     * @param localThresholdMillis how much longer than the fastest eligible node's ping
+     *     time a node's may be for it to be considered local. Local nodes are picked
+     *     from in turn; others are never selected.
      * @param lastHost the last host returned (mainly used for doing round-robin).
      *     Will be overwritten with the newly returned host if not empty. Should
      *     never be NULL.
      * @param isPrimarySelected out parameter that is set to true if the returned host
      *     is a primary.
+     * @param maxStalenessMillis nodes further behind than this are not eligible; <= 0 for
+     *     no limit.
      *
      * @return the host object of the node selected. If none of the nodes are
      *     eligible, returns an empty host. Cannot be NULL and valid only if returned
@@ -199,24 +202,15 @@ namespace mongo {
                             bool secOnly,
                             int localThresholdMillis,
                             HostAndPort* lastHost /* in/out */,
-                            bool* isPrimarySelected) {
-        HostAndPort fallbackHost;
+                            bool* isPrimarySelected,
+                            int maxStalenessMillis) {
+        // First find the fastest node that could be used, so that only nodes close to it in
+        // ping time are picked from.
+        vector<bool> eligible(nodes.size(), false);
+        int fastestPingMillis = -1;
 
-        // Implicit: start from index 0 if lastHost doesn't exist anymore
-        size_t nextNodeIndex = 0;
-
-        if (!lastHost->empty()) {
-            for (size_t x = 0; x < nodes.size(); x++) {
-                if (*lastHost == nodes[x].addr) {
-                    nextNodeIndex = x;
-                    break;
-                }
-            }
-        }
-
-        for (size_t itNode = 0; itNode < nodes.size(); ++itNode) {
-            nextNodeIndex = (nextNodeIndex + 1) % nodes.size();
-            const ReplicaSetMonitor::Node& node = nodes[nextNodeIndex];
+        for (size_t i = 0; i < nodes.size(); i++) {
+            const ReplicaSetMonitor::Node& node = nodes[i];
 
             if (!node.ok) {
                 LOG(2) << "dbclient_rs not selecting " << node << ", not currently ok" << endl;
@@ -231,34 +225,60 @@ namespace mongo {
                 continue;
             }
 
-            if (node.matchesTag(readPreferenceTag)) {
-                // found an ok candidate; may not be local.
-                fallbackHost = node.addr;
-                *isPrimarySelected = node.ismaster;
+            if (!node.isFresh(maxStalenessMillis)) {
+                LOG(3) << "dbclient_rs not selecting " << node << ", lag of "
+                       << node.lagMillis << "ms exceeds maxStalenessMS of "
+                       << maxStalenessMillis << endl;
+                continue;
+            }
 
-                if (node.isLocalSecondary(localThresholdMillis)) {
-                    // found a local node.  return early.
-                    LOG(2) << "dbclient_rs selecting local secondary " << fallbackHost
-                                      << ", ping time: " << node.pingTimeMillis << endl;
-                    *lastHost = fallbackHost;
-                    return fallbackHost;
+            if (node.matchesTag(readPreferenceTag)) {
+                eligible[i] = true;
+                if (fastestPingMillis < 0 || node.pingTimeMillis < fastestPingMillis) {
+                    fastestPingMillis = node.pingTimeMillis;
                 }
             }
         }
 
-        if (!fallbackHost.empty()) {
-            *lastHost = fallbackHost;
+        if (fastestPingMillis < 0) {
+            LOG(3) << "dbclient_rs no node selected for tag " << readPreferenceTag << endl;
+            return HostAndPort();
         }
 
-        if ( fallbackHost.empty() ) {
-            LOG(3) << "dbclient_rs no node selected for tag " << readPreferenceTag << endl;
+        // Implicit: start from index 0 if lastHost doesn't exist anymore
+        size_t nextNodeIndex = 0;
+
+        if (!lastHost->empty()) {
+            for (size_t x = 0; x < nodes.size(); x++) {
+                if (*lastHost == nodes[x].addr) {
+                    nextNodeIndex = x;
+                    break;
+                }
+            }
         }
-        else {
-            LOG(3) << "dbclient_rs node " << fallbackHost << " selected for tag "
-                              << readPreferenceTag << endl;
+
+        for (size_t itNode = 0; itNode < nodes.size(); ++itNode) {
+            nextNodeIndex = (nextNodeIndex + 1) % nodes.size();
+            const ReplicaSetMonitor::Node& node = nodes[nextNodeIndex];
+
+            if (!eligible[nextNodeIndex]) {
+                continue;
+            }
+
+            if (node.pingTimeMillis == fastestPingMillis ||
+                    node.pingTimeMillis - fastestPingMillis < localThresholdMillis) {
+                LOG(2) << "dbclient_rs selecting local node " << node.addr
+                                  << " for tag " << readPreferenceTag
+                                  << ", ping time: " << node.pingTimeMillis << endl;
+                *isPrimarySelected = node.ismaster;
+                *lastHost = node.addr;
+                return node.addr;
+            }
         }
 
-        return fallbackHost;
+        // the fastest eligible node is always local
+        verify(false);
+        return HostAndPort();
     }
 
     /**
@@ -273,6 +293,9 @@ namespace mongo {
      * Format B (unofficial internal format from mongos):
      * { <actual query>, $queryOptions: { $readPreference: <read pref obj> }}
      *
+     * The read pref obj may also bound how far behind the primary a secondary can be:
+     * { mode: <mode>, tags: <tag sets>, maxStalenessMS: <positive number> }
+     *
      * @param query the raw query document
      *
      * @return the read preference setting if a read preference exists, otherwise the default read
@@ -324,6 +347,17 @@ namespace mongo {
                 uasserted(16383, str::stream() << "Unknown read preference mode: " << mode);
             }
 
+            int maxStalenessMS = 0;
+            const BSONElement& stalenessElem = prefDoc["maxStalenessMS"];
+            if (!stalenessElem.eoo()) {
+                uassert(17359, "maxStalenessMS for read preference should be a positive number",
+                        stalenessElem.isNumber() && stalenessElem.numberLong() > 0);
+                uassert(17360, "maxStalenessMS is not allowed with primary read preference",
+                        pref != mongo::ReadPreference_PrimaryOnly);
+                maxStalenessMS = static_cast<int>(std::min(stalenessElem.numberLong(),
+                        static_cast<long long>(std::numeric_limits<int>::max())));
+            }
+
             if (prefDoc.hasField(Query::ReadPrefTagsField.name())) {
                 const BSONElement& tagsElem = prefDoc[Query::ReadPrefTagsField.name()];
                 uassert(16385, "tags for read preference should be an array",
@@ -335,11 +369,11 @@ namespace mongo {
                             tags.getCurrentTag().isEmpty());
                 }
 
-                return new ReadPreferenceSetting(pref, tags);
+                return new ReadPreferenceSetting(pref, tags, maxStalenessMS);
             }
             else {
                 TagSet tags(BSON_ARRAY(BSONObj()));
-                return new ReadPreferenceSetting(pref, tags);
+                return new ReadPreferenceSetting(pref, tags, maxStalenessMS);
             }
         }
 
@@ -882,6 +916,7 @@ namespace mongo {
                 node.secondary = o["secondary"].trueValue();
                 node.ismaster = o["ismaster"].trueValue();
                 node.ok = node.secondary || node.ismaster;
+                node.opTime = o["opTime"].type() == Timestamp ? o["opTime"]._opTime() : OpTime();
 
                 node.lastIsMaster = o.copy();
             }
@@ -965,8 +1000,11 @@ namespace mongo {
                 }
             }
             
-            if ( newMaster >= 0 )
+            if ( newMaster >= 0 ) {
+                scoped_lock lk( _lock );
+                updateLag( &_nodes );
                 return;
+            }
 
             sleepsecs( 1 );
         }
@@ -983,6 +1021,7 @@ namespace mongo {
                     hasOKNode = true;
                 }
             }
+            updateLag( &_nodes );
             if (hasOKNode) {
                 _failedChecks = 0;
                 return;
@@ -1051,6 +1090,9 @@ namespace mongo {
             builder.append("hidden", node.hidden);
             builder.append("secondary", node.secondary);
             builder.append("pingTimeMillis", node.pingTimeMillis);
+            if (node.lagMillis >= 0) {
+                builder.append("lagMillis", node.lagMillis);
+            }
 
             const BSONElement& tagElem = node.lastIsMaster["tags"];
             if (tagElem.ok() && tagElem.isABSONObj()) {
@@ -1075,14 +1117,16 @@ namespace mongo {
 
     HostAndPort ReplicaSetMonitor::selectAndCheckNode(ReadPreference preference,
                                                       TagSet* tags,
-                                                      bool* isPrimarySelected) {
+                                                      bool* isPrimarySelected,
+                                                      int maxStalenessMillis) {
 
         HostAndPort candidate;
 
         {
             scoped_lock lk(_lock);
             candidate = ReplicaSetMonitor::selectNode(_nodes, preference, tags,
-                    _localThresholdMillis, &_lastReadPrefHost, isPrimarySelected);
+                    _localThresholdMillis, &_lastReadPrefHost, isPrimarySelected,
+                    maxStalenessMillis);
         }
 
         if (candidate.empty()) {
@@ -1096,7 +1140,7 @@ namespace mongo {
             tags->reset();
             scoped_lock lk(_lock);
             return ReplicaSetMonitor::selectNode(_nodes, preference, tags, _localThresholdMillis,
-                    &_lastReadPrefHost, isPrimarySelected);
+                    &_lastReadPrefHost, isPrimarySelected, maxStalenessMillis);
         }
 
         return candidate;
@@ -1108,7 +1152,8 @@ namespace mongo {
                                               TagSet* tags,
                                               int localThresholdMillis,
                                               HostAndPort* lastHost,
-                                              bool* isPrimarySelected) {
+                                              bool* isPrimarySelected,
+                                              int maxStalenessMillis) {
         *isPrimarySelected = false;
 
         switch (preference) {
@@ -1125,14 +1170,15 @@ namespace mongo {
         case ReadPreference_PrimaryPreferred:
         {
             HostAndPort candidatePri = selectNode(nodes, ReadPreference_PrimaryOnly, tags,
-                    localThresholdMillis, lastHost, isPrimarySelected);
+                    localThresholdMillis, lastHost, isPrimarySelected, maxStalenessMillis);
 
             if (!candidatePri.empty()) {
                 return candidatePri;
             }
 
             return selectNode(nodes, ReadPreference_SecondaryOnly, tags,
-                              localThresholdMillis, lastHost, isPrimarySelected);
+                              localThresholdMillis, lastHost, isPrimarySelected,
+                              maxStalenessMillis);
         }
 
         case ReadPreference_SecondaryOnly:
@@ -1141,7 +1187,7 @@ namespace mongo {
 
             while (!tags->isExhausted()) {
                 candidate = _selectNode(nodes, tags->getCurrentTag(), true, localThresholdMillis,
-                        lastHost, isPrimarySelected);
+                        lastHost, isPrimarySelected, maxStalenessMillis);
 
                 if (candidate.empty()) {
                     tags->next();
@@ -1157,14 +1203,14 @@ namespace mongo {
         case ReadPreference_SecondaryPreferred:
         {
             HostAndPort candidateSec = selectNode(nodes, ReadPreference_SecondaryOnly, tags,
-                    localThresholdMillis, lastHost, isPrimarySelected);
+                    localThresholdMillis, lastHost, isPrimarySelected, maxStalenessMillis);
 
             if (!candidateSec.empty()) {
                 return candidateSec;
             }
 
             return selectNode(nodes, ReadPreference_PrimaryOnly, tags,
-                    localThresholdMillis, lastHost, isPrimarySelected);
+                    localThresholdMillis, lastHost, isPrimarySelected, maxStalenessMillis);
         }
 
         case ReadPreference_Nearest:
@@ -1173,7 +1219,7 @@ namespace mongo {
 
             while (!tags->isExhausted()) {
                 candidate = _selectNode(nodes, tags->getCurrentTag(), false, localThresholdMillis,
-                        lastHost, isPrimarySelected);
+                        lastHost, isPrimarySelected, maxStalenessMillis);
 
                 if (candidate.empty()) {
                     tags->next();
@@ -1208,6 +1254,64 @@ namespace mongo {
         return false;
     }
 
+    bool ReplicaSetMonitor::isHostFresh(const HostAndPort& host, int maxStalenessMillis) const {
+        scoped_lock lk(_lock);
+        for (vector<Node>::const_iterator iter = _nodes.begin(); iter != _nodes.end(); ++iter) {
+            if (iter->addr == host) {
+                return iter->isFresh(maxStalenessMillis);
+            }
+        }
+
+        return false;
+    }
+
+    // static
+    void ReplicaSetMonitor::updateLag(std::vector<Node>* nodes) {
+        OpTime newest;
+        bool havePrimary = false;
+
+        for (vector<Node>::const_iterator iter = nodes->begin(); iter != nodes->end(); ++iter) {
+            if (!iter->ok || iter->opTime.isNull()) {
+                continue;
+            }
+
+            if (iter->ismaster) {
+                newest = iter->opTime;
+                havePrimary = true;
+                break;
+            }
+
+            if (newest < iter->opTime) {
+                newest = iter->opTime;
+            }
+        }
+
+        for (vector<Node>::iterator iter = nodes->begin(); iter != nodes->end(); ++iter) {
+            if (iter->ok && iter->ismaster) {
+                iter->lagMillis = 0;
+            }
+            else if (iter->opTime.isNull() || newest.isNull()) {
+                iter->lagMillis = -1;
+            }
+            else if (iter->opTime < newest) {
+                // the difference in millis overflows int after about 24 days
+                long long lag = (static_cast<long long>(newest.getSecs()) -
+                                 iter->opTime.getSecs()) * 1000;
+                iter->lagMillis = static_cast<int>(
+                        std::min(lag, static_cast<long long>(std::numeric_limits<int>::max())));
+            }
+            else {
+                // ahead of a primary that was checked earlier
+                iter->lagMillis = 0;
+            }
+        }
+
+        if (!havePrimary) {
+            LOG(3) << "dbclient_rs no primary, lag measured from newest optime "
+                   << newest.toString() << endl;
+        }
+    }
+
     void ReplicaSetMonitor::_populateHosts_inSetsLock(const vector<HostAndPort>& seedList){
         verify(_nodes.empty());
 
@@ -1346,6 +1450,8 @@ namespace mongo {
         builder.append( "isMaster", ismaster );
         builder.append( "secondary", secondary );
         builder.append( "hidden", hidden );
+        builder.append( "pingTimeMillis", pingTimeMillis );
+        builder.append( "lagMillis", lagMillis );
 
         const BSONElement& tagElem = lastIsMaster["tags"];
         if ( tagElem.ok() && tagElem.isABSONObj() ){
@@ -1533,7 +1639,19 @@ namespace mongo {
             return false;
         }
 
-        return _lastSlaveOkConn && _lastReadPref && _lastReadPref->equals(*readPref);
+        if (!_lastSlaveOkConn || !_lastReadPref || !_lastReadPref->equals(*readPref)) {
+            return false;
+        }
+
+        // the last host may have fallen too far behind since it was picked
+        if (readPref->maxStalenessMS > 0 &&
+                !monitor->isHostFresh(_lastSlaveOkHost, readPref->maxStalenessMS)) {
+            LOG(3) << "dbclient_rs last used node " << _lastSlaveOkHost
+                   << " is more than " << readPref->maxStalenessMS << "ms behind" << endl;
+            return false;
+        }
+
+        return true;
     }
 
     void DBClientReplicaSet::_auth( DBClientConnection * conn ) {
@@ -1860,7 +1978,7 @@ namespace mongo {
         ReplicaSetMonitorPtr monitor = _getMonitor();
         bool isPrimarySelected = false;
         _lastSlaveOkHost = monitor->selectAndCheckNode(readPref->pref, &readPref->tags,
-                &isPrimarySelected);
+                &isPrimarySelected, readPref->maxStalenessMS);
 
         if ( _lastSlaveOkHost.empty() ){
 
@@ -2254,6 +2372,8 @@ namespace mongo {
         BSONObjBuilder bob;
         bob.append( "pref", readPrefToString( pref ) );
         bob.append( "tags", tags.getTagBSON() );
+        if ( maxStalenessMS > 0 )
+            bob.append( "maxStalenessMS", maxStalenessMS );
         return bob.obj();
     }
 }
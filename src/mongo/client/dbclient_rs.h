@@ -24,6 +24,7 @@
 #include <set>
 #include <utility>
 
+#include "mongo/bson/optime.h"
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/client/export_macros.h"
 #include "mongo/util/net/hostandport.h"
@@ -63,7 +64,8 @@ namespace mongo {
                 ismaster(false),
                 secondary( false ),
                 hidden( false ),
-                pingTimeMillis( 0 ) {
+                pingTimeMillis( 0 ),
+                lagMillis( -1 ) {
             }
 
             bool okForSecondaryQueries() const {
@@ -99,6 +101,16 @@ namespace mongo {
                 return pingTimeMillis < threshold;
             }
 
+            /**
+             * @param maxStalenessMillis how far behind the primary a node may be, <= 0 for
+             *     no limit
+             * @return true if this node is known to be no more than maxStalenessMillis behind
+             */
+            bool isFresh( int maxStalenessMillis ) const {
+                return maxStalenessMillis <= 0 || ( lagMillis >= 0 &&
+                                                    lagMillis <= maxStalenessMillis );
+            }
+
             /**
              * Checks whether this nodes is compatible with the given readPreference and
              * tag. Compatibility check is strict in the sense that secondary preferred
@@ -130,8 +142,17 @@ namespace mongo {
             bool secondary;
             bool hidden;
 
+            // moving average of the time taken by ismaster
             int pingTimeMillis;
 
+            // the last op this node had written, as reported by ismaster.  Null if the node
+            // doesn't report it.
+            OpTime opTime;
+
+            // how far opTime was behind the primary's (or the newest of any node's, with no
+            // primary) at the last check of the set; -1 if unknown
+            int lagMillis;
+
         };
 
         static const double SOCKET_TIMEOUT_SECS;
@@ -152,6 +173,8 @@ namespace mongo {
          *     is not Nearest.
          * @param isPrimarySelected out parameter that is set to true if the returned host
          *     is a primary. Cannot be NULL and valid only if returned host is not empty.
+         * @param maxStalenessMillis nodes whose lagMillis is greater than this, or unknown,
+         *     are not selected; <= 0 for no limit.
          *
          * @return the host object of the node selected. If none of the nodes are
          *     eligible, returns an empty host.
@@ -161,7 +184,15 @@ namespace mongo {
                                       TagSet* tags,
                                       int localThresholdMillis,
                                       HostAndPort* lastHost,
-                                      bool* isPrimarySelected);
+                                      bool* isPrimarySelected,
+                                      int maxStalenessMillis = 0);
+
+        /**
+         * Sets lagMillis of each of the nodes from their opTimes, relative to the ok primary's
+         * or, if there isn't one, to the newest reported.  Nodes that don't report an opTime
+         * get -1, except for the primary, which is never behind.
+         */
+        static void updateLag(std::vector<Node>* nodes);
 
         /**
          * Selects the right node given the nodes to pick from and the preference. This
@@ -173,13 +204,16 @@ namespace mongo {
          * @param tags the tags used for filtering nodes.
          * @param isPrimarySelected out parameter that is set to true if the returned host
          *     is a primary. Cannot be NULL and valid only if returned host is not empty.
+         * @param maxStalenessMillis secondaries further than this behind the primary are not
+         *     selected; <= 0 for no limit.
          *
          * @return the host object of the node selected. If none of the nodes are
          *     eligible, returns an empty host.
          */
         HostAndPort selectAndCheckNode(ReadPreference preference,
                                        TagSet* tags,
-                                       bool* isPrimarySelected);
+                                       bool* isPrimarySelected,
+                                       int maxStalenessMillis = 0);
 
         /**
          * Creates a new ReplicaSetMonitor, if it doesn't already exist.
@@ -282,6 +316,12 @@ namespace mongo {
         bool isHostCompatible(const HostAndPort& host, ReadPreference readPreference,
                 const TagSet* tagSet) const;
 
+        /**
+         * @return true if the host was no more than maxStalenessMillis behind the primary at
+         *     the last check.
+         */
+        bool isHostFresh(const HostAndPort& host, int maxStalenessMillis) const;
+
         /**
          * Performs a quick check if at least one node is up based on the cached
          * view of the set.
@@ -721,17 +761,22 @@ namespace mongo {
          *     object's copy of tag will have the iterator in the initial
          *     position).
          */
-        ReadPreferenceSetting(ReadPreference pref, const TagSet& tag):
-            pref(pref), tags(tag) {
+        ReadPreferenceSetting(ReadPreference pref, const TagSet& tag,
+                              int maxStalenessMS = 0):
+            pref(pref), tags(tag), maxStalenessMS(maxStalenessMS) {
         }
 
         inline bool equals(const ReadPreferenceSetting& other) const {
-            return pref == other.pref && tags.equals(other.tags);
+            return pref == other.pref && tags.equals(other.tags) &&
+                    maxStalenessMS == other.maxStalenessMS;
         }
 
         BSONObj toBSON() const;
 
         const ReadPreference pref;
         TagSet tags;
+
+        // secondaries further behind the primary than this aren't read from; 0 for no limit
+        const int maxStalenessMS;
     };
 }
@@ -127,18 +127,30 @@ namespace mongo {
     void DBClientCursor::requestMore() {
         verify( cursorId && batch.pos == batch.nReturned );
 
+        if ( _prefetchConn ) {
+            // The getMore already went out in prefetchMore(), only the reply is left to read
+            scoped_ptr<AScopedConnection> conn( _prefetchConn );
+            _prefetchConn = 0;
+
+            auto_ptr<Message> response(new Message());
+            if ( !conn->get()->recv( *response ) ) {
+                uasserted( 17362, "recv failed while receiving prefetched getMore" );
+            }
+            _client = conn->get();
+            this->batch.m = response;
+            dataReceived();
+            _client = 0;
+            conn->done();
+            return;
+        }
+
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
 
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        _assembleGetMore( toSend );
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -158,6 +170,33 @@ namespace mongo {
         }
     }
 
+    void DBClientCursor::_assembleGetMore( Message& toSend ) {
+        BufBuilder b;
+        b.appendNum(opts);
+        b.appendStr(ns);
+        b.appendNum(nextBatchSize());
+        b.appendNum(cursorId);
+        toSend.setData(dbGetMore, b.buf(), b.len());
+    }
+
+    void DBClientCursor::prefetchMore() {
+        if ( _prefetchConn || !cursorId || _client || _scopedHost.empty() || haveLimit )
+            return;
+        if ( opts & ( QueryOption_CursorTailable | QueryOption_Exhaust ) )
+            return;
+
+        auto_ptr<ScopedDbConnection> conn( new ScopedDbConnection( _scopedHost ) );
+        if ( !conn->get()->lazySupported() ) {
+            conn->done();
+            return;
+        }
+
+        Message toSend;
+        _assembleGetMore( toSend );
+        conn->get()->say( toSend );
+        _prefetchConn = conn.release();
+    }
+
     /** with QueryOption_Exhaust, the server just blasts data at us (marked at end with cursorid==0). */
     void DBClientCursor::exhaustReceiveMore() {
         verify( cursorId && batch.pos == batch.nReturned );
@@ -322,6 +361,24 @@ namespace mongo {
 
         DESTRUCTOR_GUARD (
 
+        // Read the reply to an outstanding prefetched getMore first, so the connection can carry
+        // the killCursors and go back to the pool, rather than staying checked out while
+        // another connection to the same host is taken for the killCursors.
+        scoped_ptr<AScopedConnection> prefetchConn( _prefetchConn );
+        _prefetchConn = 0;
+        if ( prefetchConn ) {
+            Message reply;
+            if ( !prefetchConn->get()->recv( reply ) ) {
+                // Not returned to the pool, the connection is in an unknown state
+                prefetchConn.reset();
+            }
+            else if ( reply.singleData()->operation() == opReply &&
+                      ((QueryResult*) reply.singleData())->cursorId == 0 ) {
+                // That batch was the last, the server has closed the cursor itself
+                cursorId = 0;
+            }
+        }
+
         if ( cursorId && _ownCursor && ! inShutdown() ) {
             BufBuilder b;
             b.appendNum( (int)0 ); // reserved
@@ -340,6 +397,12 @@ namespace mongo {
                     _client->say( m );
 
             }
+            else if ( prefetchConn ) {
+                if( DBClientConnection::getLazyKillCursor() )
+                    prefetchConn->get()->sayPiggyBack( m );
+                else
+                    prefetchConn->get()->say( m );
+            }
             else {
                 verify( _scopedHost.size() );
                 ScopedDbConnection conn(_scopedHost);
@@ -353,6 +416,9 @@ namespace mongo {
             }
         }
 
+        if ( prefetchConn )
+            prefetchConn->done();
+
         );
     }
 
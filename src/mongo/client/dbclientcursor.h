@@ -133,6 +133,19 @@ namespace mongo {
         /// Change batchSize after construction. Can change after requesting first batch.
         void setBatchSize(int newBatchSize) { batchSize = newBatchSize; }
 
+        /**
+         * Sends the getMore for the batch after the current one without waiting for the reply,
+         * so the next batch is on its way while the current one is consumed.  The reply is read
+         * by the more() call that exhausts the current batch.  Only cursors that were attach()ed
+         * to a pooled connection are prefetched; limited, tailable and exhaust cursors and
+         * cursors with a getMore already outstanding are left alone.  A cursor with a prefetch
+         * outstanding must not be decouple()d.
+         */
+        void prefetchMore();
+
+        /** true if a getMore sent by prefetchMore() has not been read yet */
+        bool prefetchPending() const { return _prefetchConn != 0; }
+
         DBClientCursor( DBClientBase* client, const string &_ns, BSONObj _query, int _nToReturn,
                         int _nToSkip, const BSONObj *_fieldsToReturn, int queryOptions , int bs ) :
             _client(client),
@@ -147,7 +160,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(),
             _ownCursor( true ),
-            wasError( false ) {
+            wasError( false ),
+            _prefetchConn( 0 ) {
             _finishConsInit();
         }
 
@@ -163,7 +177,8 @@ namespace mongo {
             resultFlags(0),
             cursorId(_cursorId),
             _ownCursor(true),
-            wasError(false) {
+            wasError(false),
+            _prefetchConn(0) {
             _finishConsInit();
         }
 
@@ -237,11 +252,13 @@ namespace mongo {
         string _scopedHost;
         string _lazyHost;
         bool wasError;
+        AScopedConnection* _prefetchConn; // owned; holds the getMore sent by prefetchMore()
 
         void dataReceived() { bool retry; string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, string& lazyHost );
         void requestMore();
         void exhaustReceiveMore(); // for exhaust
+        void _assembleGetMore( Message& toSend );
 
         // Don't call from a virtual function
         void _assertIfNull() const { uassert(13348, "connection died", this); }
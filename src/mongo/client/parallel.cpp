@@ -290,6 +290,7 @@ namespace mongo {
         _numServers = _servers.size();
         _lastFrom = 0;
         _cursors = 0;
+        _mergeHeapReady = false;
 
         if( ! _qSpec.isEmpty() ){
 
@@ -1469,6 +1470,11 @@ namespace mongo {
             _needToSkip = n;
         }
 
+        if ( ! _sortKey.isEmpty() ) {
+            _buildMergeHeap();
+            return ! _mergeHeap.empty();
+        }
+
         for ( int i=0; i<_numServers; i++ ) {
             if ( _cursors[i].more() )
                 return true;
@@ -1476,7 +1482,83 @@ namespace mongo {
         return false;
     }
 
+    namespace {
+
+        /**
+         * Orders server indexes so the one whose next result sorts first is on top of the heap.
+         * Ties go to the lower index, which keeps the merge order stable.
+         */
+        class MergeHeapCompare {
+        public:
+            MergeHeapCompare( FilteringClientCursor* cursors, const BSONObj& sortKey )
+                : _cursors( cursors ), _sortKey( sortKey ) {
+            }
+
+            bool operator()( int a, int b ) const {
+                int comp = _cursors[a].peek().woSortOrder( _cursors[b].peek(), _sortKey, true );
+                if ( comp != 0 )
+                    return comp > 0;
+                return a > b;
+            }
+
+        private:
+            FilteringClientCursor* _cursors;
+            const BSONObj& _sortKey;
+        };
+
+    } // namespace
+
+    void ParallelSortClusteredCursor::_buildMergeHeap() {
+        if ( _mergeHeapReady )
+            return;
+        _mergeHeapReady = true;
+
+        _mergeHeap.clear();
+        for ( int i = 0; i < _numServers; i++ ) {
+            if ( _cursors[i].more() ) {
+                _mergeHeap.push_back( i );
+            }
+            else if ( _cursors[i].rawMData() ) {
+                _cursors[i].rawMData()->pcState->done = true;
+            }
+        }
+        make_heap( _mergeHeap.begin(), _mergeHeap.end(), MergeHeapCompare( _cursors, _sortKey ) );
+    }
+
+    BSONObj ParallelSortClusteredCursor::_nextMerged() {
+        _buildMergeHeap();
+        uassert( 10019 ,  "no more elements" , ! _mergeHeap.empty() );
+
+        MergeHeapCompare compare( _cursors, _sortKey );
+        pop_heap( _mergeHeap.begin(), _mergeHeap.end(), compare );
+        int from = _mergeHeap.back();
+        _mergeHeap.pop_back();
+
+        BSONObj best = _cursors[from].next();
+        _lastFrom = from;
+
+        if( _cursors[from].rawMData() )
+            _cursors[from].rawMData()->pcState->count++;
+
+        if ( _cursors[from].more() ) {
+            _mergeHeap.push_back( from );
+            push_heap( _mergeHeap.begin(), _mergeHeap.end(), compare );
+        }
+        else if ( _cursors[from].rawMData() ) {
+            _cursors[from].rawMData()->pcState->done = true;
+        }
+
+        // Get the next batch from this server on its way while the others are merged
+        if ( _cursors[from].raw() )
+            _cursors[from].raw()->prefetchMore();
+
+        return best;
+    }
+
     BSONObj ParallelSortClusteredCursor::next() {
+        if ( ! _sortKey.isEmpty() )
+            return _nextMerged();
+
         BSONObj best = BSONObj();
         int bestFrom = -1;
 
@@ -1518,6 +1600,9 @@ namespace mongo {
         if( _cursors[bestFrom].rawMData() )
             _cursors[bestFrom].rawMData()->pcState->count++;
 
+        if ( _cursors[bestFrom].raw() )
+            _cursors[bestFrom].raw()->prefetchMore();
+
         return best;
     }
 
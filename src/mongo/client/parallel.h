@@ -231,6 +231,14 @@ namespace mongo {
         FilteringClientCursor * _cursors;
         int _needToSkip;
 
+        // Indexes into _cursors of the servers with results left, kept as a heap on each
+        // server's next result when there is a sort so next() does not rescan every server
+        vector<int> _mergeHeap;
+        bool _mergeHeapReady;
+
+        void _buildMergeHeap();
+        BSONObj _nextMerged();
+
         /**
          * Setups the shard version of the connection. When using a replica
          * set connection and the primary cannot be reached, the version
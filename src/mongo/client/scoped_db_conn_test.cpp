@@ -24,6 +24,7 @@
 #include "mongo/unittest/unittest.h"
 
 #include <vector>
+#include <boost/bind.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread/thread.hpp>
 
@@ -194,6 +195,8 @@ namespace mongo_test {
     public:
         void setUp() {
             _maxPoolSizePerHost = mongo::PoolForHost::getMaxPerHost();
+            _maxInUsePerHost = mongo::PoolForHost::getMaxInUse();
+            _waitTimeoutMillis = mongo::PoolForHost::getWaitTimeoutMillis();
             _dummyServer = new DummyServer(TARGET_PORT);
 
             _dummyServer->run(&dummyHandler);
@@ -218,6 +221,8 @@ namespace mongo_test {
             delete _dummyServer;
 
             mongo::PoolForHost::setMaxPerHost(_maxPoolSizePerHost);
+            mongo::PoolForHost::setMaxInUse(_maxInUsePerHost);
+            mongo::PoolForHost::setWaitTimeoutMillis(_waitTimeoutMillis);
         }
 
     protected:
@@ -279,8 +284,15 @@ namespace mongo_test {
 
         DummyServer* _dummyServer;
         uint32_t _maxPoolSizePerHost;
+        int _maxInUsePerHost;
+        int _waitTimeoutMillis;
     };
 
+    void releaseAfter(ScopedDbConnection* conn, int millis) {
+        mongo::sleepmillis(millis);
+        conn->done();
+    }
+
     TEST_F(DummyServerFixture, BasicScopedDbConnection) {
         ScopedDbConnection conn1(TARGET_HOST);
         ScopedDbConnection conn2(TARGET_HOST);
@@ -402,4 +414,51 @@ namespace mongo_test {
 
         conn1Again.done();
     }
+
+    TEST_F(DummyServerFixture, MaxInUseTimesOut) {
+        mongo::PoolForHost::setMaxInUse(2);
+        mongo::PoolForHost::setWaitTimeoutMillis(100);
+
+        ScopedDbConnection conn1(TARGET_HOST);
+        ScopedDbConnection conn2(TARGET_HOST);
+
+        ASSERT_THROWS(ScopedDbConnection conn3(TARGET_HOST), mongo::UserException);
+
+        conn1.done();
+        ScopedDbConnection conn3(TARGET_HOST);
+
+        conn2.done();
+        conn3.done();
+    }
+
+    TEST_F(DummyServerFixture, KilledConnFreesInUseSlot) {
+        mongo::PoolForHost::setMaxInUse(1);
+        mongo::PoolForHost::setWaitTimeoutMillis(100);
+
+        {
+            ScopedDbConnection conn1(TARGET_HOST);
+            conn1.kill();
+        }
+
+        ScopedDbConnection conn2(TARGET_HOST);
+        conn2.done();
+    }
+
+    TEST_F(DummyServerFixture, WaiterGetsReleasedConn) {
+        mongo::PoolForHost::setMaxInUse(1);
+        mongo::PoolForHost::setWaitTimeoutMillis(10 * 1000);
+
+        ScopedDbConnection conn1(TARGET_HOST);
+        DBClientBase* conn1Ptr = conn1.get();
+
+        boost::thread releaser(boost::bind(releaseAfter, &conn1, 100));
+
+        mongo::Timer timer;
+        ScopedDbConnection conn2(TARGET_HOST);
+        releaser.join();
+
+        ASSERT_GREATER_THAN_OR_EQUALS(timer.millis(), 50);
+        ASSERT_EQUALS(conn1Ptr, conn2.get());
+        conn2.done();
+    }
 }
@@ -41,7 +41,10 @@
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/storage/extent.h"
 #include "mongo/db/storage/extent_manager.h"
+#include "mongo/db/storage_options.h"
 #include "mongo/db/structure/collection_iterator.h"
+#include "mongo/db/structure/record_store_compressed.h"
+#include "mongo/db/structure/record_store_heap.h"
 
 #include "mongo/db/pdfile.h" // XXX-ERH
 #include "mongo/db/auth/user_document_parser.h" // XXX-ANDY
@@ -73,14 +76,29 @@ namespace mongo {
                             NamespaceDetails* details,
                             Database* database )
         : _ns( fullNS ),
-          _recordStore( _ns.ns() ),
           _infoCache( this ),
           _indexCatalog( this, details ) {
         _details = details;
         _database = database;
-        _recordStore.init( _details,
-                           &database->getExtentManager(),
-                           _ns.coll() == "system.indexes" );
+        if ( _details->isSystemFlagSet( NamespaceDetails::Flag_Compressed ) ) {
+            CompressedRecordStore* recordStore = new CompressedRecordStore( _ns.ns() );
+            recordStore->init( _details, &database->getExtentManager(), false );
+            _recordStore.reset( recordStore );
+        }
+        else if ( storageGlobalParams.heapRecordStore &&
+             !_details->isCapped() &&
+             _ns.isNormal() &&
+             !_ns.isSystem() &&
+             _ns.db() != "local" ) {
+            _recordStore.reset( new HeapRecordStore( _ns.ns(), _details ) );
+        }
+        else {
+            ExtentRecordStore* recordStore = new ExtentRecordStore( _ns.ns() );
+            recordStore->init( _details,
+                               &database->getExtentManager(),
+                               _ns.coll() == "system.indexes" );
+            _recordStore.reset( recordStore );
+        }
         _magic = 1357924;
         _indexCatalog.init();
     }
@@ -121,9 +139,7 @@ namespace mongo {
     CollectionIterator* Collection::getIterator( const DiskLoc& start, bool tailable,
                                                      const CollectionScanParams::Direction& dir) const {
         verify( ok() );
-        if ( _details->isCapped() )
-            return new CappedIterator( this, start, tailable, dir );
-        return new FlatIterator( this, start, dir );
+        return _recordStore->getIterator( this, start, tailable, dir );
     }
 
     int64_t Collection::countTableScan( const MatchExpression* expression ) {
@@ -142,14 +158,13 @@ namespace mongo {
     }
 
     BSONObj Collection::docFor( const DiskLoc& loc ) {
-        Record* rec = getExtentManager()->recordFor( loc );
-        return BSONObj::make( rec->accessed() );
+        return _recordStore->docFor( loc );
     }
 
     StatusWith<DiskLoc> Collection::insertDocument( const DocWriter* doc, bool enforceQuota ) {
         verify( _indexCatalog.numIndexesTotal() == 0 ); // eventually can implement, just not done
 
-        StatusWith<DiskLoc> loc = _recordStore.insertRecord( doc,
+        StatusWith<DiskLoc> loc = _recordStore->insertRecord( doc,
                                                              enforceQuota ? largestFileNumberInQuota() : 0 );
         if ( !loc.isOK() )
             return loc;
@@ -186,14 +201,12 @@ namespace mongo {
         //       under the RecordStore, this feels broken since that should be a
         //       collection access method probably
 
-        StatusWith<DiskLoc> loc = _recordStore.insertRecord( docToInsert.objdata(),
+        StatusWith<DiskLoc> loc = _recordStore->insertRecord( docToInsert.objdata(),
                                                              docToInsert.objsize(),
                                                             enforceQuota ? largestFileNumberInQuota() : 0 );
         if ( !loc.isOK() )
             return loc;
 
-        _infoCache.notifyOfWriteOp();
-
         try {
             _indexCatalog.indexRecord( docToInsert, loc.getValue() );
         }
@@ -207,7 +220,7 @@ namespace mongo {
 
             // indexRecord takes care of rolling back indexes
             // so we just have to delete the main storage
-            _recordStore.deleteRecord( loc.getValue() );
+            _recordStore->deleteRecord( loc.getValue() );
             return StatusWith<DiskLoc>( e.toStatus( "insertDocument" ) );
         }
 
@@ -236,9 +249,7 @@ namespace mongo {
 
         _indexCatalog.unindexRecord( doc, loc, noWarn);
 
-        _recordStore.deleteRecord( loc );
-
-        _infoCache.notifyOfWriteOp();
+        _recordStore->deleteRecord( loc );
     }
 
     Counter64 moveCounter;
@@ -249,8 +260,7 @@ namespace mongo {
                                                     bool enforceQuota,
                                                     OpDebug* debug ) {
 
-        Record* oldRecord = getExtentManager()->recordFor( oldLocation );
-        BSONObj objOld = BSONObj::make( oldRecord );
+        BSONObj objOld = _recordStore->docFor( oldLocation );
 
         if ( objOld.hasElement( "_id" ) ) {
             BSONElement oldId = objOld["_id"];
@@ -291,7 +301,7 @@ namespace mongo {
             }
         }
 
-        if ( oldRecord->netLength() < objNew.objsize() ) {
+        if ( !_recordStore->canUpdateInPlace( oldLocation, objNew.objsize() ) ) {
             // doesn't fit, have to move to new location
 
             if ( _details->isCapped() )
@@ -320,7 +330,7 @@ namespace mongo {
             if ( loc.isOK() ) {
                 // insert successful, now lets deallocate the old location
                 // remember its already unindexed
-                _recordStore.deleteRecord( oldLocation );
+                _recordStore->deleteRecord( oldLocation );
             }
             else {
                 // new doc insert failed, so lets re-index the old document and location
@@ -330,7 +340,6 @@ namespace mongo {
             return loc;
         }
 
-        _infoCache.notifyOfWriteOp();
         _details->paddingFits();
 
         if ( debug )
@@ -353,12 +362,21 @@ namespace mongo {
         ClientCursor::invalidateDocument(_ns.ns(), _details, oldLocation, INVALIDATION_MUTATION);
 
         //  update in place
-        int sz = objNew.objsize();
-        memcpy(getDur().writingPtr(oldRecord->data(), sz), objNew.objdata(), sz);
+        _recordStore->updateRecord( oldLocation, objNew.objdata(), objNew.objsize() );
 
         return StatusWith<DiskLoc>( oldLocation );
     }
 
+    bool Collection::canUpdateInPlace( const DiskLoc& loc, int len ) const {
+        return _recordStore->canUpdateInPlace( loc, len );
+    }
+
+    void Collection::updateDocumentWithDamages( const DiskLoc& loc,
+                                                const char* damangeSource,
+                                                const mutablebson::DamageVector& damages ) {
+        _recordStore->updateWithDamages( loc, damangeSource, damages );
+    }
+
     int64_t Collection::storageSize( int* numExtents, BSONArrayBuilder* extentInfo ) const {
         if ( _details->firstExtent().isNull() ) {
             if ( numExtents )
@@ -421,6 +439,11 @@ namespace mongo {
         return _details->isCapped();
     }
 
+    bool Collection::documentsAreExtentRecords() const {
+        return _recordStore->usesExtents() &&
+            !_details->isSystemFlagSet( NamespaceDetails::Flag_Compressed );
+    }
+
     uint64_t Collection::numRecords() const {
         return _details->numRecords();
     }
@@ -33,6 +33,7 @@
 #include <string>
 
 #include "mongo/base/string_data.h"
+#include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/exec/collection_scan_common.h"
@@ -168,6 +169,19 @@ namespace mongo {
                                             bool enforceQuota,
                                             OpDebug* debug );
 
+        /**
+         * @return true if the document at loc can be rewritten with len bytes without moving
+         */
+        bool canUpdateInPlace( const DiskLoc& loc, int len ) const;
+
+        /**
+         * applies damages, computed against the current version of the document at loc and
+         * with source bytes taken from damangeSource, in place
+         */
+        void updateDocumentWithDamages( const DiskLoc& loc,
+                                        const char* damangeSource,
+                                        const mutablebson::DamageVector& damages );
+
         int64_t storageSize( int* numExtents = NULL, BSONArrayBuilder* extentInfo = NULL ) const;
 
         // -----------
@@ -189,6 +203,12 @@ namespace mongo {
 
         bool isCapped() const;
 
+        /**
+         * @return true if every document is a record of its own chained through the
+         *     collection's extents, so the extents can be walked without an iterator
+         */
+        bool documentsAreExtentRecords() const;
+
         uint64_t numRecords() const;
 
         uint64_t dataSize() const;
@@ -223,7 +243,7 @@ namespace mongo {
         NamespaceString _ns;
         NamespaceDetails* _details;
         Database* _database;
-        RecordStore _recordStore;
+        scoped_ptr<RecordStore> _recordStore;
         CollectionInfoCache _infoCache;
         IndexCatalog _indexCatalog;
 
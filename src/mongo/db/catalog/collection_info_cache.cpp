@@ -76,9 +76,21 @@ namespace mongo {
 
     }
 
-    void CollectionInfoCache::notifyOfWriteOp() {
+    void CollectionInfoCache::addedIndex( const BSONObj& keyPattern ) {
+        _keysComputed = false;
+        if (NULL != _planCache.get()) {
+            _planCache->notifyOfIndexAdded(keyPattern);
+        }
+    }
+
+    void CollectionInfoCache::droppedIndex( const BSONObj& keyPattern ) {
+        _keysComputed = false;
+        changedIndex( keyPattern );
+    }
+
+    void CollectionInfoCache::changedIndex( const BSONObj& keyPattern ) {
         if (NULL != _planCache.get()) {
-            _planCache->notifyOfWriteOp();
+            _planCache->notifyOfIndexChanged(keyPattern);
         }
     }
 
@@ -82,14 +82,24 @@ namespace mongo {
         // ---------------------
 
         /**
-         * Called when an index is added to this collection.
+         * Called when an index is added to this collection.  Only cached plans for queries
+         * that could use the new index are dropped.
          */
-        void addedIndex() { reset(); }
+        void addedIndex( const BSONObj& keyPattern );
 
-        void clearQueryCache();
+        /**
+         * Called when an index is dropped from this collection.  Cached plans that use it are
+         * dropped.
+         */
+        void droppedIndex( const BSONObj& keyPattern );
 
-        /* you must notify the cache if you are doing writes, as query plan utility will change */
-        void notifyOfWriteOp();
+        /**
+         * Called when an existing index changes in a way that matters to planning, such as
+         * becoming multikey.  Cached plans that use it are dropped.
+         */
+        void changedIndex( const BSONObj& keyPattern );
+
+        void clearQueryCache();
 
     private:
 
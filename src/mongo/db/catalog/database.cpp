@@ -398,6 +398,10 @@ namespace mongo {
     Status Database::renameCollection( const StringData& fromNS, const StringData& toNS,
                                        bool stayTemp ) {
 
+        Collection* fromCollection = getCollection( fromNS );
+        if ( fromCollection && !fromCollection->_recordStore->usesExtents() )
+            return Status( ErrorCodes::IllegalOperation, "cannot rename in memory collection" );
+
         // move data namespace
         Status s = _renameSingleNamespace( fromNS, toNS, stayTemp );
         if ( !s.isOK() )
@@ -569,7 +573,14 @@ namespace mongo {
 
         audit::logCreateCollection( currentClient.get(), ns );
 
+        // decides the collection's record store, so it can only be chosen at creation
+        const bool compressed = options && options->getField( "compressed" ).trueValue();
+        uassert( 17353, "capped collections can't be compressed", !( compressed && capped ) );
+
         _namespaceIndex.add_ns( ns, DiskLoc(), capped );
+        if ( compressed )
+            _namespaceIndex.details( ns )->setSystemFlag( NamespaceDetails::Flag_Compressed );
+
         _addNamespaceToCatalog( ns, options );
 
         // TODO: option for: allocation, indexes?
@@ -127,7 +127,7 @@ namespace mongo {
                  str::stream() << "no NamespaceDetails for index: " << descriptor->toString(),
                  indexMetadata );
 
-        auto_ptr<RecordStore> recordStore( new RecordStore( descriptor->indexNamespace() ) );
+        auto_ptr<ExtentRecordStore> recordStore( new ExtentRecordStore( descriptor->indexNamespace() ) );
         recordStore->init( indexMetadata, _collection->getExtentManager(), false );
 
         auto_ptr<IndexCatalogEntry> entry( new IndexCatalogEntry( _collection,
@@ -484,7 +484,7 @@ namespace mongo {
         getDur().writingInt( nsd->_indexBuildsInProgress ) -= 1;
         getDur().writingInt( nsd->_nIndexes ) += 1;
 
-        _catalog->_collection->infoCache()->addedIndex();
+        _catalog->_collection->infoCache()->addedIndex( _entry->descriptor()->keyPattern() );
 
         IndexDescriptor* desc = _catalog->findIndexByName( _indexName, true );
         fassert( 17330, desc );
@@ -810,8 +810,8 @@ namespace mongo {
         // TODO: can this can only clear cursors on this index?
         ClientCursor::invalidate( _collection->ns().ns() );
 
-        // wipe out stats
-        _collection->infoCache()->reset();
+        // forget cached plans that use this index
+        _collection->infoCache()->droppedIndex( entry->descriptor()->keyPattern() );
 
         string indexNamespace = entry->descriptor()->indexNamespace();
         string indexName = entry->descriptor()->indexName();
@@ -1258,7 +1258,7 @@ namespace mongo {
             // note (one day) we may be able to fresh build less versions than we can use
             // isASupportedIndexVersionNumber() is what we can use
             uassert(14803, str::stream() << "this version of mongod cannot build new indexes of version number " << vv, 
-                    vv == 0 || vv == 1);
+                    vv == 0 || vv == 1 || vv == 2);
             v = (int) vv;
         }
         // idea is to put things we use a lot earlier
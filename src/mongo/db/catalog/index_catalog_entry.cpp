@@ -104,7 +104,7 @@ namespace mongo {
         NamespaceDetails* nsd = _collection->details();
         int idxNo = _indexNo();
         if ( nsd->setIndexIsMultikey( idxNo, true ) )
-            _collection->infoCache()->clearQueryCache();
+            _collection->infoCache()->changedIndex( _descriptor->keyPattern() );
         _isMultikey = true;
     }
 
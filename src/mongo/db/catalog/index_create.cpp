@@ -46,10 +46,15 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/processinfo.h"
 
 namespace mongo {
 
+    // Threads generating and sorting keys for a foreground index build.  0 means one per core,
+    // 1 builds serially.
+    MONGO_EXPORT_SERVER_PARAMETER(indexBuildThreads, int, 0);
+
     /**
      * Add the provided (obj, dl) pair to the provided index.
      */
@@ -203,7 +208,7 @@ namespace mongo {
         verify( Lock::isWriteLocked( ns ) );
         // this is so that people know there are more keys to look at when doing
         // things like in place updates, etc...
-        collection->infoCache()->addedIndex();
+        collection->infoCache()->addedIndex( idx->keyPattern() );
 
         if ( collection->numRecords() == 0 ) {
             Status status = btreeState->accessMethod()->initializeAsEmpty();
@@ -239,16 +244,34 @@ namespace mongo {
         if ( bulk )
             log() << "\t building index using bulk method";
 
-        unsigned long long n = addExistingToIndex( collection,
-                                                   btreeState->descriptor(),
-                                                   iam,
-                                                   doInBackground );
+        // Dropping dups while generating keys needs documents to be added one at a time, and the
+        // threads read documents straight from the extents, which only works when each
+        // document is a record there (not for compressed or heap collections).
+        int threads = indexBuildThreads > 0 ? indexBuildThreads : ProcessInfo().getNumCores();
+        bool parallel = bulk && threads > 1 && !idx->dropDups() &&
+            collection->documentsAreExtentRecords();
+
+        unsigned long long n;
+        if ( parallel ) {
+            log() << "\t generating keys on " << threads << " threads";
+            uassertStatusOK( bulk->insertAllParallel( collection, threads, mayInterrupt, &n ) );
+        }
+        else {
+            n = addExistingToIndex( collection,
+                                    btreeState->descriptor(),
+                                    iam,
+                                    doInBackground );
+        }
+        int keysMillis = t.millis();
 
         if ( bulk ) {
             LOG(1) << "\t bulk commit starting";
             std::set<DiskLoc> dupsToDrop;
 
             btreeState->accessMethod()->commitBulk( bulk, mayInterrupt, &dupsToDrop );
+            MONGO_TLOG(0) << "\t generating keys took " << keysMillis / 1000.0 << " secs, "
+                          << "building the btree " << ( t.millis() - keysMillis ) / 1000.0
+                          << " secs" << endl;
 
             if ( dupsToDrop.size() )
                 log() << "\t bulk dropping " << dupsToDrop.size() << " dups";
@@ -272,7 +295,7 @@ namespace mongo {
                       << t.millis() / 1000.0 << " secs" << endl;
 
         // this one is so people know that the index is finished
-        collection->infoCache()->addedIndex();
+        collection->infoCache()->addedIndex( idx->keyPattern() );
     }
 
 }  // namespace mongo
@@ -41,6 +41,7 @@
 
 #include "mongo/base/status.h"
 #include "mongo/bson/mutable/document.h"
+#include "mongo/client/dbclientinterface.h"
 #include "mongo/db/auth/action_set.h"
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager_global.h"
@@ -107,6 +108,8 @@ namespace mongo {
         static void check(StringData tname) {
             static int max;
             StackChecker *sc = checker.get();
+            if ( ! sc )
+                return; // client was set up on another thread, see ConnectionThreadState
             const char *p = sc->buf;
 
             int lastStackByteModifed = 0;
@@ -231,6 +234,14 @@ namespace mongo {
         }
     }
 
+    void Client::setCopydbAuthConn( DBClientBase* conn ) {
+        _copydbAuthConn.reset( conn );
+    }
+
+    DBClientBase* Client::releaseCopydbAuthConn() {
+        return _copydbAuthConn.release();
+    }
+
     bool Client::shutdown() {
 #if defined(_DEBUG) && !defined(MONGO_OPTIMIZED_BUILD) && !XSAN_ENABLED
         {
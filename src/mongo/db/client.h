@@ -56,6 +56,7 @@ namespace mongo {
     class CurOp;
     class Command;
     class Client;
+    class DBClientBase;
     class AbstractMessagingPort;
     class LockCollectionForReading;
     class PageFaultRetryableSection;
@@ -131,6 +132,14 @@ namespace mongo {
 
         LockState& lockState() { return _ls; }
 
+        /**
+         * the connection copydbgetnonce got its nonce on, kept for the copydb which follows on
+         * this client.  takes ownership of conn, replacing any earlier one.
+         */
+        void setCopydbAuthConn( DBClientBase* conn );
+        /** @return the copydbgetnonce connection, if any; the caller takes ownership */
+        DBClientBase* releaseCopydbAuthConn();
+
     private:
         Client(const std::string& desc, AbstractMessagingPort *p = 0);
         friend class CurOp;
@@ -149,6 +158,8 @@ namespace mongo {
         PageFaultRetryableSection *_pageFaultRetryableSection;
 
         LockState _ls;
+
+        auto_ptr<DBClientBase> _copydbAuthConn;
         
         friend class PageFaultRetryableSection; // TEMP
         friend class NoPageFaultsAllowed; // TEMP
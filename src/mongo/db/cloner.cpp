@@ -52,6 +52,7 @@
 #include "mongo/db/pdfile.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
 
@@ -111,10 +112,53 @@ namespace mongo {
         return res;
     }
 
-    Cloner::Cloner() { }
+    void CloneProgress::start(const string& ns, long long expected) {
+        scoped_lock lk(_mutex);
+        Counts& counts = _collections[ns];
+        counts.copied = 0;
+        counts.expected = expected;
+        counts.done = false;
+    }
+
+    void CloneProgress::update(const string& ns, long long copied) {
+        scoped_lock lk(_mutex);
+        _collections[ns].copied = copied;
+    }
+
+    void CloneProgress::finish(const string& ns) {
+        scoped_lock lk(_mutex);
+        _collections[ns].done = true;
+    }
+
+    void CloneProgress::clear() {
+        scoped_lock lk(_mutex);
+        _collections.clear();
+    }
+
+    bool CloneProgress::empty() const {
+        scoped_lock lk(_mutex);
+        return _collections.empty();
+    }
+
+    void CloneProgress::append(BSONArrayBuilder* out) const {
+        scoped_lock lk(_mutex);
+        for (map<string, Counts>::const_iterator i = _collections.begin();
+             i != _collections.end();
+             ++i) {
+            BSONObjBuilder b(out->subobjStart());
+            b.append("ns", i->first);
+            b.append("copied", i->second.copied);
+            if (i->second.expected >= 0)
+                b.append("expected", i->second.expected);
+            b.append("done", i->second.done);
+            b.done();
+        }
+    }
+
+    Cloner::Cloner() : _progress(NULL) { }
 
     struct Cloner::Fun {
-        Fun( Client::Context& ctx ) : lastLog(0), context( ctx ) { }
+        Fun( Client::Context& ctx ) : lastLog(0), context( ctx ), progress(NULL) { }
 
         void operator()( DBClientCursorBatchIterator &i ) {
             Lock::GlobalWrite lk;
@@ -189,6 +233,9 @@ namespace mongo {
                     saveLast = time( 0 );
                 }
             }
+
+            if ( progress )
+                progress->update( to_collection, n );
         }
 
         time_t lastLog;
@@ -203,6 +250,7 @@ namespace mongo {
         bool logForRepl;
         bool _mayYield;
         bool _mayBeInterrupted;
+        CloneProgress* progress;
     };
 
     /* copy the specified collection
@@ -226,6 +274,8 @@ namespace mongo {
         f.logForRepl = logForRepl;
         f._mayYield = mayYield;
         f._mayBeInterrupted = mayBeInterrupted;
+        if ( !isindex )
+            f.progress = _progress;
 
         int options = QueryOption_NoCursorTimeout | ( slaveOk ? QueryOption_SlaveOk : 0 );
         {
@@ -331,6 +381,125 @@ namespace mongo {
 
     extern bool inDBRepair;
 
+    void Cloner::cloneCollectionData(Client::Context& context, const BSONObj& collection,
+                                     const string& todb, const CloneOptions& opts,
+                                     bool masterSameProcess) {
+        LOG(2) << "  really will clone: " << collection << endl;
+        const char * from_name = collection["name"].valuestr();
+        BSONObj options = collection.getObjectField("options");
+
+        /* change name "<fromdb>.collection" -> <todb>.collection */
+        const char *p = strchr(from_name, '.');
+        verify(p);
+        string to_name = todb + p;
+
+        bool wantIdIndex = false;
+        {
+            string err;
+            const char *toname = to_name.c_str();
+            /* we defer building id index for performance - building it in batch is much faster */
+            userCreateNS(toname, options, err, opts.logForRepl, &wantIdIndex);
+        }
+        LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
+
+        if ( _progress ) {
+            long long expected;
+            {
+                dbtempreleaseif r( opts.mayYield );
+                expected = _conn->count( from_name, BSONObj(),
+                                         opts.slaveOk ? QueryOption_SlaveOk : 0 );
+            }
+            _progress->start( to_name, expected );
+        }
+
+        Query q;
+        if( opts.snapshot )
+            q.snapshot();
+        copy(context,from_name, to_name.c_str(), false, opts.logForRepl, masterSameProcess,
+             opts.slaveOk, opts.mayYield, opts.mayBeInterrupted, q);
+
+        if( wantIdIndex ) {
+            /* we need dropDups to be true as we didn't do a true snapshot and this is before applying oplog operations
+               that occur during the initial sync.  inDBRepair makes dropDups be true.
+               */
+            bool old = inDBRepair;
+            try {
+                inDBRepair = true;
+                Collection* c = cc().database()->getCollection( to_name );
+                if ( c )
+                    c->getIndexCatalog()->ensureHaveIdIndex();
+                inDBRepair = old;
+            }
+            catch(...) {
+                inDBRepair = old;
+                throw;
+            }
+        }
+
+        if ( _progress )
+            _progress->finish( to_name );
+    }
+
+    struct Cloner::ParallelClone {
+        ParallelClone() : mutex( "ParallelClone" ), status( Status::OK() ) { }
+
+        mongo::mutex mutex;
+        list<BSONObj> toClone;   // collections no thread has started on yet
+        Status status;           // the first error any thread hit
+    };
+
+    void Cloner::cloneCollectionsInThread(ParallelClone* all, const string& masterHost,
+                                          const string& todb, const CloneOptions* opts) {
+        // The pool's threads outlive the clone, so the Client is detached again before returning.
+        const string threadName = getThreadName();
+        Client::initThread( "clone worker" );
+        try {
+            Cloner cloner;
+            cloner._progress = opts->progress;
+
+            string errmsg;
+            ConnectionString cs = ConnectionString::parse( masterHost, errmsg );
+            auto_ptr<DBClientBase> con( cs.connect( errmsg ) );
+            uassert( 17357, str::stream() << "clone couldn't connect to " << masterHost
+                                          << ": " << errmsg,
+                     con.get() );
+            uassert( 17358, str::stream() << "clone couldn't authenticate to " << masterHost,
+                     replAuthenticate( con.get() ) );
+            cloner._conn = con;
+
+            while ( true ) {
+                BSONObj collection;
+                {
+                    scoped_lock lk( all->mutex );
+                    if ( all->toClone.empty() || !all->status.isOK() )
+                        break;
+                    collection = all->toClone.front();
+                    all->toClone.pop_front();
+                }
+
+                mayInterrupt( opts->mayBeInterrupted );
+                Client::WriteContext ctx( todb );
+                cloner.cloneCollectionData( ctx.ctx(), collection, todb, *opts, false );
+            }
+        }
+        catch ( const DBException& e ) {
+            scoped_lock lk( all->mutex );
+            if ( all->status.isOK() )
+                all->status = e.toStatus();
+        }
+        catch ( const std::exception& e ) {
+            scoped_lock lk( all->mutex );
+            if ( all->status.isOK() )
+                all->status = Status( ErrorCodes::InternalError, e.what() );
+        }
+        catch ( ... ) {
+            scoped_lock lk( all->mutex );
+            if ( all->status.isOK() )
+                all->status = Status( ErrorCodes::InternalError, "unknown exception" );
+        }
+        Client::resetThread( threadName );
+    }
+
     bool Cloner::go(Client::Context& context,
                     const string& masterHost, const CloneOptions& opts, set<string>* clonedColls,
                     string& errmsg, int* errCode) {
@@ -338,6 +507,7 @@ namespace mongo {
             *errCode = 0;
         }
         massert( 10289 ,  "useReplAuth is not written to replication log", !opts.useReplAuth || !opts.logForRepl );
+        _progress = opts.progress;
 
         string todb = cc().database()->name();
         stringstream a,b;
@@ -440,52 +610,32 @@ namespace mongo {
             }
         }
 
-        for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
+        int numThreads = std::min( opts.numThreads, static_cast<int>( toClone.size() ) );
+        if ( numThreads > 1 && opts.mayYield && !masterSameProcess ) {
+            LOG(1) << "\t cloning " << toClone.size() << " collections on " << numThreads
+                   << " threads" << endl;
+
+            ParallelClone all;
+            all.toClone.swap( toClone );
             {
-                mayInterrupt( opts.mayBeInterrupted );
-                dbtempreleaseif r( opts.mayYield );
+                // the clone threads take the lock themselves, around each batch they insert
+                dbtemprelease r;
+                ThreadPool pool( numThreads );
+                for ( int i = 0; i < numThreads; i++ ) {
+                    pool.schedule( &Cloner::cloneCollectionsInThread,
+                                   &all, masterHost, todb, &opts );
+                }
+                pool.join();
             }
-            BSONObj collection = *i;
-            LOG(2) << "  really will clone: " << collection << endl;
-            const char * from_name = collection["name"].valuestr();
-            BSONObj options = collection.getObjectField("options");
-
-            /* change name "<fromdb>.collection" -> <todb>.collection */
-            const char *p = strchr(from_name, '.');
-            verify(p);
-            string to_name = todb + p;
+            uassertStatusOK( all.status );
+        }
 
-            bool wantIdIndex = false;
+        for ( list<BSONObj>::iterator i=toClone.begin(); i != toClone.end(); i++ ) {
             {
-                string err;
-                const char *toname = to_name.c_str();
-                /* we defer building id index for performance - building it in batch is much faster */
-                userCreateNS(toname, options, err, opts.logForRepl, &wantIdIndex);
-            }
-            LOG(1) << "\t\t cloning " << from_name << " -> " << to_name << endl;
-            Query q;
-            if( opts.snapshot )
-                q.snapshot();
-            copy(context,from_name, to_name.c_str(), false, opts.logForRepl, masterSameProcess,
-                 opts.slaveOk, opts.mayYield, opts.mayBeInterrupted, q);
-
-            if( wantIdIndex ) {
-                /* we need dropDups to be true as we didn't do a true snapshot and this is before applying oplog operations
-                   that occur during the initial sync.  inDBRepair makes dropDups be true.
-                   */
-                bool old = inDBRepair;
-                try {
-                    inDBRepair = true;
-                    Collection* c = cc().database()->getCollection( to_name );
-                    if ( c )
-                        c->getIndexCatalog()->ensureHaveIdIndex();
-                    inDBRepair = old;
-                }
-                catch(...) {
-                    inDBRepair = old;
-                    throw;
-                }
+                mayInterrupt( opts.mayBeInterrupted );
+                dbtempreleaseif r( opts.mayYield );
             }
+            cloneCollectionData( context, *i, todb, opts, masterSameProcess );
         }
 
         // now build the indexes
@@ -658,8 +808,6 @@ namespace mongo {
     } cmdCloneCollection;
 
 
-    // SERVER-4328 todo review for concurrency
-    thread_specific_ptr< DBClientConnection > authConn_;
     /* Usage:
      admindb.$cmd.findOne( { copydbgetnonce: 1, fromhost: <hostname> } );
      */
@@ -688,13 +836,16 @@ namespace mongo {
                 ss << "localhost:" << serverGlobalParams.port;
                 fromhost = ss.str();
             }
-            authConn_.reset( new DBClientConnection() );
+            // Kept on the Client rather than the thread: connections need not be serviced by
+            // the same thread from one request to the next.
+            DBClientConnection* authConn = new DBClientConnection();
+            cc().setCopydbAuthConn( authConn );
             BSONObj ret;
             {
                 dbtemprelease t;
-                if ( !authConn_->connect( fromhost, errmsg ) )
+                if ( !authConn->connect( fromhost, errmsg ) )
                     return false;
-                if( !authConn_->runCommand( "admin", BSON( "getnonce" << 1 ), ret ) ) {
+                if( !authConn->runCommand( "admin", BSON( "getnonce" << 1 ), ret ) ) {
                     errmsg = "couldn't get nonce " + ret.toString();
                     return false;
                 }
@@ -761,18 +912,19 @@ namespace mongo {
             string nonce = cmdObj.getStringField( "nonce" );
             string key = cmdObj.getStringField( "key" );
             if ( !username.empty() && !nonce.empty() && !key.empty() ) {
-                uassert( 13008, "must call copydbgetnonce first", authConn_.get() );
+                DBClientBase* authConn = cc().releaseCopydbAuthConn();
+                uassert( 13008, "must call copydbgetnonce first", authConn );
+                cloner.setConnection( authConn );
                 BSONObj ret;
                 {
                     dbtemprelease t;
-                    if ( !authConn_->runCommand( cloneOptions.fromDB,
-                                                 BSON( "authenticate" << 1 << "user" << username
-                                                       << "nonce" << nonce << "key" << key ), ret ) ) {
+                    if ( !authConn->runCommand( cloneOptions.fromDB,
+                                                BSON( "authenticate" << 1 << "user" << username
+                                                      << "nonce" << nonce << "key" << key ), ret ) ) {
                         errmsg = "unable to login " + ret.toString();
                         return false;
                     }
                 }
-                cloner.setConnection( authConn_.release() );
             }
             else if (!fromSelf) {
                 // If fromSelf leave the cloner's conn empty, it will use a DBDirectClient instead.
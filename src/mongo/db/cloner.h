@@ -32,6 +32,7 @@
 
 #include "mongo/db/client.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
@@ -40,6 +41,37 @@ namespace mongo {
     class DBClientCursor;
     class Query;
 
+    /**
+     * How far cloning of each collection has got, for reporting while collections are copied on
+     * several threads.  Thread safe.
+     */
+    class CloneProgress : boost::noncopyable {
+    public:
+        CloneProgress() : _mutex("CloneProgress") { }
+
+        /** expected is the number of documents the source reported, or -1 if unknown */
+        void start(const string& ns, long long expected);
+        void update(const string& ns, long long copied);
+        void finish(const string& ns);
+        void clear();
+
+        bool empty() const;
+
+        /** appends { ns, copied, expected, done } for each collection started */
+        void append(BSONArrayBuilder* out) const;
+
+    private:
+        struct Counts {
+            Counts() : copied(0), expected(-1), done(false) { }
+            long long copied;
+            long long expected;
+            bool done;
+        };
+
+        mutable mongo::mutex _mutex;
+        map<string, Counts> _collections;
+    };
+
     class Cloner: boost::noncopyable {
     public:
         Cloner();
@@ -92,8 +124,23 @@ namespace mongo {
                   bool masterSameProcess, bool slaveOk, bool mayYield, bool mayBeInterrupted,
                   Query q);
 
+        /**
+         * Creates the collection described by the source's system.namespaces entry in todb and
+         * copies its documents, then builds the _id index if it was deferred.
+         */
+        void cloneCollectionData(Client::Context& ctx, const BSONObj& collection,
+                                 const string& todb, const CloneOptions& opts,
+                                 bool masterSameProcess);
+
+        struct ParallelClone;
+
+        /** takes collections from all until none are left, over a new connection to masterHost */
+        static void cloneCollectionsInThread(ParallelClone* all, const string& masterHost,
+                                             const string& todb, const CloneOptions* opts);
+
         struct Fun;
         auto_ptr<DBClientBase> _conn;
+        CloneProgress* _progress;
     };
 
     struct CloneOptions {
@@ -108,6 +155,9 @@ namespace mongo {
 
             syncData = true;
             syncIndexes = true;
+
+            numThreads = 1;
+            progress = NULL;
         }
 
         string fromDB;
@@ -122,6 +172,15 @@ namespace mongo {
 
         bool syncData;
         bool syncIndexes;
+
+        /**
+         * Collections cloned at once, each thread with its own connection to the source.
+         * More than one needs mayYield, and isn't used when cloning from this process.
+         */
+        int numThreads;
+
+        /** if not NULL, updated as each collection's documents are copied */
+        CloneProgress* progress;
     };
 
 } // namespace mongo
@@ -313,10 +313,10 @@ namespace mongo {
             if (parentIsExpanded) {
                 NodeInfo nodeInfo;
                 if (firstKeyNode != NULL) {
-                    nodeInfo.firstKey = KeyNode(*bucket, *firstKeyNode).key.toBson();
+                    nodeInfo.firstKey = KeyNode(*bucket, *firstKeyNode).key.toBson().getOwned();
                 }
                 if (lastKeyNode != NULL) {
-                    nodeInfo.lastKey = KeyNode(*bucket, *lastKeyNode).key.toBson();
+                    nodeInfo.lastKey = KeyNode(*bucket, *lastKeyNode).key.toBson().getOwned();
                 }
 
                 nodeInfo.childNum = childNum;
@@ -346,6 +346,7 @@ namespace mongo {
 
     typedef BtreeInspectorImpl<V0> BtreeInspectorV0;
     typedef BtreeInspectorImpl<V1> BtreeInspectorV1;
+    typedef BtreeInspectorImpl<V2> BtreeInspectorV2;
 
     /**
      * Run analysis with the provided parameters. See IndexStatsCmd for in-depth expanation of
@@ -379,6 +380,7 @@ namespace mongo {
 
         scoped_ptr<BtreeInspector> inspector(NULL);
         switch (details->version()) {
+          case 2: inspector.reset(new BtreeInspectorV2(params.expandNodes)); break;
           case 1: inspector.reset(new BtreeInspectorV1(params.expandNodes)); break;
           case 0: inspector.reset(new BtreeInspectorV0(params.expandNodes)); break;
           default:
@@ -231,6 +231,7 @@ namespace mongo {
             shapeBuilder.append("query", cs->query);
             shapeBuilder.append("sort", cs->sort);
             shapeBuilder.append("projection", cs->projection);
+            shapeBuilder.append("hits", cs->hits);
             shapeBuilder.doneFast();
 
             // Release resources for cached solution after extracting query shape.
@@ -238,6 +239,17 @@ namespace mongo {
         }
         arrayBuilder.doneFast();
 
+        // Cache-wide size and counters.
+        PlanCache::Counters counters = planCache.getCounters();
+        BSONObjBuilder statsBuilder(bob->subobjStart("stats"));
+        statsBuilder.appendNumber("size", static_cast<long long>(planCache.size()));
+        statsBuilder.appendNumber("maxSize", static_cast<long long>(planCache.maxSize()));
+        statsBuilder.append("hits", counters.hits);
+        statsBuilder.append("misses", counters.misses);
+        statsBuilder.append("replans", counters.replans);
+        statsBuilder.append("evictions", counters.evictions);
+        statsBuilder.doneFast();
+
         return Status::OK();
     }
 
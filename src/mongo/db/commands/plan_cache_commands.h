@@ -112,7 +112,8 @@ namespace mongo {
 
         /**
          * Looks up cache keys for collection's plan cache.
-         * Inserts keys for query into BSON builder.
+         * Inserts keys for query into BSON builder, along with the hit count of each key
+         * and a 'stats' object with the cache's size and counters.
          */
         static Status list(const PlanCache& planCache, BSONObjBuilder* bob);
     };
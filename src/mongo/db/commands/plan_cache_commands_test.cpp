@@ -123,6 +123,38 @@ namespace {
         ASSERT_EQUALS(shapes[0].getObjectField("query"), cq->getQueryObj());
         ASSERT_EQUALS(shapes[0].getObjectField("sort"), cq->getParsed().getSort());
         ASSERT_EQUALS(shapes[0].getObjectField("projection"), cq->getParsed().getProj());
+        ASSERT_EQUALS(shapes[0].getField("hits").numberLong(), 0LL);
+    }
+
+    TEST(PlanCacheCommandsTest, planCacheListQueryShapesStats) {
+        CanonicalQuery* cqRaw;
+        ASSERT_OK(CanonicalQuery::canonicalize(ns, fromjson("{a: 1}"), &cqRaw));
+        auto_ptr<CanonicalQuery> cq(cqRaw);
+
+        PlanCache planCache(10);
+        QuerySolution qs;
+        qs.cacheData.reset(createSolutionCacheData());
+        std::vector<QuerySolution*> solns;
+        solns.push_back(&qs);
+        planCache.add(*cq, solns, new PlanRankingDecision());
+
+        CachedSolution* csRaw;
+        ASSERT_OK(planCache.get(*cq, &csRaw));
+        delete csRaw;
+
+        BSONObjBuilder bob;
+        ASSERT_OK(PlanCacheListQueryShapes::list(planCache, &bob));
+        BSONObj resultObj = bob.obj();
+        BSONObj shape = resultObj.getField("shapes").Array()[0].Obj();
+        ASSERT_EQUALS(shape.getField("hits").numberLong(), 1LL);
+
+        BSONObj stats = resultObj.getObjectField("stats");
+        ASSERT_EQUALS(stats.getField("size").numberLong(), 1LL);
+        ASSERT_EQUALS(stats.getField("maxSize").numberLong(), 10LL);
+        ASSERT_EQUALS(stats.getField("hits").numberLong(), 1LL);
+        ASSERT_EQUALS(stats.getField("misses").numberLong(), 0LL);
+        ASSERT_EQUALS(stats.getField("replans").numberLong(), 0LL);
+        ASSERT_EQUALS(stats.getField("evictions").numberLong(), 0LL);
     }
 
     /**
@@ -230,9 +262,11 @@ namespace {
         vector<BSONObj> shapesBefore = getShapes(planCache);
         ASSERT_EQUALS(shapesBefore.size(), 2U);
         BSONObj shapeA = BSON("query" << cqA->getQueryObj() << "sort" << cqA->getParsed().getSort()
-                           << "projection" << cqA->getParsed().getProj());
+                           << "projection" << cqA->getParsed().getProj()
+                           << "hits" << 0LL);
         BSONObj shapeB = BSON("query" << cqB->getQueryObj() << "sort" << cqB->getParsed().getSort()
-                           << "projection" << cqB->getParsed().getProj());
+                           << "projection" << cqB->getParsed().getProj()
+                           << "hits" << 0LL);
         ASSERT_TRUE(std::find(shapesBefore.begin(), shapesBefore.end(), shapeA) != shapesBefore.end());
         ASSERT_TRUE(std::find(shapesBefore.begin(), shapesBefore.end(), shapeB) != shapesBefore.end());
 
@@ -794,6 +794,13 @@ namespace {
         }
         const NamespaceDetails* nsd = collection->details();
 
+        if (subCommand == SUBCMD_DISK_STORAGE &&
+            nsd->isSystemFlagSet(NamespaceDetails::Flag_Compressed)) {
+            // the records are compressed blocks rather than documents
+            errmsg = "diskStorage can't analyze a compressed collection";
+            return false;
+        }
+
         const Extent* extent = NULL;
 
         // { extent: num }
@@ -31,6 +31,7 @@
 #include "mongo/db/commands.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/structure/catalog/namespace_details.h"
+#include "mongo/db/structure/record_store_compressed.h"
 #include "mongo/db/pdfile.h"
 #include "mongo/db/query/internal_plans.h"
 #include "mongo/db/query/runner.h"
@@ -226,6 +227,7 @@ namespace mongo {
                     long long bsonLen = 0;
                     int outOfOrder = 0;
                     DiskLoc cl_last;
+                    DiskLoc lastBlock;
 
                     DiskLoc cl;
                     Runner::RunnerState state;
@@ -233,39 +235,51 @@ namespace mongo {
                     while (Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, &cl))) {
                         n++;
 
+                        // The documents of a compressed block share its record, and come one
+                        // after another in a scan.  The record is counted once.
+                        DiskLoc recLoc = cl;
+                        bool newRecord = true;
+                        if ( CompressedRecordStore::isCompressedLoc( cl ) ) {
+                            recLoc = CompressedRecordStore::blockFor( cl );
+                            newRecord = recLoc != lastBlock;
+                            lastBlock = recLoc;
+                        }
+
                         if ( n < 1000000 )
-                            recs.insert(cl);
+                            recs.insert(recLoc);
                         if ( nsd->isCapped() ) {
                             if ( cl < cl_last )
                                 outOfOrder++;
                             cl_last = cl;
                         }
 
-                        Record *r = cl.rec();
-                        len += r->lengthWithHeaders();
-                        nlen += r->netLength();
-                        
-                        if ( r->lengthWithHeaders() ==
-                                NamespaceDetails::quantizeAllocationSpace
-                                    ( r->lengthWithHeaders() ) ) {
-                            // Count the number of records having a size consistent with
-                            // the quantizeAllocationSpace quantization implementation.
-                            ++nQuantizedSize;
-                        }
+                        if ( newRecord ) {
+                            Record *r = recLoc.rec();
+                            len += r->lengthWithHeaders();
+                            nlen += r->netLength();
+
+                            if ( r->lengthWithHeaders() ==
+                                    NamespaceDetails::quantizeAllocationSpace
+                                        ( r->lengthWithHeaders() ) ) {
+                                // Count the number of records having a size consistent with
+                                // the quantizeAllocationSpace quantization implementation.
+                                ++nQuantizedSize;
+                            }
 
-                        if ( r->lengthWithHeaders() ==
-                                NamespaceDetails::quantizePowerOf2AllocationSpace
-                                    ( r->lengthWithHeaders() - 1 ) ) {
-                            // Count the number of records having a size consistent with the
-                            // quantizePowerOf2AllocationSpace quantization implementation.
-                            // Because of SERVER-8311, power of 2 quantization is not idempotent and
-                            // r->lengthWithHeaders() - 1 must be checked instead of the record
-                            // length itself.
-                            ++nPowerOf2QuantizedSize;
+                            if ( r->lengthWithHeaders() ==
+                                    NamespaceDetails::quantizePowerOf2AllocationSpace
+                                        ( r->lengthWithHeaders() - 1 ) ) {
+                                // Count the number of records having a size consistent with the
+                                // quantizePowerOf2AllocationSpace quantization implementation.
+                                // Because of SERVER-8311, power of 2 quantization is not
+                                // idempotent and r->lengthWithHeaders() - 1 must be checked
+                                // instead of the record length itself.
+                                ++nPowerOf2QuantizedSize;
+                            }
                         }
 
                         if (full){
-                            BSONObj obj = BSONObj::make(r);
+                            BSONObj obj = cl.obj();
                             const Status status = validateBSON(obj.objdata(), obj.objsize());
                             if (!status.isOK()) {
                                 valid = false;
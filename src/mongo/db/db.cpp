@@ -71,6 +71,7 @@
 #include "mongo/db/storage_options.h"
 #include "mongo/db/ttl.h"
 #include "mongo/platform/process_id.h"
+#include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/background.h"
@@ -181,8 +182,45 @@ namespace mongo {
         sleepmicros( Client::recommendedYieldMicros() );
     }
 
+    /**
+     * carries a connection's Client and sharding info between the worker threads of a
+     * pooled MessageServer
+     */
+    class MyConnectionThreadState : public ConnectionThreadState {
+    public:
+        MyConnectionThreadState() : _client(0), _sharding(0) {}
+
+        virtual ~MyConnectionThreadState() {
+            delete _sharding;
+            delete _client;
+        }
+
+        virtual void detach() {
+            _client = currentClient.release();
+            _sharding = ShardedConnectionInfo::release();
+        }
+
+        virtual void attach() {
+            verify( currentClient.get() == 0 );
+            currentClient.reset( _client );
+            ShardedConnectionInfo::reset( _sharding );
+            _client = 0;
+            _sharding = 0;
+        }
+
+    private:
+        Client* _client;
+        ShardedConnectionInfo* _sharding;
+    };
+
     class MyMessageHandler : public MessageHandler {
     public:
+        virtual bool supportsWorkerPool() const { return true; }
+
+        virtual ConnectionThreadState* newConnectionThreadState() {
+            return new MyConnectionThreadState();
+        }
+
         virtual void connected( AbstractMessagingPort* p ) {
             Client::initThread("conn", p);
         }
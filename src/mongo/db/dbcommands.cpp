@@ -67,6 +67,7 @@
 #include "mongo/db/query/query_planner.h"
 #include "mongo/db/repl/is_master.h"
 #include "mongo/db/repl/oplog.h"
+#include "mongo/db/structure/record_store_compressed.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
@@ -930,6 +931,8 @@ namespace mongo {
             while (Runner::RUNNER_ADVANCED == (state = runner->getNext(NULL, &loc))) {
                 if ( estimate )
                     size += avgObjSize;
+                else if ( CompressedRecordStore::isCompressedLoc( loc ) )
+                    size += loc.obj().objsize(); // the block's record holds other documents too
                 else
                     size += loc.rec()->netLength();
 
@@ -1000,7 +1003,8 @@ namespace mongo {
         virtual LockType locktype() const { return READ; }
         virtual void help( stringstream &help ) const {
             help << "{ collStats:\"blog.posts\" , scale : 1 } scale divides sizes e.g. for KB use 1024\n"
-                    "    avgObjSize - in bytes";
+                    "    avgObjSize - in bytes\n"
+                    "    verbose : true also lists the extents and the free space on the deleted lists";
         }
         virtual void addRequiredPrivileges(const std::string& dbname,
                                            const BSONObj& cmdObj,
@@ -1064,8 +1068,13 @@ namespace mongo {
                 result.appendNumber( "max" , nsd->maxCappedDocs() );
             }
 
-            if ( verbose )
+            if ( nsd->isSystemFlagSet( NamespaceDetails::Flag_Compressed ) )
+                result.appendBool( "compressed" , true );
+
+            if ( verbose ) {
                 result.appendArray( "extents" , extents.arr() );
+                nsd->appendDeletedListStats( &result, scale );
+            }
 
             return true;
         }
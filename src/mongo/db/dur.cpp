@@ -48,7 +48,9 @@
          remapping. with many files (e.g., 1000), remapping could be time consuming (several ms), so we don't want
          to be too frequent.
        there could be a slow down immediately after remapping as fresh copy-on-writes for commonly written pages will
-         be required.  so doing these remaps fractionally is helpful. 
+         be required.  so doing these remaps fractionally is helpful.  each pass is also cut off after
+         RemapSliceMicros unless the private views are getting too large.
+       on posix the remap of a view is atomic, so it is done in R rather than W; readers carry on.
 
    mutexes:
 
@@ -58,13 +60,24 @@
      READLOCK mmmutex
        commitJob.reset()
      UNLOCK dbMutex                      // now other threads can write
+       queue the buffer for the journal writer thread, which takes its own READLOCK mmmutex
+     UNLOCK mmmutex
+     UNLOCK groupCommitMutex
+
+   journal writer thread, while its queue is non-empty:
+
+     READLOCK mmmutex
        WRITETOJOURNAL()
        WRITETODATAFILES()
      UNLOCK mmmutex
-     UNLOCK groupCommitMutex
+
+   so the next commit's PREPLOGBUFFER overlaps the previous commit's journal write and fsync.
+   there are two log buffers, so at most one commit is prepared ahead of the writer.
 
    every Nth groupCommit, at the end, we REMAPPRIVATEVIEW() at the end of the work. because of
-   that we are in W lock for that groupCommit, which is nonideal of course.
+   that we are in R lock for that whole groupCommit, and on windows and solaris upgrade to W for
+   the remap, which is nonideal of course.  that groupCommit, and
+   early commits from other threads, first wait for the journal writer to finish what is queued.
 
    @see https://docs.google.com/drawings/edit?id=1TklsmZzm7ohIZkwgeK6rMvsdaR13KjtJYMsfLr175Zc
 */
@@ -99,8 +112,8 @@ namespace mongo {
         void unspoolWriteIntents();
 
         void PREPLOGBUFFER(JSectHeader& outParm, AlignedBuilder&);
-        void WRITETOJOURNAL(JSectHeader h, AlignedBuilder& uncompressed);
-        void WRITETODATAFILES(const JSectHeader& h, AlignedBuilder& uncompressed);
+        void WRITETOJOURNAL(JSectHeader h, AlignedBuilder& uncompressed, Stats::S& s);
+        void WRITETODATAFILES(const JSectHeader& h, AlignedBuilder& uncompressed, Stats::S& s);
 
         /** declared later in this file
             only used in this file -- use DurableInterface::commitNow() outside
@@ -115,7 +128,25 @@ namespace mongo {
             memset(this, 0, sizeof(*this));
         }
 
-        Stats::Stats() {
+        void Stats::S::addWrites(const S& w) {
+            _journaledBytes += w._journaledBytes;
+            _uncompressedBytes += w._uncompressedBytes;
+            _writeToDataFilesBytes += w._writeToDataFilesBytes;
+            _writeToJournalMicros += w._writeToJournalMicros;
+            _writeToDataFilesMicros += w._writeToDataFilesMicros;
+        }
+
+        void Stats::S::noteRemapStall(unsigned long long micros) {
+            int i = 0;
+            unsigned long long limit = 1000;
+            while( i < NRemapStallBuckets - 1 && micros >= limit ) {
+                i++;
+                limit *= 4;
+            }
+            _remapStalls[i]++;
+        }
+
+        Stats::Stats() : writerMutex("durStatsWriter") {
             _a.reset();
             _b.reset();
             curr = &_a;
@@ -128,7 +159,7 @@ namespace mongo {
         string _CSVHeader();
 
         string Stats::S::_CSVHeader() { 
-            return "cmts  jrnMB\twrDFMB\tcIWLk\tearly\tprpLgB  wrToJ\twrToDF\trmpPrVw";
+            return "cmts  jrnMB\twrDFMB\tcIWLk\tearly\tprpLgB  wrToJ\twrToDF\trmpPrVw\tpipe\tmaxQ\twtWrtr";
         }
 
         string Stats::S::_asCSV() { 
@@ -143,7 +174,10 @@ namespace mongo {
                 (unsigned) (_prepLogBufferMicros/1000) << '\t' << 
                 (unsigned) (_writeToJournalMicros/1000) << '\t' << 
                 (unsigned) (_writeToDataFilesMicros/1000) << '\t' << 
-                (unsigned) (_remapPrivateViewMicros/1000);
+                (unsigned) (_remapPrivateViewMicros/1000) << '\t' << 
+                _pipelinedCommits << '\t' << 
+                _maxQueueDepth << '\t' << 
+                (unsigned) (_waitForWriterMicros/1000);
             return ss.str();
         }
 
@@ -163,7 +197,23 @@ namespace mongo {
                              "writeToJournal" << (unsigned) (_writeToJournalMicros/1000) <<
                              "writeToDataFiles" << (unsigned) (_writeToDataFilesMicros/1000) <<
                              "remapPrivateView" << (unsigned) (_remapPrivateViewMicros/1000)
+                           ) <<
+                       "pipeline" <<
+                       BSON( "commits" << _pipelinedCommits <<
+                             "maxQueueDepth" << _maxQueueDepth <<
+                             "waitForWriterMs" << (unsigned) (_waitForWriterMicros/1000)
                            );
+            {
+                BSONObjBuilder h(b.subobjStart("remapStallsMs"));
+                unsigned long long ms = 1;
+                for( int i = 0; i < NRemapStallBuckets - 1; i++, ms *= 4 ) {
+                    string name = str::stream() << "<" << ms;
+                    h << name << _remapStalls[i];
+                }
+                string name = str::stream() << ">=" << ms / 4;
+                h << name << _remapStalls[NRemapStallBuckets - 1];
+                h.done();
+            }
             if (storageGlobalParams.journalCommitInterval != 0)
                 b << "journalCommitIntervalMs" << storageGlobalParams.journalCommitInterval;
             return b.obj();
@@ -178,6 +228,7 @@ namespace mongo {
             unsigned long long dt = now - _lastRotate;
             if( dt >= _intervalMicros && _intervalMicros ) {
                 // rotate
+                SimpleMutex::scoped_lock lk(writerMutex);
                 curr->_dtMillis = (unsigned) (dt/1000);
                 _lastRotate = now;
                 curr = other();
@@ -468,6 +519,20 @@ namespace mongo {
 
         extern size_t privateMapBytes;
 
+#if defined(_WIN32) || defined(__sunos__)
+        // the view is briefly unmapped while it is remapped, so readers must be excluded too
+        static const bool remapNeedsWriteLock = true;
+#else
+        // mmap MAP_FIXED replaces the private view atomically, and once the commit's writes are in
+        // the data files the new mapping reads the same bytes as the old one.  so excluding writers,
+        // which could otherwise write to a view mid remap, is enough.
+        static const bool remapNeedsWriteLock = false;
+#endif
+
+        // a remap pass stops after this long, unless the private views are using too much memory,
+        // and the next pass picks up where it left off
+        static const unsigned long long RemapSliceMicros = 20 * 1000;
+
         static void _REMAPPRIVATEVIEW() {
             // todo: Consider using ProcessInfo herein and watching for getResidentSize to drop.  that could be a way 
             //       to assure very good behavior here.
@@ -477,7 +542,7 @@ namespace mongo {
 
             LOG(4) << "journal REMAPPRIVATEVIEW" << endl;
 
-            verify( Lock::isW() );
+            verify( Lock::isW() || ( !remapNeedsWriteLock && Lock::isR() ) );
             verify( !commitJob.hasWritten() );
 
             // we want to remap all private views about every 2 seconds.  there could be ~1000 views so
@@ -507,14 +572,15 @@ namespace mongo {
             if( sz == 0 )
                 return;
 
+            bool bounded = true;
             {
                 // be careful not to use too much memory if the write rate is 
                 // extremely high
                 double f = privateMapBytes / ((double)UncommittedBytesLimit);
                 if( f > fraction ) { 
                     fraction = f;
+                    bounded = false;
                 }
-                privateMapBytes = 0;
             }
 
             unsigned ntodo = (unsigned) (sz * fraction);
@@ -530,10 +596,12 @@ namespace mongo {
                 if( i == e ) i = b;
             }
             unsigned startedAt = startAt;
-            startAt = (startAt + ntodo) % sz; // mark where to start next time
 
             Timer t;
-            for( unsigned x = 0; x < ntodo; x++ ) {
+            unsigned x = 0;
+            for( ; x < ntodo; x++ ) {
+                if( bounded && x > 0 && t.micros() > RemapSliceMicros )
+                    break;
                 dassert( i != e );
                 if( (*i)->isDurableMappedFile() ) {
                     DurableMappedFile *mmf = (DurableMappedFile*) *i;
@@ -542,20 +610,30 @@ namespace mongo {
                         mmf->willNeedRemap() = false;
                         mmf->remapThePrivateView();
                     }
-                    i++;
-                    if( i == e ) i = b;
+                    // only what this pass remapped leaves the private views
+                    privateMapBytes -= min(privateMapBytes, mmf->privateBytes());
+                    mmf->privateBytes() = 0;
                 }
+                i++;
+                if( i == e ) i = b;
+            }
+            if( x == sz ) {
+                // every view is fresh.  also drops the bytes no file was charged for.
+                privateMapBytes = 0;
             }
-            LOG(2) << "journal REMAPPRIVATEVIEW done startedAt: " << startedAt << " n:" << ntodo << ' ' << t.millis() << "ms" << endl;
+            startAt = (startAt + x) % sz; // mark where to start next time
+            LOG(2) << "journal REMAPPRIVATEVIEW done startedAt: " << startedAt << " n:" << x << " of " << ntodo << ' ' << t.millis() << "ms" << endl;
         }
 
         /** We need to remap the private views periodically. otherwise they would become very large.
-            Call within write lock.  See top of file for more commentary.
+            Call within write lock, or on posix at least a read lock.  See top of file for more commentary.
         */
         void REMAPPRIVATEVIEW() {
             Timer t;
             _REMAPPRIVATEVIEW();
-            stats.curr->_remapPrivateViewMicros += t.micros();
+            unsigned long long micros = t.micros();
+            stats.curr->_remapPrivateViewMicros += micros;
+            stats.curr->noteRemapStall(micros);
         }
 
         // this is a pseudo-local variable in the groupcommit functions 
@@ -563,12 +641,228 @@ namespace mongo {
         // reallocate, and more importantly regrow it, on every single commit.
         static AlignedBuilder __theBuilder(4 * 1024 * 1024);
 
+        /** writes the journal and data files for commits prepared by _groupCommitWithLimitedLocks(),
+            in the order they were queued, so that the commit thread can go on to PREPLOGBUFFER the
+            next commit while the previous one is being written and fsynced.
+
+            the writer is in LockMongoFilesShared the whole time its queue is non-empty; the commit
+            thread holds it from PREPLOGBUFFER until the writer has it, so files can't be closed
+            under a queued commit.  the writer takes no other locks.
+
+            the writer runs until the commit thread calls stop(); commits queued after that are
+            written by the caller.
+        */
+        class JournalWriter : boost::noncopyable {
+        public:
+            JournalWriter() :
+                _m("JournalWriter"), _nBuffers(0), _filesLocked(false), _stopping(false),
+                _stopped(false) { }
+
+            /** a log buffer for the next commit.  call outside of locks: waits if every buffer is
+                still queued for writing. */
+            AlignedBuilder* getBuffer() {
+                scoped_lock lk(_m);
+                if( _free.empty() && _nBuffers < NBuffers ) {
+                    _nBuffers++;
+                    return new AlignedBuilder(4 * 1024 * 1024);
+                }
+                if( _free.empty() ) {
+                    Timer t;
+                    while( _free.empty() )
+                        _cond.wait(lk.boost());
+                    stats.curr->_waitForWriterMicros += t.micros();
+                }
+                AlignedBuilder* ab = _free.back();
+                _free.pop_back();
+                return ab;
+            }
+
+            /** return a buffer from getBuffer() which was not queued */
+            void putBack(AlignedBuilder* ab) {
+                scoped_lock lk(_m);
+                _free.push_back(ab);
+                _cond.notify_all();
+            }
+
+            /** queue a prepared commit.  call in LockMongoFilesShared, which the caller may
+                release once we return.
+                @param when the commit number to notify once the journal write is done
+            */
+            void enqueue(const JSectHeader& h, AlignedBuilder* ab, NotifyAll::When when) {
+                {
+                    scoped_lock lk(_m);
+                    if( !_stopped ) {
+                        _queue.push_back(Commit(h, ab, when));
+                        stats.curr->_pipelinedCommits++;
+                        if( _queue.size() > stats.curr->_maxQueueDepth )
+                            stats.curr->_maxQueueDepth = _queue.size();
+                        _cond.notify_all();
+                        while( !_filesLocked && !_queue.empty() )
+                            _cond.wait(lk.boost());
+                        return;
+                    }
+                }
+
+                // the writer has exited, and left the queue empty.  the caller's
+                // LockMongoFilesShared keeps the files open while we write.
+                Commit c(h, ab, when);
+                write(c);
+                putBack(ab);
+            }
+
+            /** let the writer exit once everything queued is written.  call from the commit thread
+                when it is done committing. */
+            void stop() {
+                scoped_lock lk(_m);
+                _stopping = true;
+                _cond.notify_all();
+            }
+
+            /** a commit which found nothing written is acknowledged once everything queued
+                before it is in the journal */
+            void acknowledge(NotifyAll::When when) {
+                scoped_lock lk(_m);
+                if( _queue.empty() ) {
+                    commitJob.notifyCommitted(when);
+                    return;
+                }
+                _queue.push_back(Commit(JSectHeader(), 0, when));
+                _cond.notify_all();
+            }
+
+            /** wait for everything queued to be written to the journal and data files.
+                call in groupCommitMutex so nothing new is queued meanwhile. */
+            void drain() {
+                commitJob.groupCommitMutex.dassertLocked();
+                scoped_lock lk(_m);
+                while( !_queue.empty() )
+                    _cond.wait(lk.boost());
+            }
+
+            void run() {
+                Client::initThread("journalWriter");
+                while( 1 ) {
+                    {
+                        scoped_lock lk(_m);
+                        while( _queue.empty() && !_stopping )
+                            _cond.wait(lk.boost());
+                        if( _queue.empty() ) {
+                            _stopped = true;
+                            break;
+                        }
+                    }
+                    try {
+                        writeQueued();
+                    }
+                    catch(DBException& e) {
+                        log() << "dbexception in journal writer causing immediate shutdown: " << e.toString() << endl;
+                        mongoAbort("jw1");
+                    }
+                    catch(std::ios_base::failure& e) {
+                        log() << "ios_base exception in journal writer causing immediate shutdown: " << e.what() << endl;
+                        mongoAbort("jw2");
+                    }
+                    catch(std::bad_alloc& e) {
+                        log() << "bad_alloc exception in journal writer causing immediate shutdown: " << e.what() << endl;
+                        mongoAbort("jw3");
+                    }
+                    catch(std::exception& e) {
+                        log() << "exception in journal writer causing immediate shutdown: " << e.what() << endl;
+                        mongoAbort("jw4");
+                    }
+                }
+                cc().shutdown();
+            }
+
+        private:
+            struct Commit {
+                Commit(const JSectHeader& h, AlignedBuilder* ab, NotifyAll::When when) :
+                    h(h), ab(ab), when(when) { }
+                JSectHeader h;
+                AlignedBuilder* ab; // 0 if only acknowledging
+                NotifyAll::When when;
+            };
+
+            void writeQueued() {
+                LockMongoFilesShared lkFiles;
+                {
+                    scoped_lock lk(_m);
+                    _filesLocked = true;
+                    _cond.notify_all();
+                }
+                while( 1 ) {
+                    Commit* c;
+                    {
+                        scoped_lock lk(_m);
+                        if( _queue.empty() ) {
+                            _filesLocked = false;
+                            return;
+                        }
+                        // stays queued until written so that drain() waits for it.  only the
+                        // back of the deque is pushed to meanwhile, which leaves this in place.
+                        c = &_queue.front();
+                    }
+
+                    write(*c);
+
+                    scoped_lock lk(_m);
+                    if( c->ab )
+                        _free.push_back(c->ab);
+                    _queue.pop_front();
+                    _cond.notify_all();
+                }
+            }
+
+            void write(Commit& c) {
+                if( c.ab ) {
+                    // counted here while writing, so rotate() never waits on the journal I/O
+                    Stats::S s;
+                    s.reset();
+
+                    unsigned abLen = c.ab->len();
+                    WRITETOJOURNAL(c.h, *c.ab, s);
+
+                    // data is now in the journal, which is sufficient for acknowledging getLastError.
+                    commitJob.notifyCommitted(c.when);
+
+                    WRITETODATAFILES(c.h, *c.ab, s);
+                    verify( abLen == c.ab->len() ); // no one touched the builder while it was queued
+                    c.ab->reset();
+
+                    SimpleMutex::scoped_lock lkStats(stats.writerMutex);
+                    stats.curr->addWrites(s);
+                }
+                else {
+                    commitJob.notifyCommitted(c.when);
+                }
+            }
+
+            enum { NBuffers = 2 };
+
+            mongo::mutex _m;
+            boost::condition _cond;
+            deque<Commit> _queue;
+            vector<AlignedBuilder*> _free;
+            unsigned _nBuffers;
+            bool _filesLocked; // writer is in LockMongoFilesShared
+            bool _stopping;    // stop() was called
+            bool _stopped;     // the writer has exited
+        };
+
+        static JournalWriter& journalWriter = *(new JournalWriter()); // don't destroy
+
+        static void journalWriterThread() {
+            journalWriter.run();
+        }
+
         static bool _groupCommitWithLimitedLocks() {
             unspoolWriteIntents(); // in case we were doing some writing ourself (likely impossible with limitedlocks version)
-            AlignedBuilder &ab = __theBuilder;
 
             verify( ! Lock::isLocked() );
 
+            // get the buffer before locking, as this waits for the journal writer if it is behind
+            AlignedBuilder* ab = journalWriter.getBuffer();
+
             // do we need this to be greedy, so that it can start working fairly soon?
             // probably: as this is a read lock, it wouldn't change anything if only reads anyway.
             // also needs to stop greed. our time to work before clearing lk1 is not too bad, so 
@@ -580,8 +874,10 @@ namespace mongo {
             commitJob.commitingBegin(); // increments the commit epoch for getlasterror j:true
 
             if( !commitJob.hasWritten() ) {
-                // getlasterror request could have came after the data was already committed
-                commitJob.committingNotifyCommitted();
+                // getlasterror request could have came after the data was already committed,
+                // though perhaps not yet written by the journal writer
+                journalWriter.putBack(ab);
+                journalWriter.acknowledge(commitJob.commitNumber());
                 return true;
             }
 
@@ -590,33 +886,33 @@ namespace mongo {
             // the private mmap for their actual data.  i suppose we could lock individual databases 
             // and do them one at a time or in parallel (surely the latter would make sense if one went 
             // that route...)
-            PREPLOGBUFFER(h,ab); 
+            PREPLOGBUFFER(h,*ab); 
 
-            LockMongoFilesShared lk3;
+            // durops (file creates and drops) are acted on by their callers as soon as the commit
+            // returns, so a commit with any is written before we return
+            const bool hasOps = !commitJob.ops().empty();
 
-            unsigned abLen = ab.len();
-            commitJob.committingReset(); // must be reset before allowing anyone to write
-            DEV verify( !commitJob.hasWritten() );
+            {
+                LockMongoFilesShared lk3;
 
-            // release the readlock -- allowing others to now write while we are writing to the journal (etc.)
-            lk1.reset();
+                NotifyAll::When when = commitJob.commitNumber();
+                commitJob.committingReset(); // must be reset before allowing anyone to write
+                DEV verify( !commitJob.hasWritten() );
 
-            // ****** now other threads can do writes ******
+                // release the readlock -- allowing others to now write while we are writing to the journal (etc.)
+                lk1.reset();
 
-            WRITETOJOURNAL(h, ab);
-            verify( abLen == ab.len() ); // a check that no one touched the builder while we were doing work. if so, our locking is wrong.
+                // ****** now other threads can do writes ******
 
-            // data is now in the journal, which is sufficient for acknowledging getLastError.
-            // (ok to crash after that)
-            commitJob.committingNotifyCommitted();
+                // note the higher-up-the-chain locking of filesLockedFsync is important here, 
+                // as we are not in Lock::GlobalRead anymore. private view readers won't see 
+                // anything as the journal writer does WRITETODATAFILES, but external viewers of 
+                // the datafiles will see them mutating.
+                journalWriter.enqueue(h, ab, when);
+            }
 
-            // note the higher-up-the-chain locking of filesLockedFsync is important here, 
-            // as we are not in Lock::GlobalRead anymore. private view readers won't see 
-            // anything as we do this, but external viewers of the datafiles will see them 
-            // mutating.
-            WRITETODATAFILES(h, ab);
-            verify( abLen == ab.len() ); // check again wasn't modded
-            ab.reset();
+            if( hasOps )
+                journalWriter.drain();
 
             // can't : d.dbMutex._remapPrivateViewRequested = true;
             // (writes have happened we released)
@@ -664,6 +960,10 @@ namespace mongo {
                 // there is only one dur thread, "early commits" can be done by other threads)
                 SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
 
+                // commits queued by _groupCommitWithLimitedLocks() must reach the journal and data
+                // files before this one, and before any remap
+                journalWriter.drain();
+
                 commitJob.commitingBegin();
 
                 if( !commitJob.hasWritten() ) {
@@ -677,13 +977,13 @@ namespace mongo {
                     // todo : write to the journal outside locks, as this write can be slow.
                     //        however, be careful then about remapprivateview as that cannot be done 
                     //        if new writes are then pending in the private maps.
-                    WRITETOJOURNAL(h, ab);
+                    WRITETOJOURNAL(h, ab, *stats.curr);
 
                     // data is now in the journal, which is sufficient for acknowledging getLastError.
                     // (ok to crash after that)
                     commitJob.committingNotifyCommitted();
 
-                    WRITETODATAFILES(h, ab);
+                    WRITETODATAFILES(h, ab, *stats.curr);
                     debugValidateAllMapsMatch();
 
                     commitJob.committingReset();
@@ -710,9 +1010,12 @@ namespace mongo {
                 //
                 // For durthread, lgw is set, and we can upgrade to a W lock for the remap. we do this way as we don't want 
                 // to be in W the entire time we were committing about (in particular for WRITETOJOURNAL() which takes time).
+                // Where the remap is atomic we stay in R, so readers aren't stalled by the remap at all.
                 if( lgw ) { 
-                    LOG(4) << "_groupCommit upgrade" << endl;
-                    lgw->upgrade();
+                    if( remapNeedsWriteLock ) {
+                        LOG(4) << "_groupCommit upgrade" << endl;
+                        lgw->upgrade();
+                    }
                     REMAPPRIVATEVIEW();
                 }
             }
@@ -846,6 +1149,7 @@ namespace mongo {
                     mongoAbort("exception in durThread");
                 }
             }
+            journalWriter.stop();
             cc().shutdown();
         }
 
@@ -897,6 +1201,7 @@ namespace mongo {
             preallocateFiles();
 
             boost::thread t(durThread);
+            boost::thread tw(journalWriterThread);
         }
 
         void DurableImpl::syncDataAndTruncateJournal() {
@@ -905,6 +1210,7 @@ namespace mongo {
             // a commit from the commit thread won't begin while we are in the write lock,
             // but it may already be in progress and the end of that work is done outside 
             // (dbMutex) locks. This line waits for that to complete if already underway.
+            // commitNow() then waits for the journal writer to finish anything still queued.
             {
                 SimpleMutex::scoped_lock lk(commitJob.groupCommitMutex);
             }
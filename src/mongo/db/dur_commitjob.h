@@ -172,6 +172,14 @@ namespace mongo {
                 groupCommitMutex.dassertLocked();
                 _notify.notifyAll(_commitNumber); 
             }
+            /** the commit number of the commit in progress, for a later notifyCommitted() */
+            NotifyAll::When commitNumber() const {
+                groupCommitMutex.dassertLocked();
+                return _commitNumber;
+            }
+            /** as committingNotifyCommitted() for commit 'when', whose journal write finished
+                after groupCommitMutex was released */
+            void notifyCommitted(NotifyAll::When when) { _notify.notifyAll(when); }
             /** we use the commitjob object over and over, calling reset() rather than reconstructing */
             void committingReset() {
                 groupCommitMutex.dassertLocked();
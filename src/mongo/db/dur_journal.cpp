@@ -722,12 +722,13 @@ namespace mongo {
             @param uncompressed - a buffer that will be written to the journal after compression
             will not return until on disk
         */
-        void WRITETOJOURNAL(JSectHeader h, AlignedBuilder& uncompressed) {
+        void WRITETOJOURNAL(JSectHeader h, AlignedBuilder& uncompressed, Stats::S& s) {
             Timer t;
-            j.journal(h, uncompressed);
-            stats.curr->_writeToJournalMicros += t.micros();
+            s._journaledBytes += j.journal(h, uncompressed);
+            s._uncompressedBytes += uncompressed.len();
+            s._writeToJournalMicros += t.micros();
         }
-        void Journal::journal(const JSectHeader& h, const AlignedBuilder& uncompressed) {
+        unsigned Journal::journal(const JSectHeader& h, const AlignedBuilder& uncompressed) {
             RACECHECK
             static AlignedBuilder b(32*1024*1024);
             /* buffer to journal will be
@@ -742,6 +743,10 @@ namespace mongo {
             {
                 dassert( h.sectionLen() == (unsigned) 0xffffffff ); // we will backfill later
                 b.appendStruct(h);
+                // a pipelined commit's header is prepared while the previous section is still being
+                // written, and that write may rotate to a new file.  we are the only writer, so the
+                // file we are about to append to is the current one.
+                ((JSectHeader*)b.atOfs(0))->fileId = _curFileId;
             }
 
             size_t compressedLength = 0;
@@ -775,11 +780,9 @@ namespace mongo {
                 // must already be open -- so that _curFileId is correct for previous buffer building
                 verify( _curLogFile );
 
-                stats.curr->_uncompressedBytes += uncompressed.len();
                 unsigned w = b.len();
                 _written += w;
                 verify( w <= L );
-                stats.curr->_journaledBytes += L;
                 _curLogFile->synchronousAppend((const void *) b.buf(), L);
                 _rotate();
             }
@@ -787,6 +790,7 @@ namespace mongo {
                 log() << "error exception in dur::journal " << e.what() << endl;
                 throw;
             }
+            return L;
         }
 
     }
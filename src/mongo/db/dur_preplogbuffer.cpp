@@ -95,6 +95,7 @@ namespace mongo {
 
             JEntry e;
             e.len = min(i->length(), (unsigned)(mmf->length() - ofs)); //don't write past end of file
+            mmf->privateBytes() += e.len;
             verify( ofs <= 0x80000000 );
             e.ofs = (unsigned) ofs;
             e.setFileNo( mmf->fileSuffixNo() );
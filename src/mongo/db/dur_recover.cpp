@@ -48,12 +48,14 @@
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/storage/durable_mapped_file.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/storage_options.h"
 #include "mongo/util/bufreader.h"
 #include "mongo/util/checksum.h"
 #include "mongo/util/compress.h"
 #include "mongo/util/concurrency/race.h"
 #include "mongo/util/mongoutils/str.h"
+#include "mongo/util/processinfo.h"
 #include "mongo/util/startup_test.h"
 
 using namespace mongoutils;
@@ -62,6 +64,10 @@ namespace mongo {
 
     namespace dur {
 
+        // threads used to parse journal sections and apply their writes during recovery.  0 means
+        // one per core, 1 recovers serially.
+        MONGO_EXPORT_STARTUP_SERVER_PARAMETER(journalRecoveryThreads, int, 0);
+
         struct ParsedJournalEntry { /*copyable*/
             ParsedJournalEntry() : e(0) { }
 
@@ -196,6 +202,68 @@ namespace mongo {
 
         };
 
+        /** a journal section read ahead during recovery.  parseSection() fills in everything after
+            'f', on one of the recovery threads.
+        */
+        struct ParsedSection { /*copyable*/
+            ParsedSection(const JSectHeader *h, const void *data, unsigned len, const JSectFooter *f) :
+                h(h), data(data), len(len), f(f), hasOps(false), abrupt(false), errCode(0) { }
+
+            const JSectHeader *h;  // pointers into the memory mapped journal file
+            const void *data;
+            unsigned len;
+            const JSectFooter *f;
+
+            shared_ptr<JournalSectionIterator> i; // owns the uncompressed data the entries point into
+            vector<ParsedJournalEntry> entries;
+            bool hasOps;      // has DurOp entries, which are applied serially
+            bool abrupt;      // the section ended prematurely
+            int errCode;      // else nonzero if the section could not be parsed or its checksum is bad
+            string errMsg;
+        };
+
+        static void parseSection(ParsedSection *s) {
+            try {
+                s->i.reset(new JournalSectionIterator(*s->h, s->data, s->len, true));
+                ParsedJournalEntry e;
+                while( !s->i->atEof() ) {
+                    s->i->next(e);
+                    if( e.op )
+                        s->hasOps = true;
+                    s->entries.push_back(e);
+                }
+                verify( ((const char *)s->h) + sizeof(JSectHeader) == s->data );
+                if( !s->f->checkHash(s->h, s->len + sizeof(JSectHeader)) ) {
+                    msgasserted(13594, "journal checksum doesn't match");
+                }
+            }
+            catch( BufReader::eof& ) {
+                s->abrupt = true;
+            }
+            catch( DBException& e ) {
+                s->errCode = e.getCode();
+                s->errMsg = e.what();
+            }
+        }
+
+        /** a basic write resolved to the data file it goes to */
+        struct PendingWrite {
+            PendingWrite(DurableMappedFile *mmf, const JEntry *e) : mmf(mmf), e(e) { }
+            DurableMappedFile *mmf;
+            const JEntry *e;
+        };
+
+        /** apply writes in order.  each data file's writes all go to the same thread, so writes to a
+            file are applied in journal order while different files are written concurrently.
+        */
+        static void applyPendingWrites(const vector<PendingWrite> *writes, unsigned long long *bytes) {
+            for( vector<PendingWrite>::const_iterator i = writes->begin(); i != writes->end(); ++i ) {
+                void* dest = (char*)i->mmf->view_write() + i->e->ofs;
+                memcpy(dest, i->e->srcData(), i->e->len);
+                *bytes += i->e->len;
+            }
+        }
+
         static string fileName(const char* dbName, int fileNo) {
             stringstream ss;
             ss << dbName << '.';
@@ -280,7 +348,7 @@ namespace mongo {
 
                 void* dest = (char*)mmf->view_write() + entry.e->ofs;
                 memcpy(dest, entry.e->srcData(), entry.e->len);
-                stats.curr->_writeToDataFilesBytes += entry.e->len;
+                _bytesWritten += entry.e->len;
             }
             else {
                 massert(13622, "Trying to write past end of file in WRITETODATAFILES", _recovering);
@@ -365,11 +433,8 @@ namespace mongo {
                 log() << "END section" << endl;
         }
 
-        void RecoveryJob::processSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f) {
-            LockMongoFilesShared lkFiles; // for RecoveryJob::Last
-            scoped_lock lk(_mx);
-            RACECHECK
-
+        /** @return true if the section's writes were already in the data files synced before the crash */
+        bool RecoveryJob::skipSection(const JSectHeader *h) {
             /** todo: we should really verify the checksum to see that seqNumber is ok?
                       that is expensive maybe there is some sort of checksum of just the header 
                       within the header itself
@@ -385,8 +450,18 @@ namespace mongo {
                     }
                     _lastSeqMentionedInConsoleLog = h->seqNumber;
                 }
-                return;
+                return true;
             }
+            return false;
+        }
+
+        void RecoveryJob::processSection(const JSectHeader *h, const void *p, unsigned len, const JSectFooter *f) {
+            LockMongoFilesShared lkFiles; // for RecoveryJob::Last
+            scoped_lock lk(_mx);
+            RACECHECK
+
+            if( skipSection(h) )
+                return;
 
             auto_ptr<JournalSectionIterator> i;
             if( _recovering ) {
@@ -428,11 +503,115 @@ namespace mongo {
             applyEntries(entries);
         }
 
+        /** parse the sections in parallel, then apply them in order up to the first bad one.  runs of
+            sections without DurOps have their writes applied in parallel by data file.
+            @return true if a section ended prematurely, ie the end of the journal
+        */
+        bool RecoveryJob::processSections(vector<ParsedSection>& sections) {
+            if( sections.empty() )
+                return false;
+
+            LockMongoFilesShared lkFiles; // for RecoveryJob::Last
+            scoped_lock lk(_mx);
+
+            for( size_t i = 0; i < sections.size(); i++ )
+                _pool->schedule(parseSection, &sections[i]);
+            _pool->join();
+
+            size_t good = 0;
+            while( good < sections.size() && !sections[good].abrupt && !sections[good].errCode )
+                good++;
+
+            const bool apply = (storageGlobalParams.durOptions &
+                                StorageGlobalParams::DurScanOnly) == 0;
+            size_t i = 0;
+            while( i < good ) {
+                if( sections[i].hasOps ) {
+                    applyEntries(sections[i].entries);
+                    i++;
+                    continue;
+                }
+                size_t end = i + 1;
+                while( end < good && !sections[end].hasOps )
+                    end++;
+                if( apply )
+                    applyWrites(sections, i, end);
+                i = end;
+            }
+
+            if( good < sections.size() ) {
+                ParsedSection& bad = sections[good];
+                if( bad.errCode )
+                    msgasserted(bad.errCode, bad.errMsg);
+            }
+            bool abrupt = good < sections.size();
+            sections.clear();
+            return abrupt;
+        }
+
+        void RecoveryJob::applyWrites(const vector<ParsedSection>& sections, size_t from, size_t to) {
+            // resolve the data files here, as opening them can't be done from the other threads
+            map< pair<string,int>, pair<DurableMappedFile*,unsigned> > files;
+            vector< vector<PendingWrite> > writes(_nThreads);
+
+            const char *lastDbName = 0;
+            int lastFileNo = -1;
+            pair<DurableMappedFile*,unsigned> last(0, 0);
+            for( size_t s = from; s < to; s++ ) {
+                const vector<ParsedJournalEntry>& entries = sections[s].entries;
+                for( vector<ParsedJournalEntry>::const_iterator i = entries.begin(); i != entries.end(); ++i ) {
+                    verify(i->e);
+                    if( i->dbName != lastDbName || i->e->getFileNo() != lastFileNo ) {
+                        verify(i->dbName);
+                        pair<string,int> key(i->dbName, i->e->getFileNo());
+                        map< pair<string,int>, pair<DurableMappedFile*,unsigned> >::iterator f = files.find(key);
+                        if( f == files.end() ) {
+                            DurableMappedFile *mmf = getDurableMappedFile(*i);
+                            verify(mmf->view_write());
+                            unsigned thread = files.size() % _nThreads;
+                            f = files.insert(make_pair(key, make_pair(mmf, thread))).first;
+                        }
+                        last = f->second;
+                        lastDbName = i->dbName;
+                        lastFileNo = i->e->getFileNo();
+                    }
+
+                    // a write past the end of the file is skipped, as in write()
+                    if( (i->e->ofs + i->e->len) <= last.first->length() )
+                        writes[last.second].push_back(PendingWrite(last.first, i->e));
+                }
+            }
+
+            vector<unsigned long long> bytes(_nThreads, 0);
+            for( unsigned t = 0; t < _nThreads; t++ ) {
+                if( !writes[t].empty() )
+                    _pool->schedule(applyPendingWrites, &writes[t], &bytes[t]);
+            }
+            _pool->join();
+
+            for( unsigned t = 0; t < _nThreads; t++ )
+                _bytesWritten += bytes[t];
+        }
+
+        unsigned long long RecoveryJob::takeBytesWritten() {
+            scoped_lock lk(_mx);
+            unsigned long long n = _bytesWritten;
+            _bytesWritten = 0;
+            return n;
+        }
+
         /** apply a specific journal file, that is already mmap'd
             @param p start of the memory mapped file
             @return true if this is detected to be the last file (ends abruptly)
         */
         bool RecoveryJob::processFileBuffer(const void *p, unsigned len) {
+            // dumping the journal logs it in order, so is done serially
+            const bool parallel = _pool &&
+                (storageGlobalParams.durOptions & StorageGlobalParams::DurDumpJournal) == 0;
+            // limits how much of the journal is uncompressed at once
+            const unsigned long long MaxPendingBytes = 256 * 1024 * 1024;
+            vector<ParsedSection> pending;
+            unsigned long long pendingBytes = 0;
             try {
                 unsigned long long fileId;
                 BufReader br(p,len);
@@ -475,6 +654,7 @@ namespace mongo {
                             log() << "Ending processFileBuffer at differing fileId want:" << fileId << " got:" << h.fileId << endl;
                             log() << "  sect len:" << h.sectionLen() << " seqnum:" << h.seqNumber << endl;
                         }
+                        processSections(pending);
                         return true;
                     }
                     unsigned slen = h.sectionLen();
@@ -482,15 +662,31 @@ namespace mongo {
                     const char *hdr = (const char *) br.skip(h.sectionLenWithPadding());
                     const char *data = hdr + sizeof(JSectHeader);
                     const char *footer = data + dataLen;
-                    processSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer);
+                    if( parallel ) {
+                        if( !skipSection((const JSectHeader*) hdr) ) {
+                            pending.push_back(ParsedSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer));
+                            pendingBytes += dataLen;
+                        }
+                        if( pending.size() >= 4 * _nThreads || pendingBytes >= MaxPendingBytes ) {
+                            pendingBytes = 0;
+                            if( processSections(pending) )
+                                return true;
+                        }
+                    }
+                    else {
+                        processSection((const JSectHeader*) hdr, data, dataLen, (const JSectFooter*) footer);
+                    }
 
                     // ctrl c check
                     killCurrentOp.checkForInterrupt(false);
                 }
+                if( processSections(pending) )
+                    return true;
             }
             catch( BufReader::eof& ) {
                 if (storageGlobalParams.durOptions & StorageGlobalParams::DurDumpJournal)
                     log() << "ABRUPT END" << endl;
+                processSections(pending);
                 return true; // abrupt end
             }
 
@@ -517,26 +713,47 @@ namespace mongo {
             return processFileBuffer(p, (unsigned) f.length());
         }
 
-        /** @param files all the j._0 style files we need to apply for recovery */
-        void RecoveryJob::go(vector<boost::filesystem::path>& files) {
-            log() << "recover begin" << endl;
+        void RecoveryJob::applyFiles(const vector<boost::filesystem::path>& files) {
             LockMongoFilesExclusive lkFiles; // for RecoveryJob::Last
             _recovering = true;
 
-            // load the last sequence number synced to the datafiles on disk before the last crash
-            _lastDataSyncedFromLastRun = journalReadLSN();
-            log() << "recover lsn: " << _lastDataSyncedFromLastRun << endl;
+            _nThreads = journalRecoveryThreads > 0 ? journalRecoveryThreads : ProcessInfo().getNumCores();
+            if( _nThreads > 1 ) {
+                log() << "recover using " << _nThreads << " threads" << endl;
+                _pool.reset(new ThreadPool(_nThreads));
+            }
 
-            for( unsigned i = 0; i != files.size(); ++i ) {
-                bool abruptEnd = processFile(files[i]);
-                if( abruptEnd && i+1 < files.size() ) {
-                    log() << "recover error: abrupt end to file " << files[i].string() << ", yet it isn't the last journal file" << endl;
-                    close();
-                    uasserted(13535, "recover abrupt journal file end");
+            try {
+                for( unsigned i = 0; i != files.size(); ++i ) {
+                    bool abruptEnd = processFile(files[i]);
+                    if( abruptEnd && i+1 < files.size() ) {
+                        log() << "recover error: abrupt end to file " << files[i].string() << ", yet it isn't the last journal file" << endl;
+                        uasserted(13535, "recover abrupt journal file end");
+                    }
                 }
             }
+            catch(...) {
+                _pool.reset();
+                close();
+                _recovering = false;
+                throw;
+            }
 
+            _pool.reset();
             close();
+            _recovering = false;
+            stats.curr->_writeToDataFilesBytes += takeBytesWritten();
+        }
+
+        /** @param files all the j._0 style files we need to apply for recovery */
+        void RecoveryJob::go(vector<boost::filesystem::path>& files) {
+            log() << "recover begin" << endl;
+
+            // load the last sequence number synced to the datafiles on disk before the last crash
+            _lastDataSyncedFromLastRun = journalReadLSN();
+            log() << "recover lsn: " << _lastDataSyncedFromLastRun << endl;
+
+            applyFiles(files);
 
             if (storageGlobalParams.durOptions & StorageGlobalParams::DurScanOnly) {
                 uasserted(13545, str::stream() << "--durOptions "
@@ -548,7 +765,6 @@ namespace mongo {
             removeJournalFiles();
             log() << "recover done" << endl;
             okToCleanUp = true;
-            _recovering = false;
         }
 
         void _recover() {
@@ -31,10 +31,12 @@
 #pragma once
 
 #include <boost/filesystem/operations.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <list>
 
 #include "mongo/db/dur_journalformat.h"
 #include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/thread_pool.h"
 #include "mongo/util/file.h"
 
 namespace mongo {
@@ -42,6 +44,7 @@ namespace mongo {
 
     namespace dur {
         struct ParsedJournalEntry;
+        struct ParsedSection;
 
         /** call go() to execute a recovery from existing journal files.
          */
@@ -56,16 +59,25 @@ namespace mongo {
                 int fileNo;
             } last;        
         public:
-            RecoveryJob() : _lastDataSyncedFromLastRun(0), 
-                _mx("recovery"), _recovering(false) { _lastSeqMentionedInConsoleLog = 1; }
+            RecoveryJob() : _lastDataSyncedFromLastRun(0), _bytesWritten(0),
+                _mx("recovery"), _recovering(false), _nThreads(1) { _lastSeqMentionedInConsoleLog = 1; }
             void go(vector<boost::filesystem::path>& files);
             ~RecoveryJob();
 
+            /** apply the journal files to the data files, as go() does, but without the lsn check
+                or removing the journal afterwards.  throws if a file other than the last ends
+                abruptly.
+            */
+            void applyFiles(const vector<boost::filesystem::path>& files);
+
             /** @param data data between header and footer. compressed if recovering. */
             void processSection(const JSectHeader *h, const void *data, unsigned len, const JSectFooter *f);
 
             void close(); // locks and calls _close()
 
+            /** @return bytes written to the data files since the last call */
+            unsigned long long takeBytesWritten();
+
             static RecoveryJob & get() { return _instance; }
         private:
             void write(Last& last, const ParsedJournalEntry& entry); // actually writes to the file
@@ -73,6 +85,12 @@ namespace mongo {
             void applyEntries(const vector<ParsedJournalEntry> &entries);
             bool processFileBuffer(const void *, unsigned len);
             bool processFile(boost::filesystem::path journalfile);
+            bool skipSection(const JSectHeader *h);
+
+            // recovery with _nThreads > 1 parses sections, and applies the writes of runs of sections
+            // to different data files, in parallel
+            bool processSections(vector<ParsedSection>& sections);
+            void applyWrites(const vector<ParsedSection>& sections, size_t from, size_t to);
             void _close(); // doesn't lock
             DurableMappedFile* getDurableMappedFile(const ParsedJournalEntry& entry);
 
@@ -80,10 +98,13 @@ namespace mongo {
 
             unsigned long long _lastDataSyncedFromLastRun;
             unsigned long long _lastSeqMentionedInConsoleLog;
+            unsigned long long _bytesWritten; // see takeBytesWritten()
         public:
-            mongo::mutex _mx; // protects _mmfs
+            mongo::mutex _mx; // protects _mmfs and _bytesWritten
         private:
             bool _recovering; // are we in recovery or WRITETODATAFILES
+            unsigned _nThreads;
+            boost::scoped_ptr<ThreadPool> _pool; // while recovering with _nThreads > 1
 
             static RecoveryJob &_instance;
         };
@@ -33,17 +33,23 @@ namespace mongo {
 
         /** journaling stats.  the model here is that the commit thread is the only writer, and that reads are
             uncommon (from a serverStatus command and such).  Thus, there should not be multicore chatter overhead.
+            the journal writer thread of a pipelined commit counts its write stage fields in an S of its own
+            while writing, then addWrites() them to curr in writerMutex, so that rotate() can't switch or reset
+            curr under it and never waits for the journal I/O.
         */
         struct Stats {
             Stats();
             void rotate();
             BSONObj asObj();
             unsigned _intervalMicros;
+            SimpleMutex writerMutex;
             struct S {
                 BSONObj _asObj();
                 string _asCSV();
                 string _CSVHeader();
                 void reset();
+                void noteRemapStall(unsigned long long micros);
+                void addWrites(const S& w); // adds w's journal and data file write fields
 
                 unsigned _commits;
                 unsigned _earlyCommits; // count of early commits from commitIfNeeded() or from getDur().commitNow()
@@ -56,6 +62,18 @@ namespace mongo {
                 unsigned long long _writeToDataFilesMicros;
                 unsigned long long _remapPrivateViewMicros;
 
+                // histogram of how long each REMAPPRIVATEVIEW held off writers (and readers too if
+                // in W).  buckets are <1ms, <4ms, <16ms ... <1024ms, and >=1024ms.
+                enum { NRemapStallBuckets = 7 };
+                unsigned _remapStalls[NRemapStallBuckets];
+
+                // pipelined commits, whose journal and data file writes overlap preparing the next
+                // commit's log buffer.  the queue holds commits prepared but not yet written.
+                unsigned _pipelinedCommits;
+                unsigned _maxQueueDepth;
+                // time a commit waited for the journal writer to free a log buffer
+                unsigned long long _waitForWriterMicros;
+
                 // undesirable to be in write lock for the group commit (it can be done in a read lock), so good if we
                 // have visibility when this happens.  can happen for a couple reasons
                 // - read lock starvation
@@ -98,14 +98,15 @@ namespace mongo {
             @see https://docs.google.com/drawings/edit?id=1TklsmZzm7ohIZkwgeK6rMvsdaR13KjtJYMsfLr175Zc&hl=en
         */
 
-        void WRITETODATAFILES(const JSectHeader& h, AlignedBuilder& uncompressed) {
+        void WRITETODATAFILES(const JSectHeader& h, AlignedBuilder& uncompressed, Stats::S& s) {
 #ifdef _WIN32
             SimpleMutex::scoped_lock _globalFlushMutex(globalFlushMutex);
 #endif
             Timer t;
             WRITETODATAFILES_Impl1(h, uncompressed);
+            s._writeToDataFilesBytes += RecoveryJob::get().takeBytesWritten();
             unsigned long long m = t.micros();
-            stats.curr->_writeToDataFilesMicros += m;
+            s._writeToDataFilesMicros += m;
             LOG(2) << "journal WRITETODATAFILES " << m / 1000.0 << "ms" << endl;
         }
 
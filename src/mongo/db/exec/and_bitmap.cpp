@@ -0,0 +1,202 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/and_bitmap.h"
+
+#include <algorithm>
+
+#include "mongo/db/exec/working_set_common.h"
+
+namespace mongo {
+
+    AndBitmapStage::AndBitmapStage(WorkingSet* ws)
+        : _ws(ws),
+          _currentChild(0),
+          _nextLoc(0, 0) { }
+
+    AndBitmapStage::~AndBitmapStage() {
+        for (size_t i = 0; i < _children.size(); ++i) { delete _children[i]; }
+    }
+
+    void AndBitmapStage::addChild(PlanStage* child) { _children.push_back(child); }
+
+    bool AndBitmapStage::isEOF() {
+        // We're not done until every child has been read.
+        if (_currentChild < _children.size()) { return false; }
+
+        // Then we're done when everything in the intersection has been returned.
+        return _result.empty();
+    }
+
+    PlanStage::StageState AndBitmapStage::work(WorkingSetID* out) {
+        ++_commonStats.works;
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        if (_currentChild < _children.size()) {
+            return readChild(out);
+        }
+
+        // Every child has been read.  Return the intersection in DiskLoc order, forgetting each
+        // DiskLoc as it is returned.
+        DiskLoc loc;
+        verify(_result.next(_nextLoc, &loc));
+        _result.remove(loc);
+        _nextLoc = loc;
+
+        WorkingSetID id = _ws->allocate();
+        WorkingSetMember* member = _ws->get(id);
+        member->loc = loc;
+        member->state = WorkingSetMember::LOC_AND_IDX;
+
+        *out = id;
+        ++_commonStats.advanced;
+        return PlanStage::ADVANCED;
+    }
+
+    PlanStage::StageState AndBitmapStage::readChild(WorkingSetID* out) {
+        WorkingSetID id;
+        StageState childStatus = _children[_currentChild]->work(&id);
+
+        if (PlanStage::ADVANCED == childStatus) {
+            WorkingSetMember* member = _ws->get(id);
+
+            // Maybe the child had an invalidation.  We intersect DiskLoc(s) so we can't do anything
+            // with this WSM.
+            if (!member->hasLoc()) {
+                _ws->flagForReview(id);
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
+
+            // Only the DiskLoc matters to us.  Nothing is fetched until after the intersection.
+            _current.add(member->loc);
+            _ws->free(id);
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+        else if (PlanStage::IS_EOF == childStatus) {
+            // Finished with a child.
+            if (0 == _currentChild) {
+                _result.swap(_current);
+            }
+            else {
+                _result.intersectWith(_current);
+            }
+            _specificStats.memUsage = std::max(_specificStats.memUsage,
+                                               _result.memUsage() + _current.memUsage());
+            _current.clear();
+            _specificStats.bitmapAfterChild.push_back(_result.size());
+            ++_currentChild;
+
+            // _result is now the intersection of the first _currentChild nodes.  If it's empty
+            // there's no point reading any more children.
+            if (_result.empty()) {
+                _currentChild = _children.size();
+                return PlanStage::IS_EOF;
+            }
+
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+        else {
+            if (PlanStage::NEED_FETCH == childStatus) {
+                *out = id;
+                ++_commonStats.needFetch;
+            }
+            else if (PlanStage::NEED_TIME == childStatus) {
+                ++_commonStats.needTime;
+            }
+
+            return childStatus;
+        }
+    }
+
+    void AndBitmapStage::prepareToYield() {
+        ++_commonStats.yields;
+
+        for (size_t i = 0; i < _children.size(); ++i) {
+            _children[i]->prepareToYield();
+        }
+    }
+
+    void AndBitmapStage::recoverFromYield() {
+        ++_commonStats.unyields;
+
+        for (size_t i = 0; i < _children.size(); ++i) {
+            _children[i]->recoverFromYield();
+        }
+    }
+
+    void AndBitmapStage::invalidate(const DiskLoc& dl, InvalidationType type) {
+        ++_commonStats.invalidates;
+
+        if (isEOF()) { return; }
+
+        for (size_t i = 0; i < _children.size(); ++i) {
+            _children[i]->invalidate(dl, type);
+        }
+
+        // While the first child is being read its DiskLocs are the candidates.  After that only
+        // DiskLocs in the intersection so far can still be returned.
+        bool reading = _currentChild < _children.size();
+        bool wasCandidate = (0 == _currentChild) ? _current.remove(dl) : _result.remove(dl);
+        _current.remove(dl);
+
+        if (!wasCandidate) { return; }
+
+        // As in AndHashStage: whether it's a deletion or a mutation, we can't keep AND-ing by
+        // DiskLoc.  So, we fetch it, flag it and try to pick it up later.
+        if (reading) {
+            ++_specificStats.flaggedInProgress;
+        }
+        else {
+            ++_specificStats.flaggedButPassed;
+        }
+
+        WorkingSetID id = _ws->allocate();
+        WorkingSetMember* member = _ws->get(id);
+        member->loc = dl;
+        member->state = WorkingSetMember::LOC_AND_IDX;
+        WorkingSetCommon::fetchAndInvalidateLoc(member);
+        _ws->flagForReview(id);
+    }
+
+    PlanStageStats* AndBitmapStage::getStats() {
+        _commonStats.isEOF = isEOF();
+
+        auto_ptr<PlanStageStats> ret(new PlanStageStats(_commonStats, STAGE_AND_BITMAP));
+        ret->specific.reset(new AndBitmapStats(_specificStats));
+        for (size_t i = 0; i < _children.size(); ++i) {
+            ret->children.push_back(_children[i]->getStats());
+        }
+
+        return ret.release();
+    }
+
+}  // namespace mongo
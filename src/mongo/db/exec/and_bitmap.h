@@ -0,0 +1,97 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/db/exec/disk_loc_bitmap.h"
+#include "mongo/db/exec/plan_stage.h"
+
+namespace mongo {
+
+    /**
+     * Reads from N children, each of which must have a valid DiskLoc.  Each child's DiskLocs are
+     * gathered into a DiskLocBitmap which is intersected with the bitmaps of the children before
+     * it.  The intersection is output in DiskLoc order.
+     *
+     * Children's WSMs are freed as soon as their DiskLoc is recorded, so nothing is fetched or
+     * kept per result while intersecting.  Output WSMs have a DiskLoc and nothing else: no
+     * index key data and no object.  A parent stage that needs either must fetch.  For the same
+     * reason this stage takes no filter.
+     *
+     * Preconditions: Valid DiskLoc.  More than one child.
+     *
+     * Any DiskLoc that we keep a reference to that is invalidated before we are able to return it
+     * is fetched and added to the WorkingSet as "flagged for further review."
+     */
+    class AndBitmapStage : public PlanStage {
+    public:
+        AndBitmapStage(WorkingSet* ws);
+        virtual ~AndBitmapStage();
+
+        void addChild(PlanStage* child);
+
+        virtual StageState work(WorkingSetID* out);
+        virtual bool isEOF();
+
+        virtual void prepareToYield();
+        virtual void recoverFromYield();
+        virtual void invalidate(const DiskLoc& dl, InvalidationType type);
+
+        virtual PlanStageStats* getStats();
+
+    private:
+        StageState readChild(WorkingSetID* out);
+
+        // Not owned by us.
+        WorkingSet* _ws;
+
+        // The stages we read from.  Owned by us.
+        std::vector<PlanStage*> _children;
+
+        // The intersection of every child read so far, minus anything already returned.
+        DiskLocBitmap _result;
+
+        // DiskLocs of the child being read.
+        DiskLocBitmap _current;
+
+        // Which child are we currently reading?  Equal to _children.size() once we're returning
+        // results.
+        size_t _currentChild;
+
+        // Every DiskLoc before this one has been returned.
+        DiskLoc _nextLoc;
+
+        // Stats
+        CommonStats _commonStats;
+        AndBitmapStats _specificStats;
+    };
+
+}  // namespace mongo
@@ -33,25 +33,57 @@
 #include "mongo/db/exec/filter.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/extent.h"
+#include "mongo/db/storage/record.h"
+#include "mongo/db/structure/catalog/namespace_details.h"
 #include "mongo/db/structure/collection_iterator.h"
+#include "mongo/util/processinfo.h"
 
 #include "mongo/db/client.h" // XXX-ERH
 #include "mongo/db/pdfile.h" // XXX-ERH/ACM
 
 namespace mongo {
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecCollectionScanThreads, int, 1);
+
+    namespace {
+
+        // How many records each thread tests per round of a parallel scan.
+        const size_t kParallelRoundDocs = 4096;
+
+        bool hasWhere(const MatchExpression* expr) {
+            if (MatchExpression::WHERE == expr->matchType()) {
+                return true;
+            }
+            for (size_t i = 0; i < expr->numChildren(); ++i) {
+                if (hasWhere(expr->getChild(i))) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+    }  // namespace
+
     CollectionScan::CollectionScan(const CollectionScanParams& params,
                                    WorkingSet* workingSet,
                                    const MatchExpression* filter)
         : _workingSet(workingSet),
           _filter(filter),
           _params(params),
-          _nsDropped(false) { }
+          _nsDropped(false),
+          _parallel(false),
+          _nextBuffered(0) { }
 
     PlanStage::StageState CollectionScan::work(WorkingSetID* out) {
         ++_commonStats.works;
         if (_nsDropped) { return PlanStage::DEAD; }
 
+        if (_parallel) {
+            return workParallel(out);
+        }
+
         if (NULL == _iter) {
             Collection* collection = cc().database()->getCollection( _params.ns );
             if ( collection == NULL ) {
@@ -59,6 +91,12 @@ namespace mongo {
                 return PlanStage::DEAD;
             }
 
+            if (startParallel(collection)) {
+                _parallel = true;
+                ++_commonStats.needTime;
+                return PlanStage::NEED_TIME;
+            }
+
             _iter.reset( collection->getIterator( _params.start,
                                                   _params.tailable,
                                                   _params.direction ) );
@@ -107,11 +145,20 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState CollectionScan::workBatch(size_t max,
+                                                    vector<WorkingSetID>* results,
+                                                    WorkingSetID* out) {
+        return workInBatch(this, max, results, out);
+    }
+
     bool CollectionScan::isEOF() {
         if ((0 != _params.maxScan) && (_specificStats.docsTested >= _params.maxScan)) {
             return true;
         }
         if (_nsDropped) { return true; }
+        if (_parallel) {
+            return _nextBuffered == _buffered.size() && parallelScanDone();
+        }
         if (NULL == _iter) { return false; }
         return _iter->isEOF();
     }
@@ -119,6 +166,30 @@ namespace mongo {
     void CollectionScan::invalidate(const DiskLoc& dl, InvalidationType type) {
         ++_commonStats.invalidates;
 
+        if (_parallel) {
+            if (INVALIDATION_MUTATION == type) {
+                // The match was decided on the old version; check again when we return it.
+                _mutated.insert(dl);
+                return;
+            }
+
+            _deleted.insert(dl);
+
+            // Threads stopped at the deleted record move past it, as FlatIterator does.
+            for (size_t i = 0; i < _workers.size(); ++i) {
+                ScanWorker& worker = _workers[i];
+                if (NULL == worker.extent ||
+                    DiskLoc(worker.extent->myLoc.a(), worker.nextOfs) != dl) {
+                    continue;
+                }
+                worker.nextOfs = dl.rec()->nextOfs();
+                if (DiskLoc::NullOfs == worker.nextOfs) {
+                    worker.extent = NULL;
+                }
+            }
+            return;
+        }
+
         // We don't care about mutations since we apply any filters to the result when we (possibly)
         // return it.  Deletions can harm the underlying CollectionIterator so we pass them down.
         if (NULL != _iter && (INVALIDATION_DELETION == type)) {
@@ -141,6 +212,166 @@ namespace mongo {
                 _nsDropped = true;
             }
         }
+        else if (_parallel) {
+            // The threads' extents are only good while the collection is.
+            Database* db = cc().database();
+            if (NULL == db || NULL == db->getCollection(_params.ns)) {
+                warning() << "collection dropped during yield of parallel collscan";
+                _nsDropped = true;
+            }
+        }
+    }
+
+    bool CollectionScan::startParallel(Collection* collection) {
+        size_t threads = internalQueryExecCollectionScanThreads > 0 ?
+            internalQueryExecCollectionScanThreads : ProcessInfo().getNumCores();
+        threads = std::min(threads, _params.parallelism);
+
+        // Anything that cares where the scan starts, how far it goes or what order it returns
+        // documents in stays on one thread, as do filters that run JavaScript.
+        if (threads < 2 ||
+            _params.tailable ||
+            !_params.start.isNull() ||
+            0 != _params.maxScan ||
+            collection->isCapped() ||
+            !collection->documentsAreExtentRecords() ||
+            (NULL != _filter && hasWhere(_filter))) {
+            return false;
+        }
+
+        for (DiskLoc loc = collection->details()->firstExtent(); !loc.isNull(); ) {
+            const Extent* e = loc.ext();
+            _extents.push_back(e);
+            loc = e->xnext;
+        }
+
+        // Only one thread would have anything to do.
+        if (_extents.size() < 2) {
+            _extents.clear();
+            return false;
+        }
+
+        threads = std::min(threads, _extents.size());
+        _workers.resize(threads);
+        _pool.reset(new ThreadPool(threads));
+        return true;
+    }
+
+    bool CollectionScan::parallelScanDone() const {
+        if (_nextExtent.load() < _extents.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < _workers.size(); ++i) {
+            if (NULL != _workers[i].extent) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Status CollectionScan::runParallelRound() {
+        _buffered.clear();
+        _nextBuffered = 0;
+        _deleted.clear();
+        _mutated.clear();
+
+        for (size_t i = 0; i < _workers.size(); ++i) {
+            _pool->schedule(&CollectionScan::scanInThread, this, i);
+        }
+        _pool->join();
+
+        for (size_t i = 0; i < _workers.size(); ++i) {
+            ScanWorker& worker = _workers[i];
+            if (!worker.status.isOK()) {
+                return worker.status;
+            }
+            _specificStats.docsTested += worker.docsTested;
+            worker.docsTested = 0;
+            _buffered.insert(_buffered.end(), worker.matches.begin(), worker.matches.end());
+            worker.matches.clear();
+        }
+        return Status::OK();
+    }
+
+    void CollectionScan::scanInThread(size_t workerIndex) {
+        ScanWorker& worker = _workers[workerIndex];
+        try {
+            while (worker.docsTested < kParallelRoundDocs) {
+                if (NULL == worker.extent) {
+                    unsigned i = _nextExtent.fetchAndAdd(1);
+                    if (i >= _extents.size()) {
+                        return;
+                    }
+                    if (_extents[i]->firstRecord.isNull()) {
+                        continue;
+                    }
+                    worker.extent = _extents[i];
+                    worker.nextOfs = worker.extent->firstRecord.getOfs();
+                }
+
+                // Records are in the same file as their extent.
+                const DiskLoc& extentLoc = worker.extent->myLoc;
+                const char* fileBase =
+                    reinterpret_cast<const char*>(worker.extent) - extentLoc.getOfs();
+                Record* r = reinterpret_cast<Record*>(const_cast<char*>(fileBase) +
+                                                      worker.nextOfs);
+
+                ++worker.docsTested;
+                if (NULL == _filter || _filter->matchesBSON(BSONObj(r->dataNoThrowing()))) {
+                    worker.matches.push_back(DiskLoc(extentLoc.a(), worker.nextOfs));
+                }
+
+                worker.nextOfs = r->np()->nextOfs;
+                if (DiskLoc::NullOfs == worker.nextOfs) {
+                    worker.extent = NULL;
+                }
+            }
+        }
+        catch (const DBException& e) {
+            worker.status = e.toStatus();
+        }
+        catch (const std::exception& e) {
+            worker.status = Status(ErrorCodes::InternalError, e.what());
+        }
+    }
+
+    PlanStage::StageState CollectionScan::workParallel(WorkingSetID* out) {
+        if (_nextBuffered == _buffered.size()) {
+            if (parallelScanDone()) {
+                return PlanStage::IS_EOF;
+            }
+
+            Status status = runParallelRound();
+            if (!status.isOK()) {
+                warning() << "parallel collection scan of " << _params.ns << " failed: "
+                          << status.toString() << endl;
+                return PlanStage::FAILURE;
+            }
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        DiskLoc loc = _buffered[_nextBuffered++];
+        if (_deleted.count(loc)) {
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        WorkingSetID id = _workingSet->allocate();
+        WorkingSetMember* member = _workingSet->get(id);
+        member->loc = loc;
+        member->obj = loc.obj();
+        member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+
+        if (_mutated.count(loc) && !Filter::passes(member, _filter)) {
+            _workingSet->free(id);
+            ++_commonStats.needTime;
+            return PlanStage::NEED_TIME;
+        }
+
+        *out = id;
+        ++_commonStats.advanced;
+        return PlanStage::ADVANCED;
     }
 
     PlanStageStats* CollectionScan::getStats() {
@@ -28,16 +28,26 @@
 
 #pragma once
 
+#include "mongo/base/status.h"
 #include "mongo/db/diskloc.h"
 #include "mongo/db/exec/collection_scan_common.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/matcher/expression.h"
 #include "mongo/db/structure/collection_iterator.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/platform/unordered_set.h"
+#include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
 
+    class Collection;
+    class Extent;
     class WorkingSet;
 
+    // Threads a planned collection scan may use.  1 scans on the query's thread, 0 means one per
+    // core.
+    extern int internalQueryExecCollectionScanThreads;
+
     /**
      * Scans over a collection, starting at the DiskLoc provided in params and continuing until
      * there are no more records in the collection.
@@ -51,6 +61,7 @@ namespace mongo {
                        const MatchExpression* filter);
 
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t max, vector<WorkingSetID>* results, WorkingSetID* out);
         virtual bool isEOF();
 
         virtual void invalidate(const DiskLoc& dl, InvalidationType type);
@@ -73,6 +84,67 @@ namespace mongo {
         // True if nsdetails(_ns) == NULL on our first call to work.
         bool _nsDropped;
 
+        //
+        // Parallel scan.  Threads take extents one at a time and test their records against
+        // _filter, a bounded number per round.  This thread waits for each round, then hands
+        // out the matches.  The threads are idle between rounds, so yields and invalidations
+        // only need to deal with their saved positions.
+        //
+
+        /**
+         * @return true if the scan of 'collection' can and should run on several threads, in
+         *     which case the extents to scan have been collected.
+         */
+        bool startParallel(Collection* collection);
+
+        /**
+         * Has every thread test up to a round's worth of records, then buffers their matches.
+         */
+        Status runParallelRound();
+
+        /**
+         * Runs on a pool thread.  Doesn't touch the Client, so it can't fault in pages itself.
+         */
+        void scanInThread(size_t worker);
+
+        StageState workParallel(WorkingSetID* out);
+
+        // True once every extent has been handed out and scanned to its end.
+        bool parallelScanDone() const;
+
+        // Where one thread is in its scan between rounds.
+        struct ScanWorker {
+            ScanWorker() : extent(NULL), nextOfs(0), docsTested(0), status(Status::OK()) { }
+
+            // The extent being scanned, or NULL if the thread needs another.
+            const Extent* extent;
+
+            // Offset of the next record to test in extent's file.
+            int nextOfs;
+
+            // Found in the current round.
+            std::vector<DiskLoc> matches;
+            size_t docsTested;
+            Status status;
+        };
+
+        bool _parallel;
+
+        // Looked up here as the pool threads don't hold the lock.
+        std::vector<const Extent*> _extents;
+        AtomicUInt32 _nextExtent;
+
+        std::vector<ScanWorker> _workers;
+        scoped_ptr<ThreadPool> _pool;
+
+        // Matches from the last round, handed out in turn.
+        std::vector<DiskLoc> _buffered;
+        size_t _nextBuffered;
+
+        // Buffered matches deleted or changed during a yield since the round that found them.
+        unordered_set<DiskLoc, DiskLoc::Hasher> _deleted;
+        unordered_set<DiskLoc, DiskLoc::Hasher> _mutated;
+
         // Stats
         CommonStats _commonStats;
         CollectionScanStats _specificStats;
@@ -41,7 +41,8 @@ namespace mongo {
         CollectionScanParams() : start(DiskLoc()),
                                  direction(FORWARD),
                                  tailable(false),
-                                 maxScan(0) { }
+                                 maxScan(0),
+                                 parallelism(1) { }
 
         // What collection?
         string ns;
@@ -57,6 +58,11 @@ namespace mongo {
 
         // If non-zero, how many documents will we look at?
         size_t maxScan;
+
+        // How many threads may scan the collection?  A scan on more than one thread hands out
+        // the collection's extents to them and returns documents in no particular order.  Only
+        // done for plain scans of whole, non-capped collections.
+        size_t parallelism;
     };
 
 }  // namespace mongo
@@ -0,0 +1,283 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#include "mongo/db/exec/disk_loc_bitmap.h"
+
+#include <algorithm>
+
+#include "mongo/util/assert_util.h"
+
+namespace mongo {
+
+    namespace {
+
+        // Number of 64 bit words in a bitset container.
+        const size_t kNumWords = (1 << 16) / 64;
+
+        size_t countBits(uint64_t word) {
+            word = word - ((word >> 1) & 0x5555555555555555ULL);
+            word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+            word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+            return (word * 0x0101010101010101ULL) >> 56;
+        }
+
+        // Index of the lowest set bit of a non-zero word.
+        int lowestBit(uint64_t word) {
+            int bit = 0;
+            while (0 == (word & 0xFFFF)) { word >>= 16; bit += 16; }
+            while (0 == (word & 1)) { word >>= 1; ++bit; }
+            return bit;
+        }
+
+    }  // namespace
+
+    //
+    // Container
+    //
+
+    bool DiskLocBitmap::Container::add(uint16_t low) {
+        if (isBitset()) {
+            uint64_t mask = 1ULL << (low % 64);
+            if (_bits[low / 64] & mask) { return false; }
+            _bits[low / 64] |= mask;
+            ++_count;
+            return true;
+        }
+
+        std::vector<uint16_t>::iterator it = std::lower_bound(_array.begin(), _array.end(), low);
+        if (_array.end() != it && *it == low) { return false; }
+        _array.insert(it, low);
+        ++_count;
+
+        if (_count > kMaxArraySize) { toBitset(); }
+        return true;
+    }
+
+    bool DiskLocBitmap::Container::remove(uint16_t low) {
+        if (isBitset()) {
+            uint64_t mask = 1ULL << (low % 64);
+            if (0 == (_bits[low / 64] & mask)) { return false; }
+            _bits[low / 64] &= ~mask;
+            --_count;
+
+            if (_count <= kMaxArraySize) { toArray(); }
+            return true;
+        }
+
+        std::vector<uint16_t>::iterator it = std::lower_bound(_array.begin(), _array.end(), low);
+        if (_array.end() == it || *it != low) { return false; }
+        _array.erase(it);
+        --_count;
+        return true;
+    }
+
+    bool DiskLocBitmap::Container::contains(uint16_t low) const {
+        if (isBitset()) {
+            return 0 != (_bits[low / 64] & (1ULL << (low % 64)));
+        }
+        return std::binary_search(_array.begin(), _array.end(), low);
+    }
+
+    void DiskLocBitmap::Container::intersectWith(const Container& other) {
+        if (isBitset() && other.isBitset()) {
+            _count = 0;
+            for (size_t i = 0; i < kNumWords; ++i) {
+                _bits[i] &= other._bits[i];
+                _count += countBits(_bits[i]);
+            }
+            if (_count <= kMaxArraySize) { toArray(); }
+            return;
+        }
+
+        // At least one side is an array, so the result is no larger than that array.
+        const Container& probe = isBitset() ? *this : other;
+        const std::vector<uint16_t>& candidates = isBitset() ? other._array : _array;
+        std::vector<uint16_t> result;
+        result.reserve(candidates.size());
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (probe.contains(candidates[i])) { result.push_back(candidates[i]); }
+        }
+
+        _array.swap(result);
+        std::vector<uint64_t>().swap(_bits);
+        _count = _array.size();
+    }
+
+    bool DiskLocBitmap::Container::next(uint32_t start, uint16_t* out) const {
+        if (start > 0xFFFF) { return false; }
+
+        if (!isBitset()) {
+            std::vector<uint16_t>::const_iterator it =
+                std::lower_bound(_array.begin(), _array.end(), static_cast<uint16_t>(start));
+            if (_array.end() == it) { return false; }
+            *out = *it;
+            return true;
+        }
+
+        size_t word = start / 64;
+        uint64_t bits = _bits[word] & (~0ULL << (start % 64));
+        while (0 == bits) {
+            if (++word == kNumWords) { return false; }
+            bits = _bits[word];
+        }
+        *out = static_cast<uint16_t>(word * 64 + lowestBit(bits));
+        return true;
+    }
+
+    size_t DiskLocBitmap::Container::memUsage() const {
+        return _array.capacity() * sizeof(uint16_t) + _bits.capacity() * sizeof(uint64_t);
+    }
+
+    void DiskLocBitmap::Container::toBitset() {
+        _bits.assign(kNumWords, 0);
+        for (size_t i = 0; i < _array.size(); ++i) {
+            _bits[_array[i] / 64] |= 1ULL << (_array[i] % 64);
+        }
+        std::vector<uint16_t>().swap(_array);
+    }
+
+    void DiskLocBitmap::Container::toArray() {
+        std::vector<uint16_t> array;
+        array.reserve(_count);
+        for (size_t i = 0; i < kNumWords; ++i) {
+            uint64_t bits = _bits[i];
+            while (0 != bits) {
+                array.push_back(static_cast<uint16_t>(i * 64 + lowestBit(bits)));
+                bits &= bits - 1;
+            }
+        }
+        _array.swap(array);
+        std::vector<uint64_t>().swap(_bits);
+    }
+
+    //
+    // DiskLocBitmap
+    //
+
+    DiskLocBitmap::DiskLocBitmap() : _size(0) { }
+
+    // static
+    uint64_t DiskLocBitmap::containerKey(const DiskLoc& loc) {
+        return (static_cast<uint64_t>(loc.a()) << 16) | (static_cast<uint32_t>(loc.getOfs()) >> 16);
+    }
+
+    bool DiskLocBitmap::add(const DiskLoc& loc) {
+        invariant(!loc.isNull() && loc.a() >= 0 && loc.getOfs() >= 0);
+        if (!_containers[containerKey(loc)].add(static_cast<uint16_t>(loc.getOfs()))) {
+            return false;
+        }
+        ++_size;
+        return true;
+    }
+
+    bool DiskLocBitmap::remove(const DiskLoc& loc) {
+        ContainerMap::iterator it = _containers.find(containerKey(loc));
+        if (_containers.end() == it) { return false; }
+        if (!it->second.remove(static_cast<uint16_t>(loc.getOfs()))) { return false; }
+
+        --_size;
+        if (0 == it->second.size()) { _containers.erase(it); }
+        return true;
+    }
+
+    bool DiskLocBitmap::contains(const DiskLoc& loc) const {
+        ContainerMap::const_iterator it = _containers.find(containerKey(loc));
+        if (_containers.end() == it) { return false; }
+        return it->second.contains(static_cast<uint16_t>(loc.getOfs()));
+    }
+
+    void DiskLocBitmap::intersectWith(const DiskLocBitmap& other) {
+        ContainerMap::iterator it = _containers.begin();
+        ContainerMap::const_iterator otherIt = other._containers.begin();
+        _size = 0;
+
+        while (_containers.end() != it) {
+            // Skip the containers of 'other' that come before this one.
+            while (other._containers.end() != otherIt && otherIt->first < it->first) {
+                ++otherIt;
+            }
+
+            if (other._containers.end() != otherIt && otherIt->first == it->first) {
+                it->second.intersectWith(otherIt->second);
+            }
+            else {
+                // Nothing in 'other' shares this container.
+                _containers.erase(it++);
+                continue;
+            }
+
+            if (0 == it->second.size()) {
+                _containers.erase(it++);
+            }
+            else {
+                _size += it->second.size();
+                ++it;
+            }
+        }
+    }
+
+    bool DiskLocBitmap::next(const DiskLoc& start, DiskLoc* out) const {
+        uint64_t startKey = 0;
+        uint32_t startLow = 0;
+        if (start.a() >= 0) {
+            startKey = containerKey(start);
+            startLow = static_cast<uint16_t>(start.getOfs());
+        }
+
+        for (ContainerMap::const_iterator it = _containers.lower_bound(startKey);
+             _containers.end() != it; ++it) {
+            uint16_t low;
+            if (it->second.next(it->first == startKey ? startLow : 0, &low)) {
+                int file = static_cast<int>(it->first >> 16);
+                int ofs = static_cast<int>(((it->first & 0xFFFF) << 16) | low);
+                *out = DiskLoc(file, ofs);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void DiskLocBitmap::clear() {
+        _containers.clear();
+        _size = 0;
+    }
+
+    void DiskLocBitmap::swap(DiskLocBitmap& other) {
+        _containers.swap(other._containers);
+        std::swap(_size, other._size);
+    }
+
+    size_t DiskLocBitmap::memUsage() const {
+        size_t total = 0;
+        for (ContainerMap::const_iterator it = _containers.begin(); it != _containers.end(); ++it) {
+            total += sizeof(*it) + it->second.memUsage();
+        }
+        return total;
+    }
+
+}  // namespace mongo
@@ -0,0 +1,140 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "mongo/db/diskloc.h"
+#include "mongo/platform/cstdint.h"
+
+namespace mongo {
+
+    /**
+     * A compressed set of DiskLocs, laid out like a roaring bitmap.
+     *
+     * DiskLocs are grouped by file and by the high 16 bits of their offset.  Each group is
+     * stored in a container holding the low 16 bits of the offsets, either as a sorted array
+     * while the group is sparse or as a 64k bit bitset once it holds more than
+     * kMaxArraySize entries.  Groups are kept in DiskLoc order, so iterating with next()
+     * visits DiskLocs in the order they are laid out on disk.
+     *
+     * Not thread safe.
+     */
+    class DiskLocBitmap {
+    public:
+        DiskLocBitmap();
+
+        /**
+         * Adds 'loc' to the set.  Returns true if it was not already present.
+         * 'loc' must be a valid, non-null DiskLoc.
+         */
+        bool add(const DiskLoc& loc);
+
+        /**
+         * Removes 'loc' from the set.  Returns true if it was present.
+         */
+        bool remove(const DiskLoc& loc);
+
+        bool contains(const DiskLoc& loc) const;
+
+        /**
+         * Keeps only the DiskLocs that are also in 'other'.
+         */
+        void intersectWith(const DiskLocBitmap& other);
+
+        /**
+         * Finds the smallest DiskLoc in the set that is not less than 'start'.  Returns false if
+         * there is none.
+         */
+        bool next(const DiskLoc& start, DiskLoc* out) const;
+
+        size_t size() const { return _size; }
+
+        bool empty() const { return 0 == _size; }
+
+        void clear();
+
+        void swap(DiskLocBitmap& other);
+
+        /**
+         * Approximate number of bytes used by the containers.
+         */
+        size_t memUsage() const;
+
+        // Containers holding more entries than this are stored as bitsets.
+        static const size_t kMaxArraySize = 4096;
+
+    private:
+        /**
+         * The low 16 bits of the offsets of one group of DiskLocs.
+         */
+        class Container {
+        public:
+            Container() : _count(0) { }
+
+            bool add(uint16_t low);
+            bool remove(uint16_t low);
+            bool contains(uint16_t low) const;
+            void intersectWith(const Container& other);
+
+            /**
+             * Finds the smallest entry not less than 'start', which may be past the largest
+             * possible entry.  Returns false if there is none.
+             */
+            bool next(uint32_t start, uint16_t* out) const;
+
+            size_t size() const { return _count; }
+            size_t memUsage() const;
+
+        private:
+            bool isBitset() const { return !_bits.empty(); }
+            void toBitset();
+            void toArray();
+
+            // Sorted.  Only used while !isBitset().
+            std::vector<uint16_t> _array;
+
+            // One bit per possible entry.  Empty unless the container is a bitset.
+            std::vector<uint64_t> _bits;
+
+            size_t _count;
+        };
+
+        typedef std::map<uint64_t, Container> ContainerMap;
+
+        static uint64_t containerKey(const DiskLoc& loc);
+
+        ContainerMap _containers;
+
+        // Total number of DiskLocs in all containers.
+        size_t _size;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,172 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+/**
+ * This file contains tests for mongo/db/exec/disk_loc_bitmap.cpp
+ */
+
+#include "mongo/db/exec/disk_loc_bitmap.h"
+
+#include <set>
+
+#include "mongo/unittest/unittest.h"
+
+using namespace mongo;
+
+namespace {
+
+    // Collects the contents of 'bitmap' in iteration order.
+    std::vector<DiskLoc> contents(const DiskLocBitmap& bitmap) {
+        std::vector<DiskLoc> locs;
+        DiskLoc loc(0, 0);
+        while (bitmap.next(loc, &loc)) {
+            locs.push_back(loc);
+            loc = DiskLoc(loc.a(), loc.getOfs() + 1);
+        }
+        return locs;
+    }
+
+    TEST(DiskLocBitmapTest, Empty) {
+        DiskLocBitmap bitmap;
+        ASSERT_TRUE(bitmap.empty());
+        ASSERT_FALSE(bitmap.contains(DiskLoc(0, 16)));
+        ASSERT_FALSE(bitmap.remove(DiskLoc(0, 16)));
+        DiskLoc loc;
+        ASSERT_FALSE(bitmap.next(DiskLoc(0, 0), &loc));
+    }
+
+    TEST(DiskLocBitmapTest, AddRemoveContains) {
+        DiskLocBitmap bitmap;
+        ASSERT_TRUE(bitmap.add(DiskLoc(0, 16)));
+        ASSERT_FALSE(bitmap.add(DiskLoc(0, 16)));
+        ASSERT_TRUE(bitmap.add(DiskLoc(3, 1 << 20)));
+        ASSERT_EQUALS(bitmap.size(), 2U);
+
+        ASSERT_TRUE(bitmap.contains(DiskLoc(0, 16)));
+        ASSERT_TRUE(bitmap.contains(DiskLoc(3, 1 << 20)));
+        ASSERT_FALSE(bitmap.contains(DiskLoc(1, 16)));
+        ASSERT_FALSE(bitmap.contains(DiskLoc(0, 16 + (1 << 16))));
+
+        ASSERT_TRUE(bitmap.remove(DiskLoc(0, 16)));
+        ASSERT_FALSE(bitmap.remove(DiskLoc(0, 16)));
+        ASSERT_FALSE(bitmap.contains(DiskLoc(0, 16)));
+        ASSERT_EQUALS(bitmap.size(), 1U);
+
+        bitmap.clear();
+        ASSERT_TRUE(bitmap.empty());
+    }
+
+    // Iteration is in DiskLoc order no matter the insertion order.
+    TEST(DiskLocBitmapTest, IterationOrder) {
+        DiskLocBitmap bitmap;
+        std::set<DiskLoc> expected;
+        for (int i = 0; i < 1000; ++i) {
+            DiskLoc loc((i * 7) % 3, ((i * 7919) % 100000) * 8);
+            bitmap.add(loc);
+            expected.insert(loc);
+        }
+        ASSERT_EQUALS(bitmap.size(), expected.size());
+
+        std::vector<DiskLoc> locs = contents(bitmap);
+        ASSERT_EQUALS(locs.size(), expected.size());
+        ASSERT_TRUE(std::equal(locs.begin(), locs.end(), expected.begin()));
+
+        // Starting part way through skips what comes before.
+        DiskLoc loc;
+        ASSERT_TRUE(bitmap.next(DiskLoc(1, 0), &loc));
+        ASSERT_EQUALS(loc, *expected.lower_bound(DiskLoc(1, 0)));
+    }
+
+    // A container switches to a bitset when dense and back to an array when it thins out.
+    TEST(DiskLocBitmapTest, DenseContainer) {
+        DiskLocBitmap bitmap;
+        const int n = DiskLocBitmap::kMaxArraySize * 4;
+        for (int i = n - 1; i >= 0; --i) {
+            ASSERT_TRUE(bitmap.add(DiskLoc(0, i * 4)));
+        }
+        ASSERT_EQUALS(bitmap.size(), static_cast<size_t>(n));
+        ASSERT_TRUE(bitmap.contains(DiskLoc(0, 4)));
+        ASSERT_FALSE(bitmap.contains(DiskLoc(0, 5)));
+
+        std::vector<DiskLoc> locs = contents(bitmap);
+        ASSERT_EQUALS(locs.size(), static_cast<size_t>(n));
+        for (int i = 0; i < n; ++i) {
+            ASSERT_EQUALS(locs[i], DiskLoc(0, i * 4));
+        }
+
+        for (int i = 0; i < n; i += 2) {
+            ASSERT_TRUE(bitmap.remove(DiskLoc(0, i * 4)));
+        }
+        ASSERT_EQUALS(bitmap.size(), static_cast<size_t>(n / 2));
+        ASSERT_FALSE(bitmap.contains(DiskLoc(0, 0)));
+        ASSERT_TRUE(bitmap.contains(DiskLoc(0, 4)));
+        ASSERT_EQUALS(contents(bitmap).size(), static_cast<size_t>(n / 2));
+    }
+
+    TEST(DiskLocBitmapTest, Intersect) {
+        DiskLocBitmap sparse;
+        DiskLocBitmap dense;
+        DiskLocBitmap other;
+        for (int i = 0; i < 20000; ++i) {
+            dense.add(DiskLoc(0, i * 3));
+            other.add(DiskLoc(0, i * 2));
+        }
+        for (int i = 0; i < 100; ++i) {
+            sparse.add(DiskLoc(0, i * 5));
+        }
+        // Only in one side.
+        sparse.add(DiskLoc(2, 0));
+        dense.add(DiskLoc(1, 0));
+
+        // Bitset with bitset.
+        DiskLocBitmap both;
+        both.intersectWith(dense);
+        ASSERT_TRUE(both.empty());
+        both.swap(dense);
+        both.intersectWith(other);
+        std::vector<DiskLoc> locs = contents(both);
+        ASSERT_EQUALS(locs.size(), both.size());
+        for (size_t i = 0; i < locs.size(); ++i) {
+            ASSERT_EQUALS(locs[i], DiskLoc(0, i * 6));
+        }
+
+        // Array with bitset.
+        sparse.intersectWith(both);
+        locs = contents(sparse);
+        ASSERT_EQUALS(locs.size(), 17U);
+        for (size_t i = 0; i < locs.size(); ++i) {
+            ASSERT_EQUALS(locs[i], DiskLoc(0, i * 30));
+        }
+
+        // Bitset with array.
+        both.intersectWith(sparse);
+        ASSERT_EQUALS(both.size(), 17U);
+        ASSERT_TRUE(both.contains(DiskLoc(0, 480)));
+    }
+
+}  // namespace
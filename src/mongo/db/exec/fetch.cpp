@@ -51,6 +51,10 @@ namespace mongo {
             return false;
         }
 
+        if (!_pending.empty()) {
+            return false;
+        }
+
         return _child->isEOF();
     }
 
@@ -76,42 +80,20 @@ namespace mongo {
             return fetchCompleted(out);
         }
 
+        // Results left over from a batch come before anything new from our child.
+        if (!_pending.empty()) {
+            WorkingSetID id = _pending.front();
+            _pending.pop_front();
+            return fetchMember(id, out);
+        }
+
         // If we're here, we're not waiting for a DiskLoc to be fetched.  Get another to-be-fetched
         // result from our child.
         WorkingSetID id;
         StageState status = _child->work(&id);
 
         if (PlanStage::ADVANCED == status) {
-            WorkingSetMember* member = _ws->get(id);
-
-            // If there's an obj there, there is no fetching to perform.
-            if (member->hasObj()) {
-                ++_specificStats.alreadyHasObj;
-                return returnIfMatches(member, id, out);
-            }
-
-            // We need a valid loc to fetch from and this is the only state that has one.
-            verify(WorkingSetMember::LOC_AND_IDX == member->state);
-            verify(member->hasLoc());
-
-            Record* record = member->loc.rec();
-            const char* data = record->dataNoThrowing();
-
-            if (!recordInMemory(data)) {
-                // member->loc points to a record that's NOT in memory.  Pass a fetch request up.
-                verify(WorkingSet::INVALID_ID == _idBeingPagedIn);
-                _idBeingPagedIn = id;
-                *out = id;
-                ++_commonStats.needFetch;
-                return PlanStage::NEED_FETCH;
-            }
-            else {
-                // Don't need index data anymore as we have an obj.
-                member->keyData.clear();
-                member->obj = BSONObj(data);
-                member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
-                return returnIfMatches(member, id, out);
-            }
+            return fetchMember(id, out);
         }
         else {
             if (PlanStage::NEED_FETCH == status) {
@@ -125,6 +107,58 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState FetchStage::workBatch(size_t max,
+                                                vector<WorkingSetID>* results,
+                                                WorkingSetID* out) {
+        // Finish a page-in and the results queued behind it one at a time.
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn || !_pending.empty()) {
+            return workInBatch(this, max, results, out);
+        }
+
+        ++_commonStats.works;
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        size_t numResults = results->size();
+        StageState status = _child->workBatch(max, results, out);
+
+        // Fetch and filter the batch in place.  Once a record needs paging in, the rest of the
+        // batch waits for it.
+        size_t numKept = numResults;
+        for (size_t i = numResults; i < results->size(); ++i) {
+            WorkingSetID id = (*results)[i];
+            if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+                _pending.push_back(id);
+                continue;
+            }
+
+            WorkingSetID fetchedId;
+            if (PlanStage::ADVANCED == fetchMember(id, &fetchedId)) {
+                (*results)[numKept++] = fetchedId;
+            }
+        }
+        results->resize(numKept);
+
+        if (PlanStage::DEAD == status || PlanStage::FAILURE == status) {
+            return status;
+        }
+
+        // Our page-in request goes up in place of whatever stopped the child.  If that was a
+        // page-in request of the child's own, the child reads its record in the lock instead.
+        if (WorkingSet::INVALID_ID != _idBeingPagedIn) {
+            *out = _idBeingPagedIn;
+            return PlanStage::NEED_FETCH;
+        }
+
+        if (PlanStage::NEED_FETCH == status) {
+            ++_commonStats.needFetch;
+        }
+        else if (PlanStage::IS_EOF != status) {
+            status = results->size() > numResults ? PlanStage::ADVANCED : PlanStage::NEED_TIME;
+        }
+        return status;
+    }
+
     void FetchStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
@@ -149,6 +183,15 @@ namespace mongo {
                 WorkingSetCommon::fetchAndInvalidateLoc(member);
             }
         }
+
+        // Same for the results waiting behind it.
+        for (std::deque<WorkingSetID>::const_iterator it = _pending.begin();
+             it != _pending.end(); ++it) {
+            WorkingSetMember* member = _ws->get(*it);
+            if (member->hasLoc() && (member->loc == dl)) {
+                WorkingSetCommon::fetchAndInvalidateLoc(member);
+            }
+        }
     }
 
     PlanStage::StageState FetchStage::fetchCompleted(WorkingSetID* out) {
@@ -184,6 +227,39 @@ namespace mongo {
         return returnIfMatches(member, memberID, out);
     }
 
+    PlanStage::StageState FetchStage::fetchMember(WorkingSetID id, WorkingSetID* out) {
+        WorkingSetMember* member = _ws->get(id);
+
+        // If there's an obj there, there is no fetching to perform.
+        if (member->hasObj()) {
+            ++_specificStats.alreadyHasObj;
+            return returnIfMatches(member, id, out);
+        }
+
+        // We need a valid loc to fetch from and this is the only state that has one.
+        verify(WorkingSetMember::LOC_AND_IDX == member->state);
+        verify(member->hasLoc());
+
+        Record* record = member->loc.rec();
+        const char* data = record->dataNoThrowing();
+
+        if (!recordInMemory(data)) {
+            // member->loc points to a record that's NOT in memory.  Pass a fetch request up.
+            verify(WorkingSet::INVALID_ID == _idBeingPagedIn);
+            _idBeingPagedIn = id;
+            *out = id;
+            ++_commonStats.needFetch;
+            return PlanStage::NEED_FETCH;
+        }
+        else {
+            // Don't need index data anymore as we have an obj.
+            member->keyData.clear();
+            member->obj = BSONObj(data);
+            member->state = WorkingSetMember::LOC_AND_UNOWNED_OBJ;
+            return returnIfMatches(member, id, out);
+        }
+    }
+
     PlanStage::StageState FetchStage::returnIfMatches(WorkingSetMember* member,
                                                       WorkingSetID memberID,
                                                       WorkingSetID* out) {
@@ -28,6 +28,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include "mongo/db/diskloc.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/jsobj.h"
@@ -50,6 +52,7 @@ namespace mongo {
 
         virtual bool isEOF();
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t max, vector<WorkingSetID>* results, WorkingSetID* out);
 
         virtual void prepareToYield();
         virtual void recoverFromYield();
@@ -70,6 +73,12 @@ namespace mongo {
          */
         StageState fetchCompleted(WorkingSetID* out);
 
+        /**
+         * Makes the object for a result 'id' of our child's.  Returns as returnIfMatches does,
+         * or asks for a page-in if the record isn't in memory.
+         */
+        StageState fetchMember(WorkingSetID id, WorkingSetID* out);
+
         // _ws is not owned by us.
         WorkingSet* _ws;
         scoped_ptr<PlanStage> _child;
@@ -81,6 +90,10 @@ namespace mongo {
         // a "please page this in" result and hold on to the WSID until the next call to work(...).
         WorkingSetID _idBeingPagedIn;
 
+        // Results of a batch from our child that were behind _idBeingPagedIn.  We return them
+        // a result at a time before asking the child for more.
+        std::deque<WorkingSetID> _pending;
+
         // Stats
         CommonStats _commonStats;
         FetchStats _specificStats;
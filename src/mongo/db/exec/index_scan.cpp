@@ -186,6 +186,12 @@ namespace mongo {
         return PlanStage::NEED_TIME;
     }
 
+    PlanStage::StageState IndexScan::workBatch(size_t max,
+                                               vector<WorkingSetID>* results,
+                                               WorkingSetID* out) {
+        return workInBatch(this, max, results, out);
+    }
+
     bool IndexScan::isEOF() {
         if (NULL == _indexCursor.get()) {
             // Have to call work() at least once.
@@ -85,6 +85,7 @@ namespace mongo {
         virtual ~IndexScan() { }
 
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t max, vector<WorkingSetID>* results, WorkingSetID* out);
         virtual bool isEOF();
         virtual void prepareToYield();
         virtual void recoverFromYield();
@@ -28,6 +28,8 @@
 
 #include "mongo/db/exec/limit.h"
 
+#include <algorithm>
+
 namespace mongo {
 
     LimitStage::LimitStage(int limit, WorkingSet* ws, PlanStage* child)
@@ -64,6 +66,31 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState LimitStage::workBatch(size_t max,
+                                                vector<WorkingSetID>* results,
+                                                WorkingSetID* out) {
+        ++_commonStats.works;
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        // Never ask for more than we'll return.
+        size_t numResults = results->size();
+        StageState status = _child->workBatch(std::min(max, static_cast<size_t>(_numToReturn)),
+                                              results, out);
+
+        size_t numAdvanced = results->size() - numResults;
+        _numToReturn -= numAdvanced;
+        _commonStats.advanced += numAdvanced;
+
+        if (PlanStage::NEED_FETCH == status) {
+            ++_commonStats.needFetch;
+        }
+        else if (PlanStage::NEED_TIME == status) {
+            ++_commonStats.needTime;
+        }
+        return status;
+    }
+
     void LimitStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
@@ -168,6 +168,20 @@ namespace mongo {
          */
         virtual StageState work(WorkingSetID* out) = 0;
 
+        /**
+         * Batched form of work(), for callers that want many results at once.  Does up to 'max'
+         * units of work, appending each result to 'results'.  Stops early at the first state
+         * other than ADVANCED or NEED_TIME, and returns it; its WorkingSetID, if any, is put in
+         * *out as work() would.  The results appended before it are still the caller's.
+         * Otherwise returns ADVANCED if anything was appended and NEED_TIME if not.
+         *
+         * Stages whose results come one at a time from their child override this to take a
+         * batch from the child and process it in one pass, saving a virtual call per stage per
+         * result.
+         */
+        virtual StageState workBatch(size_t max, vector<WorkingSetID>* results,
+                                     WorkingSetID* out);
+
         /**
          * Returns true if no more work can be done on the query / out of results.
          */
@@ -217,6 +231,49 @@ namespace mongo {
          * Caller owns returned pointer.
          */
         virtual PlanStageStats* getStats() = 0;
+
+    protected:
+        /**
+         * The loop behind workBatch().  Stages that have nothing better to do than call their own
+         * work() repeatedly pass 'this' as their own type so that the calls aren't virtual.
+         */
+        template <typename STAGE>
+        static StageState workInBatch(STAGE* stage, size_t max, vector<WorkingSetID>* results,
+                                      WorkingSetID* out) {
+            size_t numResults = results->size();
+            for (size_t i = 0; i < max; ++i) {
+                WorkingSetID id;
+                StageState state = workOnce(stage, &id);
+                if (ADVANCED == state) {
+                    results->push_back(id);
+                }
+                else if (NEED_TIME != state) {
+                    if (NEED_FETCH == state) {
+                        *out = id;
+                    }
+                    return state;
+                }
+            }
+            return results->size() > numResults ? ADVANCED : NEED_TIME;
+        }
+
+    private:
+        template <typename STAGE>
+        static StageState workOnce(STAGE* stage, WorkingSetID* out) {
+            return stage->STAGE::work(out);
+        }
     };
 
+    // PlanStage::work is pure, so the default workBatch() has to dispatch.
+    template <>
+    inline PlanStage::StageState PlanStage::workOnce<PlanStage>(PlanStage* stage,
+                                                                WorkingSetID* out) {
+        return stage->work(out);
+    }
+
+    inline PlanStage::StageState PlanStage::workBatch(size_t max, vector<WorkingSetID>* results,
+                                                      WorkingSetID* out) {
+        return workInBatch(this, max, results, out);
+    }
+
 }  // namespace mongo
@@ -108,6 +108,27 @@ namespace mongo {
         virtual ~SpecificStats() { }
     };
 
+    struct AndBitmapStats : public SpecificStats {
+        AndBitmapStats() : flaggedButPassed(0),
+                           flaggedInProgress(0),
+                           memUsage(0) { }
+
+        virtual ~AndBitmapStats() { }
+
+        // Invalidation counters.
+        // How many results had the AND fully evaluated but were invalidated?
+        size_t flaggedButPassed;
+
+        // How many results were mid-AND but got flagged?
+        size_t flaggedInProgress;
+
+        // How many DiskLocs are in the intersection after each child?
+        std::vector<size_t> bitmapAfterChild;
+
+        // The most bytes the bitmaps used at once.
+        size_t memUsage;
+    };
+
     struct AndHashStats : public SpecificStats {
         AndHashStats() : flaggedButPassed(0),
                          flaggedInProgress(0) { }
@@ -237,12 +258,15 @@ namespace mongo {
     };
 
     struct SortStats : public SpecificStats {
-        SortStats() : forcedFetches(0) { }
+        SortStats() : forcedFetches(0), spills(0) { }
 
         virtual ~SortStats() { }
 
         // How many records were we forced to fetch as the result of an invalidation?
         size_t forcedFetches;
+
+        // How many sorted runs did we write to disk?
+        size_t spills;
     };
 
     struct MergeSortStats : public SpecificStats {
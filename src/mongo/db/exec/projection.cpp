@@ -76,6 +76,38 @@ namespace mongo {
         return status;
     }
 
+    PlanStage::StageState ProjectionStage::workBatch(size_t max,
+                                                     vector<WorkingSetID>* results,
+                                                     WorkingSetID* out) {
+        ++_commonStats.works;
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        size_t numResults = results->size();
+        StageState status = _child->workBatch(max, results, out);
+
+        for (size_t i = numResults; i < results->size(); ++i) {
+            Status projStatus = _exec->transform(_ws->get((*results)[i]));
+            if (!projStatus.isOK()) {
+                warning() << "Couldn't execute projection, status = "
+                          << projStatus.toString() << endl;
+                // Only the results before this one are projected; nobody gets the rest.
+                for (size_t j = i; j < results->size(); ++j) {
+                    _ws->free((*results)[j]);
+                }
+                results->resize(i);
+                _commonStats.advanced += i - numResults;
+                return PlanStage::FAILURE;
+            }
+        }
+        _commonStats.advanced += results->size() - numResults;
+
+        if (PlanStage::NEED_FETCH == status) {
+            ++_commonStats.needFetch;
+        }
+        return status;
+    }
+
     void ProjectionStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
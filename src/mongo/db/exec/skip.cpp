@@ -28,6 +28,8 @@
 
 #include "mongo/db/exec/skip.h"
 
+#include <algorithm>
+
 namespace mongo {
 
     SkipStage::SkipStage(int toSkip, WorkingSet* ws, PlanStage* child)
@@ -72,6 +74,37 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState SkipStage::workBatch(size_t max,
+                                               vector<WorkingSetID>* results,
+                                               WorkingSetID* out) {
+        ++_commonStats.works;
+
+        if (isEOF()) { return PlanStage::IS_EOF; }
+
+        size_t numResults = results->size();
+        StageState status = _child->workBatch(max, results, out);
+
+        // Drop the results we're still skipping from the front of the batch.
+        vector<WorkingSetID>::iterator first = results->begin() + numResults;
+        size_t numSkipped = std::min(static_cast<size_t>(_toSkip), results->size() - numResults);
+        for (size_t i = 0; i < numSkipped; ++i) {
+            _ws->free(first[i]);
+        }
+        results->erase(first, first + numSkipped);
+        _toSkip -= numSkipped;
+
+        _commonStats.needTime += numSkipped;
+        _commonStats.advanced += results->size() - numResults;
+
+        if (PlanStage::NEED_FETCH == status) {
+            ++_commonStats.needFetch;
+        }
+        else if (PlanStage::ADVANCED == status && results->size() == numResults) {
+            status = PlanStage::NEED_TIME;
+        }
+        return status;
+    }
+
     void SkipStage::prepareToYield() {
         ++_commonStats.yields;
         _child->prepareToYield();
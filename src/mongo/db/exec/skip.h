@@ -47,6 +47,7 @@ namespace mongo {
 
         virtual bool isEOF();
         virtual StageState work(WorkingSetID* out);
+        virtual StageState workBatch(size_t max, vector<WorkingSetID>* results, WorkingSetID* out);
 
         virtual void prepareToYield();
         virtual void recoverFromYield();
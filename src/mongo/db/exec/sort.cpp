@@ -35,6 +35,9 @@
 #include "mongo/db/index/btree_key_generator.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/query/query_planner.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage_options.h"
+#include "mongo/util/bufreader.h"
 
 namespace {
 
@@ -58,7 +61,66 @@ namespace mongo {
 
     using std::vector;
 
-    const size_t kMaxBytes = 32 * 1024 * 1024;
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecSortAllowDiskUse, bool, false);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecSortMaxBytes, int, 32 * 1024 * 1024);
+
+    // Most sorted runs we read from at once.  Past this, runs are merged into one first.
+    const size_t kMaxSpilledRuns = 32;
+
+    struct SortStage::SpilledItem {
+        struct SorterDeserializeSettings {}; // unused
+
+        void serializeForSorter(BufBuilder& buf) const {
+            loc.serializeForSorter(buf);
+            obj.serializeForSorter(buf);
+        }
+
+        static SpilledItem deserializeForSorter(BufReader& buf,
+                                                const SorterDeserializeSettings&) {
+            SpilledItem out;
+            out.loc = DiskLoc::deserializeForSorter(buf, DiskLoc::SorterDeserializeSettings());
+            out.obj = BSONObj::deserializeForSorter(buf, BSONObj::SorterDeserializeSettings());
+            return out;
+        }
+
+        int memUsageForSorter() const { return sizeof(SpilledItem) + obj.objsize(); }
+
+        SpilledItem getOwned() const {
+            SpilledItem out;
+            out.loc = loc;
+            out.obj = obj.getOwned();
+            return out;
+        }
+
+        // Debug builds print the items when the sorter finds its comparator inconsistent.
+        friend std::ostream& operator<<(std::ostream& stream, const SpilledItem& item) {
+            return stream << "{ loc: " << item.loc << ", obj: " << item.obj << " }";
+        }
+
+        // Only used to break ties between equal sort keys.
+        DiskLoc loc;
+        BSONObj obj;
+    };
+
+    class SortStage::SpillComparator {
+    public:
+        typedef std::pair<BSONObj, SpilledItem> Data;
+
+        explicit SpillComparator(const BSONObj& pattern) : _pattern(pattern) { }
+
+        int operator()(const Data& lhs, const Data& rhs) const {
+            // False means ignore field names.
+            int result = lhs.first.woCompare(rhs.first, _pattern, false);
+            if (0 != result) {
+                return result;
+            }
+            return lhs.second.loc.compare(rhs.second.loc);
+        }
+
+    private:
+        BSONObj _pattern;
+    };
 
     SortStageKeyGenerator::SortStageKeyGenerator(const BSONObj& sortSpec, const BSONObj& queryObj) {
         _hasBounds = false;
@@ -276,7 +338,10 @@ namespace mongo {
           _pattern(params.pattern),
           _query(params.query),
           _limit(params.limit),
+          _maxMemoryUsageBytes(params.maxMemoryUsageBytes),
+          _extSortAllowed(params.extSortAllowed),
           _sorted(false),
+          _hasComputedData(false),
           _resultIterator(_data.end()),
           _memUsage(0) {
         dassert(_limit >= 0);
@@ -287,6 +352,9 @@ namespace mongo {
     bool SortStage::isEOF() {
         // We're done when our child has no more results, we've sorted the child's results, and
         // we've returned all sorted results.
+        if (_spilledResults) {
+            return _child->isEOF() && _sorted && !_spilledResults->more();
+        }
         return _child->isEOF() && _sorted && (_data.end() == _resultIterator);
     }
 
@@ -306,8 +374,11 @@ namespace mongo {
             return PlanStage::NEED_TIME;
         }
 
-        if (_memUsage > kMaxBytes) {
-            return PlanStage::FAILURE;
+        if (_memUsage > _maxMemoryUsageBytes) {
+            if (!canSpill()) {
+                return PlanStage::FAILURE;
+            }
+            spill();
         }
 
         if (isEOF()) { return PlanStage::IS_EOF; }
@@ -326,6 +397,10 @@ namespace mongo {
                 // Planner must put a fetch before we get here.
                 verify(member->hasObj());
 
+                if (member->hasComputed(WSM_COMPUTED_TEXT_SCORE)) {
+                    _hasComputedData = true;
+                }
+
                 // We might be sorting something that was invalidated at some point.
                 if (member->hasLoc()) {
                     _wsidByDiskLoc[member->loc] = id;
@@ -348,7 +423,20 @@ namespace mongo {
             else if (PlanStage::IS_EOF == code) {
                 // TODO: We don't need the lock for this.  We could ask for a yield and do this work
                 // unlocked.  Also, this is performing a lot of work for one call to work(...)
-                sortBuffer();
+                if (!_spilledRuns.empty()) {
+                    // Whatever is still buffered becomes the last run, then we merge the runs.
+                    if (!_data.empty()) {
+                        spill();
+                    }
+                    _spilledResults.reset(SpilledIterator::merge(
+                                            _spilledRuns,
+                                            SortOptions(),
+                                            SpillComparator(_sortKeyGen->getSortComparator())));
+                    _spilledRuns.clear();
+                }
+                else {
+                    sortBuffer();
+                }
                 _resultIterator = _data.begin();
                 _sorted = true;
                 ++_commonStats.needTime;
@@ -366,6 +454,21 @@ namespace mongo {
             }
         }
 
+        // Returning results from disk.  The documents are copies, so they come back owned and
+        // without a DiskLoc, as if they had been invalidated.
+        if (_spilledResults) {
+            verify(_sorted);
+            SpilledItem item = _spilledResults->next().second;
+
+            *out = _ws->allocate();
+            WorkingSetMember* member = _ws->get(*out);
+            member->obj = item.obj.getOwned();
+            member->state = WorkingSetMember::OWNED_OBJ;
+
+            ++_commonStats.advanced;
+            return PlanStage::ADVANCED;
+        }
+
         // Returning results.
         verify(_resultIterator != _data.end());
         verify(_sorted);
@@ -530,4 +633,66 @@ namespace mongo {
         }
     }
 
+    bool SortStage::canSpill() const {
+        // A limited sort keeps only its top results in memory; if those don't fit, we fail as
+        // before.
+        return _extSortAllowed && _limit == 0 && !_hasComputedData;
+    }
+
+    void SortStage::spill() {
+        verify(_limit == 0);
+        sortBuffer();
+
+        SortedFileWriter<BSONObj, SpilledItem> writer(
+            SortOptions().TempDir(storageGlobalParams.dbpath + "/_tmp"));
+
+        for (size_t i = 0; i < _data.size(); ++i) {
+            WorkingSetMember* member = _ws->get(_data[i].wsid);
+
+            SpilledItem spilled;
+            spilled.loc = _data[i].loc;
+            spilled.obj = member->obj;
+            writer.addAlreadySorted(_data[i].sortKey, spilled);
+
+            // The run now holds a copy, so we no longer care what happens to the DiskLoc.
+            if (member->hasLoc()) {
+                _wsidByDiskLoc.erase(member->loc);
+            }
+            _ws->free(_data[i].wsid);
+        }
+
+        vector<SortableDataItem>().swap(_data);
+        _memUsage = 0;
+
+        _spilledRuns.push_back(boost::shared_ptr<SpilledIterator>(writer.done()));
+        ++_specificStats.spills;
+
+        if (_spilledRuns.size() >= kMaxSpilledRuns) {
+            mergeSpilledRuns();
+        }
+    }
+
+    void SortStage::mergeSpilledRuns() {
+        boost::scoped_ptr<SpilledIterator> merged(
+            SpilledIterator::merge(_spilledRuns,
+                                   SortOptions(),
+                                   SpillComparator(_sortKeyGen->getSortComparator())));
+
+        SortedFileWriter<BSONObj, SpilledItem> writer(
+            SortOptions().TempDir(storageGlobalParams.dbpath + "/_tmp"));
+        while (merged->more()) {
+            SpilledIterator::Data next = merged->next();
+            writer.addAlreadySorted(next.first, next.second);
+        }
+        merged.reset();
+
+        _spilledRuns.clear();
+        _spilledRuns.push_back(boost::shared_ptr<SpilledIterator>(writer.done()));
+    }
+
 }  // namespace mongo
+
+#include "mongo/db/sorter/sorter.cpp"
+MONGO_CREATE_SORTER(mongo::BSONObj,
+                    mongo::SortStage::SpilledItem,
+                    mongo::SortStage::SpillComparator);
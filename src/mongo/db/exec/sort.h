@@ -38,16 +38,25 @@
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/query/index_bounds.h"
+#include "mongo/db/sorter/sorter.h"
 #include "mongo/platform/unordered_map.h"
 
 namespace mongo {
 
     class BtreeKeyGenerator;
 
+    // When set, unlimited sorts that outgrow their memory budget spill sorted runs to disk.
+    extern bool internalQueryExecSortAllowDiskUse;
+
+    // The memory budget, in bytes, of sorts built by the planner.
+    extern int internalQueryExecSortMaxBytes;
+
     // Parameters that must be provided to a SortStage
     class SortStageParams {
     public:
-        SortStageParams() : limit(0) { }
+        SortStageParams() : limit(0),
+                            maxMemoryUsageBytes(32 * 1024 * 1024),
+                            extSortAllowed(false) { }
 
         // How we're sorting.
         BSONObj pattern;
@@ -57,6 +66,13 @@ namespace mongo {
 
         // Must be >= 0.  Equal to 0 for no limit.
         int limit;
+
+        // How much data we buffer before spilling to disk, or failing if we can't spill.
+        size_t maxMemoryUsageBytes;
+
+        // May we spill sorted runs to disk?  Only done when there is no limit, since a limited
+        // sort only ever holds 'limit' results.
+        bool extSortAllowed;
     };
 
     /**
@@ -167,6 +183,10 @@ namespace mongo {
         // Must be >= 0.  Equal to 0 for no limit.
         int _limit;
 
+        size_t _maxMemoryUsageBytes;
+
+        bool _extSortAllowed;
+
         //
         // Sort key generation
         //
@@ -216,6 +236,44 @@ namespace mongo {
          */
         void sortBuffer();
 
+        //
+        // External sort
+        //
+
+        // A document written out to a sorted run.  Keyed by its sort key in the run.
+        struct SpilledItem;
+
+        // Orders spilled (sort key, SpilledItem) pairs the same way WorkingSetComparator does.
+        class SpillComparator;
+
+        typedef SortIteratorInterface<BSONObj, SpilledItem> SpilledIterator;
+
+        /**
+         * Can we spill the buffered data rather than fail when it outgrows the budget?
+         */
+        bool canSpill() const;
+
+        /**
+         * Sorts the buffered data, writes it to a sorted run on disk and frees the buffered
+         * working set members.
+         */
+        void spill();
+
+        /**
+         * Merges every sorted run into one so that the final merge never reads from more than
+         * kMaxSpilledRuns files at once.
+         */
+        void mergeSpilledRuns();
+
+        // Sorted runs written so far.
+        std::vector<boost::shared_ptr<SpilledIterator> > _spilledRuns;
+
+        // Once the child is exhausted, merges _spilledRuns.  NULL if we never spilled.
+        boost::scoped_ptr<SpilledIterator> _spilledResults;
+
+        // Set if a buffered member carries computed data, which a sorted run can't hold.
+        bool _hasComputedData;
+
         // Comparator for data buffer
         // Initialization follows sort key generator
         scoped_ptr<WorkingSetComparator> _sortKeyComparator;
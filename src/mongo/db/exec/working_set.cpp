@@ -28,30 +28,48 @@
 
 #include "mongo/db/exec/working_set.h"
 
+#include <algorithm>
+
 #include "mongo/db/index/index_descriptor.h"
 
 namespace mongo {
 
+    namespace {
+
+        // Sizes of the arrays WorkingSetMembers are allocated in.  Most working sets only ever
+        // hold a few members, so start small.
+        const size_t kMinBlockSize = 8;
+        const size_t kMaxBlockSize = 1024;
+
+    }  // namespace
+
     WorkingSet::MemberHolder::MemberHolder() : flagged(false), member(NULL) { }
     WorkingSet::MemberHolder::~MemberHolder() {}
 
-    WorkingSet::WorkingSet() : _freeList(INVALID_ID) { }
+    WorkingSet::WorkingSet() : _blockRemaining(0), _blockSize(0), _freeList(INVALID_ID) { }
 
     WorkingSet::~WorkingSet() {
-        for (size_t i = 0; i < _data.size(); i++) {
-            delete _data[i].member;
+        for (size_t i = 0; i < _blocks.size(); i++) {
+            delete[] _blocks[i];
         }
     }
 
     WorkingSetID WorkingSet::allocate() {
         if (_freeList == INVALID_ID) {
-            // The free list is empty so we need to make a single new WSM to return. This relies on
-            // vector::resize being amortized O(1) for efficient allocation. Note that the free list
-            // remains empty until something is returned by a call to free().
+            // The free list is empty so we need to hand out a new WSM, taking it from the current
+            // block or starting another. This relies on vector::resize being amortized O(1) for
+            // efficient allocation. Note that the free list remains empty until something is
+            // returned by a call to free().
             WorkingSetID id = _data.size();
             _data.resize(_data.size() + 1);
             _data.back().nextFreeOrSelf = id;
-            _data.back().member = new WorkingSetMember();
+            if (0 == _blockRemaining) {
+                _blockSize = std::min(std::max(2 * _blockSize, kMinBlockSize), kMaxBlockSize);
+                _blocks.push_back(new WorkingSetMember[_blockSize]);
+                _blockRemaining = _blockSize;
+            }
+            _data.back().member = &_blocks.back()[_blockSize - _blockRemaining];
+            --_blockRemaining;
             return id;
         }
 
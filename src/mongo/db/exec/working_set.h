@@ -111,7 +111,7 @@ namespace mongo {
             // Free list link if freed. Points to self if in use.
             WorkingSetID nextFreeOrSelf;
             bool flagged;
-            // Owning pointer
+            // Points into one of _blocks.
             WorkingSetMember* member;
         };
 
@@ -119,6 +119,15 @@ namespace mongo {
         // Elements are added to _freeList rather than removed when freed.
         vector<MemberHolder> _data;
 
+        // The members themselves, allocated an array at a time rather than one by one so that
+        // members handed out together sit together.  Each array is twice the size of the last,
+        // up to a limit.  Owned here.
+        vector<WorkingSetMember*> _blocks;
+
+        // How many members of the last of _blocks haven't been handed out yet.
+        size_t _blockRemaining;
+        size_t _blockSize;
+
         // Index into _data, forming a linked-list using MemberHolder::nextFreeOrSelf as the next
         // link. INVALID_ID is the list terminator since 0 is a valid index.
         // If _freeList == INVALID_ID, the free list is empty and all elements in _data are in use.
@@ -147,4 +147,35 @@ namespace {
         ASSERT_FALSE(member->getFieldDotted("y", &elt));
     }
 
+    // Members come from arrays allocated a block at a time.  They must stay put as more are
+    // allocated, and freed ones must be reused.
+    TEST(WorkingSetTest, manyMembers) {
+        WorkingSet ws;
+        std::vector<WorkingSetID> ids;
+        std::vector<WorkingSetMember*> members;
+        for (int i = 0; i < 5000; ++i) {
+            WorkingSetID id = ws.allocate();
+            WorkingSetMember* member = ws.get(id);
+            member->obj = BSON("x" << i);
+            member->state = WorkingSetMember::OWNED_OBJ;
+            ids.push_back(id);
+            members.push_back(member);
+        }
+
+        for (int i = 0; i < 5000; ++i) {
+            ASSERT_EQUALS(members[i], ws.get(ids[i]));
+            ASSERT_EQUALS(i, ws.get(ids[i])->obj["x"].numberInt());
+        }
+
+        // Free every other member, then allocate as many again.  Nothing new is needed.
+        for (int i = 0; i < 5000; i += 2) {
+            ws.free(ids[i]);
+        }
+        for (int i = 0; i < 5000; i += 2) {
+            WorkingSetID id = ws.allocate();
+            ASSERT_LESS_THAN(id, 5000U);
+            ASSERT_EQUALS(WorkingSetMember::INVALID, ws.get(id)->state);
+        }
+    }
+
 }  // namespace
@@ -85,6 +85,14 @@ namespace mongo {
                                  .MaxMemoryUsageBytes(maxFileSize),
                     OldExtSortComparator(comp, _mayInterrupt)))
     {}
+
+    BSONObjExternalSorter::Iterator* BSONObjExternalSorter::merge(
+            const vector< shared_ptr<Iterator> >& iters,
+            const ExternalSortComparison* comp) {
+        return Iterator::merge(iters,
+                               SortOptions(),
+                               OldExtSortComparator(comp, boost::make_shared<bool>(false)));
+    }
 }
 
 #include "mongo/db/sorter/sorter.cpp"
@@ -73,6 +73,10 @@ namespace mongo {
 
         auto_ptr<Iterator> iterator() { return auto_ptr<Iterator>(_sorter->done()); }
 
+        /** merges the output of several sorters which used 'comp' into one sorted stream */
+        static Iterator* merge( const vector< shared_ptr<Iterator> >& iters,
+                                const ExternalSortComparison* comp );
+
         void sort( bool mayInterrupt ) { *_mayInterrupt = mayInterrupt; }
         int numFiles() { return _sorter->numFiles(); }
         long getCurSizeSoFar() { return _sorter->memUsed(); }
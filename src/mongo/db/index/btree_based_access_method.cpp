@@ -31,6 +31,8 @@
 #include <vector>
 
 #include "mongo/base/status.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/client.h"
 #include "mongo/db/extsort.h"
 #include "mongo/db/index/btree_index_cursor.h"
 #include "mongo/db/index/btree_interface.h"
@@ -41,14 +43,19 @@
 #include "mongo/db/pdfile_private.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/sort_phase_one.h"
+#include "mongo/db/storage/extent.h"
+#include "mongo/db/storage/record.h"
 #include "mongo/db/structure/btree/btreebuilder.h"
+#include "mongo/db/structure/catalog/namespace_details.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/util/concurrency/thread_pool.h"
 
 namespace mongo {
 
     BtreeBasedAccessMethod::BtreeBasedAccessMethod(IndexCatalogEntry* btreeState)
         : _btreeState(btreeState), _descriptor(btreeState->descriptor()) {
 
-        verify(0 == _descriptor->version() || 1 == _descriptor->version());
+        verify(0 <= _descriptor->version() && _descriptor->version() <= 2);
         _interface = BtreeInterface::interfaces[_descriptor->version()];
     }
 
@@ -180,6 +187,9 @@ namespace mongo {
         else if ( 1 == _descriptor->version() ) {
             newHead = BtreeBucket<V1>::addBucket( _btreeState );
         }
+        else if ( 2 == _descriptor->version() ) {
+            newHead = BtreeBucket<V2>::addBucket( _btreeState );
+        }
         else {
             return Status( ErrorCodes::InternalError, "invalid index number" );
         }
@@ -222,6 +232,11 @@ namespace mongo {
                                                                      _btreeState->head(),
                                                                      key );
         }
+        if ( 2 == _descriptor->version() ) {
+            return BtreeBucket<V2>::asVersion( record )->findSingle( _btreeState,
+                                                                     _btreeState->head(),
+                                                                     key );
+        }
         verify( 0 );
     }
 
@@ -364,6 +379,73 @@ namespace mongo {
             return Status::OK();
         }
 
+        virtual Status insertAllParallel( Collection* collection,
+                                          int numThreads,
+                                          bool mayInterrupt,
+                                          unsigned long long* numAdded ) {
+            verify( numThreads > 0 );
+            if ( !collection->documentsAreExtentRecords() ) {
+                return Status( ErrorCodes::BadValue,
+                               "parallel index build needs documents stored as extent records" );
+            }
+            CurOp* op = cc().curop();
+            Timer timer;
+
+            // Extents are looked up here as the other threads don't hold the lock.
+            ParallelInsert all;
+            for ( DiskLoc loc = collection->details()->firstExtent(); !loc.isNull(); ) {
+                Extent* e = loc.ext();
+                all.extents.push_back( e );
+                loc = e->xnext;
+            }
+
+            // The threads share the memory one sorter would have had, within reason.
+            long maxSortBytes = std::max( 100 * 1024 * 1024 / numThreads, 16 * 1024 * 1024 );
+            vector<KeyGenerator> gens( numThreads );
+            for ( int t = 0; t < numThreads; t++ ) {
+                gens[t].phase1.sortCmp = _phase1.sortCmp;
+                gens[t].phase1.sorter.reset( new BSONObjExternalSorter( _phase1.sortCmp.get(),
+                                                                        maxSortBytes ) );
+            }
+
+            ProgressMeter& pm = op->setMessage( "Index Bulk Build: (1/3) generate and sort keys",
+                                                "Index: (1/3) Key Generation Progress",
+                                                collection->numRecords(),
+                                                10 );
+
+            // This thread does a share of the work too, reporting progress as it goes and
+            // stopping everyone if the operation is killed.
+            {
+                ThreadPool pool( numThreads - 1 );
+                for ( int t = 1; t < numThreads; t++ ) {
+                    pool.schedule( &BtreeBulk::generateKeysInThread, this, &all, &gens[t] );
+                }
+                try {
+                    generateKeys( &all, &gens[0], &pm, mayInterrupt );
+                }
+                catch ( ... ) {
+                    all.abort.store( 1 );
+                    pool.join();
+                    throw;
+                }
+                pool.join();
+            }
+            pm.finished();
+
+            *numAdded = 0;
+            for ( int t = 0; t < numThreads; t++ ) {
+                if ( !gens[t].status.isOK() )
+                    return gens[t].status;
+                _phase1.n += gens[t].phase1.n;
+                _phase1.nkeys += gens[t].phase1.nkeys;
+                _phase1.multi = _phase1.multi || gens[t].phase1.multi;
+                _sorted.push_back( gens[t].sorted );
+            }
+            *numAdded = _phase1.n;
+            _phaseTimes = str::stream() << "keys " << timer.millis() / 1000.0 << "s";
+            return Status::OK();
+        }
+
         virtual Status touch(const BSONObj& obj) {
             return _notAllowed();
         }
@@ -390,10 +472,14 @@ namespace mongo {
             BtreeBuilder<V> btBuilder(dupsAllowed, entry);
 
             BSONObj keyLast;
-            scoped_ptr<BSONObjExternalSorter::Iterator> i( _phase1.sorter->iterator() );
+            scoped_ptr<BSONObjExternalSorter::Iterator> i(
+                _sorted.empty() ?
+                _phase1.sorter->iterator().release() :
+                BSONObjExternalSorter::merge( _sorted, _phase1.sortCmp.get() ) );
 
             // verifies that pm and op refer to the same ProgressMeter
-            ProgressMeter& pm = op->setMessage("Index Bulk Build: (2/3) btree bottom up",
+            string msg = phaseMessage("Index Bulk Build: (2/3) btree bottom up");
+            ProgressMeter& pm = op->setMessage(msg.c_str(),
                                                "Index: (2/3) BTree Bottom Up Progress",
                                                _phase1.nkeys,
                                                10);
@@ -437,7 +523,9 @@ namespace mongo {
                 pm.hit();
             }
             pm.finished();
-            op->setMessage("Index Bulk Build: (3/3) btree-middle",
+            _phaseTimes += str::stream() << ( _phaseTimes.empty() ? "" : ", " )
+                                         << "bottom up " << timer.millis() / 1000.0 << "s";
+            op->setMessage(phaseMessage("Index Bulk Build: (3/3) btree-middle").c_str(),
                            "Index: (3/3) BTree Middle Progress");
             LOG(timer.seconds() > 10 ? 0 : 1 ) << "\t done building bottom layer, going to commit";
             btBuilder.commit( mayInterrupt );
@@ -453,8 +541,109 @@ namespace mongo {
             return Status( ErrorCodes::InternalError, "cannot use bulk for this yet" );
         }
 
+        /** the currentOp message for a phase, with how long the finished phases took */
+        string phaseMessage( const char* phase ) const {
+            if ( _phaseTimes.empty() )
+                return phase;
+            return str::stream() << phase << " (took " << _phaseTimes << ")";
+        }
+
+        /** what the insertAllParallel threads share */
+        struct ParallelInsert {
+            vector<Extent*> extents;
+            AtomicUInt32 nextExtent; // next one for a thread to take
+            AtomicUInt64 docsDone;
+            AtomicUInt32 abort;
+        };
+
+        /** one insertAllParallel thread's keys, sorted when it runs out of extents */
+        struct KeyGenerator {
+            KeyGenerator() : status( Status::OK() ) { }
+            SortPhaseOne phase1;
+            shared_ptr<BSONObjExternalSorter::Iterator> sorted;
+            Status status;
+        };
+
+        void generateKeysInThread( ParallelInsert* all, KeyGenerator* gen ) {
+            // records need a Client to note when they aren't in memory.  The pool's threads
+            // outlive the build, so the Client is detached again before returning.
+            const string threadName = getThreadName();
+            Client::initThread( "index build worker" );
+            try {
+                generateKeys( all, gen, NULL, false );
+            }
+            catch ( const DBException& e ) {
+                gen->status = e.toStatus();
+                all->abort.store( 1 );
+            }
+            catch ( const std::exception& e ) {
+                gen->status = Status( ErrorCodes::InternalError, e.what() );
+                all->abort.store( 1 );
+            }
+            catch ( ... ) {
+                gen->status = Status( ErrorCodes::InternalError, "unknown exception" );
+                all->abort.store( 1 );
+            }
+            Client::resetThread( threadName );
+        }
+
+        /**
+         * Generates keys for the records of extents taken from 'all' until there are none left.
+         * @param pm - if not NULL, updated with everyone's progress, and the operation is checked
+         *             for interruption
+         */
+        void generateKeys( ParallelInsert* all,
+                           KeyGenerator* gen,
+                           ProgressMeter* pm,
+                           bool mayInterrupt ) {
+            unsigned long long reported = 0;
+            unsigned long long pending = 0;
+            while ( true ) {
+                unsigned i = all->nextExtent.fetchAndAdd( 1 );
+                if ( i >= all->extents.size() )
+                    break;
+
+                const Extent* e = all->extents[i];
+                if ( e->firstRecord.isNull() )
+                    continue;
+
+                // records are in the same file as their extent
+                const DiskLoc& extentLoc = e->myLoc;
+                const char* fileBase = reinterpret_cast<const char*>( e ) - extentLoc.getOfs();
+                for ( int ofs = e->firstRecord.getOfs(); ofs != DiskLoc::NullOfs; ) {
+                    const Record* r = reinterpret_cast<const Record*>( fileBase + ofs );
+                    BSONObjSet keys;
+                    _real->getKeys( BSONObj( r->data() ), &keys );
+                    gen->phase1.addKeys( keys, DiskLoc( extentLoc.a(), ofs ), false );
+                    ofs = r->nextOfs();
+
+                    if ( ++pending < 128 )
+                        continue;
+                    all->docsDone.fetchAndAdd( pending );
+                    pending = 0;
+                    if ( all->abort.load() )
+                        return;
+                    if ( pm ) {
+                        killCurrentOp.checkForInterrupt( !mayInterrupt );
+                        unsigned long long done = all->docsDone.load();
+                        pm->hit( static_cast<int>( done - reported ) );
+                        reported = done;
+                    }
+                }
+            }
+            all->docsDone.fetchAndAdd( pending );
+
+            gen->sorted.reset( gen->phase1.sorter->iterator().release() );
+        }
+
         BtreeBasedAccessMethod* _real; // now owned here
         SortPhaseOne _phase1;
+
+        // Set by insertAllParallel, the sorted keys of each of its threads.
+        vector< shared_ptr<BSONObjExternalSorter::Iterator> > _sorted;
+
+        // how long each finished phase took, for currentOp
+        string _phaseTimes;
     };
 
     int oldCompare(const BSONObj& l,const BSONObj& r, const Ordering &o); // key.cpp
@@ -499,7 +688,8 @@ namespace mongo {
         if ( 0 == version ) {
             return new BtreeExternalSortComparisonV0( keyPattern );
         }
-        else if ( 1 == version ) {
+        else if ( 1 == version || 2 == version ) {
+            // v:2 keys are v:1 keys, only stored differently
             return new BtreeExternalSortComparisonV1( keyPattern );
         }
         verify( 0 );
@@ -522,6 +712,13 @@ namespace mongo {
         return bulk.release();
     }
 
+    Status BtreeBasedAccessMethod::insertAllParallel( Collection* collection,
+                                                      int numThreads,
+                                                      bool mayInterrupt,
+                                                      unsigned long long* numAdded ) {
+        return Status( ErrorCodes::InternalError, "insertAllParallel is only for bulk" );
+    }
+
     Status BtreeBasedAccessMethod::commitBulk( IndexAccessMethod* bulkRaw,
                                                bool mayInterrupt,
                                                set<DiskLoc>* dupsToDrop ) {
@@ -549,6 +746,8 @@ namespace mongo {
             bulk->commit<V0>( dupsToDrop, cc().curop(), mayInterrupt );
         else if ( _descriptor->version() == 1 )
             bulk->commit<V1>( dupsToDrop, cc().curop(), mayInterrupt );
+        else if ( _descriptor->version() == 2 )
+            bulk->commit<V2>( dupsToDrop, cc().curop(), mayInterrupt );
         else
             return Status( ErrorCodes::InternalError, "bad btree version" );
 
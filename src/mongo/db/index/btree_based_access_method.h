@@ -89,6 +89,11 @@ namespace mongo {
                                    bool mayInterrupt,
                                    std::set<DiskLoc>* dups );
 
+        virtual Status insertAllParallel( Collection* collection,
+                                          int numThreads,
+                                          bool mayInterrupt,
+                                          unsigned long long* numAdded );
+
         virtual Status touch(const BSONObj& obj);
 
         virtual Status validate(int64_t* numKeys);
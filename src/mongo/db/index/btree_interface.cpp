@@ -165,7 +165,7 @@ namespace mongo {
                 throw UserException(deletedBucketCode, "keyAt bucket deleted");
             }
             dassert( n >= 0 && n < 10000 );
-            return keyOffset >= n ? BSONObj() : b->keyNode(keyOffset).key.toBson();
+            return keyOffset >= n ? BSONObj() : toBson(b->keyNode(keyOffset));
         }
 
         virtual DiskLoc recordAt(const IndexCatalogEntry* btreeState,
@@ -191,7 +191,7 @@ namespace mongo {
                 *keyOut = BSONObj();
                 *recordOut = DiskLoc();
             } else {
-                *keyOut = b->keyNode(keyOffset).key.toBson();
+                *keyOut = toBson(b->keyNode(keyOffset));
                 *recordOut = b->keyNode(keyOffset).recordLoc;
             }
         }
@@ -217,11 +217,21 @@ namespace mongo {
                                        const BSONObj& keyPattern) {
             return getBucket( btreeState, thisLoc )->fullValidate(thisLoc, keyPattern);
         }
+
+    private:
+        /**
+         * Prefix compressed keys are reassembled into the KeyNode, which is gone once we return,
+         * so those are copied out.
+         */
+        static BSONObj toBson(const typename BucketBasics<Version>::KeyNode& kn) {
+            return Version::PrefixCompressed ? kn.key.toBson().getOwned() : kn.key.toBson();
+        }
     };
 
     BtreeInterfaceImpl<V0> interface_v0;
     BtreeInterfaceImpl<V1> interface_v1;
-    BtreeInterface* BtreeInterface::interfaces[] = { &interface_v0, &interface_v1 };
+    BtreeInterfaceImpl<V2> interface_v2;
+    BtreeInterface* BtreeInterface::interfaces[] = { &interface_v0, &interface_v1, &interface_v2 };
 
 }  // namespace mongo
 
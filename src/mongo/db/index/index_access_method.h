@@ -35,6 +35,7 @@
 
 namespace mongo {
 
+    class Collection;
     class UpdateTicket;
     struct InsertDeleteOptions;
 
@@ -169,6 +170,19 @@ namespace mongo {
         virtual Status commitBulk( IndexAccessMethod* bulk,
                                    bool mayInterrupt,
                                    std::set<DiskLoc>* dups ) = 0;
+
+        /**
+         * Adds every document in 'collection' to something created from initiateBulk, in place of
+         * calling insert for each of them.  Keys are generated and sorted on 'numThreads'
+         * threads, each taking extents of the collection as it goes and sorting into its own
+         * runs, which commitBulk merges.  The caller must hold the collection's write lock, and
+         * the collection's documents must be extent records (see documentsAreExtentRecords).
+         * @param numAdded - set to the number of documents added
+         */
+        virtual Status insertAllParallel( Collection* collection,
+                                          int numThreads,
+                                          bool mayInterrupt,
+                                          unsigned long long* numAdded ) = 0;
     };
 
     /**
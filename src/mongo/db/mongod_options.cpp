@@ -208,6 +208,11 @@ namespace mongo {
         general_options.addOptionChaining("storage.smallFiles", "smallfiles", moe::Switch,
                 "use a smaller default file size");
 
+        general_options.addOptionChaining("heapRecordStore", "heapRecordStore", moe::Switch,
+                "keep documents of user collections in memory, for benchmarking only")
+                                         .hidden()
+                                         .setSources(moe::SourceAllLegacy);
+
         general_options.addOptionChaining("storage.syncPeriodSecs", "syncdelay", moe::Double,
                 "seconds between disk syncs (0=never, but not recommended)")
                                          .setDefault(moe::Value(60.0));
@@ -667,6 +672,11 @@ namespace mongo {
         if (params.count("storage.smallFiles")) {
             storageGlobalParams.smallfiles = true;
         }
+        if (params.count("heapRecordStore")) {
+            warning() << "--heapRecordStore is for benchmarking only, "
+                      << "documents will not be persisted";
+            storageGlobalParams.heapRecordStore = true;
+        }
         if (params.count("diaglog")) {
             warning() << "--diaglog is deprecated and will be removed in a future release";
             int x = params["diaglog"].as<int>();
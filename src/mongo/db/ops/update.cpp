@@ -590,7 +590,10 @@ namespace mongo {
             // place", that is, some values of the old document just get adjusted without any
             // change to the binary layout on the bson layer. It may be that a whole new
             // document is needed to accomodate the new bson layout of the resulting document.
-            doc.reset(oldObj, mutablebson::Document::kInPlaceEnabled);
+            // Some record stores can't overwrite a document at all, not even in place.
+            doc.reset(oldObj, collection->canUpdateInPlace(loc, oldObj.objsize()) ?
+                      mutablebson::Document::kInPlaceEnabled :
+                      mutablebson::Document::kInPlaceDisabled);
             BSONObj logObj;
 
 
@@ -685,16 +688,8 @@ namespace mongo {
 
                     collection->details()->paddingFits();
 
-                    // All updates were in place. Apply them via durability and writing pointer.
-                    mutablebson::DamageVector::const_iterator where = damages.begin();
-                    const mutablebson::DamageVector::const_iterator end = damages.end();
-                    for( ; where != end; ++where ) {
-                        const char* sourcePtr = source + where->sourceOffset;
-                        void* targetPtr = getDur().writingPtr(
-                            const_cast<char*>(oldObj.objdata()) + where->targetOffset,
-                            where->size);
-                        std::memcpy(targetPtr, sourcePtr, where->size);
-                    }
+                    // All updates were in place. Apply them through the record store.
+                    collection->updateDocumentWithDamages(loc, source, damages);
                     docWasModified = true;
                     opDebug->fastmod = true;
                 }
@@ -43,7 +43,8 @@ namespace mongo {
         }
 
         bool isIntersectPlan(const PlanStageStats& stats) {
-            if (stats.stageType == STAGE_AND_HASH || stats.stageType == STAGE_AND_SORTED) {
+            if (stats.stageType == STAGE_AND_HASH || stats.stageType == STAGE_AND_SORTED
+                || stats.stageType == STAGE_AND_BITMAP) {
                 return true;
             }
             for (size_t i = 0; i < stats.children.size(); ++i) {
@@ -282,7 +283,10 @@ namespace mongo {
 
     // XXX: where does this really live?  stage_types.h?
     string stageTypeString(StageType type) {
-        if (STAGE_AND_HASH == type) {
+        if (STAGE_AND_BITMAP == type) {
+            return "AND_BITMAP";
+        }
+        else if (STAGE_AND_HASH == type) {
             return "AND_HASH";
         }
         else if (STAGE_AND_SORTED == type) {
@@ -350,7 +354,17 @@ namespace mongo {
         bob.appendNumber("isEOF", stats.common.isEOF);
 
         // Stage-specific stats
-        if (STAGE_AND_HASH == stats.stageType) {
+        if (STAGE_AND_BITMAP == stats.stageType) {
+            AndBitmapStats* spec = static_cast<AndBitmapStats*>(stats.specific.get());
+            bob.appendNumber("flaggedButPassed", spec->flaggedButPassed);
+            bob.appendNumber("flaggedInProgress", spec->flaggedInProgress);
+            bob.appendNumber("memUsage", spec->memUsage);
+            for (size_t i = 0; i < spec->bitmapAfterChild.size(); ++i) {
+                bob.appendNumber(string(stream() << "bitmapAfterChild_" << i),
+                                 spec->bitmapAfterChild[i]);
+            }
+        }
+        else if (STAGE_AND_HASH == stats.stageType) {
             AndHashStats* spec = static_cast<AndHashStats*>(stats.specific.get());
             bob.appendNumber("flaggedButPassed", spec->flaggedButPassed);
             bob.appendNumber("flaggedInProgress", spec->flaggedInProgress);
@@ -412,6 +426,7 @@ namespace mongo {
         else if (STAGE_SORT == stats.stageType) {
             SortStats* spec = static_cast<SortStats*>(stats.specific.get());
             bob.appendNumber("forcedFetches", spec->forcedFetches);
+            bob.appendNumber("spills", spec->spills);
         }
         else if (STAGE_SORT_MERGE == stats.stageType) {
             MergeSortStats* spec = static_cast<MergeSortStats*>(stats.specific.get());
@@ -42,10 +42,13 @@
 #include "mongo/db/query/query_planner_common.h"
 #include "mongo/db/query/single_solution_runner.h"
 #include "mongo/db/query/stage_builder.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/s/d_logic.h"
 
 namespace mongo {
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryPlannerBitmapIntersection, bool, false);
+
     static bool isSimpleIdQuery(const BSONObj& query) {
         bool hasID = false;
 
@@ -233,6 +236,11 @@ namespace mongo {
             }
         }
 
+        // Set before the cache lookup so that cached and freshly planned solutions agree.
+        if (internalQueryPlannerBitmapIntersection) {
+            plannerParams.options |= QueryPlannerParams::INDEX_INTERSECTION_BITMAP;
+        }
+
         // Try to look up a cached solution for the query.
         //
         // Skip cache look up for non-cacheable queries.
@@ -0,0 +1,173 @@
+/**
+ *    Copyright (C) 2014 MongoDB Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects for
+ *    all of the code used other than as permitted herein. If you modify file(s)
+ *    with this exception, you may extend this exception to your version of the
+ *    file(s), but you are not obligated to do so. If you do not wish to do so,
+ *    delete this exception statement from your version. If you delete this
+ *    exception statement from all source files in the program, then also delete
+ *    it in the license file.
+ */
+
+#pragma once
+
+#include <list>
+
+#include "mongo/base/disallow_copying.h"
+#include "mongo/base/status.h"
+#include "mongo/platform/unordered_map.h"
+
+namespace mongo {
+
+    /**
+     * A map from K to owned V* that holds at most a fixed number of entries.  Adding to a full
+     * map deletes the least recently used entry.  Adding or getting an entry makes it the most
+     * recently used.
+     *
+     * Not thread safe.
+     */
+    template <class K, class V>
+    class LRUKeyValue {
+        MONGO_DISALLOW_COPYING(LRUKeyValue);
+    public:
+        typedef std::pair<K, V*> KVListElt;
+        typedef std::list<KVListElt> KVList;
+        typedef typename KVList::iterator KVListIt;
+        typedef typename KVList::const_iterator const_iterator;
+        typedef unordered_map<K, KVListIt> KVMap;
+        typedef typename KVMap::const_iterator KVMapConstIt;
+
+        explicit LRUKeyValue(size_t maxSize) : _maxSize(maxSize), _currentSize(0) { }
+
+        ~LRUKeyValue() {
+            clear();
+        }
+
+        /**
+         * Adds (key, entry), replacing and deleting any entry already under 'key'.  Takes
+         * ownership of 'entry'.
+         *
+         * Returns true if the least recently used entry was deleted to make room.
+         */
+        bool add(const K& key, V* entry) {
+            KVMapConstIt i = _kvMap.find(key);
+            if (_kvMap.end() != i) {
+                KVListIt found = i->second;
+                delete found->second;
+                _kvMap.erase(i);
+                _kvList.erase(found);
+                _currentSize--;
+            }
+
+            _kvList.push_front(std::make_pair(key, entry));
+            _kvMap[key] = _kvList.begin();
+            _currentSize++;
+
+            if (_currentSize <= _maxSize) {
+                return false;
+            }
+
+            KVListIt last = _kvList.end();
+            --last;
+            _kvMap.erase(last->first);
+            delete last->second;
+            _kvList.erase(last);
+            _currentSize--;
+            return true;
+        }
+
+        /**
+         * Returns true if there's an entry under 'key'.  Doesn't count as a use.
+         */
+        bool hasKey(const K& key) const {
+            return _kvMap.end() != _kvMap.find(key);
+        }
+
+        /**
+         * If there's an entry under 'key', sets *entryOut to it, makes it the most recently used
+         * and returns OK.  The entry stays owned here.
+         */
+        Status get(const K& key, V** entryOut) {
+            KVMapConstIt i = _kvMap.find(key);
+            if (_kvMap.end() == i) {
+                return Status(ErrorCodes::NoSuchKey, "no such key in LRU key-value store");
+            }
+            KVListIt found = i->second;
+            if (found != _kvList.begin()) {
+                _kvList.splice(_kvList.begin(), _kvList, found);
+            }
+            *entryOut = found->second;
+            return Status::OK();
+        }
+
+        /**
+         * Deletes the entry under 'key', if there is one.
+         */
+        Status remove(const K& key) {
+            KVMapConstIt i = _kvMap.find(key);
+            if (_kvMap.end() == i) {
+                return Status(ErrorCodes::NoSuchKey, "no such key in LRU key-value store");
+            }
+            KVListIt found = i->second;
+            delete found->second;
+            _kvMap.erase(i);
+            _kvList.erase(found);
+            _currentSize--;
+            return Status::OK();
+        }
+
+        /**
+         * Deletes every entry.
+         */
+        void clear() {
+            for (KVListIt i = _kvList.begin(); i != _kvList.end(); ++i) {
+                delete i->second;
+            }
+            _kvMap.clear();
+            _kvList.clear();
+            _currentSize = 0;
+        }
+
+        size_t size() const { return _currentSize; }
+
+        size_t maxSize() const { return _maxSize; }
+
+        /**
+         * Iterates from the most to the least recently used entry.
+         */
+        const_iterator begin() const { return _kvList.begin(); }
+
+        const_iterator end() const { return _kvList.end(); }
+
+    private:
+        // The maximum allowable number of entries.
+        const size_t _maxSize;
+
+        // The number of entries, kept as std::list::size() is linear.
+        size_t _currentSize;
+
+        // Most recently used first.
+        KVList _kvList;
+
+        // Finds an entry's place in _kvList.
+        KVMap _kvMap;
+    };
+
+}  // namespace mongo
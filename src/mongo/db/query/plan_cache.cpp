@@ -35,11 +35,18 @@
 #include "mongo/db/query/plan_ranker.h"
 #include "mongo/db/query/query_solution.h"
 #include "mongo/db/query/qlog.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/platform/hash_namespace.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
 
-    const int PlanCache::kPlanCacheMaxWriteOperations = 1000;
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheSize, int, 5000);
+
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryCacheEvictionRatio, double, 10.0);
+
+    // static
+    const size_t PlanCache::kNumShards = 16;
 
     //
     // Cache-related functions for CanonicalQuery
@@ -84,6 +91,7 @@ namespace mongo {
         : plannerData(entry.plannerData.size()),
           backupSoln(entry.backupSoln),
           key(key),
+          hits(entry.hits),
           query(entry.query.copy()),
           sort(entry.sort.copy()),
           projection(entry.projection.copy()) {
@@ -109,7 +117,8 @@ namespace mongo {
 
     PlanCacheEntry::PlanCacheEntry(const std::vector<QuerySolution*>& solutions,
                                    PlanRankingDecision* d)
-        : plannerData(solutions.size()) {
+        : plannerData(solutions.size()),
+          hits(0) {
         // The caller of this constructor is responsible for ensuring
         // that the QuerySolution 's' has valid cacheData. If there's no
         // data to cache you shouldn't be trying to construct a PlanCacheEntry.
@@ -142,6 +151,77 @@ namespace mongo {
         return ss;
     }
 
+    namespace {
+
+        bool treeUsesIndex(const PlanCacheIndexTree* tree, const BSONObj& keyPattern) {
+            if (NULL != tree->entry.get() && tree->entry->keyPattern.woCompare(keyPattern) == 0) {
+                return true;
+            }
+            for (size_t i = 0; i < tree->children.size(); ++i) {
+                if (treeUsesIndex(tree->children[i], keyPattern)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Returns true if 'obj', a query or sort, mentions the path 'field', or a path inside or
+         * containing it, including under $and, $or and $nor.
+         */
+        bool mentionsField(const BSONObj& obj, const StringData& field) {
+            BSONObjIterator it(obj);
+            while (it.more()) {
+                BSONElement elt = it.next();
+                StringData name = elt.fieldNameStringData();
+                if ('$' != name[0]) {
+                    if (name == field) {
+                        return true;
+                    }
+                    // 'field' may be inside this one, as in {a: {$elemMatch: {b: 1}}} for
+                    // 'a.b', or this one may be inside 'field', as in {'a.b': 1} for 'a'.
+                    if (field.startsWith(name) && '.' == field[name.size()]) {
+                        return true;
+                    }
+                    if (name.startsWith(field) && '.' == name[field.size()]) {
+                        return true;
+                    }
+                }
+                else if (Array == elt.type()) {
+                    // $and, $or and $nor.
+                    BSONObjIterator clauses(elt.Obj());
+                    while (clauses.more()) {
+                        BSONElement clause = clauses.next();
+                        if (clause.isABSONObj() && mentionsField(clause.Obj(), field)) {
+                            return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+    }  // namespace
+
+    bool PlanCacheEntry::usesIndex(const BSONObj& keyPattern) const {
+        for (size_t i = 0; i < plannerData.size(); ++i) {
+            if (NULL != plannerData[i]->tree.get() &&
+                treeUsesIndex(plannerData[i]->tree.get(), keyPattern)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool PlanCacheEntry::couldUseIndex(const BSONObj& keyPattern) const {
+        BSONElement leading = keyPattern.firstElement();
+        if (leading.eoo()) {
+            return false;
+        }
+        StringData field = leading.fieldNameStringData();
+        return mentionsField(query, field) || mentionsField(sort, field);
+    }
+
     string CachedSolution::toString() const {
         mongoutils::str::stream ss;
         ss << "key: " << key << '\n';
@@ -241,8 +321,32 @@ namespace mongo {
     // PlanCache
     //
 
+    PlanCache::PlanCache() {
+        init(std::max(internalQueryCacheSize, 0));
+    }
+
+    PlanCache::PlanCache(size_t maxEntries) {
+        init(maxEntries);
+    }
+
+    void PlanCache::init(size_t maxEntries) {
+        // Small caches get fewer shards so that each still holds something.
+        size_t numShards = std::max(std::min(kNumShards, maxEntries), size_t(1));
+        size_t shardSize = (maxEntries + numShards - 1) / numShards;
+        for (size_t i = 0; i < numShards; ++i) {
+            _shards.push_back(new Shard(shardSize));
+        }
+    }
+
     PlanCache::~PlanCache() {
-        _clear();
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            delete _shards[i];
+        }
+    }
+
+    PlanCache::Shard* PlanCache::shardFor(const PlanCacheKey& key) const {
+        size_t hash = MONGO_HASH_NAMESPACE::hash<PlanCacheKey>()(key);
+        return _shards[hash % _shards.size()];
     }
 
     Status PlanCache::add(const CanonicalQuery& query, const std::vector<QuerySolution*>& solns,
@@ -270,16 +374,13 @@ namespace mongo {
             }
         }
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        // Replace existing entry.
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
+        // Replaces any existing entry.
         const PlanCacheKey& key = query.getPlanCacheKey();
-        ConstIterator i = _cache.find(key);
-        if (i != _cache.end()) {
-            PlanCacheEntry* previousEntry = i->second;
-            delete previousEntry;
+        Shard* shard = shardFor(key);
+        boost::lock_guard<boost::mutex> shardLock(shard->mutex);
+        if (shard->entries.add(key, entry)) {
+            _evictions.fetchAndAdd(1);
         }
-        _cache[key] = entry;
 
         return Status::OK();
     }
@@ -288,20 +389,41 @@ namespace mongo {
         const PlanCacheKey& key = query.getPlanCacheKey();
         verify(crOut);
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        ConstIterator i = _cache.find(key);
-        if (i == _cache.end()) {
+        Shard* shard = shardFor(key);
+        boost::lock_guard<boost::mutex> shardLock(shard->mutex);
+        PlanCacheEntry* entry;
+        Status status = shard->entries.get(key, &entry);
+        if (!status.isOK()) {
+            _misses.fetchAndAdd(1);
             return Status(ErrorCodes::BadValue, "no such key in cache");
         }
-        PlanCacheEntry* entry = i->second;
         verify(entry);
 
+        _hits.fetchAndAdd(1);
+        ++entry->hits;
         *crOut = new CachedSolution(key, *entry);
 
         return Status::OK();
     }
 
+    /**
+     * Returns true if the run in 'feedback' did more than internalQueryCacheEvictionRatio times
+     * as much work per result as the winning plan did while it was being picked.
+     */
+    static bool hasWorksRatioDegraded(const PlanCacheEntry* entry,
+                                      const PlanCacheEntryFeedback* feedback) {
+        const PlanStageStats* trial = entry->decision->statsOfWinner;
+        const PlanStageStats* run = feedback->stats.get();
+        if (NULL == trial || NULL == run || 0 == trial->common.works) {
+            return false;
+        }
+
+        // Add one to the results so that runs that find nothing still compare.
+        double trialWorksPerResult = double(trial->common.works) / (trial->common.advanced + 1);
+        double runWorksPerResult = double(run->common.works) / (run->common.advanced + 1);
+        return runWorksPerResult > internalQueryCacheEvictionRatio * trialWorksPerResult;
+    }
+
     // XXX: Figure out what the right policy is here for determining if
     // the cached solution is bad.
     static bool hasCachedPlanPerformanceDegraded(PlanCacheEntry* entry,
@@ -353,86 +475,115 @@ namespace mongo {
         }
         std::auto_ptr<PlanCacheEntryFeedback> autoFeedback(feedback);
 
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        ConstIterator i = _cache.find(cq.getPlanCacheKey());
-        if (i == _cache.end()) {
+        const PlanCacheKey& key = cq.getPlanCacheKey();
+        Shard* shard = shardFor(key);
+        boost::lock_guard<boost::mutex> shardLock(shard->mutex);
+        PlanCacheEntry* entry;
+        Status status = shard->entries.get(key, &entry);
+        if (!status.isOK()) {
             return Status(ErrorCodes::BadValue, "no such key in cache");
         }
-        PlanCacheEntry* entry = i->second;
         verify(entry);
 
-        if (entry->feedback.size() >= PlanCacheEntry::kMaxFeedback) {
+        bool degraded = hasWorksRatioDegraded(entry, autoFeedback.get());
+        if (!degraded && entry->feedback.size() >= PlanCacheEntry::kMaxFeedback) {
             // If we have enough feedback, then use it to determine whether
             // we should get rid of the cached solution.
-            if (hasCachedPlanPerformanceDegraded(entry, autoFeedback.get())) {
-                _cache.erase(i);
-            }
+            degraded = hasCachedPlanPerformanceDegraded(entry, autoFeedback.get());
         }
-        else {
+        else if (!degraded) {
             // We don't have enough feedback yet---just store it and move on.
             entry->feedback.push_back(autoFeedback.release());
         }
 
+        if (degraded) {
+            QLOG() << "Cached plan for " << key << " has degraded, uncaching it" << endl;
+            shard->entries.remove(key);
+            _replans.fetchAndAdd(1);
+        }
+
         return Status::OK();
     }
 
     Status PlanCache::remove(const CanonicalQuery& canonicalQuery) {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        const PlanCacheKey& ck = canonicalQuery.getPlanCacheKey();
-        ConstIterator i = _cache.find(ck);
-        if (i == _cache.end()) {
+        const PlanCacheKey& key = canonicalQuery.getPlanCacheKey();
+        Shard* shard = shardFor(key);
+        boost::lock_guard<boost::mutex> shardLock(shard->mutex);
+        Status status = shard->entries.remove(key);
+        if (!status.isOK()) {
             return Status(ErrorCodes::BadValue, "no such key in cache");
         }
-        PlanCacheEntry* entry = i->second;
-        verify(entry);
-        _cache.erase(i);
-        delete entry;
         return Status::OK();
     }
 
     void PlanCache::clear() {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        _clear();
-        _writeOperations.store(0);
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            boost::lock_guard<boost::mutex> shardLock(_shards[i]->mutex);
+            _shards[i]->entries.clear();
+        }
     }
 
     std::vector<CachedSolution*> PlanCache::getAllSolutions() const {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
+        typedef LRUKeyValue<PlanCacheKey, PlanCacheEntry>::const_iterator ConstIterator;
         std::vector<CachedSolution*> solutions;
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
-            const PlanCacheKey& key = i->first;
-            PlanCacheEntry* entry = i->second;
-            CachedSolution* cs = new CachedSolution(key, *entry);
-            solutions.push_back(cs);
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            boost::lock_guard<boost::mutex> shardLock(_shards[i]->mutex);
+            const LRUKeyValue<PlanCacheKey, PlanCacheEntry>& entries = _shards[i]->entries;
+            for (ConstIterator j = entries.begin(); j != entries.end(); ++j) {
+                solutions.push_back(new CachedSolution(j->first, *j->second));
+            }
         }
 
         return solutions;
     }
 
     size_t PlanCache::size() const {
-        boost::lock_guard<boost::mutex> cacheLock(_cacheMutex);
-        return _cache.size();
+        size_t total = 0;
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            boost::lock_guard<boost::mutex> shardLock(_shards[i]->mutex);
+            total += _shards[i]->entries.size();
+        }
+        return total;
     }
 
-    void PlanCache::notifyOfWriteOp() {
-        // It's fine to clear the cache multiple times if multiple threads
-        // increment the counter to kPlanCacheMaxWriteOperations or greater.
-        if (_writeOperations.addAndFetch(1) < kPlanCacheMaxWriteOperations) {
-            return;
-        }
-        clear();
+    size_t PlanCache::maxSize() const {
+        return _shards.size() * _shards[0]->entries.maxSize();
+    }
+
+    PlanCache::Counters PlanCache::getCounters() const {
+        Counters counters;
+        counters.hits = _hits.load();
+        counters.misses = _misses.load();
+        counters.replans = _replans.load();
+        counters.evictions = _evictions.load();
+        return counters;
     }
 
-    void PlanCache::_clear() {
-        typedef unordered_map<PlanCacheKey, PlanCacheEntry*>::const_iterator ConstIterator;
-        for (ConstIterator i = _cache.begin(); i != _cache.end(); i++) {
-            PlanCacheEntry* entry = i->second;
-            delete entry;
+    void PlanCache::notifyOfIndexAdded(const BSONObj& keyPattern) {
+        removeIf(&PlanCacheEntry::couldUseIndex, keyPattern);
+    }
+
+    void PlanCache::notifyOfIndexChanged(const BSONObj& keyPattern) {
+        removeIf(&PlanCacheEntry::usesIndex, keyPattern);
+    }
+
+    void PlanCache::removeIf(bool (PlanCacheEntry::*pred)(const BSONObj&) const,
+                             const BSONObj& keyPattern) {
+        typedef LRUKeyValue<PlanCacheKey, PlanCacheEntry>::const_iterator ConstIterator;
+        for (size_t i = 0; i < _shards.size(); ++i) {
+            boost::lock_guard<boost::mutex> shardLock(_shards[i]->mutex);
+            LRUKeyValue<PlanCacheKey, PlanCacheEntry>& entries = _shards[i]->entries;
+
+            std::vector<PlanCacheKey> toRemove;
+            for (ConstIterator j = entries.begin(); j != entries.end(); ++j) {
+                if ((j->second->*pred)(keyPattern)) {
+                    toRemove.push_back(j->first);
+                }
+            }
+            for (size_t j = 0; j < toRemove.size(); ++j) {
+                entries.remove(toRemove[j]);
+            }
         }
-        _cache.clear();
     }
 
 }  // namespace mongo
@@ -29,12 +29,14 @@
 #pragma once
 
 #include <set>
+#include <vector>
 #include <boost/optional/optional.hpp>
 #include <boost/thread/mutex.hpp>
 
 #include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/query/canonical_query.h"
 #include "mongo/db/query/index_tag.h"
+#include "mongo/db/query/lru_key_value.h"
 #include "mongo/db/query/query_planner_params.h"
 #include "mongo/platform/atomic_word.h"
 
@@ -44,11 +46,16 @@ namespace mongo {
     struct QuerySolution;
     struct QuerySolutionNode;
 
+    // About how many entries each collection's PlanCache may hold.
+    extern int internalQueryCacheSize;
+
+    // A cached plan is dropped, and its query shape planned again, when a run of it does this
+    // many times as much work per result as it did in the trial that picked it.
+    extern double internalQueryCacheEvictionRatio;
+
     /**
      * TODO HK notes
 
-     * cache should be LRU with some cap on size
-
      * {x:1} and {x:{$gt:7}} not same shape for now -- operator matters
      */
 
@@ -196,6 +203,9 @@ namespace mongo {
         // For debugging.
         std::string toString() const;
 
+        // How many times the entry has been looked up.
+        long long hits;
+
         // We are extracting just enough information from the canonical
         // query. We could clone the canonical query but the following
         // items are all that is displayed to the user.
@@ -227,6 +237,17 @@ namespace mongo {
         // For debugging.
         std::string toString() const;
 
+        /**
+         * Returns true if any of the plans the entry can recreate scans the index 'keyPattern'.
+         */
+        bool usesIndex(const BSONObj& keyPattern) const;
+
+        /**
+         * Returns true if the index 'keyPattern' could help answer the entry's query shape, ie.
+         * the query or sort mentions its leading field.
+         */
+        bool couldUseIndex(const BSONObj& keyPattern) const;
+
         //
         // Planner data
         //
@@ -265,6 +286,9 @@ namespace mongo {
         // The standard deviation of the scores from stored as feedback.
         boost::optional<double> stddevScore;
 
+        // How many times the entry has been looked up.
+        long long hits;
+
         // Determines the amount of feedback that we are willing to store. Must be >= 1.
         // TODO: how do we tune this?
         static const size_t kMaxFeedback;
@@ -281,16 +305,34 @@ namespace mongo {
      * mapping, the cache contains information on why that mapping was made and statistics on the
      * cache entry's actual performance on subsequent runs.
      *
+     * The cache holds a bounded number of entries and drops the least recently used to make room.
+     * Entries are also dropped one at a time: when indexes they use or could use change, and when
+     * feedback shows their plan doing much worse than it did when it was picked.
+     *
+     * Entries are spread over several independently locked shards by key.  Each shard has its
+     * own share of the capacity and its own LRU order.
      */
     class PlanCache {
     private:
         MONGO_DISALLOW_COPYING(PlanCache);
     public:
         /**
-         * Flush cache when the number of write operations since last
-         * clear() reaches this limit.
+         * Totals since the cache was created, for the plan cache commands.
          */
-        static const int kPlanCacheMaxWriteOperations;
+        struct Counters {
+            // Lookups that found an entry.
+            long long hits;
+
+            // Lookups that didn't.
+            long long misses;
+
+            // Entries dropped because their plan performed badly, so that the query shape gets
+            // planned again.
+            long long replans;
+
+            // Entries dropped to make room for others.
+            long long evictions;
+        };
 
         /**
          * We don't want to cache every possible query. This function
@@ -309,7 +351,15 @@ namespace mongo {
          */
         static PlanCacheKey getPlanCacheKey(const CanonicalQuery& query);
 
-        PlanCache() { }
+        /**
+         * Holds about internalQueryCacheSize entries.
+         */
+        PlanCache();
+
+        /**
+         * Holds about 'maxEntries' entries.
+         */
+        explicit PlanCache(size_t maxEntries);
 
         ~PlanCache();
 
@@ -353,7 +403,9 @@ namespace mongo {
          * statistics about the plan.  Status::OK() is returned.
          *
          * May cause the cache entry to be removed if it is determined that the cached plan
-         * is badly performing.
+         * is badly performing: when the run did more than internalQueryCacheEvictionRatio times
+         * as much work per result as the plan did in the trial that picked it, or when its score
+         * falls well below those of earlier runs.
          */
         Status feedback(const CanonicalQuery& cq, PlanCacheEntryFeedback* feedback);
 
@@ -382,32 +434,53 @@ namespace mongo {
         size_t size() const;
 
         /**
-         *  You must notify the cache if you are doing writes, as query plan utility will change.
-         *  Cache is flushed after every 1000 notifications.
+         * Returns the most entries the cache will hold.
          */
-        void notifyOfWriteOp();
+        size_t maxSize() const;
 
-    private:
+        Counters getCounters() const;
 
         /**
-         * Releases resources associated with each cache entry
-         * and clears map.
-         * Invoked by clear() and during destruction.
+         * Call when the index 'keyPattern' is added.  Drops the entries for query shapes it could
+         * help with, so that they get planned again with it as a candidate.
          */
-        void _clear();
-
-        unordered_map<PlanCacheKey, PlanCacheEntry*> _cache;
+        void notifyOfIndexAdded(const BSONObj& keyPattern);
 
         /**
-         * Protects _cache.
+         * Call when the index 'keyPattern' is dropped or changes in a way that affects the plans
+         * that use it, such as becoming multikey.  Drops the entries whose plans use it.
          */
-        mutable boost::mutex _cacheMutex;
+        void notifyOfIndexChanged(const BSONObj& keyPattern);
+
+    private:
+        static const size_t kNumShards;
+
+        struct Shard {
+            explicit Shard(size_t maxSize) : entries(maxSize) { }
+
+            // Protects entries.
+            boost::mutex mutex;
+            LRUKeyValue<PlanCacheKey, PlanCacheEntry> entries;
+        };
+
+        void init(size_t maxEntries);
+
+        Shard* shardFor(const PlanCacheKey& key) const;
 
         /**
-         * Counter for write notifications since initialization or last clear() invocation.
-         * Starts at 0.
+         * Drops the entries for which 'pred(*entry, keyPattern)' is true.
          */
-        AtomicInt32 _writeOperations;
+        void removeIf(bool (PlanCacheEntry::*pred)(const BSONObj&) const,
+                      const BSONObj& keyPattern);
+
+        // Owned here.
+        std::vector<Shard*> _shards;
+
+        // Counted by const lookups too.
+        mutable AtomicInt64 _hits;
+        mutable AtomicInt64 _misses;
+        mutable AtomicInt64 _replans;
+        mutable AtomicInt64 _evictions;
     };
 
 }  // namespace mongo
@@ -263,45 +263,138 @@ namespace {
         ASSERT_EQUALS(planCache.size(), 1U);
     }
 
-    TEST(PlanCacheTest, NotifyOfWriteOp) {
-        PlanCache planCache;
-        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+    /**
+     * Adds a single solution for 'cq' whose index tree uses 'keyPattern', if not empty.
+     */
+    void addSolution(PlanCache* planCache, const CanonicalQuery& cq,
+                     const BSONObj& keyPattern = BSONObj(),
+                     PlanRankingDecision* decision = new PlanRankingDecision()) {
         QuerySolution qs;
         qs.cacheData.reset(new SolutionCacheData());
         qs.cacheData->tree.reset(new PlanCacheIndexTree());
+        if (!keyPattern.isEmpty()) {
+            qs.cacheData->tree->setIndexEntry(IndexEntry(keyPattern));
+        }
         std::vector<QuerySolution*> solns;
         solns.push_back(&qs);
-        ASSERT_OK(planCache.add(*cq, solns, new PlanRankingDecision()));
+        ASSERT_OK(planCache->add(cq, solns, decision));
+    }
+
+    TEST(PlanCacheTest, WritesDoNotClearCache) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        addSolution(&planCache, *cq);
         ASSERT_EQUALS(planCache.size(), 1U);
+        ASSERT_EQUALS(planCache.maxSize(), static_cast<size_t>(internalQueryCacheSize));
+    }
 
-        // First (PlanCache::kPlanCacheMaxWriteOperations - 1) notifications should have
-        // no effect on cache contents.
-        for (int i = 0; i < (PlanCache::kPlanCacheMaxWriteOperations - 1); ++i) {
-            planCache.notifyOfWriteOp();
-        }
+    TEST(PlanCacheTest, EvictLeastRecentlyUsed) {
+        PlanCache planCache(1);
+        ASSERT_EQUALS(planCache.maxSize(), 1U);
+        auto_ptr<CanonicalQuery> cqA(canonicalize("{a: 1}"));
+        auto_ptr<CanonicalQuery> cqB(canonicalize("{b: 1}"));
+
+        addSolution(&planCache, *cqA);
+        addSolution(&planCache, *cqB);
         ASSERT_EQUALS(planCache.size(), 1U);
+        ASSERT_EQUALS(planCache.getCounters().evictions, 1LL);
 
-        // 1000th notification will cause cache to be cleared.
-        planCache.notifyOfWriteOp();
-        ASSERT_EQUALS(planCache.size(), 0U);
+        CachedSolution* cs;
+        ASSERT_NOT_OK(planCache.get(*cqA, &cs));
+        ASSERT_OK(planCache.get(*cqB, &cs));
+        delete cs;
+    }
 
-        // Clearing the cache should reset the internal write
-        // operation counter.
-        // Repopulate cache. Write (PlanCache::kPlanCacheMaxWriteOperations - 1) times.
-        // Clear cache.
-        // Add cache entry again.
-        // After clearing and adding a new entry, the next write operation should not
-        // clear the cache.
-        ASSERT_OK(planCache.add(*cq, solns, new PlanRankingDecision()));
-        for (int i = 0; i < (PlanCache::kPlanCacheMaxWriteOperations - 1); ++i) {
-            planCache.notifyOfWriteOp();
-        }
+    TEST(PlanCacheTest, HitAndMissCounters) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+
+        CachedSolution* cs;
+        ASSERT_NOT_OK(planCache.get(*cq, &cs));
+        addSolution(&planCache, *cq);
+        ASSERT_OK(planCache.get(*cq, &cs));
+        delete cs;
+        ASSERT_OK(planCache.get(*cq, &cs));
+        ASSERT_EQUALS(cs->hits, 2LL);
+        delete cs;
+
+        PlanCache::Counters counters = planCache.getCounters();
+        ASSERT_EQUALS(counters.hits, 2LL);
+        ASSERT_EQUALS(counters.misses, 1LL);
+        ASSERT_EQUALS(counters.replans, 0LL);
+        ASSERT_EQUALS(counters.evictions, 0LL);
+    }
+
+    TEST(PlanCacheTest, NotifyOfIndexChanged) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cqA(canonicalize("{a: 1}"));
+        auto_ptr<CanonicalQuery> cqB(canonicalize("{b: 1}"));
+        addSolution(&planCache, *cqA, BSON("a" << 1));
+        addSolution(&planCache, *cqB, BSON("b" << 1));
+
+        // Only the entry whose plan uses {a: 1} goes.
+        planCache.notifyOfIndexChanged(BSON("a" << 1 << "c" << 1));
+        ASSERT_EQUALS(planCache.size(), 2U);
+        planCache.notifyOfIndexChanged(BSON("a" << 1));
         ASSERT_EQUALS(planCache.size(), 1U);
-        planCache.clear();
-        ASSERT_OK(planCache.add(*cq, solns, new PlanRankingDecision()));
-        // Notification after clearing will not flush cache.
-        planCache.notifyOfWriteOp();
+
+        CachedSolution* cs;
+        ASSERT_OK(planCache.get(*cqB, &cs));
+        delete cs;
+    }
+
+    TEST(PlanCacheTest, NotifyOfIndexAdded) {
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cqA(canonicalize("{a: 1, b: 1}"));
+        auto_ptr<CanonicalQuery> cqB(canonicalize("{c: 1}", "{'d.e': 1}", "{}"));
+        addSolution(&planCache, *cqA);
+        addSolution(&planCache, *cqB);
+
+        // An index whose leading field no query mentions cannot help either entry.
+        planCache.notifyOfIndexAdded(BSON("x" << 1 << "a" << 1));
+        ASSERT_EQUALS(planCache.size(), 2U);
+
+        // Matches a query predicate.
+        planCache.notifyOfIndexAdded(BSON("b" << 1));
         ASSERT_EQUALS(planCache.size(), 1U);
+
+        // Matches the parent of a sort field.
+        planCache.notifyOfIndexAdded(BSON("d" << -1));
+        ASSERT_EQUALS(planCache.size(), 0U);
+    }
+
+    TEST(PlanCacheTest, FeedbackWorksRatioDegraded) {
+        // The winning plan did 100 works for 10 results during the trial.
+        CommonStats trial;
+        trial.works = 100;
+        trial.advanced = 10;
+        PlanStageStats trialStats(trial, STAGE_COLLSCAN);
+
+        PlanCache planCache;
+        auto_ptr<CanonicalQuery> cq(canonicalize("{a: 1}"));
+        PlanRankingDecision* decision = new PlanRankingDecision();
+        decision->statsOfWinner = &trialStats;
+        addSolution(&planCache, *cq, BSONObj(), decision);
+
+        // A run that is a little worse is kept as feedback.
+        PlanCacheEntryFeedback* feedback = new PlanCacheEntryFeedback();
+        CommonStats run;
+        run.works = 200;
+        run.advanced = 10;
+        feedback->stats.reset(new PlanStageStats(run, STAGE_COLLSCAN));
+        feedback->score = 1;
+        ASSERT_OK(planCache.feedback(*cq, feedback));
+        ASSERT_EQUALS(planCache.size(), 1U);
+
+        // A run that does far more work per result than the trial evicts the entry.
+        feedback = new PlanCacheEntryFeedback();
+        run.works = 100000;
+        run.advanced = 10;
+        feedback->stats.reset(new PlanStageStats(run, STAGE_COLLSCAN));
+        feedback->score = 1;
+        ASSERT_OK(planCache.feedback(*cq, feedback));
+        ASSERT_EQUALS(planCache.size(), 0U);
+        ASSERT_EQUALS(planCache.getCounters().replans, 1LL);
     }
 
     /**
@@ -33,11 +33,19 @@
 #include "mongo/db/exec/working_set.h"
 #include "mongo/db/exec/working_set_common.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/server_parameters.h"
 
 namespace mongo {
 
+    MONGO_EXPORT_SERVER_PARAMETER(internalQueryExecBatchSize, int, 1);
+
     PlanExecutor::PlanExecutor(WorkingSet* ws, PlanStage* rt)
-        : _workingSet(ws) , _root(rt) , _killed(false) { }
+        : _workingSet(ws),
+          _root(rt),
+          _batchPos(0),
+          _batchEndState(PlanStage::NEED_TIME),
+          _batchEndId(WorkingSet::INVALID_ID),
+          _killed(false) { }
 
     PlanExecutor::~PlanExecutor() { }
 
@@ -62,6 +70,14 @@ namespace mongo {
 
     void PlanExecutor::invalidate(const DiskLoc& dl, InvalidationType type) {
         if (!_killed) { _root->invalidate(dl, type); }
+
+        // The plan has let go of the results we're holding, so they're ours to fix up.
+        for (size_t i = _batchPos; i < _batch.size(); ++i) {
+            WorkingSetMember* member = _workingSet->get(_batch[i]);
+            if (member->hasLoc() && member->loc == dl) {
+                WorkingSetCommon::fetchAndInvalidateLoc(member);
+            }
+        }
     }
 
     void PlanExecutor::setYieldPolicy(Runner::YieldPolicy policy) {
@@ -86,7 +102,7 @@ namespace mongo {
             }
 
             WorkingSetID id;
-            PlanStage::StageState code = _root->work(&id);
+            PlanStage::StageState code = nextState(&id);
 
             if (PlanStage::ADVANCED == code) {
                 WorkingSetMember* member = _workingSet->get(id);
@@ -177,8 +193,47 @@ namespace mongo {
         }
     }
 
+    PlanStage::StageState PlanExecutor::nextState(WorkingSetID* out) {
+        if (_batchPos < _batch.size()) {
+            *out = _batch[_batchPos++];
+            return PlanStage::ADVANCED;
+        }
+
+        if (PlanStage::NEED_TIME != _batchEndState) {
+            PlanStage::StageState state = _batchEndState;
+            *out = _batchEndId;
+            _batchEndState = PlanStage::NEED_TIME;
+            return state;
+        }
+
+        if (internalQueryExecBatchSize <= 1) {
+            return _root->work(out);
+        }
+
+        _batch.clear();
+        _batchPos = 0;
+        PlanStage::StageState state = _root->workBatch(internalQueryExecBatchSize, &_batch, out);
+        if (_batch.empty()) {
+            return state;
+        }
+
+        // A fetch goes first: the member's loc is only guaranteed until we next yield, and
+        // handing out the batch may yield.  The batch is handed out after it.
+        if (PlanStage::NEED_FETCH == state) {
+            return state;
+        }
+
+        // Hand out the batch first.
+        if (PlanStage::ADVANCED != state) {
+            _batchEndState = state;
+            _batchEndId = *out;
+        }
+        *out = _batch[_batchPos++];
+        return PlanStage::ADVANCED;
+    }
+
     bool PlanExecutor::isEOF() {
-        return _killed || _root->isEOF();
+        return _killed || (_batchPos == _batch.size() && _root->isEOF());
     }
 
     void PlanExecutor::kill() {
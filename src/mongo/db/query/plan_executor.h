@@ -29,8 +29,10 @@
 #pragma once
 
 #include <boost/scoped_ptr.hpp>
+#include <vector>
 
 #include "mongo/base/status.h"
+#include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/query/runner.h"
 #include "mongo/db/query/runner_yield_policy.h"
 
@@ -38,10 +40,13 @@ namespace mongo {
 
     class BSONObj;
     class DiskLoc;
-    class PlanStage;
     struct PlanStageStats;
     class WorkingSet;
 
+    // How many results a PlanExecutor asks its plan for at once.  1 calls work() a result at a
+    // time; more calls workBatch().
+    extern int internalQueryExecBatchSize;
+
     /**
      * A PlanExecutor is the abstraction that knows how to crank a tree of stages into execution.
      * The executor is usually part of a larger abstraction that is interacting with the cache
@@ -99,10 +104,27 @@ namespace mongo {
         void kill();
 
     private:
+        /**
+         * Gets the next state from the plan, from the current batch if there's anything left in
+         * it.
+         */
+        PlanStage::StageState nextState(WorkingSetID* out);
+
         boost::scoped_ptr<WorkingSet> _workingSet;
         boost::scoped_ptr<PlanStage> _root;
         boost::scoped_ptr<RunnerYieldPolicy> _yieldPolicy;
 
+        // Results of the last workBatch() not handed out yet, from _batchPos on.  Kept valid
+        // across yields by invalidate().
+        std::vector<WorkingSetID> _batch;
+        size_t _batchPos;
+
+        // The state that ended the last batch, to return once the batch has been handed out.
+        // NEED_TIME if there's nothing to return.  Never NEED_FETCH, which is returned before
+        // the batch.
+        PlanStage::StageState _batchEndState;
+        WorkingSetID _batchEndId;
+
         // Did somebody drop an index we care about or the namespace we're looking at?  If so,
         // we'll be killed.
         bool _killed;
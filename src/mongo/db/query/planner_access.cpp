@@ -66,6 +66,7 @@ namespace mongo {
         csn->filter.reset(query.root()->shallowClone());
         csn->tailable = tailable;
         csn->maxScan = query.getParsed().getMaxScan();
+        csn->parallelOk = true;
 
         // If the sort is {$natural: +-1} this changes the direction of the collection scan.
         const BSONObj& sortObj = query.getParsed().getSort();
@@ -73,6 +74,7 @@ namespace mongo {
             BSONElement natural = sortObj.getFieldDotted("$natural");
             if (!natural.eoo()) {
                 csn->direction = natural.numberInt() >= 0 ? 1 : -1;
+                csn->parallelOk = false;
             }
         }
 
@@ -81,6 +83,7 @@ namespace mongo {
             BSONElement natural = query.getParsed().getHint().getFieldDotted("$natural");
             if (!natural.eoo()) {
                 csn->direction = natural.numberInt() >= 0 ? 1 : -1;
+                csn->parallelOk = false;
             }
         }
 
@@ -991,4 +994,40 @@ namespace mongo {
         return solnRoot;
     }
 
+    // static
+    QuerySolutionNode* QueryPlannerAccess::useBitmapIntersection(const CanonicalQuery& query,
+                                                                 QuerySolutionNode* root) {
+        for (size_t i = 0; i < root->children.size(); ++i) {
+            root->children[i] = useBitmapIntersection(query, root->children[i]);
+        }
+
+        if (STAGE_AND_HASH != root->getType() || NULL != root->filter.get()) {
+            return root;
+        }
+
+        // A bitmap AND only hands back DiskLocs, so a child that fetched would have its
+        // documents thrown away and fetched again.
+        const BSONObj& sort = query.getParsed().getSort();
+        for (size_t i = 0; i < root->children.size(); ++i) {
+            if (root->children[i]->fetched()) {
+                return root;
+            }
+
+            // The AndHashNode provides the sort order of its last child, which buildIndexedAnd
+            // picked to provide the sort if it could.  The bitmap only provides DiskLoc order.
+            if (!sort.isEmpty()) {
+                root->children[i]->computeProperties();
+                const BSONObjSet& sorts = root->children[i]->getSort();
+                if (sorts.end() != sorts.find(sort)) {
+                    return root;
+                }
+            }
+        }
+
+        AndBitmapNode* abn = new AndBitmapNode();
+        abn->children.swap(root->children);
+        delete root;
+        return abn;
+    }
+
 }  // namespace mongo
@@ -104,6 +104,15 @@ namespace mongo {
                                                  bool inArrayOperator,
                                                  const vector<IndexEntry>& indices);
 
+        /**
+         * Replaces each AND_HASH in the tree rooted at 'root' with an AND_BITMAP when the bitmap
+         * can do the same job: the AND has no filter, none of its children fetch, and none of
+         * its children provides the query's sort.  Takes ownership of 'root' and returns the new
+         * root.
+         */
+        static QuerySolutionNode* useBitmapIntersection(const CanonicalQuery& query,
+                                                        QuerySolutionNode* root);
+
         /**
          * Helper used by buildIndexedAnd and buildIndexedOr.
          *
@@ -86,7 +86,10 @@ namespace mongo {
             ss << "INCLUDE_SHARD_FILTER ";
         }
         if (options & QueryPlannerParams::NO_BLOCKING_SORT) {
-            ss << "NO_BLOCKING_SORT";
+            ss << "NO_BLOCKING_SORT ";
+        }
+        if (options & QueryPlannerParams::INDEX_INTERSECTION_BITMAP) {
+            ss << "INDEX_INTERSECTION_BITMAP";
         }
         return ss;
     }
@@ -327,6 +330,10 @@ namespace mongo {
         QuerySolutionNode* solnRoot =
             QueryPlannerAccess::buildIndexedDataAccess(query, clone, false, params.indices);
 
+        if (NULL != solnRoot && (params.options & QueryPlannerParams::INDEX_INTERSECTION_BITMAP)) {
+            solnRoot = QueryPlannerAccess::useBitmapIntersection(query, solnRoot);
+        }
+
         if (NULL != solnRoot) {
             // Takes ownership of 'solnRoot'.
             QuerySolution* soln = QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
@@ -713,6 +720,10 @@ namespace mongo {
 
                 if (NULL == solnRoot) { continue; }
 
+                if (params.options & QueryPlannerParams::INDEX_INTERSECTION_BITMAP) {
+                    solnRoot = QueryPlannerAccess::useBitmapIntersection(query, solnRoot);
+                }
+
                 QuerySolution* soln = QueryPlannerAnalysis::analyzeDataAccess(query, params, solnRoot);
                 if (NULL != soln) {
                     QLOG() << "Planner: adding solution:\n" << soln->toString() << endl;
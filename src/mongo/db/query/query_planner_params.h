@@ -64,6 +64,11 @@ namespace mongo {
 
             // Set this if you want to turn on index intersection.
             INDEX_INTERSECTION = 1 << 4,
+
+            // Set this along with INDEX_INTERSECTION to intersect index scans that aren't sorted
+            // by DiskLoc with a compressed DiskLoc bitmap instead of a hash table, where that's
+            // possible.
+            INDEX_INTERSECTION_BITMAP = 1 << 5,
         };
 
         // See Options enum above.
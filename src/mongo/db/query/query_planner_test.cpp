@@ -2041,6 +2041,47 @@ namespace {
                                     "{ixscan: {filter: null, pattern: {b:1}}}]}}}}");
     }
 
+    TEST_F(QueryPlannerTest, IntersectBitmapTwoPred) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::INDEX_INTERSECTION
+                         | QueryPlannerParams::INDEX_INTERSECTION_BITMAP;
+        addIndex(BSON("a" << 1));
+        addIndex(BSON("b" << 1));
+        runQuery(fromjson("{a:1, b:{$gt: 1}}"));
+
+        assertSolutionExists("{fetch: {filter: null, node: {andBitmap: {nodes: ["
+                                    "{ixscan: {filter: null, pattern: {a:1}}},"
+                                    "{ixscan: {filter: null, pattern: {b:1}}}]}}}}");
+    }
+
+    TEST_F(QueryPlannerTest, IntersectBitmapSubtreeNodes) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::INDEX_INTERSECTION
+                         | QueryPlannerParams::INDEX_INTERSECTION_BITMAP;
+        addIndex(BSON("a" << 1));
+        addIndex(BSON("b" << 1));
+        addIndex(BSON("c" << 1));
+        addIndex(BSON("d" << 1));
+
+        runQuery(fromjson("{$or: [{a: 1}, {b: 1}], $or: [{c:1}, {d:1}]}"));
+        assertSolutionExists("{fetch: {filter: null, node: {andBitmap: {nodes: ["
+                                    "{or: {nodes: [{ixscan:{filter:null, pattern:{a:1}}},"
+                                          "{ixscan:{filter:null, pattern:{b:1}}}]}},"
+                                    "{or: {nodes: [{ixscan:{filter:null, pattern:{c:1}}},"
+                                          "{ixscan:{filter:null, pattern:{d:1}}}]}}]}}}}");
+    }
+
+    // The bitmap doesn't provide the sort that the hashed AND gets from its last child.
+    TEST_F(QueryPlannerTest, IntersectBitmapKeepsSortFromAndHash) {
+        params.options = QueryPlannerParams::NO_TABLE_SCAN | QueryPlannerParams::INDEX_INTERSECTION
+                         | QueryPlannerParams::INDEX_INTERSECTION_BITMAP;
+        addIndex(BSON("a" << 1));
+        addIndex(BSON("b" << 1));
+        runQuerySortProj(fromjson("{a: 1, b:{$gt: 1}}"), fromjson("{b:1}"), BSONObj());
+
+        assertSolutionExists("{fetch: {filter: null, node: {andHash: {nodes: ["
+                                    "{ixscan: {filter: null, pattern: {a:1}}},"
+                                    "{ixscan: {filter: null, pattern: {b:1}}}]}}}}");
+    }
+
     //
     // Test bad input to query planner helpers.
     //
@@ -304,6 +304,12 @@ namespace mongo {
             BSONObj orObj = el.Obj();
             return childrenMatch(orObj, orn);
         }
+        else if (STAGE_AND_BITMAP == trueSoln->getType()) {
+            const AndBitmapNode* abn = static_cast<const AndBitmapNode*>(trueSoln);
+            BSONElement el = testSoln["andBitmap"];
+            if (el.eoo() || !el.isABSONObj()) { return false; }
+            return childrenMatch(el.Obj(), abn);
+        }
         else if (STAGE_AND_HASH == trueSoln->getType()) {
             const AndHashNode* ahn = static_cast<const AndHashNode*>(trueSoln);
             BSONElement el = testSoln["andHash"];
@@ -77,7 +77,10 @@ namespace mongo {
     // CollectionScanNode
     //
 
-    CollectionScanNode::CollectionScanNode() : tailable(false), direction(1), maxScan(0) { }
+    CollectionScanNode::CollectionScanNode() : tailable(false),
+                                               direction(1),
+                                               maxScan(0),
+                                               parallelOk(false) { }
 
     void CollectionScanNode::appendToString(mongoutils::str::stream* ss, int indent) const {
         addIndent(ss, indent);
@@ -91,6 +94,25 @@ namespace mongo {
         addCommon(ss, indent);
     }
 
+    //
+    // AndBitmapNode
+    //
+
+    AndBitmapNode::AndBitmapNode() { }
+
+    AndBitmapNode::~AndBitmapNode() { }
+
+    void AndBitmapNode::appendToString(mongoutils::str::stream* ss, int indent) const {
+        addIndent(ss, indent);
+        *ss << "AND_BITMAP\n";
+        addCommon(ss, indent);
+        for (size_t i = 0; i < children.size(); ++i) {
+            addIndent(ss, indent + 1);
+            *ss << "Child " << i << ":\n";
+            children[i]->appendToString(ss, indent + 1);
+        }
+    }
+
     //
     // AndHashNode
     //
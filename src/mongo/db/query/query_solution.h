@@ -234,6 +234,26 @@ namespace mongo {
 
         // maxScan option to .find() limits how many docs we look at.
         int maxScan;
+
+        // Can the scan hand back documents out of $natural order, and so run on several threads?
+        bool parallelOk;
+    };
+
+    struct AndBitmapNode : public QuerySolutionNode {
+        AndBitmapNode();
+        virtual ~AndBitmapNode();
+
+        virtual StageType getType() const { return STAGE_AND_BITMAP; }
+
+        virtual void appendToString(mongoutils::str::stream* ss, int indent) const;
+
+        // Only DiskLocs come out of a bitmap AND: no object and no index keys.
+        bool fetched() const { return false; }
+        bool hasField(const string& field) const { return false; }
+        bool sortedByDiskLoc() const { return true; }
+        const BSONObjSet& getSort() const { return _sort; }
+
+        BSONObjSet _sort;
     };
 
     struct AndHashNode : public QuerySolutionNode {
@@ -28,8 +28,11 @@
 
 #include "mongo/db/query/stage_builder.h"
 
+#include <limits>
+
 #include "mongo/db/exec/2d.h"
 #include "mongo/db/exec/2dnear.h"
+#include "mongo/db/exec/and_bitmap.h"
 #include "mongo/db/exec/and_hash.h"
 #include "mongo/db/exec/and_sorted.h"
 #include "mongo/db/exec/collection_scan.h"
@@ -59,6 +62,10 @@ namespace mongo {
             params.direction = (csn->direction == 1) ? CollectionScanParams::FORWARD
                                                      : CollectionScanParams::BACKWARD;
             params.maxScan = csn->maxScan;
+            if (csn->parallelOk) {
+                // As many threads as internalQueryExecCollectionScanThreads allows.
+                params.parallelism = std::numeric_limits<size_t>::max();
+            }
             return new CollectionScan(params, ws, csn->filter.get());
         }
         else if (STAGE_IXSCAN == root->getType()) {
@@ -106,6 +113,8 @@ namespace mongo {
             params.pattern = sn->pattern;
             params.query = sn->query;
             params.limit = sn->limit;
+            params.maxMemoryUsageBytes = internalQueryExecSortMaxBytes;
+            params.extSortAllowed = internalQueryExecSortAllowDiskUse;
             return new SortStage(params, ws, childStage);
         }
         else if (STAGE_PROJECTION == root->getType()) {
@@ -126,6 +135,16 @@ namespace mongo {
             if (NULL == childStage) { return NULL; }
             return new SkipStage(sn->skip, ws, childStage);
         }
+        else if (STAGE_AND_BITMAP == root->getType()) {
+            const AndBitmapNode* abn = static_cast<const AndBitmapNode*>(root);
+            auto_ptr<AndBitmapStage> ret(new AndBitmapStage(ws));
+            for (size_t i = 0; i < abn->children.size(); ++i) {
+                PlanStage* childStage = buildStages(qsol, abn->children[i], ws);
+                if (NULL == childStage) { return NULL; }
+                ret->addChild(childStage);
+            }
+            return ret.release();
+        }
         else if (STAGE_AND_HASH == root->getType()) {
             const AndHashNode* ahn = static_cast<const AndHashNode*>(root);
             auto_ptr<AndHashStage> ret(new AndHashStage(ws, ahn->filter.get()));
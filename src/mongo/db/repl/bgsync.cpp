@@ -76,6 +76,14 @@ namespace replset {
     static int bufferMaxSizeGauge = 256*1024*1024;
     static ServerStatusMetricField<int> displayBufferMaxSize( "repl.buffer.maxSizeBytes",
                                                                 &bufferMaxSizeGauge );
+    //The number and time spent waiting for room in the buffer to queue fetched batches
+    static TimerStats bufferFullStats;
+    static ServerStatusMetricField<TimerStats> displayBufferFull( "repl.buffer.pushWaits",
+                                                                &bufferFullStats );
+    //The number of fetched batches, and how long each sat in the buffer before being applied
+    static TimerStats queueLatencyStats;
+    static ServerStatusMetricField<TimerStats> displayQueueLatency( "repl.buffer.queueLatency",
+                                                                &queueLatencyStats );
 
 
     BackgroundSyncInterface::~BackgroundSyncInterface() {}
@@ -85,7 +93,12 @@ namespace replset {
         return static_cast<size_t>(o.objsize());
     }
 
-    BackgroundSync::BackgroundSync() : _buffer(bufferMaxSizeGauge, &getSize),
+    size_t getBatchSize(const BackgroundSync::OpBatch& batch) {
+        return batch.bytes;
+    }
+
+    BackgroundSync::BackgroundSync() : _buffer(bufferMaxSizeGauge, &getBatchSize),
+                                       _applyingPos(0),
                                        _lastOpTimeFetched(0, 0),
                                        _lastH(0),
                                        _pause(true),
@@ -125,7 +138,7 @@ namespace replset {
             boost::unique_lock<boost::mutex> lock(s_instance->_mutex);
 
             // If all ops in the buffer have been applied, unblock waitForRepl (if it's waiting)
-            if (s_instance->_buffer.empty()) {
+            if (s_instance->_opsUnconsumed.load() == 0) {
                 s_instance->_appliedBuffer = true;
                 s_instance->_condvar.notify_all();
             }
@@ -429,9 +442,29 @@ namespace replset {
             }
 
             // At this point, we are guaranteed to have at least one thing to read out
-            // of the oplogreader cursor.
-            BSONObj o = r.nextSafe().getOwned();
-            opsReadStats.increment();
+            // of the oplogreader cursor.  Queue everything left in the current batch together,
+            // copied into one buffer rather than an allocation per op.
+            std::vector<BSONObj> fetched;
+            size_t bytes = 0;
+            while (r.moreInCurrentBatch()) {
+                BSONObj o = r.nextSafe();
+                fetched.push_back(o);
+                bytes += getSize(o);
+            }
+
+            OpBatch batch;
+            batch.storage.reset(new char[bytes]);
+            batch.ops.reserve(fetched.size());
+            char* next = batch.storage.get();
+            for (std::vector<BSONObj>::const_iterator it = fetched.begin();
+                 it != fetched.end(); ++it) {
+                memcpy(next, it->objdata(), it->objsize());
+                batch.ops.push_back(BSONObj(next));
+                next += it->objsize();
+            }
+            batch.bytes = bytes;
+            const BSONObj& last = batch.ops.back();
+            opsReadStats.increment(batch.ops.size());
 
             {
                 boost::unique_lock<boost::mutex> lock(_mutex);
@@ -441,15 +474,20 @@ namespace replset {
             OCCASIONALLY {
                 LOG(2) << "bgsync buffer has " << _buffer.size() << " bytes" << rsLog;
             }
-            // the blocking queue will wait (forever) until there's room for us to push
-            _buffer.push(o);
-            bufferCountGauge.increment();
-            bufferSizeGauge.increment(getSize(o));
+            _opsUnconsumed.fetchAndAdd(batch.ops.size());
+            bufferCountGauge.increment(batch.ops.size());
+            bufferSizeGauge.increment(bytes);
+            {
+                // the blocking queue will wait (forever) until there's room for us to push
+                TimerHolder pushTimer(&bufferFullStats);
+                batch.queued.reset();
+                _buffer.push(batch);
+            }
 
             {
                 boost::unique_lock<boost::mutex> lock(_mutex);
-                _lastH = o["h"].numberLong();
-                _lastOpTimeFetched = o["ts"]._opTime();
+                _lastH = last["h"].numberLong();
+                _lastOpTimeFetched = last["ts"]._opTime();
             }
         }
     }
@@ -468,31 +506,60 @@ namespace replset {
     }
 
 
-    bool BackgroundSync::peek(BSONObj* op) {
-        {
-            boost::unique_lock<boost::mutex> lock(_mutex);
+    void BackgroundSync::_startApplying(const OpBatch& batch) {
+        queueLatencyStats.recordMillis(batch.queued.millis());
+        _applying = batch;
+        _applyingPos = 0;
 
-            if (_currentSyncTarget != _oplogMarkerTarget &&
-                _currentSyncTarget != NULL) {
-                _oplogMarkerTarget = NULL;
+        boost::unique_lock<boost::mutex> lock(_mutex);
+
+        if (_currentSyncTarget != _oplogMarkerTarget &&
+            _currentSyncTarget != NULL) {
+            _oplogMarkerTarget = NULL;
+        }
+    }
+
+    bool BackgroundSync::peek(BSONObj* op, OplogStorage* storage) {
+        if (_applyingPos == _applying.ops.size()) {
+            OpBatch batch;
+            if (!_buffer.tryPop(batch)) {
+                return false;
             }
+            _startApplying(batch);
+        }
+
+        *op = _applying.ops[_applyingPos];
+        if (storage) {
+            *storage = _applying.storage;
         }
-        return _buffer.peek(*op);
+        return true;
     }
 
     void BackgroundSync::waitForMore() {
-        BSONObj op;
+        if (_applyingPos < _applying.ops.size()) {
+            return;
+        }
+
+        OpBatch batch;
         // Block for one second before timing out.
-        // Ignore the value of the op we peeked at.
-        _buffer.blockingPeek(op, 1);
+        if (_buffer.blockingPop(batch, 1)) {
+            _startApplying(batch);
+        }
     }
 
     void BackgroundSync::consume() {
         // this is just to get the op off the queue, it's been peeked at
         // and queued for application already
-        BSONObj op = _buffer.blockingPop();
+        verify(_applyingPos < _applying.ops.size());
         bufferCountGauge.decrement(1);
-        bufferSizeGauge.decrement(getSize(op));
+        bufferSizeGauge.decrement(getSize(_applying.ops[_applyingPos]));
+
+        if (++_applyingPos == _applying.ops.size()) {
+            // drop our reference to the batch's memory once its ops have been handed out
+            _applying = OpBatch();
+            _applyingPos = 0;
+        }
+        _opsUnconsumed.subtractAndFetch(1);
     }
 
     bool BackgroundSync::isStale(OplogReader& r, BSONObj& remoteOldestOp) {
@@ -637,7 +704,8 @@ namespace replset {
     }
 
     void BackgroundSync::start() {
-        massert(16235, "going to start syncing, but buffer is not empty", _buffer.empty());
+        massert(16235, "going to start syncing, but buffer is not empty",
+                _opsUnconsumed.load() == 0);
 
         boost::unique_lock<boost::mutex> lock(_mutex);
         _pause = false;
@@ -34,6 +34,7 @@
 #include "mongo/db/repl/oplogreader.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/platform/atomic_word.h"
 
 namespace mongo {
 namespace replset {
@@ -47,7 +48,8 @@ namespace replset {
         // Gets the head of the buffer, but does not remove it. 
         // Returns true if an element was present at the head;
         // false if the queue was empty.
-        virtual bool peek(BSONObj* op) = 0;
+        // If op isn't owned, storage (when not NULL) is set to what keeps it valid.
+        virtual bool peek(BSONObj* op, OplogStorage* storage = NULL) = 0;
 
         // Deletes objects in the queue;
         // called by sync thread after it has applied an op
@@ -71,15 +73,34 @@ namespace replset {
      * 3. BackgroundSync::_mutex
      */
     class BackgroundSync : public BackgroundSyncInterface {
+    public:
+        /** the ops from one getMore, copied into a single allocation */
+        struct OpBatch {
+            OpBatch() : bytes(0) { }
+            OplogStorage storage;
+            std::vector<BSONObj> ops;
+            size_t bytes;
+            Timer queued; // how long since the producer queued it
+        };
+
+    private:
         static BackgroundSync *s_instance;
         // protects creation of s_instance
         static boost::mutex s_mutex;
 
-        // _mutex protects all of the class variables
+        // _mutex protects all of the class variables, apart from the applier's below
         boost::mutex _mutex;
 
         // Production thread
-        BlockingQueue<BSONObj> _buffer;
+        BlockingQueue<OpBatch> _buffer;
+
+        // Ops queued or in _applying and not yet consumed.
+        AtomicUInt64 _opsUnconsumed;
+
+        // The batch the applier is taking ops from, and how far it has got.  Only touched by the
+        // applier, so peek and consume only lock to move on to the next batch.
+        OpBatch _applying;
+        size_t _applyingPos;
 
         OpTime _lastOpTimeFetched;
         long long _lastH;
@@ -108,6 +129,8 @@ namespace replset {
         void _producerThread();
         // Adds elements to the list, up to maxSize.
         void produce();
+        // Makes batch the one the applier takes ops from
+        void _startApplying(const OpBatch& batch);
         // Check if rollback is necessary
         bool isRollbackRequired(OplogReader& r);
         void getOplogReader(OplogReader& r);
@@ -145,7 +168,7 @@ namespace replset {
 
         // Interface implementation
 
-        virtual bool peek(BSONObj* op);
+        virtual bool peek(BSONObj* op, OplogStorage* storage = NULL);
         virtual void consume();
         virtual const Member* getSyncTarget();
         virtual void waitForMore();
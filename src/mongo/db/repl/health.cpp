@@ -448,6 +448,11 @@ namespace mongo {
                 if( !s.empty() )
                     bb.append("infoMessage", s);
             }
+            if (myState.startup2() && !initialSyncProgress.empty()) {
+                BSONArrayBuilder collections(bb.subarrayStart("initialSyncCollections"));
+                initialSyncProgress.append(&collections);
+                collections.done();
+            }
             bb.append("self", true);
             v.push_back(bb.obj());
         }
@@ -381,6 +381,10 @@ namespace {
             b.append("tags", a.done());
         }
         b.append("me", myConfig().h.toString());
+        if( !myConfig().arbiterOnly ) {
+            // lets clients tell how far behind the primary this member is
+            b.appendTimestamp("opTime", lastOpTimeWritten.asDate());
+        }
     }
 
     /** @param cfgString <setname>/<seedhost1>,<seedhost2> */
@@ -31,6 +31,7 @@
 #pragma once
 
 #include "mongo/bson/optime.h"
+#include "mongo/db/cloner.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/structure/catalog/index_details.h"
@@ -620,6 +621,10 @@ namespace mongo {
         // bool for indicating resync need on this node and the mutex that protects it
         bool initialSyncRequested;
         boost::mutex initialSyncMutex;
+
+        // documents cloned so far for each collection, shown in replSetGetStatus during initial
+        // sync
+        CloneProgress initialSyncProgress;
     private:
         IndexPrefetchConfig _indexPrefetchConfig;
 
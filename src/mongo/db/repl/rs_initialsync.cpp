@@ -41,6 +41,7 @@
 #include "mongo/bson/optime.h"
 #include "mongo/db/repl/replication_server_status.h"  // replSettings
 #include "mongo/db/repl/rs_sync.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/util/mongoutils/str.h"
 
 namespace mongo {
@@ -50,6 +51,9 @@ namespace mongo {
 
     void dropAllDatabasesExceptLocal();
 
+    // collections of a database cloned at once during initial sync
+    MONGO_EXPORT_SERVER_PARAMETER(initialSyncCloneThreads, int, 4);
+
     // add try/catch with sleep
 
     void isyncassert(const string& msg, bool expr) {
@@ -108,6 +112,8 @@ namespace mongo {
             options.mayBeInterrupted = false;
             options.syncData = dataPass;
             options.syncIndexes = ! dataPass;
+            options.numThreads = initialSyncCloneThreads;
+            options.progress = &initialSyncProgress;
 
             if (!cloner.go(ctx.ctx(), master, options, NULL, err, &errCode)) {
                 sethbmsg(str::stream() << "initial sync: error while "
@@ -407,6 +413,7 @@ namespace mongo {
             dropAllDatabasesExceptLocal();
 
             sethbmsg("initial sync clone all databases", 0);
+            initialSyncProgress.clear();
 
             list<string> dbs = r.conn()->getDatabaseNames();
 
@@ -34,10 +34,16 @@
 
 #include "third_party/murmurhash3/MurmurHash3.h"
 
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/catalog/database_holder.h"
+#include "mongo/db/catalog/index_catalog.h"
 #include "mongo/db/client.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/commands/fsync.h"
 #include "mongo/db/d_concurrency.h"
+#include "mongo/db/hasher.h"
+#include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/namespace_string.h"
 #include "mongo/db/prefetch.h"
 #include "mongo/db/repl/bgsync.h"
@@ -85,8 +91,8 @@ namespace replset {
 
     SyncTail::~SyncTail() {}
 
-    bool SyncTail::peek(BSONObj* op) {
-        return _networkQueue->peek(op);
+    bool SyncTail::peek(BSONObj* op, OplogStorage* storage) {
+        return _networkQueue->peek(op, storage);
     }
     /* apply the log op that is in param o
        @return bool success (true) or failure (false)
@@ -272,8 +278,87 @@ namespace replset {
     }
 
 
+    namespace {
+        // The _id of the document a CRUD op writes, EOO for anything else
+        BSONElement opDocumentId(const BSONObj& op) {
+            switch (op["op"].valuestrsafe()[0]) {
+            case 'i':
+            case 'd':
+                return op.getObjectField("o")["_id"];
+            case 'u':
+                return op.getObjectField("o2")["_id"];
+            default:
+                return BSONElement();
+            }
+        }
+
+        // Continues 'hash' with an _id value, so that _ids which compare equal hash equal
+        uint32_t hashDocumentId(const BSONElement& id, uint32_t hash) {
+            switch (id.type()) {
+            case NumberInt:
+            case NumberLong:
+            case NumberDouble: {
+                // 1, NumberLong(1) and 1.0 are the same _id
+                double d = id.numberDouble();
+                if (d == 0)
+                    d = 0; // and so are -0.0 and 0.0
+                MurmurHash3_x86_32(&d, sizeof(d), hash, &hash);
+                return hash;
+            }
+            case Object:
+            case Array: {
+                long long h = BSONElementHasher::hash64(id, hash);
+                return static_cast<uint32_t>(h ^ (h >> 32));
+            }
+            default:
+                MurmurHash3_x86_32(id.value(), id.valuesize(), hash, &hash);
+                return hash;
+            }
+        }
+
+        /**
+         * Whether ops on different documents in ns can be applied in any order.  Not so for
+         * capped collections, which must keep their insertion order, nor for collections with a
+         * unique index other than _id's, where a write to one document can make room for a key
+         * another one takes.  A collection that doesn't exist yet will be created by an insert,
+         * so is neither.
+         */
+        bool canApplyByDocument(const string& ns) {
+            Lock::DBRead lk(ns);
+            Database* db = dbHolder().get(ns, storageGlobalParams.dbpath);
+            Collection* collection = db ? db->getCollection(ns) : NULL;
+            if (!collection)
+                return true;
+            if (collection->isCapped())
+                return false;
+
+            IndexCatalog::IndexIterator ii =
+                collection->getIndexCatalog()->getIndexIterator(true);
+            while (ii.more()) {
+                IndexDescriptor* desc = ii.next();
+                if (desc->unique() && !desc->isIdIndex())
+                    return false;
+            }
+            return true;
+        }
+    }
+
     void SyncTail::fillWriterVectors(const std::deque<BSONObj>& ops, 
                                               std::vector< std::vector<BSONObj> >* writerVectors) {
+        // Commands and index builds are always in a batch of their own (see
+        // tryPopAndWaitForMore), so everything here is a CRUD op, and those for one document
+        // only need to be applied in order on one writer.
+        std::map<string, bool> byDocument;
+
+        // An op we can't place by document (an update whose o2 lacks an _id, say) puts its
+        // whole collection on one writer, since it could touch a document ops around it touch.
+        for (std::deque<BSONObj>::const_iterator it = ops.begin();
+             it != ops.end();
+             ++it) {
+            if (opDocumentId(*it).eoo())
+                byDocument[it->getStringField("ns")] = false;
+        }
+
         for (std::deque<BSONObj>::const_iterator it = ops.begin();
              it != ops.end();
              ++it) {
@@ -284,6 +369,15 @@ namespace replset {
             uint32_t hash = 0;
             MurmurHash3_x86_32( ns, len, 0, &hash);
 
+            BSONElement id = opDocumentId(*it);
+            if (!id.eoo()) {
+                std::map<string, bool>::iterator i = byDocument.find(ns);
+                if (i == byDocument.end())
+                    i = byDocument.insert(make_pair(string(ns), canApplyByDocument(ns))).first;
+                if (i->second)
+                    hash = hashDocumentId(id, hash);
+            }
+
             (*writerVectors)[hash % writerVectors->size()].push_back(*it);
         }
     }
@@ -344,7 +438,8 @@ namespace replset {
             }
 
             // we want to keep a record of the last op applied, to compare with minvalid
-            lastOp = ops.getDeque().back();
+            // the ops may point into fetched batches that go away with the queue
+            lastOp = ops.getDeque().back().getOwned();
             OpTime tempTs = lastOp["ts"]._opTime();
             applyOpsToOplog(&ops.getDeque());
 
@@ -504,8 +599,9 @@ namespace replset {
     // to periodically check in the loop.
     bool SyncTail::tryPopAndWaitForMore(SyncTail::OpQueue* ops) {
         BSONObj op;
+        OplogStorage storage;
         // Check to see if there are ops waiting in the bgsync queue
-        bool peek_success = peek(&op);
+        bool peek_success = peek(&op, &storage);
 
         if (!peek_success) {
             // if we don't have anything in the queue, wait a bit for something to appear
@@ -529,7 +625,7 @@ namespace replset {
 
             if (ops->empty()) {
                 // apply commands one-at-a-time
-                ops->push_back(op);
+                ops->push_back(op, storage);
                 _networkQueue->consume();
             }
 
@@ -560,7 +656,7 @@ namespace replset {
         }
     
         // Copy the op to the deque and remove it from the bgsync queue.
-        ops->push_back(op);
+        ops->push_back(op, storage);
         _networkQueue->consume();
 
         // Go back for more ops
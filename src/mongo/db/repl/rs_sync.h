@@ -28,6 +28,7 @@
 
 #pragma once
 
+#include <boost/shared_array.hpp>
 #include <deque>
 #include <vector>
 
@@ -42,6 +43,10 @@ namespace replset {
 
     class BackgroundSyncInterface;
 
+    // Memory holding ops fetched together.  Ops from the bgsync buffer point into it rather than
+    // owning a copy each, so it has to be kept as long as they are.
+    typedef boost::shared_array<char> OplogStorage;
+
     /**
      * "Normal" replica set syncing
      */
@@ -77,16 +82,20 @@ namespace replset {
         virtual BSONObj oplogApplication(const BSONObj& applyGTEObj, const BSONObj& minValidObj);
 
         void oplogApplication();
-        bool peek(BSONObj* obj);
+        bool peek(BSONObj* obj, OplogStorage* storage = NULL);
 
         class OpQueue {
         public:
             OpQueue() : _size(0) {}
             size_t getSize() { return _size; }
             std::deque<BSONObj>& getDeque() { return _deque; }
-            void push_back(BSONObj& op) {
+            /** storage, if set, is kept for as long as the queue so that op stays valid */
+            void push_back(BSONObj& op, const OplogStorage& storage = OplogStorage()) {
                 _deque.push_back(op);
                 _size += op.objsize();
+                if (storage && (_storage.empty() || _storage.back() != storage)) {
+                    _storage.push_back(storage);
+                }
             }
             bool empty() {
                 return _deque.empty();
@@ -94,6 +103,7 @@ namespace replset {
         private:
             std::deque<BSONObj> _deque;
             size_t _size;
+            std::vector<OplogStorage> _storage;
         };
 
         // returns true if we should continue waiting for BSONObjs, false if we should
@@ -120,6 +130,15 @@ namespace replset {
         // The version of the last op to be read
         int oplogVersion;
 
+        /**
+         * Splits a batch of ops between the writer vectors.  Ops for one collection are spread
+         * by the _id of the document they write where the order of writes to different
+         * documents doesn't matter, and otherwise all go to the same writer.  Either way the
+         * ops each writer gets are in the order they were in the batch.
+         */
+        static void fillWriterVectors(const std::deque<BSONObj>& ops,
+                                      std::vector< std::vector<BSONObj> >* writerVectors);
+
     private:
         BackgroundSyncInterface* _networkQueue;
 
@@ -132,8 +151,6 @@ namespace replset {
         void applyOps(const std::vector< std::vector<BSONObj> >& writerVectors, 
                       MultiSyncApplyFunc applyFunc);
 
-        void fillWriterVectors(const std::deque<BSONObj>& ops, 
-                               std::vector< std::vector<BSONObj> >* writerVectors);
         void handleSlaveDelay(const BSONObj& op);
         void setOplogVersion(const BSONObj& op);
     };
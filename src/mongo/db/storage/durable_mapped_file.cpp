@@ -169,7 +169,7 @@ namespace mongo {
         return false;
     }
 
-    DurableMappedFile::DurableMappedFile() : _willNeedRemap(false) {
+    DurableMappedFile::DurableMappedFile() : _willNeedRemap(false), _privateBytes(0) {
         _view_write = _view_private = 0;
     }
 
@@ -95,6 +95,11 @@ namespace mongo {
         */
         bool& willNeedRemap() { return _willNeedRemap; }
 
+        /** bytes journaled for this file since its private view was last remapped.  added to in
+            PREPLOGBUFFER, taken off privateMapBytes and reset in REMAPPRIVATEVIEW
+        */
+        size_t& privateBytes() { return _privateBytes; }
+
         void remapThePrivateView();
 
         virtual bool isDurableMappedFile() { return true; }
@@ -104,6 +109,7 @@ namespace mongo {
         void *_view_write;
         void *_view_private;
         bool _willNeedRemap;
+        size_t _privateBytes;
         RelativePath _p;   // e.g. "somepath/dbname"
         int _fileSuffixNo;  // e.g. 3.  -1="ns"
 
@@ -38,6 +38,8 @@
 #include "mongo/db/catalog/database_holder.h"
 #include "mongo/db/pagefault.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/structure/record_store_compressed.h"
+#include "mongo/db/structure/record_store_heap.h"
 #include "mongo/platform/bits.h"
 #include "mongo/platform/unordered_set.h"
 #include "mongo/util/net/listen.h"
@@ -526,6 +528,13 @@ namespace mongo {
     Record* DiskLoc::rec() const {
         // XXX-ERH
         verify(a() != -1);
+        if ( HeapRecordStore::isHeapLoc( *this ) )
+            return HeapRecordStore::recordForHeapLoc( *this );
+        if ( CompressedRecordStore::isCompressedLoc( *this ) ) {
+            // the block holding the document
+            DiskLoc block = CompressedRecordStore::blockFor( *this );
+            return cc().database()->getExtentManager().recordFor( block );
+        }
         return cc().database()->getExtentManager().recordFor( *this );
     }
 
@@ -540,6 +549,8 @@ namespace mongo {
     }
 
     BSONObj DiskLoc::obj() const {
+        if ( CompressedRecordStore::isCompressedLoc( *this ) )
+            return CompressedRecordStore::objForCompressedLoc( *this );
         return BSONObj::make(rec()->accessed());
     }
 
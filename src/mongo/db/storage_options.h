@@ -53,7 +53,8 @@ namespace mongo {
             journalCommitInterval(0), // 0 means use default
             quota(false), quotaFiles(8),
             syncdelay(60),
-            useHints(true)
+            useHints(true),
+            heapRecordStore(false)
         {
             repairpath = dbpath;
             dur = false;
@@ -102,6 +103,9 @@ namespace mongo {
         double syncdelay;      // seconds between fsyncs
 
         bool useHints;         // only off if --nohints
+
+        bool heapRecordStore;  // --heapRecordStore keep user collections in memory, for
+                               // benchmarking only as nothing is persisted
     };
 
     extern StorageGlobalParams storageGlobalParams;
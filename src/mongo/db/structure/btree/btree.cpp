@@ -229,9 +229,9 @@ namespace mongo {
         DEV {
             // slow:
             for ( int i = 0; i < this->n-1; i++ ) {
-                Key k1 = keyNode(i).key;
-                Key k2 = keyNode(i+1).key;
-                int z = k1.woCompare(k2, order); //OK
+                KeyNode k1 = keyNode(i);
+                KeyNode k2 = keyNode(i+1);
+                int z = k1.key.woCompare(k2.key, order); //OK
                 if ( z > 0 ) {
                     out() << "ERROR: btree key order corrupt.  Keys:" << endl;
                     if ( ++nDumped < 5 ) {
@@ -256,9 +256,9 @@ namespace mongo {
         else {
             //faster:
             if ( this->n > 1 ) {
-                Key k1 = keyNode(0).key;
-                Key k2 = keyNode(this->n-1).key;
-                int z = k1.woCompare(k2, order);
+                KeyNode k1 = keyNode(0);
+                KeyNode k2 = keyNode(this->n-1);
+                int z = k1.key.woCompare(k2.key, order);
                 //wassert( z <= 0 );
                 if ( z > 0 ) {
                     problem() << "btree keys out of order" << '\n';
@@ -333,13 +333,12 @@ namespace mongo {
      *  does not bother returning that value.
      */
     template< class V >
-    void BucketBasics<V>::popBack(DiskLoc& recLoc, Key &key) {
+    void BucketBasics<V>::popBack(DiskLoc& recLoc) {
         massert( 10282 ,  "n==0 in btree popBack()", this->n > 0 );
         verify( k(this->n-1).isUsed() ); // no unused skipping in this function at this point - btreebuilder doesn't require that
-        KeyNode kn = keyNode(this->n-1);
+        const _KeyNode& kn = k(this->n-1);
         recLoc = kn.recordLoc;
-        key.assign(kn.key);
-        int keysize = kn.key.dataSize();
+        int keysize = keyDataSize(kn.keyDataOfs());
 
         massert( 10283 , "rchild not null in btree popBack()", this->nextChild.isNull());
 
@@ -347,8 +346,7 @@ namespace mongo {
         this->nextChild = kn.prevChildBucket;
 
         this->n--;
-        // This is risky because the key we are returning points to this unalloc'ed memory,
-        // and we are assuming that the last key points to the last allocated
+        // We are assuming that the last key points to the last allocated
         // bson region.
         this->emptySize += sizeof(_KeyNode);
         _unalloc(keysize);
@@ -357,9 +355,15 @@ namespace mongo {
     /** add a key.  must be > all existing.  be careful to set next ptr right. */
     template< class V >
     bool BucketBasics<V>::_pushBack(const DiskLoc recordLoc, const Key& key, const Ordering &order, const DiskLoc prevChild) {
-        int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
-        if ( bytesNeeded > this->emptySize )
-            return false;
+        int bytesNeeded = keyStorageSize(key) + sizeof(_KeyNode);
+        if ( bytesNeeded > this->emptySize ) {
+            if ( !V::PrefixCompressed )
+                return false;
+            _compressPrefixReadyForMod(&key);
+            bytesNeeded = keyStorageSize(key) + sizeof(_KeyNode);
+            if ( bytesNeeded > this->emptySize )
+                return false;
+        }
         verify( bytesNeeded <= this->emptySize );
         if( this->n ) {
             const KeyNode klast = keyNode(this->n-1);
@@ -375,10 +379,10 @@ namespace mongo {
         _KeyNode& kn = k(this->n++);
         kn.prevChildBucket = prevChild;
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs( (short) _alloc(key.dataSize()) );
+        kn.setKeyDataOfs( (short) _alloc(bytesNeeded - sizeof(_KeyNode)) );
         short ofs = kn.keyDataOfs();
         char *p = dataAt(ofs);
-        memcpy(p, key.data(), key.dataSize());
+        storeKey(p, key);
 
         return true;
     }
@@ -395,9 +399,13 @@ namespace mongo {
     bool BucketBasics<V>::basicInsert(const DiskLoc thisLoc, int &keypos, const DiskLoc recordLoc, const Key& key, const Ordering &order) const {
         check( this->n < 1024 );
         check( keypos >= 0 && keypos <= this->n );
-        int bytesNeeded = key.dataSize() + sizeof(_KeyNode);
+        int bytesNeeded = keyStorageSize(key) + sizeof(_KeyNode);
         if ( bytesNeeded > this->emptySize ) {
             _pack(thisLoc, order, keypos);
+            if ( bytesNeeded > this->emptySize && V::PrefixCompressed ) {
+                _compressPrefix(thisLoc, key);
+                bytesNeeded = keyStorageSize(key) + sizeof(_KeyNode);
+            }
             if ( bytesNeeded > this->emptySize )
                 return false;
         }
@@ -427,10 +435,11 @@ namespace mongo {
         _KeyNode& kn = b->k(keypos);
         kn.prevChildBucket.Null();
         kn.recordLoc = recordLoc;
-        kn.setKeyDataOfs((short) b->_alloc(key.dataSize()) );
+        int keySize = bytesNeeded - sizeof(_KeyNode);
+        kn.setKeyDataOfs((short) b->_alloc(keySize) );
         char *p = b->dataAt(kn.keyDataOfs());
-        getDur().declareWriteIntent(p, key.dataSize());
-        memcpy(p, key.data(), key.dataSize());
+        getDur().declareWriteIntent(p, keySize);
+        b->storeKey(p, key);
         return true;
     }
 
@@ -448,12 +457,24 @@ namespace mongo {
         if ( this->flags & Packed ) {
             return V::BucketSize - this->emptySize - headerSize();
         }
+        int size = reservedTopSize();
+        for( int j = 0; j < this->n; ++j ) {
+            if ( mayDropKey( j, refPos ) ) {
+                continue;
+            }
+            size += keyDataSize( k( j ).keyDataOfs() ) + sizeof( _KeyNode );
+        }
+        return size;
+    }
+
+    template< class V >
+    int BucketBasics<V>::packedDataSizeIn( const BucketBasics& dest, int refPos ) const {
         int size = 0;
         for( int j = 0; j < this->n; ++j ) {
             if ( mayDropKey( j, refPos ) ) {
                 continue;
             }
-            size += keyNode( j ).key.dataSize() + sizeof( _KeyNode );
+            size += dest.keyStorageSize( keyNode( j ).key ) + sizeof( _KeyNode );
         }
         return size;
     }
@@ -477,6 +498,16 @@ namespace mongo {
         thisLoc.btreemod<V>()->_packReadyForMod(order, refPos);
     }
 
+    template< class V >
+    void BucketBasics<V>::_compressPrefix(const DiskLoc thisLoc, const Key& extra) const {
+        if ( !V::PrefixCompressed )
+            return;
+
+        VERIFYTHISLOC
+
+        thisLoc.btreemod<V>()->_compressPrefixReadyForMod(&extra);
+    }
+
     /** version when write intent already declared */
     template< class V >
     void BucketBasics<V>::_packReadyForMod( const Ordering &order, int &refPos ) {
@@ -487,8 +518,10 @@ namespace mongo {
 
         int tdz = totalDataSize();
         char temp[V::BucketSize];
-        int ofs = tdz;
-        this->topSize = 0;
+        // anything reserved at the top, i.e. a prefix compressed bucket's anchor, stays put
+        int ofs = tdz - reservedTopSize();
+        memcpy(temp + ofs, dataAt(ofs), tdz - ofs);
+        this->topSize = tdz - ofs;
         int i = 0;
         for ( int j = 0; j < this->n; j++ ) {
             if( mayDropKey( j, refPos ) ) {
@@ -501,7 +534,7 @@ namespace mongo {
                 k( i ) = k( j );
             }
             short ofsold = k(i).keyDataOfs();
-            int sz = keyNode(i).key.dataSize();
+            int sz = keyDataSize(ofsold);
             ofs -= sz;
             this->topSize += sz;
             memcpy(temp+ofs, dataAt(ofsold), sz);
@@ -565,7 +598,7 @@ namespace mongo {
         // TODO I think we only want to do the 90% split on the rhs node of the tree.
         int rightSizeLimit = ( this->topSize + sizeof( _KeyNode ) * this->n ) / ( keypos == this->n ? 10 : 2 );
         for( int i = this->n - 1; i > -1; --i ) {
-            rightSize += keyNode( i ).key.dataSize() + sizeof( _KeyNode );
+            rightSize += keyDataSize( k( i ).keyDataOfs() ) + sizeof( _KeyNode );
             if ( rightSize > rightSizeLimit ) {
                 split = i;
                 break;
@@ -597,10 +630,10 @@ namespace mongo {
         _KeyNode &kn = k( i );
         kn.recordLoc = recordLoc;
         kn.prevChildBucket = prevChildBucket;
-        short ofs = (short) _alloc( key.dataSize() );
+        short ofs = (short) _alloc( keyStorageSize( key ) );
         kn.setKeyDataOfs( ofs );
         char *p = dataAt( ofs );
-        memcpy( p, key.data(), key.dataSize() );
+        storeKey( p, key );
     }
 
     template< class V >
@@ -702,7 +735,7 @@ namespace mongo {
                 const BtreeBucket *bucket = b.btree<V>();
                 const _KeyNode& kn = bucket->k(pos);
                 if ( kn.isUsed() )
-                    return bucket->keyAt(pos).woEqual(key);
+                    return bucket->keyNode(pos).key.woEqual(key);
             b = bucket->advance(b, pos, 1, "BtreeBucket<V>::exists");
         }
         return false;
@@ -723,7 +756,7 @@ namespace mongo {
             const BtreeBucket *bucket = asVersion( record );
             const _KeyNode& kn = bucket->k(pos);
             if ( kn.isUsed() ) {
-                if( bucket->keyAt(pos).woEqual(key) )
+                if( bucket->keyNode(pos).key.woEqual(key) )
                     return kn.recordLoc != self;
                 break;
             }
@@ -822,8 +855,8 @@ namespace mongo {
         // not found
         pos = l;
         if ( pos != this->n ) {
-            Key keyatpos = keyNode(pos).key;
-            wassert( key.woCompare(keyatpos, btreeState->ordering()) <= 0 );
+            KeyNode keyatpos = keyNode(pos);
+            wassert( key.woCompare(keyatpos.key, btreeState->ordering()) <= 0 );
             if ( pos > 0 ) {
                 if( !( keyNode(pos-1).key.woCompare(key, btreeState->ordering()) <= 0 ) ) {
                     DEV {
@@ -998,7 +1031,9 @@ namespace mongo {
         {
             const BtreeBucket *l = leftNodeLoc.btree<V>();
             const BtreeBucket *r = rightNodeLoc.btree<V>();
-            if ( ( this->headerSize() + l->packedDataSize( pos ) + r->packedDataSize( pos ) + keyNode( leftIndex ).key.dataSize() + sizeof(_KeyNode) > unsigned( V::BucketSize ) ) ) {
+            // r's keys and the separator are stored against l's anchor once merged
+            int rightSize = V::PrefixCompressed ? r->packedDataSizeIn( *l, pos ) : r->packedDataSize( pos );
+            if ( ( this->headerSize() + l->packedDataSize( pos ) + rightSize + l->keyStorageSize( keyNode( leftIndex ).key ) + sizeof(_KeyNode) > unsigned( V::BucketSize ) ) ) {
                 return false;
             }
         }
@@ -1244,6 +1279,14 @@ namespace mongo {
         bool mayBalanceRight = ( ( parentIdx < p->n ) && !p->childForPos( parentIdx + 1 ).isNull() );
         bool mayBalanceLeft = ( ( parentIdx > 0 ) && !p->childForPos( parentIdx - 1 ).isNull() );
 
+        if ( V::PrefixCompressed ) {
+            // Keys change size when they move between buckets with different anchors, which
+            // rebalancedSeparatorPos() can't account for.  Merge when everything is known to
+            // fit and otherwise leave this bucket underfull.
+            mayBalanceRight = mayBalanceRight && p->canMergeChildren( this->parent, parentIdx );
+            mayBalanceLeft = mayBalanceLeft && p->canMergeChildren( this->parent, parentIdx - 1 );
+        }
+
         // Balance if possible on one side - we merge only if absolutely necessary
         // to preserve btree bucket utilization constraints since that's a more
         // heavy duty operation (especially if we must re-split later).
@@ -1412,6 +1455,7 @@ namespace mongo {
         int split = this->splitPos( keypos );
         DiskLoc rLoc = addBucket(btreeState);
         BtreeBucket *r = rLoc.btreemod<V>();
+        r->_copyPrefix(*this);
         if ( split_debug )
             out() << "     split:" << split << ' ' << keyNode(split).key.toString() << " n:" << this->n << endl;
         for ( int i = split+1; i < this->n; i++ ) {
@@ -1945,10 +1989,117 @@ namespace mongo {
         return kn.recordLoc;
     }
 
+    /*
+     * Prefix compression of v:2 buckets.
+     */
+
+    template<>
+    void BucketBasics<V2>::_compressPrefixReadyForMod(const Key* extra) {
+        assertWritable();
+
+        // Reassemble the keys, extra and the current anchor into one buffer.  The keys are
+        // rewritten from there, so nothing may point into the bucket.
+        BufBuilder bytes;
+        vector<int> ofs;
+        vector<int> size;
+        for ( int i = 0; i < this->n; i++ ) {
+            KeyNode kn = keyNode( i );
+            ofs.push_back( bytes.len() );
+            size.push_back( kn.key.dataSize() );
+            bytes.appendBuf( kn.key.data(), kn.key.dataSize() );
+        }
+        const int nKeys = this->n;
+        if ( extra ) {
+            ofs.push_back( bytes.len() );
+            size.push_back( extra->dataSize() );
+            bytes.appendBuf( extra->data(), extra->dataSize() );
+        }
+        const int nAll = ofs.size();
+        const int currentOfs = bytes.len();
+        bytes.appendBuf( anchor(), this->anchorSize );
+        const char* b = bytes.buf();
+
+        // The candidate anchors are the current one and a few sample keys, each cut to the
+        // longest prefix it shares with any other key.  Anything longer would be stored for
+        // nothing.
+        vector< pair<int,int> > candidates; // offset in b, length
+        candidates.push_back( make_pair( currentOfs, (int) this->anchorSize ) );
+        const int samples[] = { 0, nKeys / 2, nKeys - 1, nAll - 1 };
+        for ( unsigned s = 0; s < sizeof( samples ) / sizeof( samples[0] ); s++ ) {
+            int c = samples[s];
+            if ( c < 0 || ( s > 0 && c == samples[s-1] ) )
+                continue;
+            int len = 0;
+            for ( int j = 0; j < nAll; j++ ) {
+                if ( j != c )
+                    len = std::max( len, commonPrefix( b + ofs[c], size[c], b + ofs[j], size[j] ) );
+            }
+            candidates.push_back( make_pair( ofs[c], len ) );
+        }
+
+        // Pick the candidate which stores the keys and extra in the fewest bytes.  The current
+        // anchor wins ties and, as the keys are already stored against it, always fits.
+        const int tdz = totalDataSize();
+        const int nodesSize = nKeys * sizeof( _KeyNode );
+        unsigned best = 0;
+        int bestCost = -1;
+        for ( unsigned c = 0; c < candidates.size(); c++ ) {
+            const char* a = b + candidates[c].first;
+            int aLen = candidates[c].second;
+            int cost = aLen;
+            for ( int j = 0; j < nKeys; j++ ) {
+                cost += storedSize( commonPrefix( a, aLen, b + ofs[j], size[j] ), size[j] );
+            }
+            if ( cost + nodesSize > tdz )
+                continue;
+            for ( int j = nKeys; j < nAll; j++ ) {
+                cost += storedSize( commonPrefix( a, aLen, b + ofs[j], size[j] ), size[j] );
+            }
+            if ( bestCost < 0 || cost < bestCost ) {
+                best = c;
+                bestCost = cost;
+            }
+        }
+        if ( best == 0 )
+            return;
+
+        // Rewrite the bucket, anchor first at the top and then the keys below it in order.
+        const char* a = b + candidates[best].first;
+        const int aLen = candidates[best].second;
+        char temp[V2::BucketSize];
+        int top = tdz - aLen;
+        memcpy( temp + top, a, aLen );
+        for ( int j = 0; j < nKeys; j++ ) {
+            int shared = commonPrefix( a, aLen, b + ofs[j], size[j] );
+            top -= storedSize( shared, size[j] );
+            writeKey( temp + top, shared, b + ofs[j], size[j] );
+            k( j ).setKeyDataOfsSavingUse( top );
+        }
+        memcpy( this->data + top, temp + top, tdz - top );
+
+        this->anchorSize = aLen;
+        this->topSize = tdz - top;
+        this->emptySize = tdz - this->topSize - nodesSize;
+        {
+            int foo = this->emptySize;
+            verify( foo >= 0 );
+        }
+    }
+
+    template<>
+    void BucketBasics<V2>::_copyPrefix(const BucketBasics& from) {
+        verify( this->n == 0 && this->topSize == 0 );
+        int ofs = _alloc( from.anchorSize );
+        memcpy( dataAt( ofs ), from.anchor(), from.anchorSize );
+        this->anchorSize = from.anchorSize;
+    }
+
     template class BucketBasics<V0>;
     template class BucketBasics<V1>;
+    template class BucketBasics<V2>;
     template class BtreeBucket<V0>;
     template class BtreeBucket<V1>;
+    template class BtreeBucket<V2>;
     template struct __KeyNode<DiskLoc>;
     template struct __KeyNode<DiskLoc56Bit>;
 
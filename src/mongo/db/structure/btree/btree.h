@@ -142,6 +142,15 @@ namespace mongo {
         }
     };
 
+    /**
+     * Where a KeyNode would reassemble its key if the bucket didn't store keys whole.  Buckets
+     * which do, v:0 and v:1, read keys in place and need no buffer.
+     */
+    class NoKeyBuffer {
+    public:
+        const char* relocate( const char* keyData, const NoKeyBuffer& from ) const { return keyData; }
+    };
+
     /**
      * This structure represents header data for a btree bucket.  An object of
      * this type is typically allocated inside of a buffer of size BucketSize,
@@ -195,7 +204,9 @@ namespace mongo {
         typedef DiskLoc Loc;
         typedef KeyBson Key;
         typedef KeyBson KeyOwned;
+        typedef NoKeyBuffer KeyBuffer;
         enum { BucketSize = 8192 };
+        static const bool PrefixCompressed = false;
 
         // largest key size we allow.  note we very much need to support bigger keys (somehow) in the future.
         static const int KeyMax = OldBucketSize / 10;
@@ -287,11 +298,13 @@ namespace mongo {
         typedef __KeyNode<Loc> _KeyNode;
         typedef KeyV1 Key;
         typedef KeyV1Owned KeyOwned;
+        typedef NoKeyBuffer KeyBuffer;
         enum { BucketSize = 8192-16 }; // leave room for Record header
         // largest key size we allow.  note we very much need to support bigger keys (somehow) in the future.
         static const int KeyMax = 1024;
         // A sentinel value sometimes used to identify a deallocated bucket.
         static const unsigned short INVALID_N_SENTINEL = 0xffff;
+        static const bool PrefixCompressed = false;
     protected:
         /** Parent bucket of this bucket, which isNull() for the root bucket. */
         Loc parent;
@@ -315,8 +328,122 @@ namespace mongo {
         void _init() { }
     };
 
+    /**
+     * Buckets of v:2 indexes.  Keys are in the KeyV1 format, as for v:1, but are prefix
+     * compressed: a bucket keeps one prefix, its anchor, at the very top of its body and each key
+     * stores only what follows the bytes it shares with the anchor:
+     *
+     * [shared: 1 byte][suffix size: 1 or 2 bytes][suffix]
+     *
+     * Compound keys with long repeated leading fields (a tenant id, a path) shrink to their
+     * distinct tails, so a bucket holds several times as many of them and the tree is smaller
+     * and shallower.  A bucket chooses its anchor when it fills up, see
+     * BucketBasics::_compressPrefixReadyForMod(), and the right half of a split starts with the
+     * anchor of the bucket it was split from.
+     *
+     * A KeyNode reassembles its key into a buffer of its own, so unlike v:1 the key of a KeyNode
+     * does not point into the bucket.
+     */
+    class BtreeData_V2 {
+    public:
+        typedef DiskLoc56Bit Loc;
+        typedef __KeyNode<Loc> _KeyNode;
+        typedef KeyV1 Key;
+        typedef KeyV1Owned KeyOwned;
+        enum { BucketSize = 8192-16 }; // leave room for Record header
+        static const int KeyMax = 1024;
+        // A sentinel value sometimes used to identify a deallocated bucket.
+        static const unsigned short INVALID_N_SENTINEL = 0xffff;
+        static const bool PrefixCompressed = true;
+        /** Most bytes a key may share with the anchor, so also the longest useful anchor. */
+        static const int PrefixMax = 255;
+
+        class KeyBuffer {
+        public:
+            const char* relocate( const char* keyData, const KeyBuffer& from ) const {
+                return keyData == from.buf ? buf : keyData;
+            }
+            char buf[KeyMax];
+        };
+
+        /** @return length of the common prefix of a and b, at most PrefixMax */
+        static int commonPrefix( const char* a, int aLen, const char* b, int bLen ) {
+            int len = std::min( std::min( aLen, bLen ), static_cast<int>( PrefixMax ) );
+            int i = 0;
+            while ( i < len && a[i] == b[i] )
+                i++;
+            return i;
+        }
+
+        /** @return bytes used to store a key of 'size' bytes sharing 'shared' with the anchor */
+        static int storedSize( int shared, int size ) {
+            int suffix = size - shared;
+            return ( suffix < 0x80 ? 2 : 3 ) + suffix;
+        }
+
+        /** stores a key of 'size' bytes sharing 'shared' with the anchor at p */
+        static void writeKey( char* p, int shared, const char* key, int size ) {
+            int suffix = size - shared;
+            unsigned char* h = reinterpret_cast<unsigned char*>( p );
+            *h++ = static_cast<unsigned char>( shared );
+            if ( suffix < 0x80 ) {
+                *h++ = static_cast<unsigned char>( suffix );
+            }
+            else {
+                *h++ = static_cast<unsigned char>( 0x80 | ( suffix & 0x7f ) );
+                *h++ = static_cast<unsigned char>( suffix >> 7 );
+            }
+            memcpy( h, key + shared, suffix );
+        }
+
+        /**
+         * Reads the header of the key stored at p.
+         * @return the header's size, after which come the suffix's *suffixSize bytes
+         */
+        static int readKeyHeader( const char* p, int* shared, int* suffixSize ) {
+            const unsigned char* h = reinterpret_cast<const unsigned char*>( p );
+            *shared = h[0];
+            if ( h[1] < 0x80 ) {
+                *suffixSize = h[1];
+                return 2;
+            }
+            *suffixSize = ( h[1] & 0x7f ) | ( h[2] << 7 );
+            return 3;
+        }
+
+    protected:
+        /** Parent bucket of this bucket, which isNull() for the root bucket. */
+        Loc parent;
+        /** Given that there are n keys, this is the n index child. */
+        Loc nextChild;
+
+        unsigned short flags;
+
+        /** basicInsert() assumes the next three members are consecutive and in this order: */
+
+        /** Size of the empty region. */
+        unsigned short emptySize;
+        /** Size used for key storage, including storage of old keys and the anchor. */
+        unsigned short topSize;
+        /* Number of keys in the bucket. */
+        unsigned short n;
+
+        /** Size of the anchor, which takes the last anchorSize bytes of the body. */
+        unsigned short anchorSize;
+
+        /* Beginning of the bucket's body */
+        char data[4];
+
+        void _init() { anchorSize = 0; }
+
+        const char* anchor() const {
+            return reinterpret_cast<const char*>( this ) + BucketSize - anchorSize;
+        }
+    };
+
     typedef BtreeData_V0 V0;
     typedef BtreeData_V1 V1;
+    typedef BtreeData_V2 V2;
 
     /**
      * This class adds functionality to BtreeData for managing a single bucket.
@@ -364,6 +491,11 @@ namespace mongo {
         class KeyNode {
         public:
             KeyNode(const BucketBasics<Version>& bb, const _KeyNode &k);
+            KeyNode(const KeyNode& rhs);
+        private:
+            /** Holds the key if the bucket doesn't store it whole */
+            typename Version::KeyBuffer _buf;
+        public:
             const Loc& prevChildBucket;
             const Loc& recordLoc;
             /* Points to the bson key storage for a _KeyNode */
@@ -411,6 +543,24 @@ namespace mongo {
     protected:
         char * dataAt(short ofs) { return this->data + ofs; }
 
+        /*
+         * Key storage.  v:0 and v:1 buckets store keys whole, as below, and v:2 buckets
+         * specialize these to store them prefix compressed.
+         */
+
+        /** @return the data of the key stored at ofs, reassembled into buf if necessary */
+        const char* keyData(short ofs, typename Version::KeyBuffer& buf) const {
+            return this->data + ofs;
+        }
+        /** @return bytes used by the key stored at ofs */
+        int keyDataSize(short ofs) const { return Key(this->data + ofs).dataSize(); }
+        /** @return bytes needed to store 'key' in this bucket */
+        int keyStorageSize(const Key& key) const { return key.dataSize(); }
+        /** Stores 'key' at p, which has room for keyStorageSize(key) bytes. */
+        void storeKey(char *p, const Key& key) const { memcpy(p, key.data(), key.dataSize()); }
+        /** @return bytes at the top of the body which are in use but hold no key */
+        int reservedTopSize() const { return 0; }
+
         /** Initialize the header for a new node. */
         void init();
 
@@ -441,7 +591,8 @@ namespace mongo {
          *  - If there is space for key without packing, it is inserted as the
          *    last key with specified prevChild and true is returned.
          *    Importantly, nextChild is not updated!
-         *  - Otherwise false is returned and there is no change.
+         *  - Otherwise false is returned and there is no change, except that
+         *    a prefix compressed bucket may have been recompressed.
          */
         bool _pushBack(const DiskLoc recordLoc, const Key& key, const Ordering &order, const DiskLoc prevChild);
         void pushBack(const DiskLoc recordLoc, const Key& key, const Ordering &order, const DiskLoc prevChild) {
@@ -450,15 +601,8 @@ namespace mongo {
         }
 
         /**
-         * This is a special purpose function used by BtreeBuilder.  The
-         * interface is quite dangerous if you're not careful.  The bson key
-         * returned here points to bucket memory that has been invalidated but
-         * not yet reclaimed.
-         *
-         * TODO Maybe this could be replaced with two functions, one which
-         * returns the last key without deleting it and another which simply
-         * deletes the last key.  Then the caller would have enough control to
-         * ensure proper memory integrity.
+         * This is a special purpose function used by BtreeBuilder, which
+         * copies the last key out with keyNode() before removing it.
          *
          * Preconditions:
          *  - bucket is not empty
@@ -466,10 +610,9 @@ namespace mongo {
          *  - nextChild isNull()
          *  - _unalloc will work correctly as used - see code
          * Postconditions:
-         *  - The last key of the bucket is removed, and its key and recLoc are
-         *    returned.  As mentioned above, the key points to unallocated memory.
+         *  - The last key of the bucket is removed and its recLoc is returned.
          */
-        void popBack(DiskLoc& recLoc, Key &key);
+        void popBack(DiskLoc& recLoc);
 
         /**
          * Preconditions:
@@ -523,6 +666,25 @@ namespace mongo {
 
         /** @return the size the bucket's body would have if we were to call pack() */
         int packedDataSize( int refPos ) const;
+        /**
+         * @return the size this bucket's packed keys would take up in 'dest', which may
+         * store them differently, see canMergeChildren()
+         */
+        int packedDataSizeIn( const BucketBasics& dest, int refPos ) const;
+
+        /**
+         * Buckets with PrefixCompressed storage choose a new anchor for their keys and 'extra',
+         * a key about to be added, and restore them against it when that frees space.  Keys may
+         * move, so as for _pack() any KeyNode is invalidated.  No-op for other versions.
+         */
+        void _compressPrefix(const DiskLoc thisLoc, const Key& extra) const;
+        /** Compress when already writable */
+        void _compressPrefixReadyForMod(const Key* extra) {}
+        /**
+         * Preconditions: bucket is empty and has nothing allocated
+         * Postconditions: bucket stores keys against the same anchor as 'from'
+         */
+        void _copyPrefix(const BucketBasics& from) {}
         void setNotPacked() { this->flags &= ~Packed; }
         void setPacked() { this->flags |= Packed; }
         /**
@@ -959,12 +1121,6 @@ namespace mongo {
          */
         int indexInParent( const DiskLoc &thisLoc ) const;        
 
-    public:
-        Key keyAt(int i) const {
-            if( i >= this->n ) 
-                return Key();
-            return Key(this->data + k(i).keyDataOfs());
-        }
     protected:
 
         /**
@@ -1070,9 +1226,59 @@ namespace mongo {
     template< class V >
     BucketBasics<V>::KeyNode::KeyNode(const BucketBasics<V>& bb, const _KeyNode &k) :
         prevChildBucket(k.prevChildBucket),
-        recordLoc(k.recordLoc), key(bb.data+k.keyDataOfs())
+        recordLoc(k.recordLoc), key(bb.keyData(k.keyDataOfs(), _buf))
+    { }
+
+    template< class V >
+    BucketBasics<V>::KeyNode::KeyNode(const KeyNode& rhs) :
+        _buf(rhs._buf),
+        prevChildBucket(rhs.prevChildBucket),
+        recordLoc(rhs.recordLoc), key(_buf.relocate(rhs.key.data(), rhs._buf))
     { }
 
+    /*
+     * Prefix compressed key storage of v:2 buckets, see BtreeData_V2.
+     */
+
+    template<>
+    inline const char* BucketBasics<V2>::keyData(short ofs, V2::KeyBuffer& buf) const {
+        const char* p = this->data + ofs;
+        int shared, suffixSize;
+        int headerSize = readKeyHeader(p, &shared, &suffixSize);
+        if ( shared == 0 )
+            return p + headerSize;
+        memcpy(buf.buf, anchor(), shared);
+        memcpy(buf.buf + shared, p + headerSize, suffixSize);
+        return buf.buf;
+    }
+
+    template<>
+    inline int BucketBasics<V2>::keyDataSize(short ofs) const {
+        int shared, suffixSize;
+        return readKeyHeader(this->data + ofs, &shared, &suffixSize) + suffixSize;
+    }
+
+    template<>
+    inline int BucketBasics<V2>::keyStorageSize(const Key& key) const {
+        int size = key.dataSize();
+        return storedSize(commonPrefix(anchor(), anchorSize, key.data(), size), size);
+    }
+
+    template<>
+    inline void BucketBasics<V2>::storeKey(char *p, const Key& key) const {
+        int size = key.dataSize();
+        writeKey(p, commonPrefix(anchor(), anchorSize, key.data(), size), key.data(), size);
+    }
+
+    template<>
+    inline int BucketBasics<V2>::reservedTopSize() const { return anchorSize; }
+
+    template<>
+    void BucketBasics<V2>::_compressPrefixReadyForMod(const Key* extra);
+
+    template<>
+    void BucketBasics<V2>::_copyPrefix(const BucketBasics& from);
+
     template< class V >
     const BtreeBucket<V> * DiskLoc::btree() const {
         verify( _a != -1 );
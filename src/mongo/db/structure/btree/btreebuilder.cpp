@@ -145,9 +145,9 @@ namespace mongo {
                 }
 
                 BtreeBucket<V> *x = _getModifiableBucket( xloc );
-                Key k;
+                KeyOwned k( x->keyNode( x->getN() - 1 ).key );
                 DiskLoc r;
-                x->popBack(r,k);
+                x->popBack(r);
                 bool keepX = ( x->n != 0 );
                 DiskLoc keepLoc = keepX ? xloc : x->nextChild;
 
@@ -193,5 +193,6 @@ namespace mongo {
 
     template class BtreeBuilder<V0>;
     template class BtreeBuilder<V1>;
+    template class BtreeBuilder<V2>;
 
 }
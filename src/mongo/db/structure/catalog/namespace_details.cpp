@@ -248,76 +248,61 @@ namespace mongo {
     }
 
     /* for non-capped collections.
+       the deleted list buckets are size classes: every record in a bucket above bucket(len) is
+       big enough.  so we look at only the first few records of len's own bucket, and otherwise
+       take a record from the front of the next non-empty bucket, which keeps allocation constant
+       time however long the lists get.  the last bucket holds everything >= 4mb and is searched
+       until something fits.
        @param peekOnly just look up where and don't reserve
        returned item is out of the deleted list upon return
     */
     DiskLoc NamespaceDetails::__stdAlloc(int len, bool peekOnly) {
-        DiskLoc *prev;
         DiskLoc *bestprev = 0;
         DiskLoc bestmatch;
         int bestmatchlen = 0x7fffffff;
-        int b = bucket(len);
-        DiskLoc cur = _deletedList[b];
-        prev = &_deletedList[b];
-        int extra = 5; // look for a better fit, a little.
-        int chain = 0;
-        while ( 1 ) {
-            { // defensive check
-                int fileNumber = cur.a();
-                int fileOffset = cur.getOfs();
-                if (fileNumber < -1 || fileNumber >= 100000 || fileOffset < 0) {
-                    StringBuilder sb;
-                    sb << "Deleted record list corrupted in bucket " << b
-                       << ", link number " << chain
-                       << ", invalid link is " << cur.toString()
-                       << ", throwing Fatal Assertion";
-                    problem() << sb.str() << endl;
-                    fassertFailed(16469);
+        for ( int b = bucket(len); b <= MaxBucket && bestmatch.isNull(); b++ ) {
+            DiskLoc *prev = &_deletedList[b];
+            DiskLoc cur = *prev;
+            int extra = 5; // once something fits, look for a better fit, a little.
+            for ( int chain = 0; !cur.isNull(); chain++ ) {
+                { // defensive check
+                    int fileNumber = cur.a();
+                    int fileOffset = cur.getOfs();
+                    if (fileNumber < -1 || fileNumber >= 100000 || fileOffset < 0) {
+                        StringBuilder sb;
+                        sb << "Deleted record list corrupted in bucket " << b
+                           << ", link number " << chain
+                           << ", invalid link is " << cur.toString()
+                           << ", throwing Fatal Assertion";
+                        problem() << sb.str() << endl;
+                        fassertFailed(16469);
+                    }
                 }
-            }
-            if ( cur.isNull() ) {
-                // move to next bucket.  if we were doing "extra", just break
-                if ( bestmatchlen < 0x7fffffff )
-                    break;
-                b++;
-                if ( b > MaxBucket ) {
-                    // out of space. alloc a new extent.
-                    return DiskLoc();
+                DeletedRecord *r = cur.drec();
+                if ( r->lengthWithHeaders() >= len &&
+                     r->lengthWithHeaders() < bestmatchlen ) {
+                    bestmatchlen = r->lengthWithHeaders();
+                    bestmatch = cur;
+                    bestprev = prev;
+                    if (r->lengthWithHeaders() == len)
+                        // exact match, stop searching
+                        break;
                 }
-                cur = _deletedList[b];
-                prev = &_deletedList[b];
-                continue;
-            }
-            DeletedRecord *r = cur.drec();
-            if ( r->lengthWithHeaders() >= len &&
-                 r->lengthWithHeaders() < bestmatchlen ) {
-                bestmatchlen = r->lengthWithHeaders();
-                bestmatch = cur;
-                bestprev = prev;
-                if (r->lengthWithHeaders() == len)
-                    // exact match, stop searching
+                if ( !bestmatch.isNull() && --extra <= 0 )
+                    break;
+                if ( b < MaxBucket && chain + 1 >= MaxSizeClassProbes )
+                    // move up a size class, where everything fits
                     break;
-            }
-            if ( bestmatchlen < 0x7fffffff && --extra <= 0 )
-                break;
-            if ( ++chain > 30 && b < MaxBucket ) {
-                // too slow, force move to next bucket to grab a big chunk
-                //b++;
-                chain = 0;
-                cur.Null();
-            }
-            else {
-                /*this defensive check only made sense for the mmap storage engine:
-                  if ( r->nextDeleted.getOfs() == 0 ) {
-                    problem() << "~~ Assertion - bad nextDeleted " << r->nextDeleted.toString() <<
-                    " b:" << b << " chain:" << chain << ", fixing.\n";
-                    r->nextDeleted.Null();
-                }*/
                 cur = r->nextDeleted();
                 prev = &r->nextDeleted();
             }
         }
 
+        if ( bestmatch.isNull() ) {
+            // out of space. alloc a new extent.
+            return DiskLoc();
+        }
+
         /* unlink ourself from the deleted list */
         if( !peekOnly ) {
             DeletedRecord *bmr = bestmatch.drec();
@@ -329,6 +314,97 @@ namespace mongo {
         return bestmatch;
     }
 
+    bool NamespaceDetails::coalesceDeletedRecords() {
+        verify( !isCapped() );
+
+        vector<DiskLoc> drecs;
+        for ( int b = 0; b < Buckets; b++ ) {
+            for ( DiskLoc i = _deletedList[b]; !i.isNull(); i = i.drec()->nextDeleted() )
+                drecs.push_back( i );
+        }
+        std::sort( drecs.begin(), drecs.end() );
+
+        // find runs of deleted records which are next to each other in the same extent
+        vector<DiskLoc> merged; // every record in a run, sorted
+        vector<DiskLoc> runs;   // the first record of each run
+        vector<int> runLengths;
+        for ( size_t i = 0; i < drecs.size(); ) {
+            const DiskLoc a = drecs[i];
+            const DeletedRecord *ar = a.drec();
+            int len = ar->lengthWithHeaders();
+            size_t j = i + 1;
+            while ( j < drecs.size() &&
+                    drecs[j].a() == a.a() &&
+                    drecs[j].getOfs() == a.getOfs() + len &&
+                    drecs[j].drec()->extentOfs() == ar->extentOfs() ) {
+                len += drecs[j].drec()->lengthWithHeaders();
+                j++;
+            }
+            if ( j > i + 1 ) {
+                merged.insert( merged.end(), drecs.begin() + i, drecs.begin() + j );
+                runs.push_back( a );
+                runLengths.push_back( len );
+            }
+            i = j;
+        }
+        if ( runs.empty() )
+            return false;
+
+        // unlink them all, then put each run back as one record
+        for ( int b = 0; b < Buckets; b++ ) {
+            DiskLoc *prev = &_deletedList[b];
+            DiskLoc cur = *prev;
+            while ( !cur.isNull() ) {
+                DiskLoc next = cur.drec()->nextDeleted();
+                if ( std::binary_search( merged.begin(), merged.end(), cur ) )
+                    *getDur().writing(prev) = next;
+                else
+                    prev = &cur.drec()->nextDeleted();
+                cur = next;
+            }
+        }
+        for ( size_t i = 0; i < runs.size(); i++ ) {
+            DeletedRecord *d = runs[i].drec();
+            getDur().writingInt( d->lengthWithHeaders() ) = runLengths[i];
+            addDeletedRec( d, runs[i] );
+        }
+
+        LOG(1) << "coalesced " << merged.size() << " deleted records into " << runs.size() << endl;
+        return true;
+    }
+
+    void NamespaceDetails::appendDeletedListStats( BSONObjBuilder* result, int scale ) const {
+        long long count = 0;
+        long long size = 0;
+        long long largest = 0;
+        BSONArrayBuilder buckets;
+        for ( int b = 0; b < Buckets; b++ ) {
+            long long bucketCount = 0;
+            long long bucketSize = 0;
+            if ( !isCapped() || b == 0 ) {
+                // capped collections keep every deleted record on the first list
+                for ( DiskLoc i = _deletedList[b]; !i.isNull(); i = i.drec()->nextDeleted() ) {
+                    long long len = i.drec()->lengthWithHeaders();
+                    bucketCount++;
+                    bucketSize += len;
+                    largest = std::max( largest, len );
+                }
+            }
+            buckets.append( BSON( "count" << bucketCount << "size" << bucketSize / scale ) );
+            count += bucketCount;
+            size += bucketSize;
+        }
+
+        BSONObjBuilder b( result->subobjStart( "deletedRecords" ) );
+        b.appendNumber( "count", count );
+        b.appendNumber( "size", size / scale );
+        b.appendNumber( "largest", largest / scale );
+        // how much of the free space is unusable for a record as big as the largest free one
+        b.append( "fragmentation", size ? 1.0 - double( largest ) / size : 0.0 );
+        b.appendArray( "buckets", buckets.arr() );
+        b.done();
+    }
+
     void NamespaceDetails::dumpDeleted(set<DiskLoc> *extents) {
         for ( int i = 0; i < Buckets; i++ ) {
             DiskLoc dl = _deletedList[i];
@@ -57,6 +57,8 @@ namespace mongo {
     */
     const int Buckets = 19;
     const int MaxBucket = 18;
+    // records looked at in a deleted list bucket for one that fits before moving to a larger one
+    const int MaxSizeClassProbes = 5;
 
     extern int bucketSizes[];
 
@@ -250,7 +252,8 @@ namespace mongo {
                  this isn't thread safe.  TODO
         */
         enum SystemFlags {
-            Flag_HaveIdIndex = 1 << 0 // set when we have _id index (ONLY if ensureIdIndex was called -- 0 if that has never been called)
+            Flag_HaveIdIndex = 1 << 0, // set when we have _id index (ONLY if ensureIdIndex was called -- 0 if that has never been called)
+            Flag_Compressed = 1 << 1 // documents are kept in compressed blocks, set at creation only
         };
 
         enum UserFlags {
@@ -388,6 +391,17 @@ namespace mongo {
         /* add a given record to the deleted chains for this NS */
         void addDeletedRec(DeletedRecord *d, DiskLoc dloc);
         void dumpDeleted(set<DiskLoc> *extents = 0);
+
+        /** merge deleted records which are next to each other in an extent, for non-capped
+            collections.  walks all the deleted lists, so is only for when alloc() comes up empty.
+            @return true if any were merged
+        */
+        bool coalesceDeletedRecords();
+
+        /** appends "deletedRecords", the count and size of the free records in each deleted list
+            bucket and in all, and how fragmented that space is.  walks all the deleted lists.
+        */
+        void appendDeletedListStats( BSONObjBuilder* result, int scale ) const;
         // Start from firstExtent by default.
         DiskLoc firstRecord( const DiskLoc &startExtent = DiskLoc() ) const;
         // Start from lastExtent by default.
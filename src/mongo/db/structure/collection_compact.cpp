@@ -146,9 +146,9 @@ namespace mongo {
                         }
 
                         CompactDocWriter writer( objOld, lenWPadding );
-                        StatusWith<DiskLoc> status = _recordStore.insertRecord( &writer, 0 );
+                        StatusWith<DiskLoc> status = _recordStore->insertRecord( &writer, 0 );
                         uassertStatusOK( status.getStatus() );
-                        datasize += _recordStore.recordFor( status.getValue() )->netLength();
+                        datasize += _recordStore->recordFor( status.getValue() )->netLength();
 
                         InsertDeleteOptions options;
                         options.logIfError = false;
@@ -230,6 +230,14 @@ namespace mongo {
             return StatusWith<CompactStats>( ErrorCodes::BadValue,
                                              "cannot compact capped collection" );
 
+        if ( !_recordStore->usesExtents() )
+            return StatusWith<CompactStats>( ErrorCodes::BadValue,
+                                             "cannot compact in memory collection" );
+
+        if ( _details->isSystemFlagSet( NamespaceDetails::Flag_Compressed ) )
+            return StatusWith<CompactStats>( ErrorCodes::BadValue,
+                                             "cannot compact compressed collection" );
+
         if ( _indexCatalog.numIndexesInProgress() )
             return StatusWith<CompactStats>( ErrorCodes::BadValue,
                                              "cannot compact when indexes in progress" );
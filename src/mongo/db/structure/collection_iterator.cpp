@@ -32,9 +32,14 @@
 #include "mongo/db/storage/extent.h"
 #include "mongo/db/storage/extent_manager.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/touch_pages.h"
 
 namespace mongo {
 
+    // How far ahead of a collection scan to ask the OS to read.  0 turns read ahead off.
+    MONGO_EXPORT_SERVER_PARAMETER(collectionScanReadAheadKB, int, 1024);
+
     //
     // Regular / non-capped collection traversal
     //
@@ -42,7 +47,7 @@ namespace mongo {
     FlatIterator::FlatIterator(const Collection* collection,
                                const DiskLoc& start,
                                const CollectionScanParams::Direction& dir)
-        : _curr(start), _collection(collection), _direction(dir) {
+        : _curr(start), _collection(collection), _direction(dir), _readAheadEdge(0) {
 
         if (_curr.isNull()) {
 
@@ -81,6 +86,8 @@ namespace mongo {
                 _curr = e->lastRecord;
             }
         }
+
+        readAhead();
     }
 
     bool FlatIterator::isEOF() {
@@ -98,11 +105,78 @@ namespace mongo {
             else {
                 _curr = _collection->getExtentManager()->getPrevRecord( _curr );
             }
+            readAhead();
         }
 
         return ret;
     }
 
+    void FlatIterator::readAhead() {
+        // In 64 bits, as the parameter isn't bounded and file offsets go up to 2GB.
+        const long long window = collectionScanReadAheadKB * 1024LL;
+        if (window <= 0 || _curr.isNull()) {
+            return;
+        }
+
+        const ExtentManager* em = _collection->getExtentManager();
+        const bool forward = CollectionScanParams::FORWARD == _direction;
+        const int ofs = _curr.getOfs();
+
+        DiskLoc extentLoc = em->extentLocFor( _curr );
+        Extent* e = em->getExtent( extentLoc );
+        const int extentStart = extentLoc.getOfs();
+        const int extentEnd = extentStart + e->length;
+
+        if (extentLoc == _readAheadExtent) {
+            // Once read ahead reaches the end of the extent (and has started on the next one)
+            // there is nothing more to do until we get there.
+            if (forward ? _readAheadEdge >= extentEnd : _readAheadEdge <= extentStart) {
+                return;
+            }
+            // Top up when we're half way through what's been requested, so the reads are
+            // issued in large sequential chunks.
+            if ((forward ? _readAheadEdge - ofs : ofs - _readAheadEdge) > window / 2) {
+                return;
+            }
+        }
+        else {
+            _readAheadExtent = extentLoc;
+            _readAheadEdge = ofs;
+        }
+
+        const char* base = reinterpret_cast<const char*>( e );
+        if (forward) {
+            int from = std::max( _readAheadEdge, ofs );
+            int to = static_cast<int>( std::min<long long>( ofs + window, extentEnd ) );
+            if (to > from) {
+                prefetch_pages( base + ( from - extentStart ), to - from );
+            }
+            _readAheadEdge = to;
+
+            long long spill = ofs + window - extentEnd;
+            if (spill > 0 && !e->xnext.isNull()) {
+                Extent* next = em->getExtent( e->xnext );
+                prefetch_pages( reinterpret_cast<const char*>( next ),
+                                std::min<long long>( spill, next->length ) );
+            }
+        }
+        else {
+            int from = static_cast<int>( std::max<long long>( ofs - window, extentStart ) );
+            int to = std::min( _readAheadEdge, ofs );
+            if (to > from) {
+                prefetch_pages( base + ( from - extentStart ), to - from );
+            }
+            _readAheadEdge = from;
+
+            long long spill = extentStart - ( ofs - window );
+            if (spill > 0 && !e->xprev.isNull()) {
+                Extent* prev = em->getExtent( e->xprev );
+                int n = static_cast<int>( std::min<long long>( spill, prev->length ) );
+                prefetch_pages( reinterpret_cast<const char*>( prev ) + prev->length - n, n );
+            }
+        }
+    }
+
     void FlatIterator::invalidate(const DiskLoc& dl) {
         verify( _collection->ok() );
 
@@ -82,12 +82,24 @@ namespace mongo {
         virtual bool recoverFromYield();
 
     private:
+        /**
+         * Keeps the OS reading up to collectionScanReadAheadKB ahead of _curr in the scan
+         * direction, running into the following extent when the window crosses the end of this
+         * one, so a scan of cold data doesn't fault on every page.
+         */
+        void readAhead();
+
         // The result returned on the next call to getNext().
         DiskLoc _curr;
 
         const Collection* _collection;
 
         CollectionScanParams::Direction _direction;
+
+        // The extent we're reading ahead in, and the file offset read ahead has been issued up to
+        // (down to when scanning backward).
+        DiskLoc _readAheadExtent;
+        int _readAheadEdge;
     };
 
     /**
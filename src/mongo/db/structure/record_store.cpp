@@ -32,6 +32,8 @@
 
 #include "mongo/db/storage/extent.h"
 #include "mongo/db/catalog/collection.h"
+#include "mongo/db/structure/catalog/namespace_details.h"
+#include "mongo/db/structure/collection_iterator.h"
 
 
 #include "mongo/db/pdfile.h" // XXX-ERH
@@ -40,11 +42,29 @@ namespace mongo {
 
     RecordStore::RecordStore( const StringData& ns )
         : _ns( ns.toString() ) {
+    }
+
+    RecordStore::~RecordStore() {
+    }
+
+    BSONObj RecordStore::docFor( const DiskLoc& loc ) const {
+        return BSONObj::make( recordFor( loc )->accessed() );
+    }
+
+    bool RecordStore::canUpdateInPlace( const DiskLoc& loc, int len ) const {
+        return recordFor( loc )->netLength() >= len;
+    }
+
+    // ----
+
+    ExtentRecordStore::ExtentRecordStore( const StringData& ns )
+        : RecordStore( ns ) {
         _extentManager = NULL;
         _details = NULL;
+        _freedSinceCoalesce = 0;
     }
 
-    void RecordStore::init( NamespaceDetails* details,
+    void ExtentRecordStore::init( NamespaceDetails* details,
                             ExtentManager* em,
                             bool isSystemIndexes ) {
         _details = details;
@@ -52,11 +72,39 @@ namespace mongo {
         _isSystemIndexes = isSystemIndexes;
     }
 
-    Record* RecordStore::recordFor( const DiskLoc& loc ) const {
+    Record* ExtentRecordStore::recordFor( const DiskLoc& loc ) const {
         return _extentManager->recordFor( loc );
     }
 
-    StatusWith<DiskLoc> RecordStore::insertRecord( const DocWriter* doc, int quotaMax ) {
+    void ExtentRecordStore::updateRecord( const DiskLoc& loc, const char* data, int len ) {
+        Record* r = recordFor( loc );
+        memcpy( getDur().writingPtr( r->data(), len ), data, len );
+    }
+
+    void ExtentRecordStore::updateWithDamages( const DiskLoc& loc,
+                                               const char* damageSource,
+                                               const mutablebson::DamageVector& damages ) {
+        char* root = recordFor( loc )->data();
+
+        mutablebson::DamageVector::const_iterator where = damages.begin();
+        const mutablebson::DamageVector::const_iterator end = damages.end();
+        for( ; where != end; ++where ) {
+            const char* sourcePtr = damageSource + where->sourceOffset;
+            void* targetPtr = getDur().writingPtr( root + where->targetOffset, where->size );
+            std::memcpy( targetPtr, sourcePtr, where->size );
+        }
+    }
+
+    CollectionIterator* ExtentRecordStore::getIterator( const Collection* collection,
+                                                        const DiskLoc& start,
+                                                        bool tailable,
+                                                        const CollectionScanParams::Direction& dir ) const {
+        if ( _details->isCapped() )
+            return new CappedIterator( collection, start, tailable, dir );
+        return new FlatIterator( collection, start, dir );
+    }
+
+    StatusWith<DiskLoc> ExtentRecordStore::insertRecord( const DocWriter* doc, int quotaMax ) {
         int lenWHdr = doc->documentSize() + Record::HeaderSize;
         if ( doc->addPadding() )
             lenWHdr = _details->getRecordAllocationSize( lenWHdr );
@@ -79,7 +127,7 @@ namespace mongo {
     }
 
 
-    StatusWith<DiskLoc> RecordStore::insertRecord( const char* data, int len, int quotaMax ) {
+    StatusWith<DiskLoc> ExtentRecordStore::insertRecord( const char* data, int len, int quotaMax ) {
         int lenWHdr = _details->getRecordAllocationSize( len + Record::HeaderSize );
         fassert( 17208, lenWHdr >= ( len + Record::HeaderSize ) );
 
@@ -102,7 +150,7 @@ namespace mongo {
     }
 
 
-    StatusWith<DiskLoc> RecordStore::allocRecord( int lengthWithHeaders, int quotaMax ) {
+    StatusWith<DiskLoc> ExtentRecordStore::allocRecord( int lengthWithHeaders, int quotaMax ) {
         DiskLoc loc = _details->alloc( _ns, lengthWithHeaders );
         if ( !loc.isNull() )
             return StatusWith<DiskLoc>( loc );
@@ -111,6 +159,17 @@ namespace mongo {
             return StatusWith<DiskLoc>( ErrorCodes::InternalError,
                                         "no space in capped collection" );
 
+        // the free space may just be in pieces too small for this record.  merge neighbouring
+        // free records before growing the collection, if any were freed since we last did.
+        if ( _freedSinceCoalesce > 0 ) {
+            _freedSinceCoalesce = 0;
+            if ( _details->coalesceDeletedRecords() ) {
+                loc = _details->alloc( _ns, lengthWithHeaders );
+                if ( !loc.isNull() )
+                    return StatusWith<DiskLoc>( loc );
+            }
+        }
+
         LOG(1) << "allocating new extent";
 
         _extentManager->increaseStorageSize( _ns, _details,
@@ -144,7 +203,12 @@ namespace mongo {
         return StatusWith<DiskLoc>( ErrorCodes::InternalError, "cannot allocate space" );
     }
 
-    void RecordStore::deleteRecord( const DiskLoc& dl ) {
+    void ExtentRecordStore::deleteRecord( const DiskLoc& dl ) {
+        _details->incrementStats( -1 * recordFor( dl )->netLength(), -1 );
+        freeRecord( dl );
+    }
+
+    void ExtentRecordStore::freeRecord( const DiskLoc& dl ) {
 
         Record* todelete = recordFor( dl );
 
@@ -182,8 +246,6 @@ namespace mongo {
 
         /* add to the free list */
         {
-            _details->incrementStats( -1 * todelete->netLength(), -1 );
-
             if ( _isSystemIndexes ) {
                 /* temp: if in system.indexes, don't reuse, and zero out: we want to be
                    careful until validated more, as IndexDetails has pointers
@@ -199,6 +261,7 @@ namespace mongo {
                     *getDur().writing(p) = 0;
                 }
                 _details->addDeletedRec((DeletedRecord*)todelete, dl);
+                _freedSinceCoalesce++;
             }
         }
 
@@ -30,40 +30,132 @@
 
 #pragma once
 
+#include "mongo/bson/mutable/damage_vector.h"
 #include "mongo/db/diskloc.h"
+#include "mongo/db/exec/collection_scan_common.h"
 
 namespace mongo {
 
     class Collection;
+    class CollectionIterator;
     class DocWriter;
     class ExtentManager;
     class NamespaceDetails;
     class Record;
 
+    /**
+     * Storage for the records of one collection or index.  Every record is addressed by the
+     * DiskLoc the store handed out when it was inserted.
+     */
     class RecordStore {
     public:
         RecordStore( const StringData& ns );
+        virtual ~RecordStore();
+
+        const std::string& ns() const { return _ns; }
+
+        virtual Record* recordFor( const DiskLoc& loc ) const = 0;
+
+        /**
+         * @return the document stored at loc.  only valid while the lock is held unless the
+         *     store says otherwise.
+         */
+        virtual BSONObj docFor( const DiskLoc& loc ) const;
+
+        virtual void deleteRecord( const DiskLoc& dl ) = 0;
+
+        virtual StatusWith<DiskLoc> insertRecord( const char* data, int len, int quotaMax ) = 0;
+
+        virtual StatusWith<DiskLoc> insertRecord( const DocWriter* doc, int quotaMax ) = 0;
+
+        /**
+         * overwrites the start of the record at loc with len bytes of data.
+         * the record must already be at least that long.
+         */
+        virtual void updateRecord( const DiskLoc& loc, const char* data, int len ) = 0;
+
+        /**
+         * @return true if the record at loc can take len bytes through updateRecord() or
+         *     updateWithDamages(), otherwise updating it means moving it to a new record.
+         */
+        virtual bool canUpdateInPlace( const DiskLoc& loc, int len ) const;
+
+        /**
+         * applies damages, with source bytes taken from damageSource, to the record at loc
+         */
+        virtual void updateWithDamages( const DiskLoc& loc,
+                                        const char* damageSource,
+                                        const mutablebson::DamageVector& damages ) = 0;
+
+        /**
+         * @param collection the collection stored here, which the iterator checks is still
+         *     alive across yields
+         */
+        virtual CollectionIterator* getIterator( const Collection* collection,
+                                                 const DiskLoc& start,
+                                                 bool tailable,
+                                                 const CollectionScanParams::Direction& dir ) const = 0;
+
+        /**
+         * @return true if the records live in the database's extents, as compact and
+         *     renameCollection assume.
+         */
+        virtual bool usesExtents() const = 0;
+
+    protected:
+        std::string _ns;
+    };
+
+    /**
+     * The mmap'd storage: records are allocated from the extents of the database's data files
+     * and chained together through their headers, free space is kept in NamespaceDetails'
+     * deleted lists.
+     */
+    class ExtentRecordStore : public RecordStore {
+    public:
+        ExtentRecordStore( const StringData& ns );
 
         void init( NamespaceDetails* details,
                    ExtentManager* em,
                    bool isSystemIndexes );
 
-        Record* recordFor( const DiskLoc& loc ) const;
+        virtual Record* recordFor( const DiskLoc& loc ) const;
+
+        virtual void deleteRecord( const DiskLoc& dl );
+
+        virtual StatusWith<DiskLoc> insertRecord( const char* data, int len, int quotaMax );
+
+        virtual StatusWith<DiskLoc> insertRecord( const DocWriter* doc, int quotaMax );
+
+        virtual void updateRecord( const DiskLoc& loc, const char* data, int len );
 
-        void deleteRecord( const DiskLoc& dl );
+        virtual void updateWithDamages( const DiskLoc& loc,
+                                        const char* damageSource,
+                                        const mutablebson::DamageVector& damages );
 
-        StatusWith<DiskLoc> insertRecord( const char* data, int len, int quotaMax );
+        virtual CollectionIterator* getIterator( const Collection* collection,
+                                                 const DiskLoc& start,
+                                                 bool tailable,
+                                                 const CollectionScanParams::Direction& dir ) const;
 
-        StatusWith<DiskLoc> insertRecord( const DocWriter* doc, int quotaMax );
+        virtual bool usesExtents() const { return true; }
 
     protected:
+        /** @return space for a record, not yet linked into its extent's record chain */
         StatusWith<DiskLoc> allocRecord( int lengthWithHeaders, int quotaMax );
 
-    private:
-        std::string _ns;
+        /** unlinks the record at dl from its extent and frees it, leaving the stats alone */
+        void freeRecord( const DiskLoc& dl );
+
         NamespaceDetails* _details;
         ExtentManager* _extentManager;
+
+    private:
         bool _isSystemIndexes;
+
+        // records freed since the deleted lists were last coalesced, so there may be neighbouring
+        // free records to merge
+        unsigned _freedSinceCoalesce;
     };
 
 }
@@ -0,0 +1,517 @@
+// record_store_compressed.cpp
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/db/structure/record_store_compressed.h"
+
+#include <list>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/client.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/dur.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/extent_manager.h"
+#include "mongo/db/storage/record.h"
+#include "mongo/db/structure/catalog/namespace_details.h"
+#include "mongo/db/structure/collection_iterator.h"
+#include "mongo/platform/random.h"
+#include "mongo/platform/unordered_map.h"
+#include "mongo/util/compress.h"
+#include "mongo/util/concurrency/mutex.h"
+
+#include "mongo/db/pdfile.h" // XXX-ERH
+
+namespace mongo {
+
+    MONGO_EXPORT_SERVER_PARAMETER( compressedBlockCacheSizeMB, int, 16 );
+
+    namespace {
+
+        Counter64 blockCacheHits;
+        Counter64 blockCacheMisses;
+        ServerStatusMetricField<Counter64> blockCacheHitsDisplay( "storage.compressedBlockCache.hits",
+                                                                  &blockCacheHits );
+        ServerStatusMetricField<Counter64> blockCacheMissesDisplay( "storage.compressedBlockCache.misses",
+                                                                    &blockCacheMisses );
+
+#pragma pack(1)
+        /**
+         * The data of a block record: a header and then the documents back to back, as BSON
+         * while open and snappy compressed once sealed if that saved enough.
+         */
+        struct Block {
+            enum Flags {
+                Sealed = 1 << 0,
+                Compressed = 1 << 1
+            };
+
+            enum { HeaderSize = 32 };
+
+            int flags;
+            int nDocs;
+            unsigned long long deleted; // bit per slot, set once its document is removed
+            unsigned long long id; // names the sealed block in the decompressed block cache
+            int dataSize; // bytes used in data
+            int uncompressedSize;
+            char data[4];
+
+            bool isDeleted( int slot ) const { return deleted & ( 1ULL << slot ); }
+
+            int nLive() const {
+                int n = 0;
+                for ( int slot = 0; slot < nDocs; slot++ ) {
+                    if ( !isDeleted( slot ) )
+                        n++;
+                }
+                return n;
+            }
+        };
+#pragma pack()
+
+        BOOST_STATIC_ASSERT( sizeof(Block) - 4 == Block::HeaderSize );
+        BOOST_STATIC_ASSERT( ( CompressedRecordStore::MaxDocsPerBlock - 1 ) <<
+                                 CompressedRecordStore::SlotShift <
+                             1 << CompressedRecordStore::CompressedTagShift );
+
+        Block* blockIn( Record* r ) {
+            return reinterpret_cast<Block*>( r->data() );
+        }
+
+        int capacityOf( Record* r ) {
+            return r->netLength() - Block::HeaderSize;
+        }
+
+        /** what's cached for a sealed block */
+        struct CachedBlock {
+            std::string decompressed; // the documents, if the block is compressed
+            std::vector<int> offsets; // of each slot's document within the documents
+
+            size_t size() const {
+                return sizeof(CachedBlock) + decompressed.size() + offsets.size() * sizeof(int);
+            }
+        };
+
+        /**
+         * Sealed blocks read recently, least recently used evicted first once they take more
+         * than compressedBlockCacheSizeMB.  Compressed blocks are cached decompressed, and
+         * every block with the offsets of its documents, so a lookup doesn't walk the block.
+         *
+         * Blocks are looked up by the random id given when they were sealed, rather than by
+         * DiskLoc, so an entry can't outlive its block's contents: a dropped collection's
+         * blocks, or a freed block whose space is reused, simply age out.
+         */
+        class DecompressedBlockCache {
+        public:
+            typedef boost::shared_ptr<const CachedBlock> Data;
+
+            DecompressedBlockCache() : _mutex( "DecompressedBlockCache" ), _bytes( 0 ) {
+            }
+
+            unsigned long long newId() {
+                SimpleMutex::scoped_lock lk( _mutex );
+                if ( !_random ) {
+                    scoped_ptr<SecureRandom> sr( SecureRandom::create() );
+                    _random.reset( new PseudoRandom( sr->nextInt64() ) );
+                }
+                return static_cast<unsigned long long>( _random->nextInt64() );
+            }
+
+            /** @return the sealed block's entry, making it if it isn't cached */
+            Data get( const Block* b ) {
+                {
+                    SimpleMutex::scoped_lock lk( _mutex );
+                    Index::iterator i = _index.find( b->id );
+                    if ( i != _index.end() ) {
+                        _lru.splice( _lru.begin(), _lru, i->second );
+                        blockCacheHits.increment();
+                        return i->second->second;
+                    }
+                }
+
+                // decompress outside the mutex, racing readers of the same block both do it
+                blockCacheMisses.increment();
+                CachedBlock* cached = new CachedBlock();
+                Data data( cached );
+                const char* p = b->data;
+                if ( b->flags & Block::Compressed ) {
+                    massert( 17354,
+                             "compressed block is corrupt",
+                             uncompress( b->data, b->dataSize, &cached->decompressed ) &&
+                             cached->decompressed.size() ==
+                                 static_cast<size_t>( b->uncompressedSize ) );
+                    p = cached->decompressed.data();
+                }
+                cached->offsets.reserve( b->nDocs );
+                for ( int slot = 0, ofs = 0; slot < b->nDocs; slot++ ) {
+                    cached->offsets.push_back( ofs );
+                    ofs += BSONObj( p + ofs ).objsize();
+                }
+
+                SimpleMutex::scoped_lock lk( _mutex );
+                if ( _index.count( b->id ) )
+                    return data;
+
+                _lru.push_front( std::make_pair( b->id, data ) );
+                _index[b->id] = _lru.begin();
+                _bytes += data->size();
+
+                const size_t maxBytes = static_cast<size_t>( compressedBlockCacheSizeMB ) << 20;
+                while ( _bytes > maxBytes && !_lru.empty() ) {
+                    _bytes -= _lru.back().second->size();
+                    _index.erase( _lru.back().first );
+                    _lru.pop_back();
+                }
+
+                return data;
+            }
+
+        private:
+            typedef std::list< std::pair<unsigned long long, Data> > Lru;
+            typedef unordered_map<unsigned long long, Lru::iterator> Index;
+
+            SimpleMutex _mutex;
+            Lru _lru; // most recently used first
+            Index _index;
+            size_t _bytes;
+            scoped_ptr<PseudoRandom> _random;
+        } blockCache;
+
+        /** @return an owned copy of the document in slot of the block record r */
+        BSONObj docIn( Record* r, int slot ) {
+            const Block* b = blockIn( r );
+            verify( slot < b->nDocs && !b->isDeleted( slot ) );
+
+            if ( !( b->flags & Block::Sealed ) ) {
+                // the open block is still being appended to
+                const char* p = b->data;
+                for ( int i = 0; i < slot; i++ )
+                    p += BSONObj( p ).objsize();
+                return BSONObj( p ).getOwned();
+            }
+
+            DecompressedBlockCache::Data cached = blockCache.get( b );
+            const char* p = b->flags & Block::Compressed ? cached->decompressed.data() : b->data;
+            return BSONObj( p + cached->offsets[slot] ).getOwned();
+        }
+
+        /**
+         * Walks the documents of a CompressedRecordStore, using an iterator over the extent
+         * records for the blocks.
+         */
+        class CompressedIterator : public CollectionIterator {
+        public:
+            /**
+             * @param blocks iterates the block records from start's block, or from the start if
+             *     start is null.  takes ownership.
+             */
+            CompressedIterator( const CompressedRecordStore* store,
+                                CollectionIterator* blocks,
+                                const DiskLoc& start,
+                                const CollectionScanParams::Direction& dir )
+                : _store( store ),
+                  _blocks( blocks ),
+                  _forward( CollectionScanParams::FORWARD == dir ) {
+
+                if ( start.isNull() ) {
+                    advance();
+                }
+                else {
+                    _block = _blocks->getNext();
+                    _curr = start;
+                }
+            }
+
+            virtual bool isEOF() {
+                return _curr.isNull();
+            }
+
+            virtual DiskLoc getNext() {
+                DiskLoc ret = _curr;
+                if ( !isEOF() )
+                    advance();
+                return ret;
+            }
+
+            virtual void invalidate( const DiskLoc& dl ) {
+                if ( !CompressedRecordStore::isCompressedLoc( dl ) )
+                    return;
+
+                if ( dl == _curr )
+                    advance();
+
+                // the block is freed along with its last document.  we've already moved past
+                // it if it was the one being walked, but the block iterator may be on it.
+                if ( _store->isLastInBlock( dl ) )
+                    _blocks->invalidate( CompressedRecordStore::blockFor( dl ) );
+            }
+
+            virtual void prepareToYield() {
+                _blocks->prepareToYield();
+            }
+
+            virtual bool recoverFromYield() {
+                return _blocks->recoverFromYield();
+            }
+
+        private:
+            /** moves _curr to the next live document, looking into further blocks if need be */
+            void advance() {
+                int slot;
+                if ( _curr.isNull() )
+                    slot = -1;
+                else
+                    slot = CompressedRecordStore::slotFor( _curr ) + ( _forward ? 1 : -1 );
+
+                while ( true ) {
+                    if ( !_block.isNull() && slot >= 0 ) {
+                        slot = _store->nextSlot( _block, slot, _forward );
+                        if ( slot >= 0 ) {
+                            _curr = CompressedRecordStore::locFor( _block, slot );
+                            return;
+                        }
+                    }
+
+                    if ( _blocks->isEOF() ) {
+                        _block.Null();
+                        _curr.Null();
+                        return;
+                    }
+
+                    _block = _blocks->getNext();
+                    slot = _forward ? 0 : CompressedRecordStore::MaxDocsPerBlock - 1;
+                }
+            }
+
+            const CompressedRecordStore* _store;
+            scoped_ptr<CollectionIterator> _blocks;
+            bool _forward;
+
+            // the block _curr is in, which _blocks has moved past
+            DiskLoc _block;
+
+            // the result returned by the next getNext(), null at EOF
+            DiskLoc _curr;
+        };
+
+    }
+
+    CompressedRecordStore::CompressedRecordStore( const StringData& ns )
+        : ExtentRecordStore( ns ),
+          _lookedForOpenBlock( false ) {
+    }
+
+    Record* CompressedRecordStore::recordFor( const DiskLoc& loc ) const {
+        return _extentManager->recordFor( isCompressedLoc( loc ) ? blockFor( loc ) : loc );
+    }
+
+    BSONObj CompressedRecordStore::docFor( const DiskLoc& loc ) const {
+        return docIn( recordFor( loc )->accessed(), slotFor( loc ) );
+    }
+
+    BSONObj CompressedRecordStore::objForCompressedLoc( const DiskLoc& loc ) {
+        Record* r = cc().database()->getExtentManager().recordFor( blockFor( loc ) );
+        return docIn( r->accessed(), slotFor( loc ) );
+    }
+
+    int CompressedRecordStore::nextSlot( const DiskLoc& block, int slot, bool forward ) const {
+        const Block* b = blockIn( recordFor( block ) );
+        if ( forward ) {
+            for ( ; slot < b->nDocs; slot++ ) {
+                if ( !b->isDeleted( slot ) )
+                    return slot;
+            }
+        }
+        else {
+            for ( slot = std::min( slot, b->nDocs - 1 ); slot >= 0; slot-- ) {
+                if ( !b->isDeleted( slot ) )
+                    return slot;
+            }
+        }
+        return -1;
+    }
+
+    bool CompressedRecordStore::isLastInBlock( const DiskLoc& loc ) const {
+        DiskLoc block = blockFor( loc );
+        if ( block == _openBlock )
+            return false;
+        const Block* b = blockIn( recordFor( block ) );
+        return b->nLive() == 1 && !b->isDeleted( slotFor( loc ) );
+    }
+
+    StatusWith<DiskLoc> CompressedRecordStore::insertRecord( const char* data, int len, int quotaMax ) {
+        StatusWith<DiskLoc> block = blockWithRoom( len, quotaMax );
+        if ( !block.isOK() )
+            return block;
+
+        Record* r = recordFor( block.getValue() );
+        Block* b = blockIn( r );
+        const int slot = b->nDocs;
+
+        memcpy( getDur().writingPtr( b->data + b->dataSize, len ), data, len );
+        b = reinterpret_cast<Block*>( getDur().writingPtr( b, Block::HeaderSize ) );
+        b->nDocs++;
+        b->dataSize += len;
+        b->uncompressedSize = b->dataSize;
+
+        _details->incrementStats( len, 1 );
+
+        // the smallest document is 5 bytes
+        if ( b->nDocs == MaxDocsPerBlock || capacityOf( r ) - b->dataSize < 5 )
+            seal( block.getValue() );
+
+        return StatusWith<DiskLoc>( locFor( block.getValue(), slot ) );
+    }
+
+    StatusWith<DiskLoc> CompressedRecordStore::insertRecord( const DocWriter* doc, int quotaMax ) {
+        std::string buf( doc->documentSize(), '\0' );
+        doc->writeDocument( &buf[0] );
+        return insertRecord( buf.data(), buf.size(), quotaMax );
+    }
+
+    StatusWith<DiskLoc> CompressedRecordStore::blockWithRoom( int len, int quotaMax ) {
+        if ( !_lookedForOpenBlock ) {
+            _lookedForOpenBlock = true;
+            DiskLoc last = _details->lastRecord();
+            if ( !last.isNull() && !( blockIn( recordFor( last ) )->flags & Block::Sealed ) )
+                _openBlock = last;
+        }
+
+        if ( !_openBlock.isNull() ) {
+            Record* r = recordFor( _openBlock );
+            Block* b = blockIn( r );
+            if ( b->nDocs < MaxDocsPerBlock && capacityOf( r ) - b->dataSize >= len )
+                return StatusWith<DiskLoc>( _openBlock );
+            seal( _openBlock );
+        }
+
+        const int dataSize = std::max( len, static_cast<int>( BlockDataSize ) );
+        StatusWith<DiskLoc> loc = allocRecord( Record::HeaderSize + Block::HeaderSize + dataSize,
+                                               quotaMax );
+        if ( !loc.isOK() )
+            return loc;
+
+        Record* r = recordFor( loc.getValue() );
+        memset( getDur().writingPtr( blockIn( r ), Block::HeaderSize ), 0, Block::HeaderSize );
+        addRecordToRecListInExtent( r, loc.getValue() ); // XXX move code here from pdfile
+
+        _openBlock = loc.getValue();
+        return loc;
+    }
+
+    void CompressedRecordStore::seal( const DiskLoc& block ) {
+        Record* r = recordFor( block );
+        Block* b = blockIn( r );
+
+        std::string compressed;
+        compress( b->data, b->dataSize, &compressed );
+
+        // not worth a decompression on every read unless it saves an eighth
+        const bool worthIt = compressed.size() < static_cast<size_t>( b->dataSize ) -
+                                                 b->dataSize / 8;
+        if ( worthIt ) {
+            memcpy( getDur().writingPtr( b->data, compressed.size() ),
+                    compressed.data(),
+                    compressed.size() );
+        }
+
+        b = reinterpret_cast<Block*>( getDur().writingPtr( b, Block::HeaderSize ) );
+        b->flags |= Block::Sealed;
+        if ( worthIt ) {
+            b->flags |= Block::Compressed;
+            b->dataSize = compressed.size();
+        }
+        b->id = blockCache.newId();
+
+        shrink( block, Record::HeaderSize + Block::HeaderSize + b->dataSize );
+
+        if ( block == _openBlock )
+            _openBlock.Null();
+    }
+
+    void CompressedRecordStore::shrink( const DiskLoc& loc, int len ) {
+        Record* r = recordFor( loc );
+
+        // keep records aligned as NamespaceDetails::alloc() does
+        len = ( len + 3 ) & 0xfffffffc;
+        const int left = r->lengthWithHeaders() - len;
+        if ( left < 24 )
+            return;
+
+        getDur().writingInt( r->lengthWithHeaders() ) = len;
+
+        DiskLoc tail = loc;
+        tail.inc( len );
+        DeletedRecord* d = reinterpret_cast<DeletedRecord*>( _extentManager->recordFor( tail ) );
+        d = getDur().writing( d );
+        d->extentOfs() = r->extentOfs();
+        d->lengthWithHeaders() = left;
+        d->nextDeleted().Null();
+
+        _details->addDeletedRec( d, tail );
+    }
+
+    void CompressedRecordStore::deleteRecord( const DiskLoc& dl ) {
+        const DiskLoc block = blockFor( dl );
+        Block* b = blockIn( recordFor( block ) );
+
+        _details->incrementStats( -1 * docFor( dl ).objsize(), -1 );
+
+        *getDur().writing( &b->deleted ) |= 1ULL << slotFor( dl );
+
+        if ( b->nLive() == 0 && block != _openBlock )
+            freeRecord( block );
+    }
+
+    void CompressedRecordStore::updateRecord( const DiskLoc& loc, const char* data, int len ) {
+        msgasserted( 17355, "compressed documents can't be updated in place" );
+    }
+
+    void CompressedRecordStore::updateWithDamages( const DiskLoc& loc,
+                                                   const char* damageSource,
+                                                   const mutablebson::DamageVector& damages ) {
+        msgasserted( 17356, "compressed documents can't be updated in place" );
+    }
+
+    CollectionIterator* CompressedRecordStore::getIterator( const Collection* collection,
+                                                            const DiskLoc& start,
+                                                            bool tailable,
+                                                            const CollectionScanParams::Direction& dir ) const {
+        verify( !tailable ); // compressed collections aren't capped
+        DiskLoc startBlock = start.isNull() ? DiskLoc() : blockFor( start );
+        CollectionIterator* blocks = ExtentRecordStore::getIterator( collection,
+                                                                     startBlock,
+                                                                     false,
+                                                                     dir );
+        return new CompressedIterator( this, blocks, start, dir );
+    }
+
+}
@@ -0,0 +1,134 @@
+// record_store_compressed.h
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include "mongo/db/structure/record_store.h"
+
+namespace mongo {
+
+    /**
+     * Keeps a collection's documents in snappy compressed blocks, each block being one record
+     * in the collection's extents, so text heavy collections take a fraction of the disk and
+     * page cache.  Chosen when the collection is created with { compressed: true }.
+     *
+     * Documents are appended to the open block, which stays uncompressed so that an insert
+     * only journals the new document.  Once full the block is sealed: compressed in place and
+     * its record shrunk, the tail going back to the deleted lists.  Sealed blocks are never
+     * rewritten.  Removing a document sets its bit in the block's header and the block is
+     * freed along with its last document, so documents can't be updated in place either and
+     * every update moves the document.
+     *
+     * A document's DiskLoc is its block's with the slot and CompressedFileFlag folded into the
+     * file number.  Such file numbers are exactly those whose bits from CompressedTagShift up
+     * equal CompressedFileFlag, which leaves out null, invalid and maxDiskLoc.  Sealed blocks
+     * are read through a process wide cache of decompressed blocks and document offsets, so
+     * docFor() and DiskLoc::obj() return owned copies which don't depend on the cache.
+     */
+    class CompressedRecordStore : public ExtentRecordStore {
+    public:
+        enum {
+            MaxDocsPerBlock = 64,
+            BlockDataSize = 32 * 1024, // bytes of documents an open block is allocated for
+            SlotShift = 14, // above any file number < DiskLoc::MaxFiles
+            CompressedTagShift = 20, // above any slot < MaxDocsPerBlock
+            CompressedFileFlag = 1 << 21 // above any file number of a heap store
+        };
+
+        CompressedRecordStore( const StringData& ns );
+
+        /** @return the block record holding the document at loc, or the record at loc */
+        virtual Record* recordFor( const DiskLoc& loc ) const;
+
+        virtual BSONObj docFor( const DiskLoc& loc ) const;
+
+        virtual void deleteRecord( const DiskLoc& dl );
+
+        virtual StatusWith<DiskLoc> insertRecord( const char* data, int len, int quotaMax );
+
+        virtual StatusWith<DiskLoc> insertRecord( const DocWriter* doc, int quotaMax );
+
+        virtual void updateRecord( const DiskLoc& loc, const char* data, int len );
+
+        virtual void updateWithDamages( const DiskLoc& loc,
+                                        const char* damageSource,
+                                        const mutablebson::DamageVector& damages );
+
+        virtual bool canUpdateInPlace( const DiskLoc& loc, int len ) const { return false; }
+
+        virtual CollectionIterator* getIterator( const Collection* collection,
+                                                 const DiskLoc& start,
+                                                 bool tailable,
+                                                 const CollectionScanParams::Direction& dir ) const;
+
+        /**
+         * @return the first live slot of block at or after slot when forward, else at or
+         *     before it, or -1 if there is none
+         */
+        int nextSlot( const DiskLoc& block, int slot, bool forward ) const;
+
+        /** @return true if deleting the document at loc will free its block */
+        bool isLastInBlock( const DiskLoc& loc ) const;
+
+        static bool isCompressedLoc( const DiskLoc& loc ) {
+            return ( loc.a() & ~( ( 1 << CompressedTagShift ) - 1 ) ) == CompressedFileFlag;
+        }
+
+        static DiskLoc locFor( const DiskLoc& block, int slot ) {
+            return DiskLoc( CompressedFileFlag | ( slot << SlotShift ) | block.a(), block.getOfs() );
+        }
+
+        static DiskLoc blockFor( const DiskLoc& loc ) {
+            return DiskLoc( loc.a() & ( ( 1 << SlotShift ) - 1 ), loc.getOfs() );
+        }
+
+        static int slotFor( const DiskLoc& loc ) {
+            return ( loc.a() & ~CompressedFileFlag ) >> SlotShift;
+        }
+
+        /** DiskLoc::obj() for a document of any compressed collection in the current database */
+        static BSONObj objForCompressedLoc( const DiskLoc& loc );
+
+    private:
+        /** @return the open block if it has room for len more bytes, else a new one */
+        StatusWith<DiskLoc> blockWithRoom( int len, int quotaMax );
+
+        void seal( const DiskLoc& block );
+
+        /** gives the end of the record at loc from len on back to the deleted lists */
+        void shrink( const DiskLoc& loc, int len );
+
+        DiskLoc _openBlock;
+
+        // the open block is not persisted, so after a restart the last block is reused if open
+        bool _lookedForOpenBlock;
+    };
+
+}
@@ -0,0 +1,251 @@
+// record_store_heap.cpp
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/db/structure/record_store_heap.h"
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/storage/record.h"
+#include "mongo/db/structure/catalog/namespace_details.h"
+#include "mongo/db/structure/collection_iterator.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    namespace {
+
+        // stores by file number - FirstFileNumber.  written under heapStoresMutex, read
+        // without it by DiskLoc::rec(), which is safe as a store is only created or destroyed
+        // under the write lock of its database and read under at least its read lock.
+        HeapRecordStore* heapStores[HeapRecordStore::MaxStores];
+        SimpleMutex heapStoresMutex( "heapStores" );
+
+        /**
+         * Walks a HeapRecordStore in slot order.
+         */
+        class HeapIterator : public CollectionIterator {
+        public:
+            HeapIterator( const Collection* collection,
+                          const HeapRecordStore* store,
+                          const DiskLoc& start,
+                          const CollectionScanParams::Direction& dir )
+                : _collection( collection ),
+                  _store( store ),
+                  _forward( CollectionScanParams::FORWARD == dir ) {
+
+                if ( start.isNull() ) {
+                    _curr = _forward ? 0 : std::numeric_limits<int>::max();
+                    _curr = _store->nextSlot( _curr, _forward );
+                }
+                else {
+                    _curr = HeapRecordStore::slotFor( start );
+                }
+            }
+
+            virtual bool isEOF() {
+                return _curr < 0;
+            }
+
+            virtual DiskLoc getNext() {
+                if ( isEOF() )
+                    return DiskLoc();
+
+                DiskLoc ret = _store->locForSlot( _curr );
+                _curr = _store->nextSlot( _forward ? _curr + 1 : _curr - 1, _forward );
+                return ret;
+            }
+
+            virtual void invalidate( const DiskLoc& dl ) {
+                verify( _collection->ok() );
+
+                // Just move past the thing being deleted.
+                if ( !isEOF() && dl == _store->locForSlot( _curr ) ) {
+                    getNext();
+                }
+            }
+
+            virtual void prepareToYield() {
+            }
+
+            virtual bool recoverFromYield() {
+                // see FlatIterator::recoverFromYield
+                verify( _collection->ok() );
+                return true;
+            }
+
+        private:
+            const Collection* _collection;
+            const HeapRecordStore* _store;
+            bool _forward;
+
+            // slot of the result returned by the next getNext(), -1 at EOF
+            int _curr;
+        };
+
+    }
+
+    HeapRecordStore::HeapRecordStore( const StringData& ns, NamespaceDetails* details )
+        : RecordStore( ns ),
+          _details( details ),
+          _fileNumber( -1 ) {
+
+        SimpleMutex::scoped_lock lk( heapStoresMutex );
+        for ( int i = 0; i < MaxStores; i++ ) {
+            if ( !heapStores[i] ) {
+                heapStores[i] = this;
+                _fileNumber = FirstFileNumber + i;
+                break;
+            }
+        }
+        massert( 17351, "too many in memory collections", _fileNumber >= 0 );
+    }
+
+    HeapRecordStore::~HeapRecordStore() {
+        for ( size_t i = 0; i < _records.size(); i++ )
+            free( _records[i] );
+
+        SimpleMutex::scoped_lock lk( heapStoresMutex );
+        heapStores[_fileNumber - FirstFileNumber] = NULL;
+    }
+
+    Record* HeapRecordStore::recordForHeapLoc( const DiskLoc& loc ) {
+        HeapRecordStore* store = heapStores[loc.a() - FirstFileNumber];
+        verify( store );
+        return store->recordFor( loc );
+    }
+
+    Record* HeapRecordStore::recordFor( const DiskLoc& loc ) const {
+        dassert( loc.a() == _fileNumber );
+        Record* r = _records[slotFor( loc )];
+        verify( r );
+        return r;
+    }
+
+    int HeapRecordStore::nextSlot( int slot, bool forward ) const {
+        const int n = _records.size();
+        if ( forward ) {
+            for ( ; slot < n; slot++ ) {
+                if ( _records[slot] )
+                    return slot;
+            }
+        }
+        else {
+            for ( slot = std::min( slot, n - 1 ); slot >= 0; slot-- ) {
+                if ( _records[slot] )
+                    return slot;
+            }
+        }
+        return -1;
+    }
+
+    StatusWith<DiskLoc> HeapRecordStore::allocRecord( int lengthWithHeaders ) {
+        Record* r = static_cast<Record*>( malloc( lengthWithHeaders ) );
+        if ( !r )
+            return StatusWith<DiskLoc>( ErrorCodes::InternalError, "cannot allocate space" );
+
+        r->lengthWithHeaders() = lengthWithHeaders;
+        r->extentOfs() = DiskLoc::NullOfs;
+        r->nextOfs() = DiskLoc::NullOfs;
+        r->prevOfs() = DiskLoc::NullOfs;
+
+        int slot;
+        if ( _freeSlots.empty() ) {
+            slot = _records.size();
+            _records.push_back( r );
+        }
+        else {
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+            _records[slot] = r;
+        }
+
+        _details->incrementStats( r->netLength(), 1 );
+
+        return StatusWith<DiskLoc>( locForSlot( slot ) );
+    }
+
+    StatusWith<DiskLoc> HeapRecordStore::insertRecord( const DocWriter* doc, int quotaMax ) {
+        int lenWHdr = doc->documentSize() + Record::HeaderSize;
+        if ( doc->addPadding() )
+            lenWHdr = _details->getRecordAllocationSize( lenWHdr );
+
+        StatusWith<DiskLoc> loc = allocRecord( lenWHdr );
+        if ( loc.isOK() )
+            doc->writeDocument( recordFor( loc.getValue() )->data() );
+        return loc;
+    }
+
+    StatusWith<DiskLoc> HeapRecordStore::insertRecord( const char* data, int len, int quotaMax ) {
+        int lenWHdr = _details->getRecordAllocationSize( len + Record::HeaderSize );
+        fassert( 17352, lenWHdr >= ( len + Record::HeaderSize ) );
+
+        StatusWith<DiskLoc> loc = allocRecord( lenWHdr );
+        if ( loc.isOK() )
+            memcpy( recordFor( loc.getValue() )->data(), data, len );
+        return loc;
+    }
+
+    void HeapRecordStore::deleteRecord( const DiskLoc& dl ) {
+        int slot = slotFor( dl );
+        Record* r = recordFor( dl );
+
+        _details->incrementStats( -1 * r->netLength(), -1 );
+
+        free( r );
+        _records[slot] = NULL;
+        _freeSlots.push_back( slot );
+    }
+
+    void HeapRecordStore::updateRecord( const DiskLoc& loc, const char* data, int len ) {
+        memcpy( recordFor( loc )->data(), data, len );
+    }
+
+    void HeapRecordStore::updateWithDamages( const DiskLoc& loc,
+                                             const char* damageSource,
+                                             const mutablebson::DamageVector& damages ) {
+        char* root = recordFor( loc )->data();
+
+        mutablebson::DamageVector::const_iterator where = damages.begin();
+        const mutablebson::DamageVector::const_iterator end = damages.end();
+        for( ; where != end; ++where ) {
+            std::memcpy( root + where->targetOffset,
+                         damageSource + where->sourceOffset,
+                         where->size );
+        }
+    }
+
+    CollectionIterator* HeapRecordStore::getIterator( const Collection* collection,
+                                                      const DiskLoc& start,
+                                                      bool tailable,
+                                                      const CollectionScanParams::Direction& dir ) const {
+        verify( !tailable ); // capped collections aren't kept in memory
+        return new HeapIterator( collection, this, start, dir );
+    }
+
+}
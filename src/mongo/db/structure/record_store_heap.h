@@ -0,0 +1,108 @@
+// record_store_heap.h
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#pragma once
+
+#include <vector>
+
+#include "mongo/db/structure/record_store.h"
+
+namespace mongo {
+
+    /**
+     * Keeps a collection's records in memory allocated from the heap, so workloads and the
+     * query stages can be measured without mmap page faults or journaling.  Only meant for
+     * benchmarking: nothing is persisted, although the collection's indexes and
+     * NamespaceDetails are, so a database written in this mode can't be reopened.
+     *
+     * Each store takes a file number above any a data file can have and hands out
+     * DiskLoc( fileNumber, 8 * slot ), which lets DiskLoc::rec() find a heap record without
+     * knowing its collection.
+     */
+    class HeapRecordStore : public RecordStore {
+    public:
+        enum {
+            FirstFileNumber = 0x40000, // well above DiskLoc::MaxFiles, fits a DiskLoc56Bit
+            MaxStores = 0x10000
+        };
+
+        /**
+         * @param details only used to keep the collection's stats and padding up to date
+         */
+        HeapRecordStore( const StringData& ns, NamespaceDetails* details );
+        virtual ~HeapRecordStore();
+
+        virtual Record* recordFor( const DiskLoc& loc ) const;
+
+        virtual void deleteRecord( const DiskLoc& dl );
+
+        virtual StatusWith<DiskLoc> insertRecord( const char* data, int len, int quotaMax );
+
+        virtual StatusWith<DiskLoc> insertRecord( const DocWriter* doc, int quotaMax );
+
+        virtual void updateRecord( const DiskLoc& loc, const char* data, int len );
+
+        virtual void updateWithDamages( const DiskLoc& loc,
+                                        const char* damageSource,
+                                        const mutablebson::DamageVector& damages );
+
+        virtual CollectionIterator* getIterator( const Collection* collection,
+                                                 const DiskLoc& start,
+                                                 bool tailable,
+                                                 const CollectionScanParams::Direction& dir ) const;
+
+        virtual bool usesExtents() const { return false; }
+
+        /**
+         * @return the first occupied slot at or after slot when forward, else at or before
+         *     it, or -1 if there is none
+         */
+        int nextSlot( int slot, bool forward ) const;
+
+        DiskLoc locForSlot( int slot ) const { return DiskLoc( _fileNumber, slot * 8 ); }
+        static int slotFor( const DiskLoc& loc ) { return loc.getOfs() / 8; }
+
+        static bool isHeapLoc( const DiskLoc& loc ) {
+            return loc.a() >= FirstFileNumber && loc.a() < FirstFileNumber + MaxStores;
+        }
+
+        /** finds the record for a DiskLoc from any heap store */
+        static Record* recordForHeapLoc( const DiskLoc& loc );
+
+    private:
+        StatusWith<DiskLoc> allocRecord( int lengthWithHeaders );
+
+        NamespaceDetails* _details;
+        int _fileNumber;
+        std::vector<Record*> _records; // by slot, NULL if free
+        std::vector<int> _freeSlots;
+    };
+
+}
@@ -0,0 +1,182 @@
+// btreeprefixtests.cpp : prefix compressed v:2 btree index tests
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/namespace_string.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace BtreePrefixTests {
+
+    static const char* const _ns = "unittests.btreeprefix";
+    static const char* const _ns1 = "unittests.btreeprefixv1";
+
+    class Base {
+    public:
+        Base() {
+            _client.dropCollection( _ns );
+            _client.dropCollection( _ns1 );
+        }
+
+        virtual ~Base() {
+            _client.dropCollection( _ns );
+            _client.dropCollection( _ns1 );
+        }
+
+    protected:
+        static BSONObj keyPattern() { return BSON( "tenant" << 1 << "path" << 1 ); }
+
+        static string tenant( int t ) {
+            return str::stream() << "tenant-0000-0000-0000-" << t;
+        }
+
+        /** documents whose tenant and path share long prefixes, as in a multi tenant store */
+        static BSONObj doc( int i ) {
+            string path = str::stream() << "/var/data/projects/shared/" << i;
+            return BSON( "_id" << i << "tenant" << tenant( i % 10 ) << "path" << path );
+        }
+
+        void ensureIndex( const char* ns, int v, bool unique = false ) {
+            _client.ensureIndex( ns, keyPattern(), unique, "", false, false, v );
+            ASSERT_EQUALS( "", _client.getLastError() );
+        }
+
+        void insert( const char* ns, int begin, int end ) {
+            for ( int i = begin; i < end; i++ )
+                _client.insert( ns, doc( i ) );
+        }
+
+        void assertValid( const char* ns ) {
+            BSONObj info;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "validate" << nsToCollectionSubstring( ns ) <<
+                                              "full" << true ),
+                                        info ) );
+            ASSERT( info["valid"].trueValue() );
+        }
+
+        /**
+         * Scans the index for one tenant, checking the keys come back in order.
+         * @return the _ids found
+         */
+        set<int> scanTenant( const char* ns, int t ) {
+            set<int> ids;
+            auto_ptr<DBClientCursor> c =
+                _client.query( ns, Query( BSON( "tenant" << tenant( t ) ) ).hint( keyPattern() ) );
+            string last;
+            while ( c->more() ) {
+                BSONObj o = c->next();
+                string path = o["path"].String();
+                ASSERT( last < path );
+                last = path;
+                ids.insert( o["_id"].numberInt() );
+            }
+            return ids;
+        }
+
+        long long indexSize( const char* ns ) {
+            BSONObj info;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "collStats" << nsToCollectionSubstring( ns ) ),
+                                        info ) );
+            return info["indexSizes"]["tenant_1_path_1"].numberLong();
+        }
+
+        DBDirectClient _client;
+    };
+
+    /** inserts split buckets, removes merge them */
+    class InsertAndRemove : public Base {
+    public:
+        void run() {
+            ensureIndex( _ns, 2 );
+            insert( _ns, 0, 10000 );
+            assertValid( _ns );
+            ASSERT_EQUALS( 1000U, scanTenant( _ns, 3 ).size() );
+
+            _client.remove( _ns, BSON( "_id" << GTE << 2000 << LT << 9000 ) );
+            assertValid( _ns );
+
+            set<int> ids = scanTenant( _ns, 3 );
+            ASSERT_EQUALS( 300U, ids.size() );
+            for ( set<int>::const_iterator i = ids.begin(); i != ids.end(); ++i ) {
+                ASSERT_EQUALS( 3, *i % 10 );
+                ASSERT( *i < 2000 || *i >= 9000 );
+            }
+        }
+    };
+
+    /** the bottom up build of an index on existing documents */
+    class BuildExisting : public Base {
+    public:
+        void run() {
+            insert( _ns, 0, 10000 );
+            ensureIndex( _ns, 2 );
+            assertValid( _ns );
+            ASSERT_EQUALS( 1000U, scanTenant( _ns, 7 ).size() );
+        }
+    };
+
+    class Unique : public Base {
+    public:
+        void run() {
+            ensureIndex( _ns, 2, true );
+            insert( _ns, 0, 5000 );
+            BSONObj dup = doc( 1234 );
+            _client.insert( _ns, BSON( "_id" << -1 << "tenant" << dup["tenant"] <<
+                                       "path" << dup["path"] ) );
+            ASSERT( !_client.getLastError().empty() );
+            ASSERT_EQUALS( 5000U, _client.count( _ns ) );
+        }
+    };
+
+    class SmallerThanV1 : public Base {
+    public:
+        void run() {
+            ensureIndex( _ns, 2 );
+            ensureIndex( _ns1, 1 );
+            insert( _ns, 0, 20000 );
+            insert( _ns1, 0, 20000 );
+            ASSERT_LESS_THAN( indexSize( _ns ), indexSize( _ns1 ) );
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "btreeprefix" ) {
+        }
+        void setupTests() {
+            add<InsertAndRemove>();
+            add<BuildExisting>();
+            add<Unique>();
+            add<SmallerThanV1>();
+        }
+    } all;
+}
@@ -70,6 +70,9 @@ namespace mongo {
 
         options->addOptionChaining("nodur", "nodur", moe::Switch, "disable journaling");
 
+        options->addOptionChaining("heapRecordStore", "heapRecordStore", moe::Switch,
+                "keep documents of user collections in memory");
+
         options->addOptionChaining("seed", "seed", moe::UnsignedLongLong, "random number seed");
 
         options->addOptionChaining("runs", "runs", moe::Int, "number of times to run each test");
@@ -145,6 +148,10 @@ namespace mongo {
             storageGlobalParams.dur = true;
         }
 
+        if( params.count("heapRecordStore") ) {
+            storageGlobalParams.heapRecordStore = true;
+        }
+
         if( params.count("nopreallocj") ) {
             storageGlobalParams.preallocj = false;
         }
@@ -35,12 +35,17 @@
 #include "mongo/db/index/index_descriptor.h"
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/sort_phase_one.h"
+#include "mongo/db/storage_options.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/structure/collection_iterator.h"
 #include "mongo/platform/cstdint.h"
 
 #include "mongo/dbtests/dbtests.h"
 
+namespace mongo {
+    extern int indexBuildThreads;
+}
+
 namespace IndexUpdateTests {
 
     static const char* const _ns = "unittests.indexupdate";
@@ -338,6 +343,86 @@ namespace IndexUpdateTests {
         }
     };
 
+    /** A multikey index built with several key generating threads has every key. */
+    class ParallelBuildIndex : public IndexBuildBase {
+    public:
+        ParallelBuildIndex() : _threadsOld( indexBuildThreads ) {
+            indexBuildThreads = 4;
+        }
+        ~ParallelBuildIndex() {
+            indexBuildThreads = _threadsOld;
+        }
+        void run() {
+            Database* db = _ctx.ctx().db();
+            db->dropCollection( _ns );
+            Collection* coll = db->createCollection( _ns );
+            coll->getIndexCatalog()->dropAllIndexes( true );
+            // Enough documents for the collection to span several extents.
+            int32_t nDocs = 5000;
+            string s( 300, 'x' );
+            for( int32_t i = 0; i < nDocs; ++i ) {
+                coll->insertDocument( BSON( "a" << BSON_ARRAY( i << i + nDocs ) << "s" << s ),
+                                      true );
+            }
+            int nExtents;
+            coll->storageSize( &nExtents );
+            ASSERT( nExtents > 1 );
+
+            BSONObj indexInfo = BSON( "key" << BSON( "a" << 1 ) << "ns" << _ns << "name" << "a_1" );
+            ASSERT_OK( coll->getIndexCatalog()->createIndex( indexInfo, true ) );
+
+            IndexDescriptor* desc = coll->getIndexCatalog()->findIndexByName( "a_1" );
+            ASSERT( desc );
+            ASSERT( coll->getIndexCatalog()->isMultikey( desc ) );
+            int64_t numKeys;
+            ASSERT_OK( coll->getIndexCatalog()->getIndex( desc )->validate( &numKeys ) );
+            ASSERT_EQUALS( 2 * nDocs, numKeys );
+            BSONObj query = BSON( "a" << BSON( "$elemMatch" << BSON( "$gte" << 100 <<
+                                                                     "$lt" << 200 ) ) );
+            ASSERT_EQUALS( 100U, _client.count( _ns, query ) );
+        }
+    private:
+        int _threadsOld;
+    };
+
+    /** Documents of a heap record store collection are indexed even with several threads. */
+    class ParallelBuildIndexHeapRecordStore : public IndexBuildBase {
+    public:
+        ParallelBuildIndexHeapRecordStore() :
+            _threadsOld( indexBuildThreads ),
+            _heapOld( storageGlobalParams.heapRecordStore ) {
+            indexBuildThreads = 4;
+            storageGlobalParams.heapRecordStore = true;
+        }
+        ~ParallelBuildIndexHeapRecordStore() {
+            indexBuildThreads = _threadsOld;
+            storageGlobalParams.heapRecordStore = _heapOld;
+        }
+        void run() {
+            Database* db = _ctx.ctx().db();
+            db->dropCollection( _ns );
+            Collection* coll = db->createCollection( _ns );
+            coll->getIndexCatalog()->dropAllIndexes( true );
+            ASSERT( !coll->documentsAreExtentRecords() );
+            int32_t nDocs = 1000;
+            for( int32_t i = 0; i < nDocs; ++i ) {
+                coll->insertDocument( BSON( "a" << i ), true );
+            }
+
+            BSONObj indexInfo = BSON( "key" << BSON( "a" << 1 ) << "ns" << _ns << "name" << "a_1" );
+            ASSERT_OK( coll->getIndexCatalog()->createIndex( indexInfo, true ) );
+
+            IndexDescriptor* desc = coll->getIndexCatalog()->findIndexByName( "a_1" );
+            ASSERT( desc );
+            int64_t numKeys;
+            ASSERT_OK( coll->getIndexCatalog()->getIndex( desc )->validate( &numKeys ) );
+            ASSERT_EQUALS( nDocs, numKeys );
+        }
+    private:
+        int _threadsOld;
+        bool _heapOld;
+    };
+
     /** Index creation is not killed if mayInterrupt is false. */
     class InsertBuildIndexInterruptDisallowed : public IndexBuildBase {
     public:
@@ -705,6 +790,8 @@ namespace IndexUpdateTests {
             //add<InterruptBuildBottomUp>( true );
             add<InsertBuildIndexInterrupt>();
             add<InsertBuildIndexInterruptDisallowed>();
+            add<ParallelBuildIndex>();
+            add<ParallelBuildIndexHeapRecordStore>();
             add<InsertBuildIdIndexInterrupt>();
             add<InsertBuildIdIndexInterruptDisallowed>();
             add<DirectClientEnsureIndexInterruptDisallowed>();
@@ -31,11 +31,27 @@
 #include "mongo/pch.h"
 
 #include <boost/filesystem/operations.hpp>
+#include <fstream>
 
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/dur_journalformat.h"
+#include "mongo/db/dur_recover.h"
+#include "mongo/db/instance.h"
 #include "mongo/db/storage/durable_mapped_file.h"
+#include "mongo/db/structure/collection_iterator.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/compress.h"
 #include "mongo/util/timer.h"
 #include "mongo/dbtests/dbtests.h"
 
+namespace mongo {
+    namespace dur {
+        extern int journalRecoveryThreads;
+    }
+    extern int collectionScanReadAheadKB;
+}
+
 namespace MMapTests {
 
     class LeakTest  {
@@ -118,11 +134,192 @@ namespace MMapTests {
         }
     };
 
+    /** replays a large synthetic journal of random writes to a few data files, serially and then
+        with the parallel recovery, checking the files end up as the journal says and logging the
+        time each took.
+    */
+    class JournalRecoveryTest {
+        enum { NFiles = 4, FileLen = 16 * 1024 * 1024, NSections = 200, WritesPerSection = 2000 };
+        const boost::filesystem::path dir;
+        const int optOld;
+        const int threadsOld;
+        unsigned long long journalBytes;
+        vector<string> expected; // contents of each data file after recovery
+
+        static string dataFile(int fileNo) {
+            string name = str::stream() << "recoverytest." << fileNo;
+            return (boost::filesystem::path(storageGlobalParams.dbpath) / name).string();
+        }
+
+        void createDataFiles() {
+            for( int i = 0; i < NFiles; i++ ) {
+                try { boost::filesystem::remove(dataFile(i)); }
+                catch(...) { }
+                DurableMappedFile f;
+                unsigned long long len = FileLen;
+                verify( f.create(dataFile(i), len, /*sequential*/false) );
+            }
+        }
+
+        template<class T> static void append(string& b, const T& t) {
+            b.append((const char *) &t, sizeof(t));
+        }
+
+        /** @return the path of a journal file with NSections group commits */
+        string writeJournal() {
+            string fn = (dir / "j._0").string();
+            dur::JHeader jh(fn);
+            string journal;
+            append(journal, jh);
+
+            PseudoRandom r(17);
+            for( int s = 0; s < NSections; s++ ) {
+                string u;
+                dur::JDbContext c;
+                append(u, c);
+                u.append("recoverytest", strlen("recoverytest") + 1);
+                for( int w = 0; w < WritesPerSection; w++ ) {
+                    int fileNo = r.nextInt32() & (NFiles - 1);
+                    dur::JEntry e;
+                    e.len = 64 + (r.nextInt32() & 127);
+                    // some writes land on the same spots, so the order they are applied in matters
+                    e.ofs = (r.nextInt32() & (FileLen / 4 - 1)) & ~63;
+                    e.setFileNo(fileNo);
+                    append(u, e);
+                    for( unsigned i = 0; i < e.len; i++ ) {
+                        char ch = 'a' + (s + w + i) % 26;
+                        u.push_back(ch);
+                        expected[fileNo][e.ofs + i] = ch;
+                    }
+                }
+
+                string compressed;
+                compress(u.data(), u.size(), &compressed);
+                size_t start = journal.size();
+                dur::JSectHeader h;
+                h.setSectionLen(sizeof(dur::JSectHeader) + compressed.size() + sizeof(dur::JSectFooter));
+                h.seqNumber = s;
+                h.fileId = jh.fileId;
+                append(journal, h);
+                journal += compressed;
+                dur::JSectFooter f(journal.data() + start, journal.size() - start);
+                append(journal, f);
+                journal.resize((journal.size() + dur::Alignment - 1) & ~(dur::Alignment - 1), '\0');
+            }
+
+            std::ofstream out(fn.c_str(), std::ios::binary);
+            out.write(journal.data(), journal.size());
+            ASSERT( out.good() );
+            journalBytes = journal.size();
+            return fn;
+        }
+
+        /** @return milliseconds to recover */
+        int recover(const vector<boost::filesystem::path>& files, int threads) {
+            createDataFiles();
+            dur::journalRecoveryThreads = threads;
+            dur::RecoveryJob rj;
+            Timer t;
+            rj.applyFiles(files);
+            int ms = t.millis();
+
+            for( int i = 0; i < NFiles; i++ ) {
+                DurableMappedFile f;
+                verify( f.open(dataFile(i), false) );
+                ASSERT( memcmp(f.getView(), expected[i].data(), FileLen) == 0 );
+            }
+            return ms;
+        }
+
+    public:
+        JournalRecoveryTest() :
+            dir(boost::filesystem::path(storageGlobalParams.dbpath) / "recoverytest_journal"),
+            optOld(storageGlobalParams.durOptions),
+            threadsOld(dur::journalRecoveryThreads),
+            expected(NFiles, string(FileLen, '\0')) {
+            storageGlobalParams.durOptions = 0;
+        }
+        ~JournalRecoveryTest() {
+            storageGlobalParams.durOptions = optOld;
+            dur::journalRecoveryThreads = threadsOld;
+            try {
+                for( int i = 0; i < NFiles; i++ )
+                    boost::filesystem::remove(dataFile(i));
+                boost::filesystem::remove_all(dir);
+            }
+            catch(...) { }
+        }
+        void run() {
+            Lock::GlobalWrite lk;
+
+            boost::filesystem::create_directory(dir);
+            vector<boost::filesystem::path> files;
+            files.push_back(writeJournal());
+
+            int serialMs = recover(files, 1);
+            int parallelMs = recover(files, 0);
+            mongo::unittest::log() << "journal recovery of " << journalBytes / (1024 * 1024) << "MB: serial " <<
+                serialMs << "ms, parallel " << parallelMs << "ms" << endl;
+        }
+    };
+
+    /** scans a collection spread over many small extents with FlatIterator, with read ahead
+        off, with a window smaller than an extent, with one that runs into following extents and
+        with the largest the parameter takes, and checks every scan returns the documents in order
+        in both directions.
+    */
+    class ScanReadAheadTest {
+        static const char* ns() { return "unittests.mmaptests_readahead"; }
+        static const int N = 2000;
+        const int readAheadOld;
+        DBDirectClient client;
+
+        void scan(Collection* collection, CollectionScanParams::Direction dir) {
+            scoped_ptr<CollectionIterator> it( collection->getIterator(DiskLoc(), false, dir) );
+            int expected = CollectionScanParams::FORWARD == dir ? 0 : N - 1;
+            while( !it->isEOF() ) {
+                ASSERT_EQUALS( expected, it->getNext().obj()["_id"].numberInt() );
+                expected += CollectionScanParams::FORWARD == dir ? 1 : -1;
+            }
+            ASSERT_EQUALS( CollectionScanParams::FORWARD == dir ? N : -1, expected );
+        }
+
+    public:
+        ScanReadAheadTest() : readAheadOld(collectionScanReadAheadKB) { }
+        ~ScanReadAheadTest() {
+            collectionScanReadAheadKB = readAheadOld;
+            Client::WriteContext ctx(ns());
+            client.dropCollection(ns());
+        }
+        void run() {
+            Client::WriteContext ctx(ns());
+            client.createCollection(ns(), 16 * 1024);
+            string pad(100, 'x');
+            for( int i = 0; i < N; i++ )
+                client.insert(ns(), BSON("_id" << i << "pad" << pad));
+
+            Collection* collection = ctx.ctx().db()->getCollection(ns());
+            int numExtents = 0;
+            collection->storageSize(&numExtents);
+            ASSERT( numExtents > 2 );
+
+            // the last is far more bytes than an int holds
+            const int windowsKB[] = { 0, 4, 64, std::numeric_limits<int>::max() };
+            for( size_t i = 0; i < sizeof(windowsKB) / sizeof(windowsKB[0]); i++ ) {
+                collectionScanReadAheadKB = windowsKB[i];
+                scan(collection, CollectionScanParams::FORWARD);
+                scan(collection, CollectionScanParams::BACKWARD);
+            }
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "mmap" ) {}
         void setupTests() {
             add< LeakTest >();
+            add< JournalRecoveryTest >();
+            add< ScanReadAheadTest >();
         }
     } myall;
 
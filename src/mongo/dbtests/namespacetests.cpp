@@ -1106,6 +1106,17 @@ namespace NamespaceTests {
                 return DiskLoc();
             }
 
+            int nDeletedRecords() const {
+                int count = 0;
+                for( int i = 0; i < Buckets; ++i ) {
+                    for( DiskLoc dl = nsd()->deletedListEntry( i ); !dl.isNull();
+                         dl = dl.drec()->nextDeleted() ) {
+                        ++count;
+                    }
+                }
+                return count;
+            }
+
             /**
              * 'cook' the deletedList by shrinking the smallest deleted record to size
              * 'newDeletedRecordSize'.
@@ -1570,6 +1581,65 @@ namespace NamespaceTests {
             virtual string spec() const { return ""; }
         };
 
+        /** coalesceDeletedRecords() merges deleted records next to each other in an extent. */
+        class CoalesceAdjacentDeletedRecords : public Base {
+        public:
+            void run() {
+                create();
+                DiskLoc initial = smallestDeletedRecord();
+                int initialLength = initial.drec()->lengthWithHeaders();
+
+                // Carve three records off the front of the extent's free space, then free them.
+                DiskLoc carved[ 3 ];
+                for( int i = 0; i < 3; ++i ) {
+                    carved[ i ] = nsd()->alloc( ns(), 320 );
+                }
+                for( int i = 0; i < 3; ++i ) {
+                    nsd()->addDeletedRec( carved[ i ].drec(), carved[ i ] );
+                }
+                ASSERT_EQUALS( 4, nDeletedRecords() );
+
+                ASSERT( nsd()->coalesceDeletedRecords() );
+                ASSERT_EQUALS( 1, nDeletedRecords() );
+                ASSERT_EQUALS( initial, smallestDeletedRecord() );
+                ASSERT_EQUALS( initialLength, initial.drec()->lengthWithHeaders() );
+
+                // Nothing is left to merge.
+                ASSERT( !nsd()->coalesceDeletedRecords() );
+            }
+            virtual string spec() const { return ""; }
+        };
+
+        /**
+         * A record which only fits in the merged space of freed records is allocated there rather
+         * than in a new extent.
+         */
+        class AllocCoalescesBeforeNewExtent : public Base {
+        public:
+            void run() {
+                create();
+                ASSERT_EQUALS( 1, nExtents() );
+
+                vector<DiskLoc> locs;
+                string s( 900, 'a' );
+                for( int i = 0; i < 8; ++i ) {
+                    StatusWith<DiskLoc> loc =
+                            collection()->insertDocument( BSON( "_id" << i << "s" << s ), false );
+                    ASSERT( loc.isOK() );
+                    locs.push_back( loc.getValue() );
+                }
+                for( int i = 0; i < 8; ++i ) {
+                    collection()->deleteDocument( locs[ i ] );
+                }
+
+                string big( 12 * 1024, 'b' );
+                ASSERT( collection()->insertDocument( BSON( "_id" << 8 << "s" << big ),
+                                                      false ).isOK() );
+                ASSERT_EQUALS( 1, nExtents() );
+            }
+            virtual string spec() const { return "{\"size\":16384,\"$nExtents\":1}"; }
+        };
+
         /* test  NamespaceDetails::cappedTruncateAfter(const char *ns, DiskLoc loc)
         */
         class TruncateCapped : public Base {
@@ -1809,6 +1879,8 @@ namespace NamespaceTests {
             add< NamespaceDetailsTests::AllocQuantizedWithoutExtra >();
             add< NamespaceDetailsTests::AllocNotQuantizedNearDeletedSize >();
             add< NamespaceDetailsTests::AllocFailsWithTooSmallDeletedRecord >();
+            add< NamespaceDetailsTests::CoalesceAdjacentDeletedRecords >();
+            add< NamespaceDetailsTests::AllocCoalescesBeforeNewExtent >();
             add< NamespaceDetailsTests::TwoExtent >();
             add< NamespaceDetailsTests::TruncateCapped >();
             add< NamespaceDetailsTests::Migrate >();
@@ -42,6 +42,10 @@
 
 #include "mongo/db/db.h"
 #include "mongo/db/dur_stats.h"
+#include "mongo/db/exec/and_bitmap.h"
+#include "mongo/db/exec/and_hash.h"
+#include "mongo/db/exec/fetch.h"
+#include "mongo/db/exec/index_scan.h"
 #include "mongo/db/instance.h"
 #include "mongo/db/json.h"
 #include "mongo/db/structure/btree/key.h"
@@ -61,6 +65,11 @@
 #include <mutex>
 #endif
 
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 using namespace bson;
 
 namespace PerfTests {
@@ -1137,6 +1146,319 @@ namespace PerfTests {
         }
     };
 
+    /** full collection scans of text heavy documents, with or without a compressed collection */
+    template <bool compressed>
+    class ScanText : public B {
+    public:
+        virtual string name() { return compressed ? "scan-text-compressed" : "scan-text"; }
+        virtual unsigned batchSize() { return 1; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            static const char* const words[] = { "the", "quick", "brown", "fox", "jumps", "over",
+                                                 "lazy", "dog", "storage", "engine", "block",
+                                                 "record", "extent", "journal", "index", "query" };
+            const int nWords = sizeof(words) / sizeof(words[0]);
+
+            BSONObj info;
+            string coll = nsToCollectionSubstring(ns()).toString();
+            ASSERT( client().runCommand("perftest",
+                                        BSON("create" << coll << "compressed" << compressed),
+                                        info) );
+
+            for( int i = 0; i < 20000; i++ ) {
+                StringBuilder text;
+                for( int j = 0; j < 150; j++ )
+                    text << words[rand() % nWords] << ' ';
+                client().insert( ns(), BSON("_id" << i << "text" << text.str()) );
+            }
+        }
+        void timed() {
+            // nothing matches so every document is read
+            client().count( ns(), BSON("missing" << 1) );
+        }
+        void post() {
+            BSONObj info;
+            client().runCommand("perftest", BSON("collStats" << nsToCollectionSubstring(ns())), info);
+            cout << name() << " dataSize " << info["size"].numberLong()
+                 << " storageSize " << info["storageSize"].numberLong() << endl;
+        }
+    };
+
+    /**
+     * point lookups on a compound index whose keys share long leading fields, with the index
+     * stored as v:1 or prefix compressed v:2
+     */
+    template <int v>
+    class TenantPathIndex : public B {
+    public:
+        virtual string name() { return v == 2 ? "tenant-path-index-v2" : "tenant-path-index-v1"; }
+        virtual unsigned batchSize() { return 100; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            client().ensureIndex( ns(), BSON("tenant" << 1 << "path" << 1), false, "", true, false, v );
+            for( int i = 0; i < 100000; i++ ) {
+                client().insert( ns(), BSON("tenant" << tenant(i % 20) << "path" << path(i)) );
+            }
+        }
+        void timed() {
+            int i = rand() % 100000;
+            client().findOne( ns(), BSON("tenant" << tenant(i % 20) << "path" << path(i)) );
+        }
+        void post() {
+            BSONObj info;
+            client().runCommand("perftest", BSON("collStats" << nsToCollectionSubstring(ns())), info);
+            cout << name() << " indexSize " << info["indexSizes"]["tenant_1_path_1"].numberLong() << endl;
+        }
+    private:
+        static string tenant( int t ) {
+            return str::stream() << "tenant-0000-0000-0000-" << t;
+        }
+        static string path( int i ) {
+            return str::stream() << "/var/data/projects/shared/assets/" << i;
+        }
+    };
+
+    /**
+     * unindexed sorts of ten times as much data as the sort memory budget, which spill sorted
+     * runs to disk and merge them
+     */
+    class SortSpill : public B {
+    public:
+        virtual string name() { return "sort-spill"; }
+        virtual unsigned batchSize() { return 1; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            setSortParameters( true, kBudget );
+
+            string pad( 500, 'x' );
+            for( int i = 0; i < 10 * kBudget / 512; i++ ) {
+                client().insert( ns(), BSON("x" << rand() << "pad" << pad) );
+            }
+        }
+        void timed() {
+            auto_ptr<DBClientCursor> c = client().query( ns(), Query().sort(BSON("x" << 1)) );
+            ASSERT_EQUALS( 10 * kBudget / 512, c->itcount() );
+        }
+        void post() {
+            setSortParameters( false, 32 * 1024 * 1024 );
+        }
+    private:
+        static const int kBudget = 1024 * 1024;
+
+        void setSortParameters( bool allowDiskUse, int maxBytes ) {
+            BSONObj info;
+            ASSERT( client().runCommand("admin",
+                                        BSON("setParameter" << 1 <<
+                                             "internalQueryExecSortAllowDiskUse" << allowDiskUse <<
+                                             "internalQueryExecSortMaxBytes" << maxBytes),
+                                        info) );
+        }
+    };
+
+    // Counts matches of a selective predicate with no index, scanning on THREADS threads.
+    // Compare the timings across thread counts to see how the scan scales with cores.
+    template <int THREADS>
+    class ParallelScan : public B {
+    public:
+        virtual string name() { return str::stream() << "parallel-scan-" << THREADS; }
+        virtual unsigned batchSize() { return 1; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            setThreads( THREADS );
+
+            string pad( 200, 'x' );
+            for( int i = 0; i < kDocs; i++ ) {
+                client().insert( ns(), BSON("x" << i << "y" << i % 1000 << "pad" << pad) );
+            }
+        }
+        void timed() {
+            ASSERT_EQUALS( static_cast<unsigned long long>(kDocs / 1000),
+                           client().count( ns(), BSON("y" << 7) ) );
+        }
+        void post() {
+            setThreads( 1 );
+        }
+    private:
+        static const int kDocs = 200 * 1000;
+
+        void setThreads( int threads ) {
+            BSONObj info;
+            ASSERT( client().runCommand("admin",
+                                        BSON("setParameter" << 1 <<
+                                             "internalQueryExecCollectionScanThreads" << threads),
+                                        info) );
+        }
+    };
+
+#if defined(__linux__)
+    // Counts a collection with no index after its files have been closed and dropped from the
+    // page cache, reading ahead of the scan by READ_AHEAD_KB.  Compare with 0 to see what read
+    // ahead saves a cold scan.
+    template <int READ_AHEAD_KB>
+    class ColdScan : public B {
+    public:
+        virtual string name() { return str::stream() << "cold-scan-readahead-" << READ_AHEAD_KB; }
+        virtual int howLongMillis() { return 0; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            setReadAhead( READ_AHEAD_KB );
+
+            string pad( 1000, 'x' );
+            for( int i = 0; i < kDocs; i++ ) {
+                client().insert( ns(), BSON("x" << i << "pad" << pad) );
+            }
+            client().getLastError();
+
+            // mapped pages stay cached, so unmap the files before dropping them
+            BSONObj info;
+            ASSERT( client().runCommand("admin", BSON("closeAllDatabases" << 1), info) );
+            evict();
+        }
+        void timed() {
+            ASSERT_EQUALS( 0U, client().count( ns(), BSON("missing" << 1) ) );
+        }
+        void post() {
+            setReadAhead( 1024 );
+        }
+    private:
+        static const int kDocs = 64 * 1024;
+
+        static void evict() {
+            for ( boost::filesystem::directory_iterator i( storageGlobalParams.dbpath );
+                    i != boost::filesystem::directory_iterator();
+                    ++i ) {
+                boost::filesystem::path file( *i );
+                if( !str::startsWith(file.leaf().string(), "perftest.") )
+                    continue;
+                int fd = ::open( file.string().c_str(), O_RDONLY );
+                if( fd < 0 )
+                    continue;
+                fdatasync( fd );
+                posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+                ::close( fd );
+            }
+        }
+
+        void setReadAhead( int kb ) {
+            BSONObj info;
+            ASSERT( client().runCommand("admin",
+                                        BSON("setParameter" << 1 <<
+                                             "collectionScanReadAheadKB" << kb),
+                                        info) );
+        }
+    };
+#endif
+
+    // Runs an index scan, fetch, skip and projection plan asking for BATCH results at a time.
+    // Compare with batch size 1 to see what batching saves per document.
+    template <int BATCH>
+    class BatchedPlan : public B {
+    public:
+        virtual string name() { return str::stream() << "batched-plan-" << BATCH; }
+        virtual unsigned batchSize() { return 1; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            setBatchSize( BATCH );
+
+            client().ensureIndex( ns(), BSON("x" << 1) );
+            for( int i = 0; i < kDocs; i++ ) {
+                client().insert( ns(), BSON("x" << i << "y" << i % 1000 << "z" << "zzzzzzzz") );
+            }
+        }
+        void timed() {
+            BSONObj fields = BSON("x" << 1 << "y" << 1 << "_id" << 0);
+            auto_ptr<DBClientCursor> c = client().query( ns(),
+                                                         QUERY("x" << GTE << 0 << "y" << LT << 500),
+                                                         0, 10, &fields );
+            ASSERT_EQUALS( kDocs / 2 - 10, c->itcount() );
+        }
+        void post() {
+            setBatchSize( 1 );
+        }
+    private:
+        static const int kDocs = 100 * 1000;
+
+        void setBatchSize( int batchSize ) {
+            BSONObj info;
+            ASSERT( client().runCommand("admin",
+                                        BSON("setParameter" << 1 <<
+                                             "internalQueryExecBatchSize" << batchSize),
+                                        info) );
+        }
+    };
+
+    // Intersects two index range scans that each match half the collection, and fetches the
+    // roughly one quarter that matches both, with either a hashed or a bitmap AND.
+    template <bool BITMAP>
+    class IndexIntersection : public B {
+    public:
+        virtual string name() {
+            return str::stream() << "index-intersection-" << (BITMAP ? "bitmap" : "hash");
+        }
+        virtual unsigned batchSize() { return 1; }
+        virtual bool showDurStats() { return false; }
+        void prep() {
+            client().ensureIndex( ns(), BSON("x" << 1) );
+            client().ensureIndex( ns(), BSON("y" << 1) );
+            _expected = 0;
+            for( int i = 0; i < kDocs; i++ ) {
+                int y = (i * 7919) % kDocs;
+                client().insert( ns(), BSON("x" << i << "y" << y) );
+                if ( i < kDocs / 2 && y < kDocs / 2 ) {
+                    ++_expected;
+                }
+            }
+        }
+        void timed() {
+            Client::ReadContext ctx( ns() );
+            Collection* coll = ctx.ctx().db()->getCollection( ns() );
+            WorkingSet ws;
+
+            PlanStage* andStage;
+            if ( BITMAP ) {
+                AndBitmapStage* ab = new AndBitmapStage( &ws );
+                ab->addChild( halfScan(coll, "x", &ws) );
+                ab->addChild( halfScan(coll, "y", &ws) );
+                andStage = ab;
+            }
+            else {
+                AndHashStage* ah = new AndHashStage( &ws, NULL );
+                ah->addChild( halfScan(coll, "x", &ws) );
+                ah->addChild( halfScan(coll, "y", &ws) );
+                andStage = ah;
+            }
+            FetchStage fetch( &ws, andStage, NULL );
+
+            int count = 0;
+            while ( !fetch.isEOF() ) {
+                WorkingSetID id;
+                PlanStage::StageState status = fetch.work( &id );
+                if ( PlanStage::ADVANCED == status ) {
+                    ++count;
+                    ws.free( id );
+                }
+            }
+            ASSERT_EQUALS( _expected, count );
+        }
+    private:
+        static const int kDocs = 100 * 1000;
+
+        int _expected;
+
+        // Scans 'field' over [0, kDocs / 2).
+        PlanStage* halfScan( Collection* coll, const char* field, WorkingSet* ws ) {
+            IndexScanParams params;
+            params.descriptor =
+                coll->getIndexCatalog()->findIndexByKeyPattern( BSON(field << 1) );
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 0);
+            params.bounds.endKey = BSON("" << kDocs / 2);
+            params.bounds.endKeyInclusive = false;
+            params.direction = 1;
+            return new IndexScan( params, ws, NULL );
+        }
+    };
+
     template <typename T>
     class MoreIndexes : public T {
     public:
@@ -1431,6 +1753,24 @@ namespace PerfTests {
                 add< Update1 >();
                 add< MoreIndexes<Update1> >();
                 add< InsertBig >();
+                add< ScanText<false> >();
+                add< ScanText<true> >();
+                add< TenantPathIndex<1> >();
+                add< TenantPathIndex<2> >();
+                add< SortSpill >();
+                add< ParallelScan<1> >();
+                add< ParallelScan<2> >();
+                add< ParallelScan<4> >();
+                add< ParallelScan<8> >();
+#if defined(__linux__)
+                add< ColdScan<0> >();
+                add< ColdScan<1024> >();
+#endif
+                add< BatchedPlan<1> >();
+                add< BatchedPlan<16> >();
+                add< BatchedPlan<128> >();
+                add< IndexIntersection<false> >();
+                add< IndexIntersection<true> >();
                 add< FailPointTest<false, false> >();
                 add< FailPointTest<true, false> >();
                 add< FailPointTest<true, true> >();
@@ -35,6 +35,7 @@
 
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/catalog/database.h"
+#include "mongo/db/exec/and_bitmap.h"
 #include "mongo/db/exec/and_hash.h"
 #include "mongo/db/exec/and_sorted.h"
 #include "mongo/db/exec/index_scan.h"
@@ -766,6 +767,219 @@ namespace QueryStageAnd {
         }
     };
 
+    //
+    // Bitmap AND tests
+    //
+
+    /**
+     * Invalidate a DiskLoc held by a bitmap AND before the AND finishes evaluating.  The AND
+     * should process all other data just fine and flag the invalidated DiskLoc in the WorkingSet.
+     */
+    class QueryStageAndBitmapInvalidation : public QueryStageAndBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("foo" << i << "bar" << i));
+            }
+
+            addIndex(BSON("foo" << 1));
+            addIndex(BSON("bar" << 1));
+
+            WorkingSet ws;
+            scoped_ptr<AndBitmapStage> ab(new AndBitmapStage(&ws));
+
+            // Foo <= 20
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("foo" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 20);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = -1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            // Bar >= 10
+            params.descriptor = getIndex(BSON("bar" << 1), coll);
+            params.bounds.startKey = BSON("" << 10);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            // ab reads foo=20, foo=19, ..., foo=0 into its bitmap.  Read half of them...
+            for (int i = 0; i < 10; ++i) {
+                WorkingSetID out;
+                PlanStage::StageState status = ab->work(&out);
+                ASSERT_EQUALS(PlanStage::NEED_TIME, status);
+            }
+
+            // ...yield
+            ab->prepareToYield();
+            // ...invalidate one of the read objects
+            set<DiskLoc> data;
+            getLocs(&data, coll);
+            for (set<DiskLoc>::const_iterator it = data.begin(); it != data.end(); ++it) {
+                if (it->obj()["foo"].numberInt() == 15) {
+                    ab->invalidate(*it, INVALIDATION_DELETION);
+                    remove(it->obj());
+                    break;
+                }
+            }
+            ab->recoverFromYield();
+
+            // And expect to find foo==15 it flagged for review.
+            const unordered_set<WorkingSetID>& flagged = ws.getFlagged();
+            ASSERT_EQUALS(size_t(1), flagged.size());
+
+            // Expect to find the right value of foo in the flagged item.
+            WorkingSetMember* member = ws.get(*flagged.begin());
+            ASSERT_TRUE(NULL != member);
+            ASSERT_EQUALS(WorkingSetMember::OWNED_OBJ, member->state);
+            BSONElement elt;
+            ASSERT_TRUE(member->getFieldDotted("foo", &elt));
+            ASSERT_EQUALS(15, elt.numberInt());
+
+            // Now, finish up the AND.  Results carry only a DiskLoc and come out in DiskLoc
+            // order.  Since foo == bar, we would have 11 results, but we subtract one because of
+            // a mid-plan invalidation, so 10.
+            int count = 0;
+            DiskLoc lastLoc;
+            while (!ab->isEOF()) {
+                WorkingSetID id;
+                PlanStage::StageState status = ab->work(&id);
+                if (PlanStage::ADVANCED != status) { continue; }
+
+                ++count;
+                member = ws.get(id);
+                ASSERT_EQUALS(WorkingSetMember::LOC_AND_IDX, member->state);
+                ASSERT_TRUE(member->keyData.empty());
+                ASSERT_TRUE(lastLoc.isNull() || lastLoc < member->loc);
+                lastLoc = member->loc;
+
+                BSONObj obj = member->loc.obj();
+                ASSERT_LESS_THAN_OR_EQUALS(obj["foo"].numberInt(), 20);
+                ASSERT_NOT_EQUALS(15, obj["foo"].numberInt());
+                ASSERT_GREATER_THAN_OR_EQUALS(obj["bar"].numberInt(), 10);
+                ws.free(id);
+            }
+
+            ASSERT_EQUALS(10, count);
+        }
+    };
+
+    // A bitmap AND with three children.
+    class QueryStageAndBitmapThreeLeaf : public QueryStageAndBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("foo" << i << "bar" << i << "baz" << i));
+            }
+
+            addIndex(BSON("foo" << 1));
+            addIndex(BSON("bar" << 1));
+            addIndex(BSON("baz" << 1));
+
+            WorkingSet ws;
+            scoped_ptr<AndBitmapStage> ab(new AndBitmapStage(&ws));
+
+            // Foo <= 20
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("foo" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 20);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = -1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            // Bar >= 10
+            params.descriptor = getIndex(BSON("bar" << 1), coll);
+            params.bounds.startKey = BSON("" << 10);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            // 5 <= baz <= 15
+            params.descriptor = getIndex(BSON("baz" << 1), coll);
+            params.bounds.startKey = BSON("" << 5);
+            params.bounds.endKey = BSON("" << 15);
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            // foo == bar == baz, and foo<=20, bar>=10, 5<=baz<=15, so our values are:
+            // foo == 10, 11, 12, 13, 14, 15.
+            ASSERT_EQUALS(6, countResults(ab.get()));
+
+            scoped_ptr<PlanStageStats> stats(ab->getStats());
+            const AndBitmapStats* spec = static_cast<const AndBitmapStats*>(stats->specific.get());
+            ASSERT_EQUALS(size_t(3), spec->bitmapAfterChild.size());
+            ASSERT_EQUALS(size_t(21), spec->bitmapAfterChild[0]);
+            ASSERT_EQUALS(size_t(11), spec->bitmapAfterChild[1]);
+            ASSERT_EQUALS(size_t(6), spec->bitmapAfterChild[2]);
+        }
+    };
+
+    // A bitmap AND whose first child returns nothing doesn't read the other children.
+    class QueryStageAndBitmapWithNothing : public QueryStageAndBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            for (int i = 0; i < 50; ++i) {
+                insert(BSON("foo" << i << "bar" << 20));
+            }
+
+            addIndex(BSON("foo" << 1));
+            addIndex(BSON("bar" << 1));
+
+            WorkingSet ws;
+            scoped_ptr<AndBitmapStage> ab(new AndBitmapStage(&ws));
+
+            // Bar == 5.  Index scan should be eof.
+            IndexScanParams params;
+            params.descriptor = getIndex(BSON("bar" << 1), coll);
+            params.bounds.isSimpleRange = true;
+            params.bounds.startKey = BSON("" << 5);
+            params.bounds.endKey = BSON("" << 5);
+            params.bounds.endKeyInclusive = true;
+            params.direction = 1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            // Foo <= 20
+            params.descriptor = getIndex(BSON("foo" << 1), coll);
+            params.bounds.startKey = BSON("" << 20);
+            params.bounds.endKey = BSONObj();
+            params.bounds.endKeyInclusive = true;
+            params.direction = -1;
+            ab->addChild(new IndexScan(params, &ws, NULL));
+
+            ASSERT_EQUALS(0, countResults(ab.get()));
+
+            scoped_ptr<PlanStageStats> stats(ab->getStats());
+            ASSERT_EQUALS(size_t(0), stats->children[1]->common.advanced);
+        }
+    };
 
     class All : public Suite {
     public:
@@ -783,6 +997,9 @@ namespace QueryStageAnd {
             add<QueryStageAndSortedProducesNothing>();
             add<QueryStageAndSortedWithMatcher>();
             add<QueryStageAndSortedByLastChild>();
+            add<QueryStageAndBitmapInvalidation>();
+            add<QueryStageAndBitmapThreeLeaf>();
+            add<QueryStageAndBitmapWithNothing>();
         }
     }  queryStageAndAll;
 
@@ -31,6 +31,8 @@
  */
 
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
 #include "mongo/db/exec/collection_scan.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/instance.h"
@@ -590,6 +592,179 @@ namespace QueryStageCollectionScan {
         }
     };
 
+    //
+    // Parallel scans of a collection spread over many extents.
+    //
+
+    class QueryStageCollectionScanParallelBase {
+    public:
+        QueryStageCollectionScanParallelBase()
+            : _oldThreads(internalQueryExecCollectionScanThreads) {
+            Client::WriteContext ctx(ns());
+
+            // Small extents so the threads have several each.
+            _client.createCollection(ns(), 16 * 1024);
+            for (int i = 0; i < numObj(); ++i) {
+                _client.insert(ns(), BSON("_id" << i << "foo" << i));
+            }
+            internalQueryExecCollectionScanThreads = 4;
+        }
+
+        virtual ~QueryStageCollectionScanParallelBase() {
+            internalQueryExecCollectionScanThreads = _oldThreads;
+            Client::WriteContext ctx(ns());
+            _client.dropCollection(ns());
+        }
+
+        CollectionScan* makeScan(WorkingSet* ws, const MatchExpression* filter) {
+            CollectionScanParams params;
+            params.ns = ns();
+            params.direction = CollectionScanParams::FORWARD;
+            params.tailable = false;
+            params.parallelism = 4;
+            return new CollectionScan(params, ws, filter);
+        }
+
+        /**
+         * Runs a parallel scan with 'filterObj' and checks each document it returns is one
+         * of 'expected', and that it returns all of them exactly once.
+         */
+        void checkResults(const BSONObj& filterObj, const set<int>& expected) {
+            Client::ReadContext ctx(ns());
+
+            StatusWithMatchExpression swme = MatchExpressionParser::parse(filterObj);
+            verify(swme.isOK());
+            auto_ptr<MatchExpression> filterExpr(swme.getValue());
+
+            WorkingSet ws;
+            scoped_ptr<CollectionScan> scan(makeScan(&ws, filterExpr.get()));
+
+            set<int> seen;
+            while (!scan->isEOF()) {
+                WorkingSetID id;
+                PlanStage::StageState state = scan->work(&id);
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                if (PlanStage::ADVANCED == state) {
+                    int foo = ws.get(id)->obj["foo"].numberInt();
+                    ASSERT_EQUALS(1U, expected.count(foo));
+                    ASSERT(seen.insert(foo).second);
+                    ws.free(id);
+                }
+            }
+            ASSERT_EQUALS(expected.size(), seen.size());
+
+            scoped_ptr<PlanStageStats> stats(scan->getStats());
+            const CollectionScanStats* specific =
+                static_cast<const CollectionScanStats*>(stats->specific.get());
+            ASSERT_EQUALS(static_cast<size_t>(numObj()), specific->docsTested);
+        }
+
+        void remove(int id) {
+            _client.remove(ns(), BSON("_id" << id));
+        }
+
+        static int numObj() { return 20000; }
+
+        static const char* ns() { return "unittests.QueryStageCollectionScanParallel"; }
+
+    private:
+        int _oldThreads;
+        static DBDirectClient _client;
+    };
+
+    DBDirectClient QueryStageCollectionScanParallelBase::_client;
+
+    //
+    // Every document comes back once, in some order.
+    //
+
+    class QueryStageCollscanParallelAll : public QueryStageCollectionScanParallelBase {
+    public:
+        void run() {
+            set<int> expected;
+            for (int i = 0; i < numObj(); ++i) {
+                expected.insert(i);
+            }
+            checkResults(BSONObj(), expected);
+        }
+    };
+
+    //
+    // The threads apply the filter.
+    //
+
+    class QueryStageCollscanParallelWithMatch : public QueryStageCollectionScanParallelBase {
+    public:
+        void run() {
+            set<int> expected;
+            for (int i = 0; i < numObj(); i += 7) {
+                expected.insert(i);
+            }
+            checkResults(fromjson("{foo: {$mod: [7, 0]}}"), expected);
+        }
+    };
+
+    //
+    // Delete documents part way through a parallel scan, including ones already found by the
+    // threads and ones the threads are stopped at.  None of them should come back.
+    //
+
+    class QueryStageCollscanParallelInvalidate : public QueryStageCollectionScanParallelBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+
+            WorkingSet ws;
+            scoped_ptr<CollectionScan> scan(makeScan(&ws, NULL));
+
+            set<int> seen;
+            while (seen.size() < 10) {
+                WorkingSetID id;
+                PlanStage::StageState state = scan->work(&id);
+                if (PlanStage::ADVANCED == state) {
+                    seen.insert(ws.get(id)->obj["foo"].numberInt());
+                    ws.free(id);
+                }
+            }
+
+            // Remove every tenth document we haven't seen yet.
+            vector<DiskLoc> locs;
+            Collection* collection = ctx.ctx().db()->getCollection(ns());
+            scoped_ptr<CollectionIterator> it(
+                collection->getIterator(DiskLoc(), false, CollectionScanParams::FORWARD));
+            while (!it->isEOF()) {
+                locs.push_back(it->getNext());
+            }
+
+            set<int> removed;
+            scan->prepareToYield();
+            for (size_t i = 0; i < locs.size(); ++i) {
+                int foo = locs[i].obj()["foo"].numberInt();
+                if (0 != foo % 10 || seen.count(foo)) {
+                    continue;
+                }
+                scan->invalidate(locs[i], INVALIDATION_DELETION);
+                remove(foo);
+                removed.insert(foo);
+            }
+            scan->recoverFromYield();
+
+            while (!scan->isEOF()) {
+                WorkingSetID id;
+                PlanStage::StageState state = scan->work(&id);
+                ASSERT_NOT_EQUALS(PlanStage::FAILURE, state);
+                if (PlanStage::ADVANCED == state) {
+                    int foo = ws.get(id)->obj["foo"].numberInt();
+                    ASSERT_EQUALS(0U, removed.count(foo));
+                    ASSERT(seen.insert(foo).second);
+                    ws.free(id);
+                }
+            }
+
+            ASSERT_EQUALS(static_cast<size_t>(numObj()), seen.size() + removed.size());
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "QueryStageCollectionScan" ) {}
@@ -618,6 +793,9 @@ namespace QueryStageCollectionScan {
             add<QueryStageCollscanObjectsInOrderBackward>();
             add<QueryStageCollscanInvalidateUpcomingObject>();
             add<QueryStageCollscanInvalidateUpcomingObjectBackward>();
+            add<QueryStageCollscanParallelAll>();
+            add<QueryStageCollscanParallelWithMatch>();
+            add<QueryStageCollscanParallelInvalidate>();
         }
     } all;
 
@@ -41,6 +41,7 @@
 #include "mongo/db/json.h"
 #include "mongo/db/matcher/expression_parser.h"
 #include "mongo/db/pdfile.h"
+#include "mongo/db/query/plan_executor.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/structure/collection_iterator.h"
 #include "mongo/dbtests/dbtests.h"
@@ -291,6 +292,140 @@ namespace QueryStageFetch {
         }
     };
 
+    //
+    // Test a batch in which the first record isn't in memory.  The rest of the batch waits for
+    // it, and invalidations reach the ones waiting.
+    //
+    class FetchStageBatchNotInMemory : public QueryStageFetchBase {
+    public:
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+            WorkingSet ws;
+
+            for (int i = 0; i < 3; ++i) {
+                insert(BSON("foo" << i));
+            }
+            set<DiskLoc> locs;
+            getLocs(&locs, coll);
+            ASSERT_EQUALS(size_t(3), locs.size());
+
+            auto_ptr<MockStage> mockStage(new MockStage(&ws));
+            for (set<DiskLoc>::const_iterator it = locs.begin(); it != locs.end(); ++it) {
+                WorkingSetMember mockMember;
+                mockMember.state = WorkingSetMember::LOC_AND_IDX;
+                mockMember.loc = *it;
+                mockStage->pushBack(mockMember);
+            }
+
+            auto_ptr<FetchStage> fetchStage(new FetchStage(&ws, mockStage.release(), NULL));
+
+            FailPointRegistry* reg = getGlobalFailPointRegistry();
+            FailPoint* fetchInMemoryFail = reg->getFailPoint("fetchInMemoryFail");
+            fetchInMemoryFail->setMode(FailPoint::alwaysOn);
+
+            // The first result needs a fetch so the batch comes back empty.
+            vector<WorkingSetID> results;
+            WorkingSetID id;
+            PlanStage::StageState state = fetchStage->workBatch(10, &results, &id);
+            ASSERT_EQUALS(PlanStage::NEED_FETCH, state);
+            ASSERT_EQUALS(size_t(0), results.size());
+            ASSERT_FALSE(fetchStage->isEOF());
+            fetchInMemoryFail->setMode(FailPoint::off);
+
+            // Delete the last one while it waits.
+            fetchStage->invalidate(*locs.rbegin(), INVALIDATION_DELETION);
+
+            FailPoint* fetchInMemorySucceed = reg->getFailPoint("fetchInMemorySucceed");
+            fetchInMemorySucceed->setMode(FailPoint::alwaysOn);
+
+            // All three come back, ending with the mock stage's EOF.
+            state = fetchStage->workBatch(10, &results, &id);
+            ASSERT_EQUALS(PlanStage::IS_EOF, state);
+            ASSERT_EQUALS(size_t(3), results.size());
+            for (int i = 0; i < 3; ++i) {
+                WorkingSetMember* member = ws.get(results[i]);
+                ASSERT_EQUALS(i < 2 ? WorkingSetMember::LOC_AND_UNOWNED_OBJ
+                                    : WorkingSetMember::OWNED_OBJ,
+                              member->state);
+                ASSERT(member->hasObj());
+            }
+            ASSERT_TRUE(fetchStage->isEOF());
+
+            fetchInMemorySucceed->setMode(FailPoint::off);
+        }
+    };
+
+    //
+    // Test a batch ended by a fetch request, run by a PlanExecutor.  The fetch happens before
+    // the batch is handed out, so invalidating the fetched loc afterwards is harmless.
+    //
+    class FetchStageBatchEndsInFetch : public QueryStageFetchBase {
+    public:
+        FetchStageBatchEndsInFetch() : _batchSizeOld(internalQueryExecBatchSize) {
+            internalQueryExecBatchSize = 10;
+        }
+
+        ~FetchStageBatchEndsInFetch() {
+            internalQueryExecBatchSize = _batchSizeOld;
+        }
+
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+
+            insert(BSON("foo" << 5));
+            set<DiskLoc> locs;
+            getLocs(&locs, coll);
+            ASSERT_EQUALS(size_t(1), locs.size());
+
+            WorkingSet* ws = new WorkingSet();
+            auto_ptr<MockStage> mockStage(new MockStage(ws));
+            {
+                // Already fetched, so it goes straight into the batch...
+                WorkingSetMember mockMember;
+                mockMember.state = WorkingSetMember::OWNED_OBJ;
+                mockMember.obj = BSON("foo" << 4);
+                mockStage->pushBack(mockMember);
+
+                // ...which this one ends with a fetch request.
+                mockMember.state = WorkingSetMember::LOC_AND_IDX;
+                mockMember.loc = *locs.begin();
+                mockMember.obj = BSONObj();
+                mockStage->pushBack(mockMember);
+            }
+
+            PlanExecutor runner(ws, new FetchStage(ws, mockStage.release(), NULL));
+
+            FailPointRegistry* reg = getGlobalFailPointRegistry();
+            FailPoint* fetchInMemoryFail = reg->getFailPoint("fetchInMemoryFail");
+            fetchInMemoryFail->setMode(FailPoint::alwaysOn);
+
+            BSONObj obj;
+            ASSERT_EQUALS(Runner::RUNNER_ADVANCED, runner.getNext(&obj, NULL));
+            ASSERT_EQUALS(4, obj["foo"].numberInt());
+
+            // Delete the record whose fetch was requested.
+            runner.invalidate(*locs.begin(), INVALIDATION_DELETION);
+
+            ASSERT_EQUALS(Runner::RUNNER_ADVANCED, runner.getNext(&obj, NULL));
+            ASSERT_EQUALS(5, obj["foo"].numberInt());
+            ASSERT_EQUALS(Runner::RUNNER_EOF, runner.getNext(&obj, NULL));
+
+            fetchInMemoryFail->setMode(FailPoint::off);
+        }
+
+    private:
+        int _batchSizeOld;
+    };
 
     //
     // Test that a WSM with an obj is passed through verbatim.
@@ -433,6 +568,8 @@ namespace QueryStageFetch {
             add<FetchStageInMemory>();
             add<FetchStageAlreadyFetched>();
             add<FetchStageInvalidation>();
+            add<FetchStageBatchNotInMemory>();
+            add<FetchStageBatchEndsInFetch>();
             add<FetchStageFilter>();
         }
     }  queryStageFetchAll;
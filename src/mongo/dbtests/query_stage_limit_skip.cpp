@@ -74,6 +74,17 @@ namespace {
         return count;
     }
 
+    int countBatchResults(PlanStage* stage, size_t batchSize) {
+        int count = 0;
+        while (!stage->isEOF()) {
+            vector<WorkingSetID> results;
+            WorkingSetID id;
+            stage->workBatch(batchSize, &results, &id);
+            count += results.size();
+        }
+        return count;
+    }
+
     //
     // Insert 50 objects.  Filter/skip 0, 1, 2, ..., 100 objects and expect the right # of results.
     //
@@ -92,12 +103,33 @@ namespace {
         }
     };
 
+    //
+    // The same through workBatch(), with batches that don't divide the results evenly.
+    //
+    class QueryStageLimitSkipBatchTest {
+    public:
+        void run() {
+            for (int i = 0; i < 2 * N; ++i) {
+                for (size_t batchSize = 1; batchSize < 20; batchSize += 6) {
+                    WorkingSet ws;
+
+                    scoped_ptr<PlanStage> skip(new SkipStage(i, &ws, getMS(&ws)));
+                    ASSERT_EQUALS(max(0, N - i), countBatchResults(skip.get(), batchSize));
+
+                    scoped_ptr<PlanStage> limit(new LimitStage(i, &ws, getMS(&ws)));
+                    ASSERT_EQUALS(min(N, i), countBatchResults(limit.get(), batchSize));
+                }
+            }
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "query_stage_limit_skip" ) { }
 
         void setupTests() {
             add<QueryStageLimitSkipBasicTest>();
+            add<QueryStageLimitSkipBatchTest>();
         }
     }  queryStageLimitSkipAll;
 
@@ -30,6 +30,7 @@
 #include "mongo/db/catalog/database.h"
 #include "mongo/db/exec/fetch.h"
 #include "mongo/db/exec/mock_stage.h"
+#include "mongo/db/exec/plan_stats.h"
 #include "mongo/db/exec/plan_stage.h"
 #include "mongo/db/exec/sort.h"
 #include "mongo/db/instance.h"
@@ -119,6 +120,8 @@ namespace QueryStageSortTests {
             SortStageParams params;
             params.pattern = BSON("foo" << direction);
             params.limit = limit();
+            params.maxMemoryUsageBytes = maxMemoryUsageBytes();
+            params.extSortAllowed = extSortAllowed();
 
             // Must fetch so we can look at the doc as a BSONObj.
             PlanExecutor runner(ws, new FetchStage(ws, new SortStage(params, ws, ms), NULL));
@@ -142,6 +145,18 @@ namespace QueryStageSortTests {
             }
 
             checkCount(count);
+
+            scoped_ptr<PlanStageStats> stats(runner.getStats());
+            const SortStats* sortStats =
+                static_cast<const SortStats*>(stats->children[0]->specific.get());
+            checkSpills(sortStats->spills);
+        }
+
+        /**
+         * Check number of sorted runs written to disk.
+         */
+        virtual void checkSpills(size_t spills) {
+            ASSERT_EQUALS(0U, spills);
         }
 
         /**
@@ -164,6 +179,10 @@ namespace QueryStageSortTests {
         // Leave as 0 to disable limit.
         virtual int limit() const { return 0; };
 
+        virtual size_t maxMemoryUsageBytes() const { return 32 * 1024 * 1024; }
+
+        virtual bool extSortAllowed() const { return false; }
+
 
         static const char* ns() { return "unittests.QueryStageSort"; }
     private:
@@ -235,6 +254,48 @@ namespace QueryStageSortTests {
         }
     };
 
+    // Sort a big bunch of objects with a small memory budget, so that they go to disk in more
+    // sorted runs than are merged at once.
+    class QueryStageSortSpill : public QueryStageSortExt {
+    public:
+        virtual size_t maxMemoryUsageBytes() const { return 4 * 1024; }
+
+        virtual bool extSortAllowed() const { return true; }
+
+        virtual void checkSpills(size_t spills) {
+            ASSERT_GREATER_THAN(spills, 32U);
+        }
+    };
+
+    // Sorting past the memory budget fails if we can't spill.
+    class QueryStageSortSpillNotAllowed : public QueryStageSortTestBase {
+    public:
+        virtual int numObj() { return 10000; }
+
+        void run() {
+            Client::WriteContext ctx(ns());
+            Database* db = ctx.ctx().db();
+            Collection* coll = db->getCollection(ns());
+            if (!coll) {
+                coll = db->createCollection(ns());
+            }
+            fillData();
+
+            WorkingSet* ws = new WorkingSet();
+            MockStage* ms = new MockStage(ws);
+            insertVarietyOfObjects(ms, coll);
+
+            SortStageParams params;
+            params.pattern = BSON("foo" << 1);
+            params.maxMemoryUsageBytes = 4 * 1024;
+            params.extSortAllowed = false;
+
+            PlanExecutor runner(ws, new FetchStage(ws, new SortStage(params, ws, ms), NULL));
+            BSONObj obj;
+            ASSERT_EQUALS(Runner::RUNNER_ERROR, runner.getNext(&obj, NULL));
+        }
+    };
+
     // Invalidation of everything fed to sort.
     class QueryStageSortInvalidation : public QueryStageSortTestBase {
     public:
@@ -335,6 +396,8 @@ namespace QueryStageSortTests {
             // and a special case for limit == 1
             add<QueryStageSortDecWithLimit<1> >();
             add<QueryStageSortExt>();
+            add<QueryStageSortSpill>();
+            add<QueryStageSortSpillNotAllowed>();
             add<QueryStageSortInvalidation>();
             add<QueryStageSortInvalidationWithLimit<10> >();
             add<QueryStageSortInvalidationWithLimit<1> >();
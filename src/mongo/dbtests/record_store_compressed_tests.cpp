@@ -0,0 +1,192 @@
+// record_store_compressed_tests.cpp : record_store_compressed.{h,cpp} unit tests.
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/client/dbclientcursor.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/structure/record_store_compressed.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace RecordStoreCompressedTests {
+
+    static const char* const _ns = "unittests.recordstorecompressed";
+
+    class Base {
+    public:
+        Base() {
+            _client.dropCollection( _ns );
+            BSONObj info;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "create" << "recordstorecompressed" <<
+                                              "compressed" << true ),
+                                        info ) );
+        }
+
+        virtual ~Base() {
+            _client.dropCollection( _ns );
+        }
+
+    protected:
+        /** inserts n documents with enough repetitive text to fill and seal several blocks */
+        void insertText( int n ) {
+            string text;
+            for ( int i = 0; i < 20; i++ )
+                text += "compressible text ";
+            for ( int i = 0; i < n; i++ )
+                _client.insert( _ns, BSON( "_id" << i << "text" << text ) );
+        }
+
+        /** @return the _ids found by a collection scan in the given direction */
+        set<int> scan( int direction ) {
+            set<int> ids;
+            auto_ptr<DBClientCursor> c =
+                _client.query( _ns, Query().sort( BSON( "$natural" << direction ) ) );
+            while ( c->more() )
+                ids.insert( c->next()["_id"].numberInt() );
+            return ids;
+        }
+
+        DBDirectClient _client;
+    };
+
+    class InsertAndFind : public Base {
+    public:
+        void run() {
+            insertText( 1000 );
+            ASSERT_EQUALS( 1000U, _client.count( _ns ) );
+
+            ASSERT_EQUALS( 1000U, scan( 1 ).size() );
+            ASSERT_EQUALS( 1000U, scan( -1 ).size() );
+
+            for ( int i = 0; i < 1000; i += 97 ) {
+                BSONObj doc = _client.findOne( _ns, BSON( "_id" << i ) );
+                ASSERT_EQUALS( i, doc["_id"].numberInt() );
+            }
+        }
+    };
+
+    class SmallerOnDisk : public Base {
+    public:
+        void run() {
+            insertText( 1000 );
+            BSONObj stats;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "collStats" << "recordstorecompressed" ),
+                                        stats ) );
+            ASSERT( stats["compressed"].trueValue() );
+            ASSERT_EQUALS( 1000, stats["count"].numberLong() );
+            ASSERT_LESS_THAN( stats["storageSize"].numberLong(), stats["size"].numberLong() );
+        }
+    };
+
+    /** a block's record is counted once by validate, and dataSize counts the documents */
+    class SizeCommands : public Base {
+    public:
+        void run() {
+            insertText( 1000 );
+            BSONObj stats;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "collStats" << "recordstorecompressed" ),
+                                        stats ) );
+
+            BSONObj validate;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "validate" << "recordstorecompressed" ),
+                                        validate ) );
+            ASSERT( validate["valid"].trueValue() );
+            ASSERT_EQUALS( 1000, validate["objectsFound"].numberInt() );
+            ASSERT_LESS_THAN_OR_EQUALS( validate["bytesWithHeaders"].numberLong(),
+                                        stats["storageSize"].numberLong() );
+
+            BSONObj dataSize;
+            ASSERT( _client.runCommand( "unittests",
+                                        BSON( "dataSize" << _ns ),
+                                        dataSize ) );
+            ASSERT_EQUALS( stats["size"].numberLong(), dataSize["size"].numberLong() );
+        }
+    };
+
+    class RemoveAndUpdate : public Base {
+    public:
+        void run() {
+            insertText( 300 );
+
+            _client.remove( _ns, BSON( "_id" << BSON( "$mod" << BSON_ARRAY( 2 << 0 ) ) ) );
+            ASSERT_EQUALS( 150U, _client.count( _ns ) );
+
+            // documents can't be updated in place, so this moves every one of them
+            _client.update( _ns,
+                            BSONObj(),
+                            BSON( "$inc" << BSON( "n" << 1 ) ),
+                            false,
+                            true );
+            ASSERT_EQUALS( 150U, _client.count( _ns, BSON( "n" << 1 ) ) );
+
+            set<int> ids = scan( 1 );
+            ASSERT_EQUALS( 150U, ids.size() );
+            for ( set<int>::const_iterator i = ids.begin(); i != ids.end(); ++i )
+                ASSERT_EQUALS( 1, *i % 2 );
+        }
+    };
+
+    /** sentinel DiskLocs aren't mistaken for documents of a compressed collection */
+    class CompressedLocTag {
+    public:
+        void run() {
+            const DiskLoc block( DiskLoc::MaxFiles - 1, 0x7ffffff0 );
+            const DiskLoc loc =
+                CompressedRecordStore::locFor( block, CompressedRecordStore::MaxDocsPerBlock - 1 );
+            ASSERT( CompressedRecordStore::isCompressedLoc( loc ) );
+            ASSERT_EQUALS( block, CompressedRecordStore::blockFor( loc ) );
+            ASSERT_EQUALS( CompressedRecordStore::MaxDocsPerBlock - 1,
+                           CompressedRecordStore::slotFor( loc ) );
+
+            ASSERT( !CompressedRecordStore::isCompressedLoc( block ) );
+            ASSERT( !CompressedRecordStore::isCompressedLoc( DiskLoc() ) );
+            ASSERT( !CompressedRecordStore::isCompressedLoc( minDiskLoc ) );
+            ASSERT( !CompressedRecordStore::isCompressedLoc( maxDiskLoc ) );
+            DiskLoc invalid;
+            invalid.setInvalid();
+            ASSERT( !CompressedRecordStore::isCompressedLoc( invalid ) );
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "recordstorecompressed" ) {
+        }
+        void setupTests() {
+            add<InsertAndFind>();
+            add<SmallerOnDisk>();
+            add<SizeCommands>();
+            add<RemoveAndUpdate>();
+            add<CompressedLocTag>();
+        }
+    } all;
+}
@@ -0,0 +1,155 @@
+// record_store_heap_tests.cpp : record_store_heap.{h,cpp} unit tests.
+
+/**
+*    Copyright (C) 2014 10gen Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+*    As a special exception, the copyright holders give permission to link the
+*    code of portions of this program with the OpenSSL library under certain
+*    conditions as described in each individual source file and distribute
+*    linked combinations including the program with the OpenSSL library. You
+*    must comply with the GNU Affero General Public License in all respects for
+*    all of the code used other than as permitted herein. If you modify file(s)
+*    with this exception, you may extend this exception to your version of the
+*    file(s), but you are not obligated to do so. If you do not wish to do so,
+*    delete this exception statement from your version. If you delete this
+*    exception statement from all source files in the program, then also delete
+*    it in the license file.
+*/
+
+#include "mongo/db/catalog/collection.h"
+#include "mongo/db/catalog/database.h"
+#include "mongo/db/structure/collection_iterator.h"
+#include "mongo/db/structure/record_store_heap.h"
+#include "mongo/dbtests/dbtests.h"
+
+namespace RecordStoreHeapTests {
+
+    static const char* const _ns = "unittests.recordstoreheap";
+
+    class Base {
+    public:
+        Base() : _ctx( _ns ) {
+            _coll = _ctx.ctx().db()->createCollection( _ns );
+            _store.reset( new HeapRecordStore( _ns, _coll->details() ) );
+        }
+
+        virtual ~Base() {
+            _store.reset();
+            _ctx.ctx().db()->dropCollection( _ns );
+        }
+
+    protected:
+        DiskLoc insert( int i ) {
+            BSONObj obj = BSON( "_id" << i );
+            StatusWith<DiskLoc> loc = _store->insertRecord( obj.objdata(), obj.objsize(), 0 );
+            ASSERT_OK( loc.getStatus() );
+            return loc.getValue();
+        }
+
+        /** @return the _id of every record, in iteration order */
+        vector<int> scan( const CollectionScanParams::Direction& dir ) {
+            vector<int> ids;
+            scoped_ptr<CollectionIterator> it( _store->getIterator( _coll, DiskLoc(), false, dir ) );
+            while ( !it->isEOF() ) {
+                DiskLoc loc = it->getNext();
+                ids.push_back( BSONObj( _store->recordFor( loc )->data() )["_id"].numberInt() );
+            }
+            return ids;
+        }
+
+        Client::WriteContext _ctx;
+        Collection* _coll;
+        scoped_ptr<HeapRecordStore> _store;
+    };
+
+    class InsertAndIterate : public Base {
+    public:
+        void run() {
+            for ( int i = 0; i < 10; i++ )
+                insert( i );
+
+            vector<int> forward = scan( CollectionScanParams::FORWARD );
+            ASSERT_EQUALS( 10U, forward.size() );
+            for ( int i = 0; i < 10; i++ )
+                ASSERT_EQUALS( i, forward[i] );
+
+            vector<int> backward = scan( CollectionScanParams::BACKWARD );
+            ASSERT_EQUALS( 10U, backward.size() );
+            for ( int i = 0; i < 10; i++ )
+                ASSERT_EQUALS( 9 - i, backward[i] );
+
+            ASSERT_EQUALS( 10, _coll->details()->numRecords() );
+        }
+    };
+
+    class DeleteReusesSlot : public Base {
+    public:
+        void run() {
+            insert( 0 );
+            DiskLoc middle = insert( 1 );
+            insert( 2 );
+
+            _store->deleteRecord( middle );
+            vector<int> ids = scan( CollectionScanParams::FORWARD );
+            ASSERT_EQUALS( 2U, ids.size() );
+            ASSERT_EQUALS( 0, ids[0] );
+            ASSERT_EQUALS( 2, ids[1] );
+
+            ASSERT_EQUALS( middle, insert( 3 ) );
+            ASSERT_EQUALS( 3, _coll->details()->numRecords() );
+        }
+    };
+
+    /** DiskLoc::obj() has to find a heap record without being told its store */
+    class DiskLocResolves : public Base {
+    public:
+        void run() {
+            DiskLoc loc = insert( 7 );
+            ASSERT( HeapRecordStore::isHeapLoc( loc ) );
+            ASSERT_EQUALS( 7, loc.obj()["_id"].numberInt() );
+        }
+    };
+
+    class UpdateWithDamages : public Base {
+    public:
+        void run() {
+            DiskLoc loc = insert( 1 );
+            BSONObj replacement = BSON( "_id" << 5 );
+
+            // overwrite the value of _id, which follows the size, the type and "_id\0"
+            mutablebson::DamageEvent event;
+            event.sourceOffset = 9;
+            event.targetOffset = 9;
+            event.size = 4;
+            mutablebson::DamageVector damages;
+            damages.push_back( event );
+
+            _store->updateWithDamages( loc, replacement.objdata(), damages );
+            ASSERT_EQUALS( 5, loc.obj()["_id"].numberInt() );
+        }
+    };
+
+    class All : public Suite {
+    public:
+        All() : Suite( "recordstoreheap" ) {
+        }
+        void setupTests() {
+            add<InsertAndIterate>();
+            add<DeleteReusesSlot>();
+            add<DiskLocResolves>();
+            add<UpdateWithDamages>();
+        }
+    } all;
+}
@@ -53,6 +53,7 @@ using mongo::BSONElement;
 using mongo::ConnectionString;
 using mongo::HostAndPort;
 using mongo::MockReplicaSet;
+using mongo::OpTime;
 using mongo::ReadPreference;
 using mongo::ReplicaSetMonitor;
 using mongo::ReplicaSetMonitorPtr;
@@ -596,6 +597,171 @@ namespace mongo_test {
         ASSERT(!host.empty());
     }
 
+    TEST(ReplSetMonitorReadPref, NearestOnlyPicksFastest) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+        TagSet tags(TagSetFixtures::getDefaultSet());
+        HostAndPort lastHost = nodes[0].addr;
+
+        nodes[0].pingTimeMillis = 10;
+        nodes[1].pingTimeMillis = 20;
+        nodes[2].pingTimeMillis = 30;
+
+        // none within 3ms of an absolute zero, but a is the fastest
+        for (int i = 0; i < 3; i++) {
+            bool isPrimarySelected = false;
+            tags.reset();
+            HostAndPort host = ReplicaSetMonitor::selectNode(nodes,
+                mongo::ReadPreference_Nearest, &tags, 3, &lastHost,
+                &isPrimarySelected);
+
+            ASSERT(!isPrimarySelected);
+            ASSERT_EQUALS("a", host.host());
+        }
+    }
+
+    TEST(ReplSetMonitorReadPref, SecOnlyRoundRobinWithinLatencyWindow) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+        TagSet tags(TagSetFixtures::getDefaultSet());
+        HostAndPort lastHost = nodes[0].addr;
+
+        nodes[0].pingTimeMillis = 40;
+        nodes[2].pingTimeMillis = 42;
+
+        bool isPrimarySelected = false;
+        HostAndPort host = ReplicaSetMonitor::selectNode(nodes,
+            mongo::ReadPreference_SecondaryOnly, &tags, 3, &lastHost,
+            &isPrimarySelected);
+        ASSERT_EQUALS("c", host.host());
+
+        tags.reset();
+        host = ReplicaSetMonitor::selectNode(nodes,
+            mongo::ReadPreference_SecondaryOnly, &tags, 3, &lastHost,
+            &isPrimarySelected);
+        ASSERT_EQUALS("a", host.host());
+    }
+
+    TEST(ReplSetMonitorLag, LagFromPrimary) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+
+        nodes[0].opTime = OpTime(95, 1);
+        nodes[1].opTime = OpTime(100, 1);
+        nodes[2].opTime = OpTime(101, 1);
+
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        ASSERT_EQUALS(5000, nodes[0].lagMillis);
+        ASSERT_EQUALS(0, nodes[1].lagMillis);
+        ASSERT_EQUALS(0, nodes[2].lagMillis);
+    }
+
+    TEST(ReplSetMonitorLag, LagWithoutPrimary) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+
+        nodes[1].ok = false;
+        nodes[0].opTime = OpTime(95, 1);
+        nodes[1].opTime = OpTime(200, 1);
+        nodes[2].opTime = OpTime(98, 1);
+
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        ASSERT_EQUALS(3000, nodes[0].lagMillis);
+        ASSERT_EQUALS(0, nodes[2].lagMillis);
+    }
+
+    TEST(ReplSetMonitorLag, LagTooLongForIntMillis) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+
+        // a month behind, and a secondary from just after the epoch
+        nodes[0].opTime = OpTime(1000, 1);
+        nodes[1].opTime = OpTime(1000 + 31 * 24 * 3600, 1);
+        nodes[2].opTime = OpTime(1, 1);
+
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        ASSERT_EQUALS(std::numeric_limits<int>::max(), nodes[0].lagMillis);
+        ASSERT_EQUALS(std::numeric_limits<int>::max(), nodes[2].lagMillis);
+        ASSERT(!nodes[0].isFresh(10000));
+    }
+
+    TEST(ReplSetMonitorLag, UnknownOpTime) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+
+        nodes[1].opTime = OpTime(100, 1);
+        nodes[2].opTime = OpTime(100, 1);
+
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        ASSERT_EQUALS(-1, nodes[0].lagMillis);
+        ASSERT(!nodes[0].isFresh(1000));
+        ASSERT(nodes[0].isFresh(0));
+    }
+
+    TEST(ReplSetMonitorReadPref, SecOnlySkipsStale) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+        TagSet tags(TagSetFixtures::getDefaultSet());
+        HostAndPort lastHost = nodes[2].addr;
+
+        nodes[0].opTime = OpTime(70, 1);
+        nodes[1].opTime = OpTime(100, 1);
+        nodes[2].opTime = OpTime(99, 1);
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        // a would be next in turn, but is 30s behind
+        bool isPrimarySelected = false;
+        HostAndPort host = ReplicaSetMonitor::selectNode(nodes,
+            mongo::ReadPreference_SecondaryOnly, &tags, 3, &lastHost,
+            &isPrimarySelected, 10000);
+
+        ASSERT(!isPrimarySelected);
+        ASSERT_EQUALS("c", host.host());
+    }
+
+    TEST(ReplSetMonitorReadPref, SecOnlyAllStale) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+        TagSet tags(TagSetFixtures::getDefaultSet());
+        HostAndPort lastHost = nodes[2].addr;
+
+        nodes[0].opTime = OpTime(70, 1);
+        nodes[1].opTime = OpTime(100, 1);
+        nodes[2].opTime = OpTime(80, 1);
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        bool isPrimarySelected = false;
+        HostAndPort host = ReplicaSetMonitor::selectNode(nodes,
+            mongo::ReadPreference_SecondaryOnly, &tags, 3, &lastHost,
+            &isPrimarySelected, 10000);
+
+        ASSERT(host.empty());
+    }
+
+    TEST(ReplSetMonitorReadPref, SecPrefAllStaleUsesPrimary) {
+        vector<ReplicaSetMonitor::Node> nodes =
+                NodeSetFixtures::getThreeMemberWithTags();
+        TagSet tags(TagSetFixtures::getDefaultSet());
+        HostAndPort lastHost = nodes[2].addr;
+
+        nodes[0].opTime = OpTime(70, 1);
+        nodes[1].opTime = OpTime(100, 1);
+        nodes[2].opTime = OpTime(80, 1);
+        ReplicaSetMonitor::updateLag(&nodes);
+
+        bool isPrimarySelected = false;
+        HostAndPort host = ReplicaSetMonitor::selectNode(nodes,
+            mongo::ReadPreference_SecondaryPreferred, &tags, 3, &lastHost,
+            &isPrimarySelected, 10000);
+
+        ASSERT(isPrimarySelected);
+        ASSERT_EQUALS("b", host.host());
+    }
+
     TEST(ReplSetMonitorReadPref, PriOnlyWithTagsNoMatch) {
         vector<ReplicaSetMonitor::Node> nodes =
                 NodeSetFixtures::getThreeMemberWithTags();
@@ -105,7 +105,7 @@ namespace ReplSetTests {
     public:
         BackgroundSyncTest() {}
         virtual ~BackgroundSyncTest() {}
-        virtual bool peek(BSONObj* op) {
+        virtual bool peek(BSONObj* op, replset::OplogStorage* storage) {
             if (_queue.empty()) {
                 return false;
             }
@@ -41,9 +41,12 @@
 #include "mongo/db/repl/oplog.h"
 #include "mongo/db/repl/replication_server_status.h"
 #include "mongo/db/repl/rs.h"
+#include "mongo/db/repl/rs_sync.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/catalog/collection.h"
 #include "mongo/db/structure/collection_iterator.h"
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/timer.h"
 
 #include "mongo/dbtests/dbtests.h"
 
@@ -1421,6 +1424,174 @@ namespace ReplTests {
         }
     };
 
+    /** exposes how SyncTail splits a batch between its writers */
+    class SyncTailTest : public replset::SyncTail {
+    public:
+        SyncTailTest() : SyncTail( NULL ) {}
+        static void fill( const std::deque<BSONObj>& ops,
+                          std::vector< std::vector<BSONObj> >* writerVectors ) {
+            fillWriterVectors( ops, writerVectors );
+        }
+    };
+
+    BSONObj insertOp( const char* ns, const BSONObj& o ) {
+        return BSON( "op" << "i" << "ns" << ns << "o" << o );
+    }
+
+    BSONObj updateOp( const char* ns, const BSONElement& id, const BSONObj& o ) {
+        BSONObjBuilder o2;
+        o2.appendAs( id, "_id" );
+        return BSON( "op" << "u" << "ns" << ns << "o2" << o2.obj() << "o" << o );
+    }
+
+    BSONObj deleteOp( const char* ns, const BSONElement& id ) {
+        BSONObjBuilder o;
+        o.appendAs( id, "_id" );
+        return BSON( "op" << "d" << "ns" << ns << "o" << o.obj() );
+    }
+
+    /**
+     * Ops for one document go to one writer in order, and different documents of a collection
+     * are spread over the writers, except in capped collections and collections with other
+     * unique indexes.
+     */
+    class WriterVectorsByDocument : public Base {
+    public:
+        ~WriterVectorsByDocument() {
+            client()->dropCollection( cappedNs() );
+            client()->dropCollection( uniqueNs() );
+        }
+        void run() {
+            client()->createCollection( cappedNs(), 1024 * 1024, true );
+            client()->ensureIndex( uniqueNs(), BSON( "a" << 1 ), true );
+
+            std::deque<BSONObj> ops;
+            for( int i = 0; i < 100; ++i ) {
+                BSONObj id = BSON( "_id" << i );
+                ops.push_back( insertOp( ns(), id ) );
+                ops.push_back( insertOp( cappedNs(), id ) );
+                ops.push_back( insertOp( uniqueNs(), id ) );
+            }
+            for( int i = 0; i < 100; ++i ) {
+                // the same _ids as a double
+                BSONObj id = BSON( "_id" << static_cast<double>( i ) );
+                ops.push_back( updateOp( ns(), id.firstElement(),
+                                         BSON( "$set" << BSON( "x" << 1 ) ) ) );
+                ops.push_back( deleteOp( ns(), id.firstElement() ) );
+            }
+
+            std::vector< std::vector<BSONObj> > writerVectors( 16 );
+            SyncTailTest::fill( ops, &writerVectors );
+
+            std::map<int, size_t> writerForId;
+            std::map<int, string> opsForId;
+            std::set<size_t> writersForNs;
+            std::set<size_t> writersForCapped;
+            std::set<size_t> writersForUnique;
+            for( size_t w = 0; w < writerVectors.size(); ++w ) {
+                for( size_t j = 0; j < writerVectors[ w ].size(); ++j ) {
+                    const BSONObj& op = writerVectors[ w ][ j ];
+                    string ns = op.getStringField( "ns" );
+                    if ( ns == cappedNs() ) {
+                        writersForCapped.insert( w );
+                        continue;
+                    }
+                    if ( ns == uniqueNs() ) {
+                        writersForUnique.insert( w );
+                        continue;
+                    }
+                    writersForNs.insert( w );
+                    const char* type = op.getStringField( "op" );
+                    int id = ( *type == 'u' ? op.getObjectField( "o2" ) : op.getObjectField( "o" ) )
+                        [ "_id" ].numberInt();
+                    if ( writerForId.count( id ) )
+                        ASSERT_EQUALS( writerForId[ id ], w );
+                    writerForId[ id ] = w;
+                    opsForId[ id ] += type;
+                }
+            }
+            ASSERT_EQUALS( 100U, opsForId.size() );
+            for( std::map<int, string>::const_iterator i = opsForId.begin();
+                 i != opsForId.end(); ++i ) {
+                ASSERT_EQUALS( "iud", i->second );
+            }
+            ASSERT( writersForNs.size() > 1 );
+            ASSERT_EQUALS( 1U, writersForCapped.size() );
+            ASSERT_EQUALS( 1U, writersForUnique.size() );
+        }
+    private:
+        static const char* cappedNs() { return "unittests.repltests_capped"; }
+        static const char* uniqueNs() { return "unittests.repltests_unique"; }
+    };
+
+    /**
+     * Applies the same batch of inserts and updates to a single collection with different
+     * numbers of writer threads and logs the time each took.
+     */
+    class ApplyByDocumentThroughput {
+    public:
+        ~ApplyByDocumentThroughput() {
+            DBDirectClient client;
+            client.dropCollection( ns() );
+        }
+        void run() {
+            std::deque<BSONObj> ops;
+            string s( 100, 'x' );
+            for( int i = 0; i < NDocs; ++i ) {
+                ops.push_back( insertOp( ns(), BSON( "_id" << i << "x" << 0 << "s" << s ) ) );
+            }
+            for( int i = 0; i < NDocs; ++i ) {
+                BSONObj id = BSON( "_id" << i );
+                ops.push_back( updateOp( ns(), id.firstElement(),
+                                         BSON( "$inc" << BSON( "x" << 1 ) ) ) );
+            }
+
+            int writers[] = { 1, 4, 16 };
+            StringBuilder sb;
+            for( size_t i = 0; i < sizeof( writers ) / sizeof( writers[ 0 ] ); ++i ) {
+                sb << ( i ? ", " : "" ) << writers[ i ] << " writers "
+                   << apply( ops, writers[ i ] ) << "ms";
+            }
+            mongo::unittest::log() << "applying " << ops.size() << " ops to one collection: "
+                                   << sb.str() << endl;
+        }
+    private:
+        static const int NDocs = 20000;
+        static const char* ns() { return "unittests.repltests_apply"; }
+
+        static void applyVector( const std::vector<BSONObj>* ops, SyncTailTest* st ) {
+            Client::initThreadIfNotAlready( "repltests writer" );
+            for( std::vector<BSONObj>::const_iterator it = ops->begin(); it != ops->end(); ++it ) {
+                verify( st->syncApply( *it, true ) );
+            }
+        }
+
+        /** @return milliseconds to apply ops with nWriters threads */
+        int apply( const std::deque<BSONObj>& ops, int nWriters ) {
+            DBDirectClient client;
+            client.dropCollection( ns() );
+            client.createCollection( ns() );
+
+            std::vector< std::vector<BSONObj> > writerVectors( nWriters );
+            SyncTailTest::fill( ops, &writerVectors );
+
+            SyncTailTest st;
+            ThreadPool pool( nWriters );
+            Timer t;
+            for( size_t w = 0; w < writerVectors.size(); ++w ) {
+                if ( !writerVectors[ w ].empty() )
+                    pool.schedule( &applyVector, &writerVectors[ w ], &st );
+            }
+            pool.join();
+            int ms = t.millis();
+
+            ASSERT_EQUALS( static_cast<unsigned long long>( NDocs ), client.count( ns() ) );
+            ASSERT_EQUALS( static_cast<unsigned long long>( NDocs ),
+                           client.count( ns(), BSON( "x" << 1 ) ) );
+            return ms;
+        }
+    };
+
     class All : public Suite {
     public:
         All() : Suite( "repl" ) {
@@ -1483,6 +1654,8 @@ namespace ReplTests {
             add< Idempotence::ReplaySetPreexistingNoOpPull >();
             add< Idempotence::ReplayArrayFieldNotAppended >();
             add< DeleteOpIsIdBased >();
+            add< WriterVectorsByDocument >();
+            add< ApplyByDocumentThroughput >();
             add< DatabaseIgnorerBasic >();
             add< DatabaseIgnorerUpdate >();
             add< ReplSetMemberCfgEquality >();
@@ -280,6 +280,57 @@ namespace ShardingTests {
 
     };
 
+    //
+    // Tests that a manager loaded on top of an old one shares the old manager's unchanged chunks
+    // and only creates the ones that changed.
+    //
+    class ChunkManagerLoadSharesUnchangedTest : public ChunkManagerCreateFullTest {
+    public:
+
+        void run(){
+
+            string keyName = "_id";
+            createChunks( keyName );
+
+            ChunkManagerPtr manager( new ChunkManager( collName(), ShardKeyPattern( BSON( "_id" << 1 ) ), false ) );
+            ((ChunkManager*) manager.get())->loadExistingRanges( shard().getConnString() );
+            const ChunkMap oldChunks = manager->getChunkMap();
+
+            // Bump the version of one chunk only
+            BSONObj changedChunk = client().findOne(ChunkType::ConfigNS, BSONObj()).getOwned();
+            ChunkVersion version = ChunkVersion::fromBSON(changedChunk,
+                                                          ChunkType::DEPRECATED_lastmod());
+            BSONObjBuilder b;
+            ChunkVersion laterVersion = ChunkVersion( 2, 0, version.epoch() );
+            laterVersion.addToBSON(b, ChunkType::DEPRECATED_lastmod());
+            string changedName = changedChunk[ChunkType::name()].String();
+            client().update(ChunkType::ConfigNS, BSON( ChunkType::name( changedName ) ),
+                            BSON( "$set" << b.obj() ));
+
+            ChunkManager newManager( manager );
+            newManager.loadExistingRanges( shard().getConnString() );
+
+            const ChunkMap newChunks = newManager.getChunkMap();
+            ASSERT_EQUALS( oldChunks.size(), newChunks.size() );
+
+            BSONObj changedMax = changedChunk[ChunkType::max()].Obj();
+            for ( ChunkMap::const_iterator it = newChunks.begin(); it != newChunks.end(); ++it ) {
+                ChunkMap::const_iterator old = oldChunks.find( it->first );
+                ASSERT( old != oldChunks.end() );
+
+                if ( it->first.woCompare( changedMax ) == 0 ) {
+                    ASSERT( old->second != it->second );
+                    ASSERT( it->second->getLastmod().toLong() == laterVersion.toLong() );
+                    ASSERT( old->second->getLastmod().toLong() == version.toLong() );
+                }
+                else {
+                    ASSERT( old->second == it->second );
+                }
+            }
+        }
+
+    };
+
     class ChunkDiffUnitTest {
     public:
 
@@ -652,6 +703,7 @@ namespace ShardingTests {
             add< ChunkManagerCreateBasicTest >();
             add< ChunkManagerCreateFullTest >();
             add< ChunkManagerLoadBasicTest >();
+            add< ChunkManagerLoadSharesUnchangedTest >();
             add< ChunkDiffUnitTestNormal >();
             add< ChunkDiffUnitTestInverse >();
         }
@@ -30,8 +30,12 @@
 
 #include "mongo/s/balance.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/namespace_string.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/s/chunk.h"
 #include "mongo/s/cluster_write.h"
@@ -57,81 +61,120 @@ namespace mongo {
     Balancer::~Balancer() {
     }
 
-    int Balancer::_moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
+    void Balancer::_moveChunk(const CandidateChunk* candidateChunk,
                               bool secondaryThrottle,
-                              bool waitForDelete)
+                              bool waitForDelete,
+                              int* movedCount)
     {
-        int movedCount = 0;
+        const CandidateChunk& chunkInfo = *candidateChunk;
 
-        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
-            const CandidateChunk& chunkInfo = *it->get();
+        // Changes to metadata, borked metadata, and connectivity problems should cause us to
+        // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
+        // TODO: Handle all these things more cleanly, since they're expected problems
+        try {
 
-            // Changes to metadata, borked metadata, and connectivity problems should cause us to
-            // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
-            // TODO: Handle all these things more cleanly, since they're expected problems
-            try {
+            DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
+            verify( cfg );
 
-                DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
-                verify( cfg );
+            // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
+            // tried to do so once.
+            ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            verify( cm );
 
-                // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
-                // tried to do so once.
-                ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
+                // likely a split happened somewhere
+                cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
                 verify( cm );
 
-                ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
                 if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                    // likely a split happened somewhere
-                    cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
-                    verify( cm );
-
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
-                    if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                        log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
-                        continue;
-                    }
-                }
-
-                BSONObj res;
-                if (c->moveAndCommit(Shard::make(chunkInfo.to),
-                                     Chunk::MaxChunkSize,
-                                     secondaryThrottle,
-                                     waitForDelete,
-                                     0, /* maxTimeMS */
-                                     res)) {
-                    movedCount++;
-                    continue;
+                    log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
+                    return;
                 }
+            }
 
-                // the move requires acquiring the collection metadata's lock, which can fail
-                log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
-                      << " chunk: " << chunkInfo.chunk << endl;
+            BSONObj res;
+            if (c->moveAndCommit(Shard::make(chunkInfo.to),
+                                 Chunk::MaxChunkSize,
+                                 secondaryThrottle,
+                                 waitForDelete,
+                                 0, /* maxTimeMS */
+                                 res)) {
+                (*movedCount)++;
+                return;
+            }
 
-                if ( res["chunkTooBig"].trueValue() ) {
-                    // reload just to be safe
-                    cm = cfg->getChunkManager( chunkInfo.ns );
-                    verify( cm );
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            // the move requires acquiring the collection metadata's lock, which can fail
+            log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
+                  << " chunk: " << chunkInfo.chunk << endl;
 
-                    log() << "forcing a split because migrate failed for size reasons" << endl;
+            if ( res["chunkTooBig"].trueValue() ) {
+                // reload just to be safe
+                cm = cfg->getChunkManager( chunkInfo.ns );
+                verify( cm );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
 
-                    res = BSONObj();
-                    c->singleSplit( true , res );
-                    log() << "forced split results: " << res << endl;
+                log() << "forcing a split because migrate failed for size reasons" << endl;
 
-                    if ( ! res["ok"].trueValue() ) {
-                        log() << "marking chunk as jumbo: " << c->toString() << endl;
-                        c->markAsJumbo();
-                        // we increment moveCount so we do another round right away
-                        movedCount++;
-                    }
+                res = BSONObj();
+                c->singleSplit( true , res );
+                log() << "forced split results: " << res << endl;
 
+                if ( ! res["ok"].trueValue() ) {
+                    log() << "marking chunk as jumbo: " << c->toString() << endl;
+                    c->markAsJumbo();
+                    // we increment moveCount so we do another round right away
+                    (*movedCount)++;
                 }
+
             }
-            catch( const DBException& ex ) {
-                warning() << "could not move chunk " << chunkInfo.chunk.toString()
-                          << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
+        catch( const std::exception& ex ) {
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
+    }
+
+    int Balancer::_moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
+                              bool secondaryThrottle,
+                              bool waitForDelete,
+                              bool parallel)
+    {
+        int movedCount = 0;
+
+        if ( ! parallel ) {
+            for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
+                _moveChunk( it->get(), secondaryThrottle, waitForDelete, &movedCount );
             }
+            return movedCount;
+        }
+
+        vector<const MigrateInfo*> migrations;
+        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
+            migrations.push_back( it->get() );
+        }
+
+        // Migrations in a round share no shard, so they can all run at once
+        vector< vector<size_t> > rounds = BalancerPolicy::groupNonConflicting( migrations );
+        for ( size_t r = 0; r < rounds.size(); r++ ) {
+            const vector<size_t>& round = rounds[r];
+            LOG(1) << "starting " << round.size() << " migrations at once" << endl;
+
+            vector<int> moved( round.size(), 0 );
+            boost::thread_group threads;
+            for ( size_t i = 0; i < round.size(); i++ ) {
+                threads.create_thread( boost::bind( &Balancer::_moveChunk,
+                                                    this,
+                                                    migrations[round[i]],
+                                                    secondaryThrottle,
+                                                    waitForDelete,
+                                                    &moved[i] ) );
+            }
+            threads.join_all();
+
+            for ( size_t i = 0; i < moved.size(); i++ )
+                movedCount += moved[i];
         }
 
         return movedCount;
@@ -201,7 +244,53 @@ namespace mongo {
         }        
     }
 
-    void Balancer::_doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks ) {
+    /**
+     * Fills 'stats' with a cost estimate for every chunk of 'ns'. Shards only report a data
+     * size per collection, so each shard's size is spread evenly over the chunks it owns. Write
+     * and read traffic comes from the counters this mongos keeps on its own chunks.
+     */
+    static void loadChunkStats( const string& ns,
+                                const ChunkManagerPtr& cm,
+                                const map< string,vector<BSONObj> >& shardToChunksMap,
+                                ChunkStatsMap* stats ) {
+        const NamespaceString nss( ns );
+
+        for ( map< string,vector<BSONObj> >::const_iterator i = shardToChunksMap.begin();
+              i != shardToChunksMap.end();
+              ++i ) {
+            const vector<BSONObj>& chunks = i->second;
+            if ( chunks.empty() )
+                continue;
+
+            long long shardSize = 0;
+            try {
+                BSONObj cmd = BSON( "collStats" << nss.coll() );
+                BSONObj res = Shard::make( i->first ).runCommand( nss.db().toString(), cmd );
+                shardSize = res["size"].numberLong();
+            }
+            catch ( const DBException& ex ) {
+                warning() << "could not get size of " << ns << " on " << i->first
+                          << ", treating its chunks as empty" << causedBy( ex ) << endl;
+            }
+
+            for ( vector<BSONObj>::const_iterator j = chunks.begin(); j != chunks.end(); ++j ) {
+                const BSONObj min = (*j)[ChunkType::min()].Obj();
+
+                ChunkStats& chunkStats = (*stats)[min];
+                chunkStats.dataSize = shardSize / static_cast<long long>( chunks.size() );
+
+                ChunkPtr c = cm->findIntersectingChunk( min );
+                if ( c && c->getMin().woCompare( min ) == 0 ) {
+                    chunkStats.writeBytes = c->takeBytesWrittenSinceBalance();
+                    chunkStats.reads = c->takeReadsSinceBalance();
+                }
+            }
+        }
+    }
+
+    void Balancer::_doBalanceRound( DBClientBase& conn,
+                                    vector<CandidateChunkPtr>* candidateChunks,
+                                    bool costBased ) {
         verify( candidateChunks );
 
         //
@@ -375,6 +464,12 @@ namespace mongo {
                 continue;
             }
 
+            ChunkStatsMap chunkStats;
+            if ( costBased ) {
+                loadChunkStats( ns, cm, shardToChunksMap, &chunkStats );
+                status.setChunkStats( &chunkStats );
+            }
+
             CandidateChunk* p = _policy->balance( ns, status, _balancedLastTime );
             if ( p ) candidateChunks->push_back( CandidateChunkPtr( p ) );
         }
@@ -499,11 +594,16 @@ namespace mongo {
                         secondaryThrottle = balancerConfig[SettingsType::secondaryThrottle()].trueValue();
                     }
 
+                    bool costBased = balancerConfig["costBased"].trueValue();
+                    bool parallelMigrations = balancerConfig["parallelMigrations"].trueValue();
+
                     LOG(1) << "waitForDelete: " << waitForDelete << endl;
                     LOG(1) << "secondaryThrottle: " << secondaryThrottle << endl;
+                    LOG(1) << "costBased: " << costBased << endl;
+                    LOG(1) << "parallelMigrations: " << parallelMigrations << endl;
 
                     vector<CandidateChunkPtr> candidateChunks;
-                    _doBalanceRound( conn.conn() , &candidateChunks );
+                    _doBalanceRound( conn.conn() , &candidateChunks, costBased );
                     if ( candidateChunks.size() == 0 ) {
                         LOG(1) << "no need to move any chunk" << endl;
                         _balancedLastTime = 0;
@@ -511,7 +611,8 @@ namespace mongo {
                     else {
                         _balancedLastTime = _moveChunks(&candidateChunks,
                                                         secondaryThrottle,
-                                                        waitForDelete );
+                                                        waitForDelete,
+                                                        parallelMigrations );
                     }
 
                     LOG(1) << "*** end of balancing round" << endl;
@@ -89,20 +89,36 @@ namespace mongo {
          *
          * @param conn is the connection with the config server(s)
          * @param candidateChunks (IN/OUT) filled with candidate chunks, one per collection, that could possibly be moved
+         * @param costBased weigh chunks by data size and traffic instead of counting them
          */
-        void _doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks );
+        void _doBalanceRound( DBClientBase& conn,
+                              vector<CandidateChunkPtr>* candidateChunks,
+                              bool costBased );
 
         /**
-         * Issues chunk migration request, one at a time.
+         * Issues chunk migration requests. Without 'parallel' they go one at a time; with it,
+         * migrations that share no shard are issued together.
          *
          * @param candidateChunks possible chunks to move
          * @param secondaryThrottle wait for secondaries to catch up before pushing more deletes
          * @param waitForDelete wait for deletes to complete after each chunk move
+         * @param parallel run migrations between disjoint shard pairs concurrently
          * @return number of chunks effectively moved
          */
         int _moveChunks(const vector<CandidateChunkPtr>* candidateChunks,
                         bool secondaryThrottle,
-                        bool waitForDelete);
+                        bool waitForDelete,
+                        bool parallel);
+
+        /**
+         * Issues a single chunk migration request. Failures are logged and skipped.
+         *
+         * @param movedCount incremented if the chunk moved
+         */
+        void _moveChunk(const CandidateChunk* candidateChunk,
+                        bool secondaryThrottle,
+                        bool waitForDelete,
+                        int* movedCount);
 
         /**
          * Marks this balancer as being live on the config server(s).
@@ -39,13 +39,48 @@
 
 namespace mongo {
 
+    namespace {
+
+        // How much each kind of chunk stat counts towards a chunk's cost
+        const double kDataSizeWeight = 1.0;
+        const double kWriteWeight = 0.5;
+        const double kReadWeight = 0.5;
+
+        /**
+         * @return true if the shard may be given chunks with the tag
+         */
+        bool canReceive( const string& shard, const ShardInfo& info, const string& tag ) {
+            if ( info.isSizeMaxed() ) {
+                LOG(1) << shard << " has already reached the maximum total chunk size." << endl;
+                return false;
+            }
+
+            if ( info.isDraining() ) {
+                LOG(1) << shard << " is currently draining." << endl;
+                return false;
+            }
+
+            if ( info.hasOpsQueued() ) {
+                LOG(1) << shard << " has writebacks queued." << endl;
+                return false;
+            }
+
+            if ( ! info.hasTag( tag ) ) {
+                LOG(1) << shard << " doesn't have right tag" << endl;
+                return false;
+            }
+
+            return true;
+        }
+    }
+
     string TagRange::toString() const {
         return str::stream() << min << " -->> " << max << "  on  " << tag;
     }
 
     DistributionStatus::DistributionStatus( const ShardInfoMap& shardInfo,
                                             const ShardToChunksMap& shardToChunksMap )
-        : _shardInfo( shardInfo ), _shardChunks( shardToChunksMap ) {
+        : _shardInfo( shardInfo ), _shardChunks( shardToChunksMap ), _chunkStats( NULL ) {
 
         for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
             _shards.insert( i->first );
@@ -90,25 +125,8 @@ namespace mongo {
         unsigned minChunks = numeric_limits<unsigned>::max();
 
         for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
-            if ( i->second.isSizeMaxed() ) {
-                LOG(1) << i->first << " has already reached the maximum total chunk size." << endl;
+            if ( ! canReceive( i->first, i->second, tag ) )
                 continue;
-            }
-
-            if ( i->second.isDraining() ) {
-                LOG(1) << i->first << " is currently draining." << endl;
-                continue;
-            }
-
-            if ( i->second.hasOpsQueued() ) {
-                LOG(1) << i->first << " has writebacks queued." << endl;
-                continue;
-            }
-
-            if ( ! i->second.hasTag( tag ) ) {
-                LOG(1) << i->first << " doesn't have right tag" << endl;
-                continue;
-            }
 
             unsigned myChunks = numberOfChunksInShard( i->first );
             if ( myChunks >= minChunks ) {
@@ -145,6 +163,140 @@ namespace mongo {
         return worst;
     }
 
+    string DistributionStatus::getLowestCostReceiverShard( const string& tag ) const {
+        string best;
+        double minCost = numeric_limits<double>::max();
+
+        for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
+            if ( ! canReceive( i->first, i->second, tag ) )
+                continue;
+
+            double myCost = shardCost( i->first, tag );
+            if ( myCost >= minCost )
+                continue;
+
+            best = i->first;
+            minCost = myCost;
+        }
+
+        return best;
+    }
+
+    string DistributionStatus::getHighestCostShard( const string& tag ) const {
+        string worst;
+        double maxCost = 0;
+
+        for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
+
+            if ( i->second.hasOpsQueued() ) {
+                // we can't move stuff off anyway
+                continue;
+            }
+
+            if ( numberOfChunksInShardWithTag( i->first, tag ) == 0 )
+                continue;
+
+            double myCost = shardCost( i->first, tag );
+            if ( ! worst.empty() && myCost <= maxCost )
+                continue;
+
+            worst = i->first;
+            maxCost = myCost;
+        }
+
+        return worst;
+    }
+
+    unsigned DistributionStatus::numberOfReceiverShards( const string& tag ) const {
+        unsigned total = 0;
+        for ( ShardInfoMap::const_iterator i = _shardInfo.begin(); i != _shardInfo.end(); ++i ) {
+            if ( i->second.hasTag( tag ) && ! i->second.isDraining() )
+                total++;
+        }
+        return total;
+    }
+
+    void DistributionStatus::setChunkStats( const ChunkStatsMap* stats ) {
+        _chunkStats = stats;
+        _tagTotals.clear();
+    }
+
+    const ChunkStats& DistributionStatus::_statsFor( const BSONObj& chunk ) const {
+        static const ChunkStats noStats;
+        if ( ! _chunkStats )
+            return noStats;
+
+        ChunkStatsMap::const_iterator i = _chunkStats->find( chunk[ChunkType::min()].Obj() );
+        if ( i == _chunkStats->end() )
+            return noStats;
+        return i->second;
+    }
+
+    const DistributionStatus::TagTotals& DistributionStatus::_totalsFor( const string& tag ) const {
+        map<string,TagTotals>::const_iterator cached = _tagTotals.find( tag );
+        if ( cached != _tagTotals.end() )
+            return cached->second;
+
+        TagTotals totals;
+        for ( ShardToChunksMap::const_iterator i = _shardChunks.begin(); i != _shardChunks.end(); ++i ) {
+            for ( unsigned j = 0; j < i->second.size(); j++ ) {
+                if ( getTagForChunk( i->second[j] ) != tag )
+                    continue;
+
+                const ChunkStats& stats = _statsFor( i->second[j] );
+                totals.stats.dataSize += stats.dataSize;
+                totals.stats.writeBytes += stats.writeBytes;
+                totals.stats.reads += stats.reads;
+                totals.numChunks++;
+            }
+        }
+
+        return _tagTotals[tag] = totals;
+    }
+
+    double DistributionStatus::chunkCost( const BSONObj& chunk ) const {
+        const TagTotals& totals = _totalsFor( getTagForChunk( chunk ) );
+        const ChunkStats& stats = _statsFor( chunk );
+
+        // Each stat is taken as the chunk's share of its tag's total, so stats measured in
+        // different units can be mixed
+        double cost = 0;
+        double weight = 0;
+
+        if ( totals.stats.dataSize > 0 ) {
+            cost += kDataSizeWeight * stats.dataSize / totals.stats.dataSize;
+            weight += kDataSizeWeight;
+        }
+
+        if ( totals.stats.writeBytes > 0 ) {
+            cost += kWriteWeight * stats.writeBytes / totals.stats.writeBytes;
+            weight += kWriteWeight;
+        }
+
+        if ( totals.stats.reads > 0 ) {
+            cost += kReadWeight * stats.reads / totals.stats.reads;
+            weight += kReadWeight;
+        }
+
+        if ( weight == 0 )
+            return totals.numChunks ? 1.0 / totals.numChunks : 0;
+
+        return cost / weight;
+    }
+
+    double DistributionStatus::shardCost( const string& shard, const string& tag ) const {
+        ShardToChunksMap::const_iterator i = _shardChunks.find( shard );
+        if ( i == _shardChunks.end() )
+            return 0;
+
+        double total = 0;
+        for ( unsigned j = 0; j < i->second.size(); j++ )
+            if ( tag == getTagForChunk( i->second[j] ) )
+                total += chunkCost( i->second[j] );
+
+        return total;
+    }
+
     const vector<BSONObj>& DistributionStatus::getChunks( const string& shard ) const {
         ShardToChunksMap::const_iterator i = _shardChunks.find(shard);
         verify( i != _shardChunks.end() );
@@ -356,6 +508,13 @@ namespace mongo {
         for ( unsigned i=0; i<tags.size(); i++ ) {
             string tag = tags[i];
 
+            if ( distribution.hasChunkStats() ) {
+                MigrateInfo* m = _balanceTagByCost( ns, distribution, tag, balancedLastTime );
+                if ( m )
+                    return m;
+                continue;
+            }
+
             string from = distribution.getMostOverloadedShard( tag );
             if ( from.size() == 0 )
                 continue;
@@ -414,6 +573,113 @@ namespace mongo {
         return NULL;
     }
 
+    MigrateInfo* BalancerPolicy::_balanceTagByCost( const string& ns,
+                                                    const DistributionStatus& distribution,
+                                                    const string& tag,
+                                                    int balancedLastTime ) {
+
+        string from = distribution.getHighestCostShard( tag );
+        if ( from.size() == 0 )
+            return NULL;
+
+        string to = distribution.getLowestCostReceiverShard( tag );
+        if ( to.size() == 0 ) {
+            log() << "no available shards to take chunks for tag [" << tag << "]" << endl;
+            return NULL;
+        }
+
+        if ( from == to )
+            return NULL;
+
+        const double maxCost = distribution.shardCost( from, tag );
+        const double minCost = distribution.shardCost( to, tag );
+        const double gap = maxCost - minCost;
+
+        // The costs of a tag's chunks add up to 1, so an even share is 1 / receivers.  Allow a
+        // gap of a quarter of that, or a tenth while we are already moving chunks.
+        const unsigned receivers = std::max( distribution.numberOfReceiverShards( tag ), 1U );
+        const double threshold = ( balancedLastTime ? 0.1 : 0.25 ) / receivers;
+
+        LOG(1) << "collection : " << ns << endl;
+        LOG(1) << "donor      : " << from << " cost " << maxCost << endl;
+        LOG(1) << "receiver   : " << to << " cost " << minCost << endl;
+        LOG(1) << "threshold  : " << threshold << endl;
+
+        if ( gap <= threshold )
+            return NULL;
+
+        // The chunk costing nearest half the gap evens the two shards out the most.  One that
+        // costs the whole gap or more would only swap which of them is overloaded.
+        const vector<BSONObj>& chunks = distribution.getChunks( from );
+        int best = -1;
+        double bestDistance = numeric_limits<double>::max();
+        unsigned numJumboChunks = 0;
+
+        for ( unsigned j = 0; j < chunks.size(); j++ ) {
+            if ( distribution.getTagForChunk( chunks[j] ) != tag )
+                continue;
+
+            const double cost = distribution.chunkCost( chunks[j] );
+            if ( cost <= 0 || cost >= gap )
+                continue;
+
+            if ( _isJumbo( chunks[j] ) ) {
+                numJumboChunks++;
+                continue;
+            }
+
+            const double distance = fabs( cost - gap / 2 );
+            if ( distance < bestDistance ) {
+                best = j;
+                bestDistance = distance;
+            }
+        }
+
+        if ( best < 0 ) {
+            LOG(1) << "no chunk on " << from << " would even out its cost with " << to
+                   << " tag [" << tag << "] numJumboChunks: " << numJumboChunks << endl;
+            return NULL;
+        }
+
+        log() << " ns: " << ns << " going to move " << chunks[best]
+              << " from: " << from << " to: " << to << " tag [" << tag << "]"
+              << " cost: " << distribution.chunkCost( chunks[best] ) << " of gap: " << gap
+              << endl;
+        return new MigrateInfo( ns, to, from, chunks[best] );
+    }
+
+    vector< vector<size_t> > BalancerPolicy::groupNonConflicting(
+            const vector<const MigrateInfo*>& migrations ) {
+
+        vector< vector<size_t> > rounds;
+
+        // Last round each shard, or collection, takes part in.  A collection can only have one
+        // migration at a time because the donor takes its distributed lock.
+        map<string,size_t> lastRound;
+
+        for ( size_t i = 0; i < migrations.size(); i++ ) {
+            const MigrateInfo* m = migrations[i];
+
+            string resources[3] = { "shard:" + m->from, "shard:" + m->to, "ns:" + m->ns };
+
+            size_t round = 0;
+            for ( int r = 0; r < 3; r++ ) {
+                map<string,size_t>::const_iterator last = lastRound.find( resources[r] );
+                if ( last != lastRound.end() )
+                    round = std::max( round, last->second + 1 );
+            }
+
+            if ( round == rounds.size() )
+                rounds.push_back( vector<size_t>() );
+            rounds[round].push_back( i );
+
+            for ( int r = 0; r < 3; r++ )
+                lastRound[resources[r]] = round;
+        }
+
+        return rounds;
+    }
+
 
     ShardInfo::ShardInfo( long long maxSize, long long currSize,
                           bool draining, bool opsQueued,
@@ -124,8 +124,24 @@ namespace mongo {
 
     };
 
+    /**
+     * What the cost based policy knows about one chunk: an estimate of the data it holds and the
+     * traffic routed to it since the last balancing round.
+     */
+    struct ChunkStats {
+        ChunkStats() : dataSize( 0 ), writeBytes( 0 ), reads( 0 ) {}
+
+        ChunkStats( long long a_dataSize, long long a_writeBytes, long long a_reads )
+            : dataSize( a_dataSize ), writeBytes( a_writeBytes ), reads( a_reads ) {}
+
+        long long dataSize;
+        long long writeBytes;
+        long long reads;
+    };
+
     typedef map< string,ShardInfo > ShardInfoMap;
     typedef map< string,vector<BSONObj> > ShardToChunksMap;
+    typedef map< BSONObj,ChunkStats > ChunkStatsMap; // chunk min -> stats
 
     class DistributionStatus : boost::noncopyable {
     public:
@@ -139,6 +155,12 @@ namespace mongo {
          */
         bool addTagRange( const TagRange& range );
 
+        /**
+         * Makes BalancerPolicy::balance() even out chunk costs rather than chunk counts.  Chunks
+         * missing from 'stats' cost nothing.  'stats' must outlive this.
+         */
+        void setChunkStats( const ChunkStatsMap* stats );
+
         // ---- these methods might be better suiting in BalancerPolicy
         
         /**
@@ -153,6 +175,20 @@ namespace mongo {
          */
         string getMostOverloadedShard( const string& forTag ) const;
 
+        /**
+         * @param forTag "" if you don't care, or a tag
+         * @return shard best suited to receive a chunk, by cost of chunks with the given tag
+         */
+        string getLowestCostReceiverShard( const string& forTag ) const;
+
+        /**
+         * @return the shard with the highest cost of chunks with the given tag
+         */
+        string getHighestCostShard( const string& forTag ) const;
+
+        /** @return number of shards that could take chunks with the given tag */
+        unsigned numberOfReceiverShards( const string& forTag ) const;
+
 
         // ---- basic accessors, counters, etc...
 
@@ -173,6 +209,19 @@ namespace mongo {
 
         /** @return the right tag for chunk, possibly "" */
         string getTagForChunk( const BSONObj& chunk ) const;
+
+        /** @return true if setChunkStats() was given stats */
+        bool hasChunkStats() const { return _chunkStats != NULL; }
+
+        /**
+         * @return the chunk's share, from 0 to 1, of the cost of every chunk with its tag.  Cost
+         *         mixes data size, bytes written and reads; with no stats every chunk costs
+         *         the same.
+         */
+        double chunkCost( const BSONObj& chunk ) const;
+
+        /** @return sum of chunkCost() for the shard's chunks with the given tag */
+        double shardCost( const string& shard, const string& tag ) const;
         
         /** @return all shards we know about */
         const set<string>& shards() const { return _shards; }
@@ -184,11 +233,23 @@ namespace mongo {
         void dump() const;
         
     private:
+        struct TagTotals {
+            TagTotals() : numChunks( 0 ) {}
+            ChunkStats stats;
+            unsigned numChunks;
+        };
+
+        const ChunkStats& _statsFor( const BSONObj& chunk ) const;
+        const TagTotals& _totalsFor( const string& tag ) const;
+
         const ShardInfoMap& _shardInfo;
         const ShardToChunksMap& _shardChunks;
         map<BSONObj,TagRange> _tagRanges;
         set<string> _allTags;
         set<string> _shards;
+
+        const ChunkStatsMap* _chunkStats;
+        mutable map<string,TagTotals> _tagTotals; // filled in as chunkCost() needs them
     };
 
     class BalancerPolicy {
@@ -209,8 +270,27 @@ namespace mongo {
                                      const DistributionStatus& distribution,
                                      int balancedLastTime );
 
+        /**
+         * Groups migrations into rounds whose migrations can run at the same time, because no
+         * shard takes part in more than one migration of a round.  Migrations keep their order
+         * within and across rounds.
+         *
+         * @return indexes into 'migrations', one vector per round
+         */
+        static vector< vector<size_t> > groupNonConflicting(
+                const vector<const MigrateInfo*>& migrations );
+
     private:
         static bool _isJumbo( const BSONObj& chunk );
+
+        /**
+         * Step 3 of balance() for one tag when the distribution has chunk stats: moves the chunk
+         * from the costliest to the cheapest shard that best halves the gap between them.
+         */
+        static MigrateInfo* _balanceTagByCost( const string& ns,
+                                               const DistributionStatus& distribution,
+                                               const string& tag,
+                                               int balancedLastTime );
     };
 
 
@@ -368,6 +368,139 @@ namespace mongo {
             ASSERT( !m );
         }
 
+        /**
+         * Both shards hold two chunks, but shard0's are much bigger.  Counting chunks would leave
+         * this alone; weighing them by size moves one of the big ones.
+         */
+        TEST( BalancerPolicyTests, CostMovesByDataSize ) {
+            ShardToChunksMap chunkMap;
+            vector<BSONObj> chunks;
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << BSON("$minKey"<<1))) <<
+                                  ChunkType::max(BSON("x" << 10))));
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << 10)) <<
+                                  ChunkType::max(BSON("x" << 20))));
+            chunkMap["shard0"] = chunks;
+            chunks.clear();
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << 20)) <<
+                                  ChunkType::max(BSON("x" << 30))));
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << 30)) <<
+                                  ChunkType::max(BSON("x" << BSON("$maxkey"<<1)))));
+            chunkMap["shard1"] = chunks;
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo( 0, 2, false, false );
+            info["shard1"] = ShardInfo( 0, 2, false, false );
+
+            DistributionStatus status( info, chunkMap );
+            ASSERT( ! BalancerPolicy::balance( "ns", status, 0 ) );
+
+            ChunkStatsMap stats;
+            stats[BSON("x" << BSON("$minKey"<<1))] = ChunkStats( 400, 0, 0 );
+            stats[BSON("x" << 10)] = ChunkStats( 400, 0, 0 );
+            stats[BSON("x" << 20)] = ChunkStats( 100, 0, 0 );
+            stats[BSON("x" << 30)] = ChunkStats( 100, 0, 0 );
+            status.setChunkStats( &stats );
+
+            ASSERT_APPROX_EQUAL( 0.8, status.shardCost( "shard0", "" ), 0.0001 );
+            ASSERT_APPROX_EQUAL( 0.2, status.shardCost( "shard1", "" ), 0.0001 );
+
+            MigrateInfo* m = BalancerPolicy::balance( "ns", status, 0 );
+            ASSERT( m );
+            ASSERT_EQUALS( "shard0", m->from );
+            ASSERT_EQUALS( "shard1", m->to );
+            delete m;
+        }
+
+        /**
+         * A chunk that costs more than the gap between two shards would only move the imbalance
+         * around, so it stays put.
+         */
+        TEST( BalancerPolicyTests, CostKeepsHotChunk ) {
+            ShardToChunksMap chunkMap;
+            vector<BSONObj> chunks;
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << BSON("$minKey"<<1))) <<
+                                  ChunkType::max(BSON("x" << 49))));
+            chunkMap["shard0"] = chunks;
+            chunks.clear();
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << 49)) <<
+                                  ChunkType::max(BSON("x" << BSON("$maxkey"<<1)))));
+            chunkMap["shard1"] = chunks;
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo( 0, 1, false, false );
+            info["shard1"] = ShardInfo( 0, 1, false, false );
+
+            // every read goes to shard0's chunk
+            ChunkStatsMap stats;
+            stats[BSON("x" << BSON("$minKey"<<1))] = ChunkStats( 500, 0, 1000 );
+            stats[BSON("x" << 49)] = ChunkStats( 500, 0, 0 );
+
+            DistributionStatus status( info, chunkMap );
+            status.setChunkStats( &stats );
+
+            ASSERT( status.shardCost( "shard0", "" ) > status.shardCost( "shard1", "" ) );
+            ASSERT( ! BalancerPolicy::balance( "ns", status, 0 ) );
+        }
+
+        /**
+         * Without any measurements every chunk costs the same, so the cost policy still evens
+         * out chunk counts.
+         */
+        TEST( BalancerPolicyTests, CostWithoutStats ) {
+            ShardToChunksMap chunkMap;
+            vector<BSONObj> chunks;
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << BSON("$minKey"<<1))) <<
+                                  ChunkType::max(BSON("x" << 49))));
+            chunks.push_back(BSON(ChunkType::min(BSON("x" << 49)) <<
+                                  ChunkType::max(BSON("x" << BSON("$maxkey"<<1)))));
+            chunkMap["shard0"] = chunks;
+            chunks.clear();
+            chunkMap["shard1"] = chunks;
+
+            ShardInfoMap info;
+            info["shard0"] = ShardInfo( 0, 2, false, false );
+            info["shard1"] = ShardInfo( 0, 0, false, false );
+
+            ChunkStatsMap stats;
+            DistributionStatus status( info, chunkMap );
+            status.setChunkStats( &stats );
+
+            ASSERT_APPROX_EQUAL( 0.5, status.chunkCost( chunkMap["shard0"][0] ), 0.0001 );
+
+            MigrateInfo* m = BalancerPolicy::balance( "ns", status, 0 );
+            ASSERT( m );
+            ASSERT_EQUALS( "shard0", m->from );
+            ASSERT_EQUALS( "shard1", m->to );
+            delete m;
+        }
+
+        TEST( BalancerPolicyTests, GroupNonConflicting ) {
+            MigrateInfo m0( "test.a", "shard1", "shard0", BSONObj() );
+            MigrateInfo m1( "test.b", "shard3", "shard2", BSONObj() );
+            MigrateInfo m2( "test.c", "shard2", "shard1", BSONObj() ); // shares shard1 with m0
+            MigrateInfo m3( "test.d", "shard5", "shard4", BSONObj() );
+            MigrateInfo m4( "test.a", "shard7", "shard6", BSONObj() ); // same collection as m0
+
+            vector<const MigrateInfo*> migrations;
+            migrations.push_back( &m0 );
+            migrations.push_back( &m1 );
+            migrations.push_back( &m2 );
+            migrations.push_back( &m3 );
+            migrations.push_back( &m4 );
+
+            vector< vector<size_t> > rounds = BalancerPolicy::groupNonConflicting( migrations );
+            ASSERT_EQUALS( 2U, rounds.size() );
+
+            ASSERT_EQUALS( 3U, rounds[0].size() );
+            ASSERT_EQUALS( 0U, rounds[0][0] );
+            ASSERT_EQUALS( 1U, rounds[0][1] );
+            ASSERT_EQUALS( 3U, rounds[0][2] );
+
+            ASSERT_EQUALS( 2U, rounds[1].size() );
+            ASSERT_EQUALS( 2U, rounds[1][0] );
+            ASSERT_EQUALS( 4U, rounds[1][1] );
+        }
+
         /**
          * Idea behind this test is that we set up several shards, the first two of which are
          * draining and the second two of which have a data size limit.  We also simulate a random
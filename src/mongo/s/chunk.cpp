@@ -34,8 +34,11 @@
 
 #include "mongo/client/connpool.h"
 #include "mongo/client/dbclientcursor.h"
+#include "mongo/base/counter.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/query/lite_parsed_query.h"
 #include "mongo/db/queryutil.h"
+#include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/write_concern.h"
 #include "mongo/platform/random.h"
 #include "mongo/s/chunk_diff.h"
@@ -73,7 +76,7 @@ namespace mongo {
     bool Chunk::ShouldAutoSplit = true;
 
     Chunk::Chunk(const ChunkManager * manager, BSONObj from)
-        : _manager(manager), _lastmod(0, OID()), _dataWritten(mkDataWritten())
+        : _lineage(manager->_lineage), _lastmod(0, OID()), _dataWritten(mkDataWritten())
     {
         string ns = from.getStringField(ChunkType::ns().c_str());
         _shard.reset(from.getStringField(ChunkType::shard().c_str()));
@@ -87,7 +90,7 @@ namespace mongo {
         _jumbo = from[ChunkType::jumbo()].trueValue();
 
         uassert( 10170 ,  "Chunk needs a ns" , ! ns.empty() );
-        uassert( 13327 ,  "Chunk ns must match server ns" , ns == _manager->getns() );
+        uassert( 13327 ,  "Chunk ns must match server ns" , ns == _lineage->getns() );
 
         uassert( 10171 ,  "Chunk needs a server" , _shard.ok() );
 
@@ -96,17 +99,17 @@ namespace mongo {
     }
 
     Chunk::Chunk(const ChunkManager * info , const BSONObj& min, const BSONObj& max, const Shard& shard, ChunkVersion lastmod)
-        : _manager(info), _min(min), _max(max), _shard(shard), _lastmod(lastmod), _jumbo(false), _dataWritten(mkDataWritten())
+        : _lineage(info->_lineage), _min(min), _max(max), _shard(shard), _lastmod(lastmod), _jumbo(false), _dataWritten(mkDataWritten())
     {}
 
     int Chunk::mkDataWritten() {
         PseudoRandom r(static_cast<int64_t>(time(0)));
-        return r.nextInt32( MaxChunkSize / ChunkManager::SplitHeuristics::splitTestFactor );
+        return r.nextInt32( MaxChunkSize / ChunkManagerLineage::SplitHeuristics::splitTestFactor );
     }
 
     string Chunk::getns() const {
-        verify( _manager );
-        return _manager->getns();
+        verify( _lineage );
+        return _lineage->getns();
     }
 
     bool Chunk::containsPoint( const BSONObj& point ) const {
@@ -119,23 +122,23 @@ namespace mongo {
     }
 
     bool Chunk::minIsInf() const {
-        return _manager->getShardKey().globalMin().woCompare( getMin() ) == 0;
+        return _lineage->getShardKey().globalMin().woCompare( getMin() ) == 0;
     }
 
     bool Chunk::maxIsInf() const {
-        return _manager->getShardKey().globalMax().woCompare( getMax() ) == 0;
+        return _lineage->getShardKey().globalMax().woCompare( getMax() ) == 0;
     }
 
     BSONObj Chunk::_getExtremeKey( int sort ) const {
         Query q;
         if ( sort == 1 ) {
-            q.sort( _manager->getShardKey().key() );
+            q.sort( _lineage->getShardKey().key() );
         }
         else {
             // need to invert shard key pattern to sort backwards
             // TODO: make a helper in ShardKeyPattern?
 
-            BSONObj k = _manager->getShardKey().key();
+            BSONObj k = _lineage->getShardKey().key();
             BSONObjBuilder r;
 
             BSONObjIterator i(k);
@@ -149,11 +152,11 @@ namespace mongo {
         }
         // find the extreme key
         ScopedDbConnection conn(getShard().getConnString());
-        BSONObj end = conn->findOne(_manager->getns(), q);
+        BSONObj end = conn->findOne(_lineage->getns(), q);
         conn.done();
         if ( end.isEmpty() )
             return BSONObj();
-        return _manager->getShardKey().extractKey( end );
+        return _lineage->getShardKey().extractKey( end );
     }
 
     void Chunk::pickMedianKey( BSONObj& medianKey ) const {
@@ -161,8 +164,8 @@ namespace mongo {
         ScopedDbConnection conn(getShard().getConnString());
         BSONObj result;
         BSONObjBuilder cmd;
-        cmd.append( "splitVector" , _manager->getns() );
-        cmd.append( "keyPattern" , _manager->getShardKey().key() );
+        cmd.append( "splitVector" , _lineage->getns() );
+        cmd.append( "keyPattern" , _lineage->getShardKey().key() );
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.appendBool( "force" , true );
@@ -188,8 +191,8 @@ namespace mongo {
         ScopedDbConnection conn(getShard().getConnString());
         BSONObj result;
         BSONObjBuilder cmd;
-        cmd.append( "splitVector" , _manager->getns() );
-        cmd.append( "keyPattern" , _manager->getShardKey().key() );
+        cmd.append( "splitVector" , _lineage->getns() );
+        cmd.append( "keyPattern" , _lineage->getShardKey().key() );
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.append( "maxChunkSizeBytes" , chunkSize );
@@ -220,7 +223,7 @@ namespace mongo {
         if ( ! force ) {
             vector<BSONObj> candidates;
             const int maxPoints = 2;
-            pickSplitVector( candidates , getManager()->getCurrentDesiredChunkSize() , maxPoints , MaxObjectPerChunk );
+            pickSplitVector( candidates , _lineage->getCurrentDesiredChunkSize() , maxPoints , MaxObjectPerChunk );
             if ( candidates.size() <= 1 ) {
                 // no split points means there isn't enough data to split on
                 // 1 split point means we have between half the chunk size to full chunk size
@@ -281,7 +284,7 @@ namespace mongo {
     bool Chunk::multiSplit( const vector<BSONObj>& m , BSONObj& res ) const {
         const size_t maxSplitPoints = 8192;
 
-        uassert( 10165 , "can't split as shard doesn't have a manager" , _manager );
+        uassert( 10165 , "can't split as shard doesn't have a manager" , _lineage );
         uassert( 13332 , "need a split key to split chunk" , !m.empty() );
         uassert( 13333 , "can't split a chunk in that many parts", m.size() < maxSplitPoints );
         uassert( 13003 , "can't split a chunk with only one distinct value" , _min.woCompare(_max) );
@@ -289,8 +292,8 @@ namespace mongo {
         ScopedDbConnection conn(getShard().getConnString());
 
         BSONObjBuilder cmd;
-        cmd.append( "splitChunk" , _manager->getns() );
-        cmd.append( "keyPattern" , _manager->getShardKey().key() );
+        cmd.append( "splitChunk" , _lineage->getns() );
+        cmd.append( "keyPattern" , _lineage->getShardKey().key() );
         cmd.append( "min" , getMin() );
         cmd.append( "max" , getMax() );
         cmd.append( "from" , getShard().getName() );
@@ -304,7 +307,7 @@ namespace mongo {
             conn.done();
 
             // Mark the minor version for *eventual* reload
-            _manager->markMinorForReload( this->_lastmod );
+            _lineage->markMinorForReload( this->_lastmod );
 
             return false;
         }
@@ -312,7 +315,7 @@ namespace mongo {
         conn.done();
         
         // force reload of config
-        _manager->reload();
+        _lineage->reload();
 
         return true;
     }
@@ -326,14 +329,14 @@ namespace mongo {
     {
         uassert( 10167 ,  "can't move shard to its current location!" , getShard() != to );
 
-        log() << "moving chunk ns: " << _manager->getns() << " moving ( " << toString() << ") " << _shard.toString() << " -> " << to.toString() << endl;
+        log() << "moving chunk ns: " << _lineage->getns() << " moving ( " << toString() << ") " << _shard.toString() << " -> " << to.toString() << endl;
 
         Shard from = _shard;
 
         ScopedDbConnection fromconn(from.getConnString());
 
         bool worked = fromconn->runCommand( "admin" ,
-                                            BSON( "moveChunk" << _manager->getns() <<
+                                            BSON( "moveChunk" << _lineage->getns() <<
                                                   "from" << from.getAddress().toString() <<
                                                   "to" << to.getAddress().toString() <<
                                                   // NEEDED FOR 2.0 COMPATIBILITY
@@ -357,7 +360,7 @@ namespace mongo {
         // if succeeded, needs to reload to pick up the new location
         // if failed, mongos may be stale
         // reload is excessive here as the failure could be simply because collection metadata is taken
-        _manager->reload();
+        _lineage->reload();
 
         return worked;
     }
@@ -366,21 +369,23 @@ namespace mongo {
         dassert( ShouldAutoSplit );
         LastError::Disabled d( lastError.get() );
 
+        _bytesWrittenSinceBalance.fetchAndAdd( dataWritten );
+
         try {
             _dataWritten += dataWritten;
-            int splitThreshold = getManager()->getCurrentDesiredChunkSize();
+            int splitThreshold = _lineage->getCurrentDesiredChunkSize();
             if ( minIsInf() || maxIsInf() ) {
                 splitThreshold = (int) ((double)splitThreshold * .9);
             }
 
-            if ( _dataWritten < splitThreshold / ChunkManager::SplitHeuristics::splitTestFactor )
+            if ( _dataWritten < splitThreshold / ChunkManagerLineage::SplitHeuristics::splitTestFactor )
                 return false;
             
-            if ( ! getManager()->_splitHeuristics._splitTickets.tryAcquire() ) {
-                LOG(1) << "won't auto split because not enough tickets: " << getManager()->getns() << endl;
+            if ( ! _lineage->_splitHeuristics._splitTickets.tryAcquire() ) {
+                LOG(1) << "won't auto split because not enough tickets: " << _lineage->getns() << endl;
                 return false;
             }
-            TicketHolderReleaser releaser( &(getManager()->_splitHeuristics._splitTickets) );
+            TicketHolderReleaser releaser( &(_lineage->_splitHeuristics._splitTickets) );
 
             // this is a bit ugly
             // we need it so that mongos blocks for the writes to actually be committed
@@ -412,9 +417,9 @@ namespace mongo {
                 _dataWritten = 0; // we're splitting, so should wait a bit
             }
 
-            bool shouldBalance = grid.shouldBalance( _manager->getns() );
+            bool shouldBalance = grid.shouldBalance( _lineage->getns() );
 
-            log() << "autosplitted " << _manager->getns() << " shard: " << toString()
+            log() << "autosplitted " << _lineage->getns() << " shard: " << toString()
                   << " on: " << splitPoint << " (splitThreshold " << splitThreshold << ")"
 #ifdef _DEBUG
                   << " size: " << getPhysicalSize() // slow - but can be useful when debugging
@@ -438,7 +443,7 @@ namespace mongo {
                     return true; // we did split even if we didn't migrate
                 }
 
-                ChunkManagerPtr cm = _manager->reload(false/*just reloaded in mulitsplit*/);
+                ChunkManagerPtr cm = _lineage->reload(false/*just reloaded in mulitsplit*/);
                 ChunkPtr toMove = cm->findIntersectingChunk(min);
 
                 if ( ! (toMove->getMin() == min && toMove->getMax() == max) ){
@@ -459,7 +464,7 @@ namespace mongo {
                                                 res ) );
                 
                 // update our config
-                _manager->reload();
+                _lineage->reload();
             }
 
             return true;
@@ -472,7 +477,7 @@ namespace mongo {
             _dataWritten = mkDataWritten();
 
             // if the collection lock is taken (e.g. we're migrating), it is fine for the split to fail.
-            warning() << "could not autosplit collection " << _manager->getns() << causedBy( e ) << endl;
+            warning() << "could not autosplit collection " << _lineage->getns() << causedBy( e ) << endl;
             return false;
         }
     }
@@ -482,8 +487,8 @@ namespace mongo {
 
         BSONObj result;
         uassert( 10169 ,  "datasize failed!" , conn->runCommand( "admin" ,
-                 BSON( "datasize" << _manager->getns()
-                       << "keyPattern" << _manager->getShardKey().key()
+                 BSON( "datasize" << _lineage->getns()
+                       << "keyPattern" << _lineage->getShardKey().key()
                        << "min" << getMin()
                        << "max" << getMax()
                        << "maxSize" << ( MaxChunkSize + 1 )
@@ -507,7 +512,7 @@ namespace mongo {
 
     void Chunk::serialize(BSONObjBuilder& to,ChunkVersion myLastMod) {
 
-        to.append( "_id" , genID( _manager->getns() , _min ) );
+        to.append( "_id" , genID( _lineage->getns() , _min ) );
 
         if ( myLastMod.isSet() ) {
             myLastMod.addToBSON(to, ChunkType::DEPRECATED_lastmod());
@@ -519,7 +524,7 @@ namespace mongo {
             verify(0);
         }
 
-        to << ChunkType::ns(_manager->getns());
+        to << ChunkType::ns(_lineage->getns());
         to << ChunkType::min(_min);
         to << ChunkType::max(_max);
         to << ChunkType::shard(_shard.getName());
@@ -540,7 +545,7 @@ namespace mongo {
 
     string Chunk::toString() const {
         stringstream ss;
-        ss << ChunkType::ns()                 << ": " << _manager->getns()   << ", "
+        ss << ChunkType::ns()                 << ": " << _lineage->getns()   << ", "
            << ChunkType::shard()              << ": " << _shard.toString()   << ", "
            << ChunkType::DEPRECATED_lastmod() << ": " << _lastmod.toString() << ", "
            << ChunkType::min()                << ": " << _min                << ", "
@@ -549,7 +554,7 @@ namespace mongo {
     }
 
     ShardKeyPattern Chunk::skey() const {
-        return _manager->getShardKey();
+        return _lineage->getShardKey();
     }
 
     void Chunk::markAsJumbo() const {
@@ -609,14 +614,50 @@ namespace mongo {
         return true;
     }
 
+    // -------  ChunkManagerLineage --------
+
+    ChunkManagerPtr ChunkManagerLineage::reload( bool force ) const {
+        return grid.getDBConfig( _ns )->getChunkManager( _ns, force );
+    }
+
+    void ChunkManagerLineage::markMinorForReload( ChunkVersion majorVersion ) const {
+        _splitHeuristics.markMinorForReload( _ns, majorVersion );
+    }
+
+    int ChunkManagerLineage::getCurrentDesiredChunkSize() const {
+        return desiredChunkSize( _numChunks.load() );
+    }
+
     // -------  ChunkManager --------
 
+    // Time taken by each ChunkManager load, whether full or from an older manager
+    static TimerStats chunkManagerLoadStats;
+    static ServerStatusMetricField<TimerStats> displayChunkManagerLoads(
+                                                    "sharding.chunkManager.loads",
+                                                    &chunkManagerLoadStats );
+    // Chunks read from the config server and created by loads
+    static Counter64 chunksLoadedStats;
+    static ServerStatusMetricField<Counter64> displayChunksLoaded(
+                                                    "sharding.chunkManager.chunksLoaded",
+                                                    &chunksLoadedStats );
+    // Chunks a load kept from the manager it was loaded from rather than creating again
+    static Counter64 chunksSharedStats;
+    static ServerStatusMetricField<Counter64> displayChunksShared(
+                                                    "sharding.chunkManager.chunksShared",
+                                                    &chunksSharedStats );
+    // Approximate bytes loads allocated for new chunks and for each manager's chunk containers
+    static Counter64 loadBytesStats;
+    static ServerStatusMetricField<Counter64> displayLoadBytes(
+                                                    "sharding.chunkManager.loadBytes",
+                                                    &loadBytesStats );
+
     AtomicUInt ChunkManager::NextSequenceNumber = 1;
 
     ChunkManager::ChunkManager( const string& ns, const ShardKeyPattern& pattern , bool unique ) :
         _ns( ns ),
         _key( pattern ),
         _unique( unique ),
+        _lineage( new ChunkManagerLineage( _ns, _key ) ),
         _chunkRanges(),
         _mutex("ChunkManager"),
         _sequenceNumber(++NextSequenceNumber)
@@ -636,6 +677,7 @@ namespace mongo {
                                                         collDoc[CollectionType::keyPattern()].Obj().getOwned() :
                                                         BSONObj()),
         _unique(collDoc[CollectionType::unique()].trueValue()),
+        _lineage( new ChunkManagerLineage( _ns, _key ) ),
         _chunkRanges(),
         _mutex("ChunkManager"),
         // The shard versioning mechanism hinges on keeping track of the number of times we reloaded ChunkManager's.
@@ -658,6 +700,7 @@ namespace mongo {
         _ns( oldManager->getns() ),
         _key( oldManager->getShardKey() ),
         _unique( oldManager->isUnique() ),
+        _lineage( oldManager->_lineage ),
         _chunkRanges(),
         _mutex("ChunkManager"),
         _sequenceNumber(++NextSequenceNumber)
@@ -700,6 +743,17 @@ namespace mongo {
                     const_cast<set<Shard>&>(_shards).swap(shards);
                     const_cast<ShardVersionMap&>(_shardVersions).swap(shardVersions);
                     const_cast<ChunkRangeManager&>(_chunkRanges).reloadAll(_chunkMap);
+                    _buildRoutingIndex();
+
+                    _lineage->setNumChunks( _chunkMap.size() );
+                    // the minor versions marked for reload were just loaded
+                    _lineage->_splitHeuristics.clearMarkedMinorVersions();
+
+                    // a node per chunk in the chunk map, and an entry in each routing array
+                    const size_t bytesPerChunk = sizeof(ChunkMap::value_type) + 4 * sizeof(void*) +
+                        sizeof(unsigned long long) + sizeof(BSONObj) + sizeof(ChunkPtr);
+                    loadBytesStats.increment( _chunkMap.size() * bytesPerChunk );
+                    chunkManagerLoadStats.recordMillis( t.millis() );
 
                     // Once we load data, clear reference to old manager
                     _oldManager.reset();
@@ -731,7 +785,8 @@ namespace mongo {
      */
     class CMConfigDiffTracker : public ConfigDiffTracker<ChunkPtr,Shard> {
     public:
-        CMConfigDiffTracker( ChunkManager* manager ) : _manager( manager ) {}
+        CMConfigDiffTracker( ChunkManager* manager )
+            : _manager( manager ) , _newChunks( 0 ) , _newChunkBytes( 0 ) {}
 
         virtual bool isTracked( const BSONObj& chunkDoc ) const {
             // Mongos tracks all shards
@@ -746,6 +801,8 @@ namespace mongo {
 
         virtual pair<BSONObj,ChunkPtr> rangeFor( const BSONObj& chunkDoc, const BSONObj& min, const BSONObj& max ) const {
             ChunkPtr c( new Chunk( _manager, chunkDoc ) );
+            _newChunks++;
+            _newChunkBytes += sizeof(Chunk) + c->getMin().objsize() + c->getMax().objsize();
             return make_pair( max, c );
         }
 
@@ -759,6 +816,10 @@ namespace mongo {
 
         ChunkManager* _manager;
 
+        // chunks created by rangeFor and roughly the bytes they took; it's const
+        mutable long long _newChunks;
+        mutable long long _newChunkBytes;
+
     };
 
     bool ChunkManager::_load( const string& config,
@@ -781,24 +842,11 @@ namespace mongo {
             // Load a copy of the old versions
             shardVersions = oldManager->_shardVersions;
 
-            // Load a copy of the chunk map, replacing the chunk manager with our own
-            const ChunkMap& oldChunkMap = oldManager->getChunkMap();
-
-            // Could be v.expensive
-            // TODO: If chunks were immutable and didn't reference the manager, we could do more
-            // interesting things here
-            for( ChunkMap::const_iterator it = oldChunkMap.begin(); it != oldChunkMap.end(); it++ ){
-
-                ChunkPtr oldC = it->second;
-                ChunkPtr c( new Chunk( this, oldC->getMin(),
-                                             oldC->getMax(),
-                                             oldC->getShard(),
-                                             oldC->getLastmod() ) );
-
-                c->setBytesWritten( oldC->getBytesWritten() );
-
-                chunkMap.insert( make_pair( oldC->getMax(), c ) );
-            }
+            // Start from the old chunk map.  Chunks only refer to the lineage we share with
+            // oldManager, so the unchanged ones are shared rather than copied, and the diff
+            // below replaces the ones that changed
+            const ChunkMap& oldChunkMap = oldManager->_chunkMap;
+            chunkMap = oldChunkMap;
 
             // Also get any minor versions stored for reload
             oldManager->getMarkedMinorVersions( minorVersions );
@@ -819,6 +867,11 @@ namespace mongo {
             LOG(2) << "loaded " << diffsApplied << " chunks into new chunk manager for " << _ns
                    << " with version " << _version << endl;
 
+            chunksLoadedStats.increment( differ._newChunks );
+            chunksSharedStats.increment( std::max( 0LL, (long long)chunkMap.size() -
+                                                        differ._newChunks ) );
+            loadBytesStats.increment( differ._newChunkBytes );
+
             // Add all the shards we find to the shards set
             for( ShardVersionMap::iterator it = shardVersions.begin(); it != shardVersions.end(); it++ ){
                 shards.insert( it->first );
@@ -867,18 +920,18 @@ namespace mongo {
     }
 
     ChunkManagerPtr ChunkManager::reload(bool force) const {
-        return grid.getDBConfig(getns())->getChunkManager(getns(), force);
+        return _lineage->reload(force);
     }
 
     void ChunkManager::markMinorForReload( ChunkVersion majorVersion ) const {
-        _splitHeuristics.markMinorForReload( getns(), majorVersion );
+        _lineage->markMinorForReload( majorVersion );
     }
 
     void ChunkManager::getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) const {
-        _splitHeuristics.getMarkedMinorVersions( minorVersions );
+        _lineage->_splitHeuristics.getMarkedMinorVersions( minorVersions );
     }
 
-    void ChunkManager::SplitHeuristics::markMinorForReload( const string& ns, ChunkVersion majorVersion ) {
+    void ChunkManagerLineage::SplitHeuristics::markMinorForReload( const string& ns, ChunkVersion majorVersion ) {
 
         // When we get a stale minor version, it means that some *other* mongos has just split a
         // chunk into a number of smaller parts, so we shouldn't need reload the data needed to
@@ -916,13 +969,18 @@ namespace mongo {
             grid.getDBConfig( ns )->getChunkManagerIfExists( ns, true, true );
     }
 
-    void ChunkManager::SplitHeuristics::getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) {
+    void ChunkManagerLineage::SplitHeuristics::getMarkedMinorVersions( set<ChunkVersion>& minorVersions ) {
         scoped_lock lk( _staleMinorSetMutex );
         for( set<ChunkVersion>::iterator it = _staleMinorSet.begin(); it != _staleMinorSet.end(); it++ ){
             minorVersions.insert( *it );
         }
     }
 
+    void ChunkManagerLineage::SplitHeuristics::clearMarkedMinorVersions() {
+        scoped_lock lk( _staleMinorSetMutex );
+        _staleMinorSet.clear();
+    }
+
     bool ChunkManager::_isValid(const ChunkMap& chunkMap) {
 #define ENSURE(x) do { if(!(x)) { log() << "ChunkManager::_isValid failed: " #x << endl; return false; } } while(0)
 
@@ -951,6 +1009,21 @@ namespace mongo {
 #undef ENSURE
     }
 
+    void ChunkManager::_buildRoutingIndex() {
+        vector<BSONObj> maxes;
+        vector<ChunkPtr> chunks;
+        maxes.reserve( _chunkMap.size() );
+        chunks.reserve( _chunkMap.size() );
+        for ( ChunkMap::const_iterator it = _chunkMap.begin(); it != _chunkMap.end(); ++it ) {
+            maxes.push_back( it->first );
+            chunks.push_back( it->second );
+        }
+
+        // const for thread-safety, only built from the constructing thread like _chunkMap
+        const_cast<ChunkRoutingIndex&>(_routingIndex).reset( maxes );
+        const_cast<vector<ChunkPtr>&>(_routingChunks).swap( chunks );
+    }
+
     void ChunkManager::_printChunks() const {
         for (ChunkMap::const_iterator it=_chunkMap.begin(), end=_chunkMap.end(); it != end; ++it) {
             log() << *it->second << endl;
@@ -1077,10 +1150,10 @@ namespace mongo {
             BSONObj foo;
             ChunkPtr c;
             {
-                ChunkMap::const_iterator it = _chunkMap.upper_bound( point );
-                if (it != _chunkMap.end()) {
-                    foo = it->first;
-                    c = it->second;
+                size_t pos = _routingIndex.upperBound( point );
+                if (pos < _routingChunks.size()) {
+                    foo = _routingChunks[pos]->getMax();
+                    c = _routingChunks[pos];
                 }
             }
 
@@ -1152,6 +1225,10 @@ namespace mongo {
                 BoundList ranges = _key.keyBounds( frsp->getSingleKeyFRS() );
                 for ( BoundList::const_iterator it=ranges.begin(); it != ranges.end(); ++it ){
 
+                    // Point lookups are charged to their chunk for the cost based balancer
+                    if ( it->first.woCompare( it->second ) == 0 )
+                        findIntersectingChunk( it->first )->noteRead();
+
                     getShardsForRange( shards, it->first /*min*/, it->second /*max*/ );
 
                     // once we know we need to visit all shards no need to keep looping
@@ -1353,7 +1430,7 @@ namespace mongo {
         return ss.str();
     }
 
-    void ChunkRangeManager::assertValid() const {
+    void ChunkRangeManager::assertValid(const ChunkMap& chunks) const {
         if (_ranges.empty())
             return;
 
@@ -1379,7 +1456,6 @@ namespace mongo {
             }
 
             // Make sure we match the original chunks
-            const ChunkMap chunks = _ranges.begin()->second->getManager()->_chunkMap;
             for ( ChunkMap::const_iterator i=chunks.begin(); i!=chunks.end(); ++i ) {
                 const ChunkPtr chunk = i->second;
 
@@ -1409,7 +1485,7 @@ namespace mongo {
         _ranges.clear();
         _insertRange(chunks.begin(), chunks.end());
 
-        DEV assertValid();
+        DEV assertValid(chunks);
     }
 
     void ChunkRangeManager::_insertRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end) {
@@ -1425,13 +1501,15 @@ namespace mongo {
     }
 
     int ChunkManager::getCurrentDesiredChunkSize() const {
+        return ChunkManagerLineage::desiredChunkSize( numChunks() );
+    }
+
+    int ChunkManagerLineage::desiredChunkSize( int nc ) {
         // split faster in early chunks helps spread out an initial load better
         const int minChunkSize = 1 << 20;  // 1 MBytes
 
         int splitThreshold = Chunk::MaxChunkSize;
 
-        int nc = numChunks();
-
         if ( nc <= 1 ) {
             return 1024;
         }
@@ -1451,6 +1529,7 @@ namespace mongo {
     /** This is for testing only, just setting up minimal basic defaults. */
     ChunkManager::ChunkManager() :
     _unique(),
+    _lineage( new ChunkManagerLineage( _ns, _key ) ),
     _chunkRanges(),
     _mutex( "ChunkManager" ),
     _sequenceNumber()
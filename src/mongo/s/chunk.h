@@ -32,6 +32,8 @@
 
 #include "mongo/base/string_data.h"
 #include "mongo/bson/util/atomic_int.h"
+#include "mongo/platform/atomic_word.h"
+#include "mongo/s/chunk_routing_index.h"
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/distlock.h"
 #include "mongo/s/shard.h"
@@ -54,6 +56,75 @@ namespace mongo {
 
     typedef shared_ptr<const ChunkManager> ChunkManagerPtr;
 
+    /**
+     * What a Chunk needs from the ChunkManager that loaded it.  One is shared by a ChunkManager
+     * and every manager loaded incrementally from it, so a refresh can keep the previous
+     * manager's unchanged Chunk objects instead of recreating every chunk of the collection.
+     */
+    class ChunkManagerLineage : boost::noncopyable {
+    public:
+        ChunkManagerLineage( const string& ns , const ShardKeyPattern& key )
+            : _ns( ns ) , _key( key ) {}
+
+        const string& getns() const { return _ns; }
+        const ShardKeyPattern& getShardKey() const { return _key; }
+
+        /** reloads the collection's newest ChunkManager, see ChunkManager::reload */
+        ChunkManagerPtr reload( bool force = true ) const;
+
+        void markMinorForReload( ChunkVersion majorVersion ) const;
+
+        /** @param numChunks of the newest manager, which splits are sized by */
+        void setNumChunks( int numChunks ) { _numChunks.store( numChunks ); }
+
+        int getCurrentDesiredChunkSize() const;
+
+        /** the chunk size to split at for a collection of 'numChunks' chunks */
+        static int desiredChunkSize( int numChunks );
+
+        class SplitHeuristics {
+        public:
+
+            SplitHeuristics() :
+                _splitTickets( maxParallelSplits ),
+                _staleMinorSetMutex( "SplitHeuristics::staleMinorSet" ),
+                _staleMinorCount( 0 ) {}
+
+            void markMinorForReload( const string& ns, ChunkVersion majorVersion );
+            void getMarkedMinorVersions( set<ChunkVersion>& minorVersions );
+            void clearMarkedMinorVersions();
+
+            TicketHolder _splitTickets;
+
+            mutex _staleMinorSetMutex;
+
+            // mutex protects below
+            int _staleMinorCount;
+            set<ChunkVersion> _staleMinorSet;
+
+            // Test whether we should split once data * splitTestFactor > chunkSize (approximately)
+            static const int splitTestFactor = 5;
+            // Maximum number of parallel threads requesting a split
+            static const int maxParallelSplits = 5;
+
+            // The idea here is that we're over-aggressive on split testing by a factor of
+            // splitTestFactor, so we can safely wait until we get to splitTestFactor invalid splits
+            // before changing.  Unfortunately, we also potentially over-request the splits by a
+            // factor of maxParallelSplits, but since the factors are identical it works out
+            // (for now) for parallel or sequential oversplitting.
+            // TODO: Make splitting a separate thread with notifications?
+            static const int staleMinorReloadThreshold = maxParallelSplits;
+
+        };
+
+        mutable SplitHeuristics _splitHeuristics;
+
+    private:
+        const string _ns;
+        const ShardKeyPattern _key;
+        AtomicUInt32 _numChunks;
+    };
+
     /**
        config.chunks
        { ns : "alleyinsider.fs.chunks" , min : {} , max : {} , server : "localhost:30001" }
@@ -115,6 +186,22 @@ namespace mongo {
         // TODO: Split data tracking and chunk information
         void setBytesWritten( long bytesWritten ) const { _dataWritten = bytesWritten; }
 
+        //
+        // load tracking for the cost based balancer, counts only what this mongos routes
+        //
+
+        void noteRead() const { _readsSinceBalance.fetchAndAdd( 1 ); }
+
+        /** @return reads routed here since the last call, and starts counting again */
+        long long takeReadsSinceBalance() const {
+            return static_cast<long long>( _readsSinceBalance.swap( 0 ) );
+        }
+
+        /** @return bytes written here since the last call, and starts counting again */
+        long long takeBytesWrittenSinceBalance() const {
+            return static_cast<long long>( _bytesWrittenSinceBalance.swap( 0 ) );
+        }
+
         /**
          * if the amount of data written nears the max size of a shard
          * then we check the real size, and if its too big, we split
@@ -226,14 +313,14 @@ namespace mongo {
 
         string getns() const;
         Shard getShard() const { return _shard; }
-        const ChunkManager* getManager() const { return _manager; }
-        
+
 
     private:
 
         // main shard info
-        
-        const ChunkManager * _manager;
+
+        // shared with every manager this chunk is part of
+        const boost::shared_ptr<ChunkManagerLineage> _lineage;
 
         BSONObj _min;
         BSONObj _max;
@@ -244,6 +331,8 @@ namespace mongo {
         // transient stuff
 
         mutable long _dataWritten;
+        mutable AtomicUInt64 _readsSinceBalance;
+        mutable AtomicUInt64 _bytesWrittenSinceBalance;
 
         // methods, etc..
 
@@ -266,7 +355,6 @@ namespace mongo {
 
     class ChunkRange {
     public:
-        const ChunkManager* getManager() const { return _manager; }
         Shard getShard() const { return _shard; }
 
         const BSONObj& getMin() const { return _min; }
@@ -281,14 +369,12 @@ namespace mongo {
         bool containsPoint( const BSONObj& point ) const;
 
         ChunkRange(ChunkMap::const_iterator begin, const ChunkMap::const_iterator end)
-            : _manager(begin->second->getManager())
-            , _shard(begin->second->getShard())
+            : _shard(begin->second->getShard())
             , _min(begin->second->getMin())
             , _max(boost::prior(end)->second->getMax()) {
             verify( begin != end );
 
             DEV while (begin != end) {
-                verify(begin->second->getManager() == _manager);
                 verify(begin->second->getShard() == _shard);
                 ++begin;
             }
@@ -296,12 +382,10 @@ namespace mongo {
 
         // Merge min and max (must be adjacent ranges)
         ChunkRange(const ChunkRange& min, const ChunkRange& max)
-            : _manager(min.getManager())
-            , _shard(min.getShard())
+            : _shard(min.getShard())
             , _min(min.getMin())
             , _max(max.getMax()) {
             verify(min.getShard() == max.getShard());
-            verify(min.getManager() == max.getManager());
             verify(min.getMax() == max.getMin());
         }
 
@@ -310,7 +394,6 @@ namespace mongo {
         }
 
     private:
-        const ChunkManager* _manager;
         const Shard _shard;
         const BSONObj _min;
         const BSONObj _max;
@@ -326,7 +409,7 @@ namespace mongo {
         void reloadAll(const ChunkMap& chunks);
 
         // Slow operation -- wrap with DEV
-        void assertValid() const;
+        void assertValid(const ChunkMap& chunks) const;
 
         ChunkRangeMap::const_iterator upper_bound(const BSONObj& o) const { return _ranges.upper_bound(o); }
         ChunkRangeMap::const_iterator lower_bound(const BSONObj& o) const { return _ranges.lower_bound(o); }
@@ -466,6 +549,9 @@ namespace mongo {
                                     ShardVersionMap& shardVersions, ChunkManagerPtr oldManager);
         static bool _isValid(const ChunkMap& chunks);
 
+        // rebuilds _routingIndex and _routingChunks from _chunkMap
+        void _buildRoutingIndex();
+
         // end helpers
 
         // All members should be const for thread-safety
@@ -473,9 +559,17 @@ namespace mongo {
         const ShardKeyPattern _key;
         const bool _unique;
 
+        // shared with the manager this was loaded from, if any, and with our chunks
+        boost::shared_ptr<ChunkManagerLineage> _lineage;
+
         const ChunkMap _chunkMap;
         const ChunkRangeManager _chunkRanges;
 
+        // flat copy of _chunkMap for findIntersectingChunk; _routingChunks[i] is the chunk
+        // whose max is at position i of _routingIndex
+        const ChunkRoutingIndex _routingIndex;
+        const vector<ChunkPtr> _routingChunks;
+
         const set<Shard> _shards;
 
         const ShardVersionMap _shardVersions; // max version per shard
@@ -491,53 +585,7 @@ namespace mongo {
 
         const unsigned long long _sequenceNumber;
 
-        //
-        // Split Heuristic info
-        //
-
-
-        class SplitHeuristics {
-        public:
-
-            SplitHeuristics() :
-                _splitTickets( maxParallelSplits ),
-                _staleMinorSetMutex( "SplitHeuristics::staleMinorSet" ),
-                _staleMinorCount( 0 ) {}
-
-            void markMinorForReload( const string& ns, ChunkVersion majorVersion );
-            void getMarkedMinorVersions( set<ChunkVersion>& minorVersions );
-
-            TicketHolder _splitTickets;
-
-            mutex _staleMinorSetMutex;
-
-            // mutex protects below
-            int _staleMinorCount;
-            set<ChunkVersion> _staleMinorSet;
-
-            // Test whether we should split once data * splitTestFactor > chunkSize (approximately)
-            static const int splitTestFactor = 5;
-            // Maximum number of parallel threads requesting a split
-            static const int maxParallelSplits = 5;
-
-            // The idea here is that we're over-aggressive on split testing by a factor of
-            // splitTestFactor, so we can safely wait until we get to splitTestFactor invalid splits
-            // before changing.  Unfortunately, we also potentially over-request the splits by a
-            // factor of maxParallelSplits, but since the factors are identical it works out
-            // (for now) for parallel or sequential oversplitting.
-            // TODO: Make splitting a separate thread with notifications?
-            static const int staleMinorReloadThreshold = maxParallelSplits;
-
-        };
-
-        mutable SplitHeuristics _splitHeuristics;
-
-        //
-        // End split heuristics
-        //
-
         friend class Chunk;
-        friend class ChunkRangeManager; // only needed for CRM::assertValid()
         static AtomicUInt NextSequenceNumber;
         
         /** Just for testing */
@@ -577,7 +625,7 @@ namespace mongo {
         Chunk _c;
     };
     */
-    inline string Chunk::genID() const { return genID(_manager->getns(), _min); }
+    inline string Chunk::genID() const { return genID(_lineage->getns(), _min); }
 
     bool setShardVersion( DBClientBase & conn,
                           const string& ns,
@@ -0,0 +1,125 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_routing_index.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace mongo {
+
+    namespace {
+
+        const int ValueBits = 56;
+
+        /** big endian value of up to the first 7 bytes of 'data', zero padded */
+        unsigned long long bytesPrefix( const char* data, int len ) {
+            unsigned long long v = 0;
+            for ( int i = 0; i < ValueBits / 8; i++ ) {
+                v <<= 8;
+                if ( i < len )
+                    v |= static_cast<unsigned char>( data[i] );
+            }
+            return v;
+        }
+
+    }  // namespace
+
+    unsigned long long ChunkRoutingIndex::prefixOf( const BSONElement& e ) {
+        // MinKey is -1, so shift canonical types up by one to keep them unsigned
+        const unsigned long long typeBits =
+            static_cast<unsigned long long>( e.canonicalType() + 1 ) << ValueBits;
+
+        switch ( e.type() ) {
+        case NumberDouble:
+        case NumberInt:
+        case NumberLong: {
+            // numbers of all three types compare as doubles, NaN lowest and -0 equal to 0
+            double d = e.number();
+            if ( isNaN( d ) )
+                return typeBits;
+            if ( d == 0 )
+                d = 0;
+
+            unsigned long long bits;
+            memcpy( &bits, &d, sizeof( bits ) );
+            if ( bits >> 63 )
+                bits = ~bits;
+            else
+                bits |= 1ULL << 63;
+
+            // even -Infinity keeps some bits set here, so numbers stay above NaN's prefix
+            return typeBits | ( bits >> ( 64 - ValueBits ) );
+        }
+        case String:
+        case Symbol:
+            // compared with memcmp, so leading bytes order them
+            return typeBits | bytesPrefix( e.valuestr(), e.valuestrsize() - 1 );
+        case jstOID:
+            return typeBits | bytesPrefix( e.value(), OID::kOIDSize );
+        default:
+            // other types only order by type here and leave the rest to woCompare
+            return typeBits;
+        }
+    }
+
+    void ChunkRoutingIndex::reset( const std::vector<BSONObj>& maxes ) {
+        _maxes = maxes;
+        _firstField = _maxes.empty() ? "" : _maxes.front().firstElementFieldName();
+
+        _prefixes.clear();
+        _prefixes.reserve( _maxes.size() );
+        for ( size_t i = 0; i < _maxes.size(); i++ ) {
+            _prefixes.push_back( prefixOf( _maxes[i].firstElement() ) );
+        }
+    }
+
+    size_t ChunkRoutingIndex::upperBound( const BSONObj& point ) const {
+        const BSONElement first = point.firstElement();
+
+        // woCompare looks at field names too, so a key shaped differently from the boundaries
+        // can't be placed by the prefixes
+        if ( _firstField != first.fieldName() ) {
+            return std::upper_bound( _maxes.begin(), _maxes.end(), point, BSONObjCmp() ) -
+                   _maxes.begin();
+        }
+
+        const unsigned long long prefix = prefixOf( first );
+        const std::vector<unsigned long long>::const_iterator lo =
+            std::lower_bound( _prefixes.begin(), _prefixes.end(), prefix );
+        const std::vector<unsigned long long>::const_iterator hi =
+            std::upper_bound( lo, _prefixes.end(), prefix );
+
+        // everything before lo is below the point and everything from hi on above it
+        const size_t loPos = lo - _prefixes.begin();
+        const size_t hiPos = hi - _prefixes.begin();
+        return std::upper_bound( _maxes.begin() + loPos, _maxes.begin() + hiPos,
+                                 point, BSONObjCmp() ) - _maxes.begin();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,75 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    /**
+     * An immutable, sorted flat copy of a collection's chunk boundaries (the max of each chunk,
+     * as in a ChunkMap), built on each ChunkManager load to route shard keys to their chunk.
+     *
+     * Next to each boundary we keep a 64 bit prefix of its first field, packed so that the
+     * prefixes sort like the keys do.  A lookup binary searches the prefixes, which sit
+     * contiguously in memory, and only compares BSON for the few boundaries whose prefix ties
+     * with the key's.
+     */
+    class ChunkRoutingIndex {
+    public:
+        /**
+         * @param maxes chunk boundaries in ascending BSONObjCmp order, all with the same
+         *     field names
+         */
+        void reset( const std::vector<BSONObj>& maxes );
+
+        /**
+         * @return the position of the first boundary greater than 'point', as
+         *     std::map::upper_bound would, or size() if there is none
+         */
+        size_t upperBound( const BSONObj& point ) const;
+
+        size_t size() const { return _maxes.size(); }
+
+        /**
+         * Packs a value so that, for any two elements with a ordered before b by woCompare,
+         * prefixOf( a ) <= prefixOf( b ).  Equal prefixes decide nothing.
+         */
+        static unsigned long long prefixOf( const BSONElement& e );
+
+    private:
+        std::string _firstField;
+        std::vector<unsigned long long> _prefixes;
+        std::vector<BSONObj> _maxes;
+    };
+
+}  // namespace mongo
@@ -0,0 +1,250 @@
+/**
+ *    Copyright (C) 2014 10gen Inc.
+ *
+ *    This program is free software: you can redistribute it and/or  modify
+ *    it under the terms of the GNU Affero General Public License, version 3,
+ *    as published by the Free Software Foundation.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU Affero General Public License for more details.
+ *
+ *    You should have received a copy of the GNU Affero General Public License
+ *    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *    As a special exception, the copyright holders give permission to link the
+ *    code of portions of this program with the OpenSSL library under certain
+ *    conditions as described in each individual source file and distribute
+ *    linked combinations including the program with the OpenSSL library. You
+ *    must comply with the GNU Affero General Public License in all respects
+ *    for all of the code used other than as permitted herein. If you modify
+ *    file(s) with this exception, you may extend this exception to your
+ *    version of the file(s), but you are not obligated to do so. If you do not
+ *    wish to do so, delete this exception statement from your version. If you
+ *    delete this exception statement from all source files in the program,
+ *    then also delete it in the license file.
+ */
+
+#include "mongo/s/chunk_routing_index.h"
+
+#include <limits>
+#include <map>
+#include <vector>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/platform/random.h"
+#include "mongo/unittest/unittest.h"
+#include "mongo/util/timer.h"
+
+namespace {
+
+    using mongo::BSONObj;
+    using mongo::BSONObjCmp;
+    using mongo::ChunkRoutingIndex;
+    using mongo::MAXKEY;
+    using mongo::MINKEY;
+    using mongo::OID;
+    using mongo::PseudoRandom;
+    using mongo::Timer;
+    using std::map;
+    using std::vector;
+
+    typedef map<BSONObj, int, BSONObjCmp> BoundaryMap;
+
+    /** the position std::map::upper_bound gives, which the index must agree with */
+    size_t mapUpperBound( const BoundaryMap& boundaries, const BSONObj& point ) {
+        BoundaryMap::const_iterator it = boundaries.upper_bound( point );
+        return it == boundaries.end() ? boundaries.size() : it->second;
+    }
+
+    /** sorts 'maxes' through a map and builds 'index' and 'boundaries' from it */
+    void build( const vector<BSONObj>& maxes, ChunkRoutingIndex* index, BoundaryMap* boundaries ) {
+        for ( size_t i = 0; i < maxes.size(); i++ ) {
+            boundaries->insert( std::make_pair( maxes[i], 0 ) );
+        }
+
+        vector<BSONObj> sorted;
+        for ( BoundaryMap::iterator it = boundaries->begin(); it != boundaries->end(); ++it ) {
+            it->second = sorted.size();
+            sorted.push_back( it->first );
+        }
+        index->reset( sorted );
+    }
+
+    void assertMatchesMap( const vector<BSONObj>& maxes, const vector<BSONObj>& points ) {
+        ChunkRoutingIndex index;
+        BoundaryMap boundaries;
+        build( maxes, &index, &boundaries );
+        ASSERT_EQUALS( boundaries.size(), index.size() );
+
+        for ( size_t i = 0; i < points.size(); i++ ) {
+            ASSERT_EQUALS( mapUpperBound( boundaries, points[i] ),
+                           index.upperBound( points[i] ) );
+        }
+    }
+
+    TEST(ChunkRoutingIndex, Empty) {
+        ChunkRoutingIndex index;
+        index.reset( vector<BSONObj>() );
+        ASSERT_EQUALS( 0U, index.upperBound( BSON( "a" << 1 ) ) );
+    }
+
+    TEST(ChunkRoutingIndex, PrefixOrdersTypes) {
+        ASSERT_LESS_THAN( ChunkRoutingIndex::prefixOf( BSON( "" << MINKEY ).firstElement() ),
+                          ChunkRoutingIndex::prefixOf( BSON( "" << 1 ).firstElement() ) );
+        ASSERT_LESS_THAN( ChunkRoutingIndex::prefixOf( BSON( "" << 1 ).firstElement() ),
+                          ChunkRoutingIndex::prefixOf( BSON( "" << "a" ).firstElement() ) );
+        ASSERT_LESS_THAN( ChunkRoutingIndex::prefixOf( BSON( "" << "a" ).firstElement() ),
+                          ChunkRoutingIndex::prefixOf( BSON( "" << MAXKEY ).firstElement() ) );
+    }
+
+    TEST(ChunkRoutingIndex, NumbersOfMixedTypes) {
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        const double inf = std::numeric_limits<double>::infinity();
+
+        vector<BSONObj> maxes;
+        maxes.push_back( BSON( "a" << -inf ) );
+        maxes.push_back( BSON( "a" << -5 ) );
+        maxes.push_back( BSON( "a" << 0.0 ) );
+        maxes.push_back( BSON( "a" << 2.5 ) );
+        maxes.push_back( BSON( "a" << 10LL ) );
+        maxes.push_back( BSON( "a" << ( 1LL << 60 ) ) );
+        maxes.push_back( BSON( "a" << inf ) );
+        maxes.push_back( BSON( "a" << MAXKEY ) );
+
+        vector<BSONObj> points;
+        points.push_back( BSON( "a" << MINKEY ) );
+        points.push_back( BSON( "a" << nan ) );
+        points.push_back( BSON( "a" << -inf ) );
+        points.push_back( BSON( "a" << -5.0 ) );
+        points.push_back( BSON( "a" << -5LL ) );
+        points.push_back( BSON( "a" << -0.0 ) );
+        points.push_back( BSON( "a" << 0 ) );
+        points.push_back( BSON( "a" << 2 ) );
+        points.push_back( BSON( "a" << 2.5 ) );
+        points.push_back( BSON( "a" << 10 ) );
+        points.push_back( BSON( "a" << 10.0 ) );
+        points.push_back( BSON( "a" << ( 1LL << 60 ) - 1 ) );
+        points.push_back( BSON( "a" << ( 1LL << 60 ) ) );
+        points.push_back( BSON( "a" << ( 1LL << 60 ) + 1 ) );
+        points.push_back( BSON( "a" << inf ) );
+        points.push_back( BSON( "a" << "string" ) );
+        assertMatchesMap( maxes, points );
+    }
+
+    TEST(ChunkRoutingIndex, StringsSharingPrefixes) {
+        vector<BSONObj> maxes;
+        maxes.push_back( BSON( "a" << "" ) );
+        maxes.push_back( BSON( "a" << "abcdefg" ) );
+        maxes.push_back( BSON( "a" << "abcdefgh" ) );
+        maxes.push_back( BSON( "a" << "abcdefghij" ) );
+        maxes.push_back( BSON( "a" << "abd" ) );
+        maxes.push_back( BSON( "a" << "\xff" ) );
+
+        vector<BSONObj> points;
+        points.push_back( BSON( "a" << "" ) );
+        points.push_back( BSON( "a" << "abc" ) );
+        points.push_back( BSON( "a" << "abcdefg" ) );
+        points.push_back( BSON( "a" << "abcdefga" ) );
+        points.push_back( BSON( "a" << "abcdefgi" ) );
+        points.push_back( BSON( "a" << "abcdefghij" ) );
+        points.push_back( BSON( "a" << "abcdefghijk" ) );
+        points.push_back( BSON( "a" << "b" ) );
+        points.push_back( BSON( "a" << "\xff\xff" ) );
+        points.push_back( BSON( "a" << OID() ) );
+        assertMatchesMap( maxes, points );
+    }
+
+    TEST(ChunkRoutingIndex, CompoundKeys) {
+        vector<BSONObj> maxes;
+        for ( int i = 0; i < 5; i++ ) {
+            for ( int j = 0; j < 5; j++ ) {
+                maxes.push_back( BSON( "a" << i << "b" << j * 10 ) );
+            }
+        }
+
+        vector<BSONObj> points;
+        for ( int i = -1; i < 6; i++ ) {
+            for ( int j = -5; j < 55; j += 5 ) {
+                points.push_back( BSON( "a" << i << "b" << j ) );
+            }
+        }
+        assertMatchesMap( maxes, points );
+    }
+
+    TEST(ChunkRoutingIndex, OtherFieldNames) {
+        vector<BSONObj> maxes;
+        maxes.push_back( BSON( "b" << 1 ) );
+        maxes.push_back( BSON( "b" << 5 ) );
+
+        vector<BSONObj> points;
+        points.push_back( BSON( "a" << 3 ) );
+        points.push_back( BSON( "c" << 3 ) );
+        points.push_back( BSONObj() );
+        assertMatchesMap( maxes, points );
+    }
+
+    TEST(ChunkRoutingIndex, RandomNumbers) {
+        PseudoRandom random( 17 );
+
+        vector<BSONObj> maxes;
+        for ( int i = 0; i < 10000; i++ ) {
+            maxes.push_back( BSON( "a" << random.nextInt32( 100000 ) ) );
+        }
+
+        vector<BSONObj> points;
+        for ( int i = 0; i < 10000; i++ ) {
+            const int n = random.nextInt32( 100002 ) - 1;
+            switch ( i % 3 ) {
+            case 0: points.push_back( BSON( "a" << n ) ); break;
+            case 1: points.push_back( BSON( "a" << static_cast<long long>( n ) ) ); break;
+            default: points.push_back( BSON( "a" << n + 0.5 ) ); break;
+            }
+        }
+        assertMatchesMap( maxes, points );
+    }
+
+    /**
+     * Not a correctness test: times lookups on a collection with as many chunks as our largest
+     * ones, through the index and through the ChunkMap it replaces.
+     */
+    TEST(ChunkRoutingIndex, LookupRate) {
+        const int numChunks = 200 * 1000;
+        const int numLookups = 1000 * 1000;
+        PseudoRandom random( 29 );
+
+        // hashed shard key boundaries
+        vector<BSONObj> maxes;
+        for ( int i = 0; i < numChunks; i++ ) {
+            maxes.push_back( BSON( "a" << static_cast<long long>( random.nextInt64() ) ) );
+        }
+        ChunkRoutingIndex index;
+        BoundaryMap boundaries;
+        build( maxes, &index, &boundaries );
+
+        vector<BSONObj> points;
+        for ( int i = 0; i < 1000; i++ ) {
+            points.push_back( BSON( "a" << static_cast<long long>( random.nextInt64() ) ) );
+        }
+
+        size_t total = 0;
+        Timer indexTimer;
+        for ( int i = 0; i < numLookups; i++ ) {
+            total += index.upperBound( points[i % points.size()] );
+        }
+        const long long indexMicros = std::max( 1LL, (long long)indexTimer.micros() );
+
+        Timer mapTimer;
+        for ( int i = 0; i < numLookups; i++ ) {
+            total -= mapUpperBound( boundaries, points[i % points.size()] );
+        }
+        const long long mapMicros = std::max( 1LL, (long long)mapTimer.micros() );
+
+        ASSERT_EQUALS( 0U, total );
+        mongo::unittest::log() << "chunk routing lookups/sec with " << numChunks << " chunks,"
+                               << " index: " << numLookups * 1000000LL / indexMicros
+                               << " map: " << numLookups * 1000000LL / mapMicros << std::endl;
+    }
+
+}  // namespace
@@ -291,6 +291,11 @@ namespace mongo {
 
         static ShardedConnectionInfo* get( bool create );
         static void reset();
+
+        /** detaches this thread's info, if any, and returns it to the caller */
+        static ShardedConnectionInfo* release();
+        /** makes info, which may be NULL, this thread's info */
+        static void reset( ShardedConnectionInfo* info );
         static void addHook();
 
         bool inForceVersionOkMode() const {
@@ -37,6 +37,7 @@
 #include "mongo/pch.h"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread/thread.hpp>
 #include <map>
 #include <string>
@@ -66,6 +67,7 @@
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_config.h"
 #include "mongo/db/repl/write_concern.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/logger/ramlog.h"
 #include "mongo/s/chunk.h"
 #include "mongo/s/chunk_version.h"
@@ -78,6 +80,7 @@
 #include "mongo/util/elapsed_tracker.h"
 #include "mongo/util/processinfo.h"
 #include "mongo/util/queue.h"
+#include "mongo/util/scopeguard.h"
 #include "mongo/util/startup_test.h"
 #include "mongo/util/fail_point_service.h"
 
@@ -90,6 +93,9 @@ namespace mongo {
 
     Tee* migrateLog = RamLog::get("migrate");
 
+    // Most documents a window of the donor's clone scan holds.  Windows are also bounded by bytes.
+    MONGO_EXPORT_SERVER_PARAMETER(internalMigrateCloneWindowDocs, int, 100000);
+
     class MoveTimingHelper {
     public:
         MoveTimingHelper( const string& where , const string& ns , BSONObj min , BSONObj max , int total , string& cmdErrmsg )
@@ -118,7 +124,10 @@ namespace mongo {
             }
         }
 
-        void done( int step ) {
+        /**
+         * @param bytes if not negative, the data the step moved, recorded along with its rate
+         */
+        void done( int step , long long bytes = -1 ) {
             verify( step == ++_next );
             verify( step <= _total );
 
@@ -132,7 +141,12 @@ namespace mongo {
             else
                 warning() << "op is null in MoveTimingHelper::done" << migrateLog;
 
-            _b.appendNumber( s , _t.millis() );
+            const int millis = _t.millis();
+            _b.appendNumber( s , millis );
+            if ( bytes >= 0 ) {
+                _b.appendNumber( s + " bytes" , bytes );
+                _b.appendNumber( s + " bytes/s" , bytes * 1000 / std::max( millis , 1 ) );
+            }
             _t.reset();
 
 #if 0
@@ -205,6 +219,7 @@ namespace mongo {
             _active = false;
             _inCriticalSection = false;
             _memoryUsed = 0;
+            _cloneScanDone = true;
         }
 
         /**
@@ -252,6 +267,10 @@ namespace mongo {
                 _reload.clear();
                 _cloneLocs.clear();
             }
+            _cloneScanDone = true;
+            _cloneNextKey = BSONObj();
+            _cloneNextLoc = DiskLoc();
+            _cloneMaxKey = BSONObj();
             _memoryUsed = 0;
 
             scoped_lock l(_mutex);
@@ -382,7 +401,8 @@ namespace mongo {
         }
 
         /**
-         * Get the disklocs that belong to the chunk migrated and sort them in _cloneLocs (to avoid seeking disk later)
+         * Count the documents that belong to the chunk migrated and set up the clone scan over
+         * its range.  The disklocs themselves are gathered a window at a time by clone().
          *
          * @param maxChunkSize number of bytes beyond which a chunk's base data (no indices) is considered too large to move
          * @param errmsg filled with textual description of error if this call return false
@@ -436,11 +456,6 @@ namespace mongo {
             unsigned long long recCount = 0;;
             DiskLoc dl;
             while (Runner::RUNNER_ADVANCED == runner->getNext(NULL, &dl)) {
-                if ( ! isLargeChunk ) {
-                    scoped_spinlock lk( _trackerLocks );
-                    _cloneLocs.insert( dl );
-                }
-
                 if ( ++recCount > maxRecsWhenFull ) {
                     isLargeChunk = true;
                 }
@@ -458,10 +473,12 @@ namespace mongo {
                 return false;
             }
 
-            {
-                scoped_spinlock lk( _trackerLocks );
-                log() << "moveChunk number of documents: " << _cloneLocs.size() << migrateLog;
-            }
+            _cloneNextKey = min;
+            _cloneNextLoc = DiskLoc();
+            _cloneMaxKey = max;
+            _cloneScanDone = ( recCount == 0 );
+
+            log() << "moveChunk number of documents: " << recCount << migrateLog;
             return true;
         }
 
@@ -478,6 +495,8 @@ namespace mongo {
                 Client::ReadContext ctx( _ns );
                 Collection* collection = ctx.ctx().db()->getCollection( _ns );
                 verify( collection );
+                if ( _cloneWindowEmpty() && ! _cloneScanDone )
+                    _fillCloneWindow( collection );
                 scoped_spinlock lk( _trackerLocks );
                 allocSize =
                     std::min(BSONObjMaxUserSize,
@@ -493,6 +512,12 @@ namespace mongo {
 
                 {
                     Client::ReadContext ctx( _ns );
+                    if ( _cloneWindowEmpty() && ! _cloneScanDone ) {
+                        Collection* collection = ctx.ctx().db()->getCollection( _ns );
+                        verify( collection );
+                        _fillCloneWindow( collection );
+                    }
+
                     scoped_spinlock lk( _trackerLocks );
                     set<DiskLoc>::iterator i = _cloneLocs.begin();
                     for ( ; i!=_cloneLocs.end(); ++i ) {
@@ -523,7 +548,10 @@ namespace mongo {
                     
                     _cloneLocs.erase( _cloneLocs.begin() , i );
                     
-                    if ( _cloneLocs.empty() || filledBuffer )
+                    // a batch ends with its window, so the next window is read when the
+                    // recipient asks for it rather than while this batch waits to be sent
+                    if ( ( _cloneLocs.empty() && ( _cloneScanDone || a.arrSize() > 0 ) ) ||
+                         filledBuffer )
                         break;
                 }
                 
@@ -564,6 +592,9 @@ namespace mongo {
             return _cloneLocs.size();
         }
 
+        /** @return true once every window of the chunk's range has been read */
+        bool cloneScanDone() const { return _cloneScanDone; }
+
         long long mbUsed() const { return _memoryUsed / ( 1024 * 1024 ); }
 
         bool getInCriticalSection() const {
@@ -614,12 +645,76 @@ namespace mongo {
         // even though it shouldn't be needed under normal operation
         SpinLock _trackerLocks;
 
-        // disk locs yet to be transferred from here to the other side
-        // no locking needed because built initially by 1 thread in a read lock
+        // disk locs yet to be transferred from here to the other side, for the current window of
+        // the chunk's range only so memory stays bounded on large chunks
+        // no locking needed because filled by 1 thread in a read lock
         // emptied by 1 thread in a read lock
         // updates applied by 1 thread in a write lock
         set<DiskLoc> _cloneLocs;
 
+        // position of the clone scan over the shard key index, in index key format; the next
+        // window starts after (_cloneNextKey, _cloneNextLoc) and ends before _cloneMaxKey
+        BSONObj _cloneNextKey;
+        DiskLoc _cloneNextLoc;
+        BSONObj _cloneMaxKey;
+        bool _cloneScanDone;
+
+        bool _cloneWindowEmpty() {
+            scoped_spinlock lk( _trackerLocks );
+            return _cloneLocs.empty();
+        }
+
+        /**
+         * Reads the next window of the chunk's range off the shard key index into _cloneLocs,
+         * where it is kept in DiskLoc order so clone() reads the documents sequentially.
+         * Caller must hold a read lock on _ns.
+         */
+        void _fillCloneWindow( Collection* collection ) {
+            IndexDescriptor* idx =
+                collection->getIndexCatalog()->findIndexByPrefix( _shardKeyPattern ,
+                                                                  true );  /* require single key */
+            uassert( 17361,
+                     str::stream() << "can't find shard key index to clone " << _ns ,
+                     idx != NULL );
+
+            // enough documents for a few batches, but not so many the window gets large when
+            // documents are tiny
+            const long long windowBytes = 4LL * BSONObjMaxUserSize;
+            const long long avgObjSize =
+                std::max( 1LL , (long long)collection->averageObjectSize() );
+            const size_t windowDocs =
+                (size_t)std::max( 1LL , std::min( (long long)internalMigrateCloneWindowDocs ,
+                                                  windowBytes / avgObjSize ) );
+
+            auto_ptr<Runner> runner( InternalPlanner::indexScan( collection, idx,
+                                                                 _cloneNextKey, _cloneMaxKey,
+                                                                 false ) );
+            size_t added = 0;
+            BSONObj key;
+            DiskLoc dl;
+            while ( added < windowDocs &&
+                    Runner::RUNNER_ADVANCED == runner->getNext( &key, &dl ) ) {
+                // entries with equal keys are ordered by DiskLoc, so the ones up to and including
+                // _cloneNextLoc were in an earlier window
+                if ( ! _cloneNextLoc.isNull() &&
+                     dl.compare( _cloneNextLoc ) <= 0 &&
+                     key.woCompare( _cloneNextKey ) == 0 ) {
+                    continue;
+                }
+
+                {
+                    scoped_spinlock lk( _trackerLocks );
+                    _cloneLocs.insert( dl );
+                }
+                _cloneNextKey = key.getOwned();
+                _cloneNextLoc = dl;
+                added++;
+            }
+
+            if ( added < windowDocs )
+                _cloneScanDone = true;
+        }
+
         list<BSONObj> _reload; // objects that were modified that must be recloned
         list<BSONObj> _deleted; // objects deleted during clone that should be deleted later
         long long _memoryUsed; // bytes in _reload + _deleted
@@ -1128,7 +1223,7 @@ namespace mongo {
 
                 killCurrentOp.checkForInterrupt();
             }
-            timing.done(4);
+            timing.done( 4 , res["counts"]["clonedBytes"].numberLong() );
             MONGO_FP_PAUSE_WHILE(moveChunkHangAtStep4);
 
             // 5.
@@ -1140,11 +1235,13 @@ namespace mongo {
 
             // Ensure all cloned docs have actually been transferred
             std::size_t locsRemaining = migrateFromStatus.cloneLocsRemaining();
-            if ( locsRemaining != 0 ) {
+            if ( locsRemaining != 0 || ! migrateFromStatus.cloneScanDone() ) {
 
                 errmsg =
                     str::stream() << "moveChunk cannot enter critical section before all data is"
                                   << " cloned, " << locsRemaining << " locs were not transferred"
+                                  << ( migrateFromStatus.cloneScanDone() ?
+                                       "" : " and the chunk's range was not fully scanned" )
                                   << " but to-shard reported " << res;
 
                 // Should never happen, but safe to abort before critical section
@@ -1509,6 +1606,38 @@ namespace mongo {
     MONGO_FP_DECLARE(migrateThreadHangAtStep3);
     MONGO_FP_DECLARE(migrateThreadHangAtStep4);
     MONGO_FP_DECLARE(migrateThreadHangAtStep5);
+    // Pauses after each batch of the initial clone has been inserted.
+    MONGO_FP_DECLARE(migrateThreadHangAfterCloneBatch);
+
+    /**
+     * Runs one _migrateClone against the donor.  The recipient runs the next one on its own
+     * thread while it inserts the batch before, so the donor's reads overlap our writes.
+     */
+    class MigrateCloneFetch {
+    public:
+        MigrateCloneFetch( DBClientBase* conn ) : _conn( conn ) , _ok( false ) {}
+
+        void run() {
+            _res = BSONObj();
+            try {
+                // gets array of objects to copy, in disk order
+                _ok = _conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , _res );
+                _res = _res.getOwned();
+            }
+            catch ( DBException& e ) {
+                _ok = false;
+                _res = BSON( "errmsg" << e.toString() );
+            }
+        }
+
+        bool ok() const { return _ok; }
+        BSONObj result() const { return _res; }
+
+    private:
+        DBClientBase* _conn;
+        bool _ok;
+        BSONObj _res;
+    };
 
     class MigrateStatus {
     public:
@@ -1691,9 +1820,11 @@ namespace mongo {
                 // 3. initial bulk clone
                 state = CLONE;
 
+                MigrateCloneFetch fetch( conn.get() );
+                fetch.run();
                 while ( true ) {
-                    BSONObj res;
-                    if ( ! conn->runCommand( "admin" , BSON( "_migrateClone" << 1 ) , res ) ) {  // gets array of objects to copy, in disk order
+                    BSONObj res = fetch.result();
+                    if ( ! fetch.ok() ) {
                         state = FAIL;
                         errmsg = "_migrateClone failed: ";
                         errmsg += res.toString();
@@ -1703,6 +1834,14 @@ namespace mongo {
                     }
 
                     BSONObj arr = res["objects"].Obj();
+                    if ( arr.isEmpty() )
+                        break;
+
+                    // fetch the next batch while this one is inserted; joined before 'fetch' is
+                    // read again, including when an insert throws
+                    boost::thread fetcher( boost::bind( &MigrateCloneFetch::run , &fetch ) );
+                    ON_BLOCK_EXIT_OBJ( fetcher , &boost::thread::join );
+
                     int thisTime = 0;
 
                     BSONObjIterator i( arr );
@@ -1747,11 +1886,10 @@ namespace mongo {
                         }
                     }
 
-                    if ( thisTime == 0 )
-                        break;
+                    MONGO_FP_PAUSE_WHILE(migrateThreadHangAfterCloneBatch);
                 }
 
-                timing.done(3);
+                timing.done( 3 , clonedBytes );
                 MONGO_FP_PAUSE_WHILE(migrateThreadHangAtStep3);
             }
 
@@ -1761,6 +1899,7 @@ namespace mongo {
             {
                 // 4. do bulk of mods
                 state = CATCHUP;
+                long long modBytes = 0;
                 while ( true ) {
                     BSONObj res;
                     if ( ! conn->runCommand( "admin" , BSON( "_transferMods" << 1 ) , res ) ) {
@@ -1774,6 +1913,7 @@ namespace mongo {
                     if ( res["size"].number() == 0 )
                         break;
 
+                    modBytes += res["size"].numberLong();
                     apply( res , &lastOpApplied );
                     
                     const int maxIterations = 3600*50;
@@ -1803,7 +1943,7 @@ namespace mongo {
                     } 
                 }
 
-                timing.done(4);
+                timing.done( 4 , modBytes );
                 MONGO_FP_PAUSE_WHILE(migrateThreadHangAtStep4);
             }
 
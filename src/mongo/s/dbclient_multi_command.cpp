@@ -180,6 +180,8 @@ namespace mongo {
                     // invalidate other connections which might be bad.  But if the connection
                     // doesn't seem bad, don't send it back, because we don't want to reuse it.
                     if ( !command->conn->isFailed() ) {
+                        shardConnectionPool.decrementEgress( command->endpoint.toString(),
+                                                             command->conn );
                         delete command->conn;
                     }
                     else {
@@ -237,6 +239,7 @@ namespace mongo {
             // invalidate other connections which might be bad.  But if the connection doesn't seem
             // bad, don't send it back, because we don't want to reuse it.
             if ( !command->conn->isFailed() ) {
+                shardConnectionPool.decrementEgress( command->endpoint.toString(), command->conn );
                 delete command->conn;
             }
             else {
@@ -258,7 +261,10 @@ namespace mongo {
 
             PendingCommand* command = *it;
 
-            if ( NULL != command->conn ) delete command->conn;
+            if ( NULL != command->conn ) {
+                shardConnectionPool.decrementEgress( command->endpoint.toString(), command->conn );
+                delete command->conn;
+            }
             delete command;
             command = NULL;
         }
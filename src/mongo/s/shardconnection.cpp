@@ -165,6 +165,7 @@ namespace mongo {
                        and isn't needed since all connections will be closed anyway */
                     if ( inShutdown() ) {
                         if( versionManager.isVersionableCB( ss->avail ) ) versionManager.resetShardVersionCB( ss->avail );
+                        shardConnectionPool.decrementEgress( addr, ss->avail );
                         delete ss->avail;
                     }
                     else
@@ -210,6 +211,7 @@ namespace mongo {
                 }
 
                 if (!isConnGood) {
+                    shardConnectionPool.decrementEgress(addr, s->avail);
                     delete s->avail;
                     s->avail = NULL;
                 }
@@ -335,6 +337,7 @@ namespace mongo {
         void clearPool() {
             for(HostMap::iterator iter = _hosts.begin(); iter != _hosts.end(); ++iter) {
                 if (iter->second->avail != NULL) {
+                    shardConnectionPool.decrementEgress(iter->first, iter->second->avail);
                     delete iter->second->avail;
                 }
             }
@@ -443,6 +446,7 @@ namespace mongo {
                 ClientConnections::threadInstance()->done(_addr, _conn);
             }
             else {
+                shardConnectionPool.decrementEgress(_addr, _conn);
                 delete _conn;
             }
 
@@ -536,6 +540,61 @@ namespace mongo {
                                      true,
                                      true );
 
+    namespace {
+
+        /**
+         * Server parameter for one of the PoolForHost limits, which apply to every connection
+         * pool in the process.  The client library keeps its own copy of the value, so this
+         * pushes each change there.
+         */
+        class PoolForHostParameter : public ExportedServerParameter<int> {
+        public:
+            typedef void (*Setter)( int );
+
+            PoolForHostParameter( const std::string& name, int* value, Setter setter ) :
+                ExportedServerParameter<int>( ServerParameterSet::getGlobal(),
+                                              name,
+                                              value,
+                                              true,
+                                              true ),
+                _setter( setter ) {
+            }
+
+            virtual ~PoolForHostParameter() {}
+
+            virtual Status set( const int& newValue ) {
+                Status status = ExportedServerParameter<int>::set( newValue );
+                if ( status.isOK() )
+                    _setter( newValue );
+                return status;
+            }
+
+        protected:
+            virtual Status validate( const int& newValue ) {
+                if ( newValue >= 0 )
+                    return Status::OK();
+                return Status( ErrorCodes::BadValue, name() + " must not be negative" );
+            }
+
+        private:
+            Setter _setter;
+        };
+
+        int connPoolMaxInUseConnsPerHost = PoolForHost::getMaxInUse();
+        int connPoolWaitTimeoutMillis = PoolForHost::getWaitTimeoutMillis();
+        int connPoolMinConnsPerHost = PoolForHost::getMinPerHost();
+
+        PoolForHostParameter maxInUseParameter( "connPoolMaxInUseConnsPerHost",
+                                                &connPoolMaxInUseConnsPerHost,
+                                                &PoolForHost::setMaxInUse );
+        PoolForHostParameter waitTimeoutParameter( "connPoolWaitTimeoutMillis",
+                                                   &connPoolWaitTimeoutMillis,
+                                                   &PoolForHost::setWaitTimeoutMillis );
+        PoolForHostParameter minPerHostParameter( "connPoolMinConnsPerHost",
+                                                  &connPoolMinConnsPerHost,
+                                                  &PoolForHost::setMinPerHost );
+    }
+
     void ShardConnection::releaseMyConnections() {
         ClientConnections::threadInstance()->releaseAll();
     }
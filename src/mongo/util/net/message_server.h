@@ -28,6 +28,19 @@ namespace mongo {
 
     struct LastError;
 
+    /**
+     * Thread-bound state of one connection, for servers which service many connections from
+     * a shared pool of worker threads.  detach() moves whatever the handler bound to the
+     * calling thread into this object, and attach() binds it to the calling thread again,
+     * which need not be the thread it was detached from.
+     */
+    class ConnectionThreadState {
+    public:
+        virtual ~ConnectionThreadState() {}
+        virtual void detach() = 0;
+        virtual void attach() = 0;
+    };
+
     class MessageHandler {
     public:
         virtual ~MessageHandler() {}
@@ -47,6 +60,19 @@ namespace mongo {
          * called once when a socket is disconnected
          */
         virtual void disconnected( AbstractMessagingPort* p ) = 0;
+
+        /**
+         * @return true if connections may be serviced by a pool of worker threads, with
+         *     newConnectionThreadState() used to carry per connection state between them.
+         *     handlers which don't override this get one thread per connection.
+         */
+        virtual bool supportsWorkerPool() const { return false; }
+
+        /**
+         * called once per connection, before connected(), by servers using a worker pool.
+         * caller takes ownership.
+         */
+        virtual ConnectionThreadState* newConnectionThreadState() { return NULL; }
     };
 
     class MessageServer {
@@ -64,6 +90,20 @@ namespace mongo {
         virtual void setupSockets() = 0;
     };
 
-    // TODO use a factory here to decide between port and asio variations
+    /**
+     * Creates the server for handler.  When the messageServerWorkerThreads server parameter
+     * is set and both the platform and the handler support it, connections are multiplexed
+     * over that many worker threads.  Otherwise each connection gets its own thread.
+     */
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler );
+
+    /**
+     * epoll based server which waits on idle connections from a single thread and services
+     * incoming messages from a pool of nWorkers threads, plus temporary ones up to maxWorkers
+     * in all while all of those are busy.  linux only; returns NULL elsewhere.
+     */
+    MessageServer * createEpollServer( const MessageServer::Options& opts,
+                                       MessageHandler * handler,
+                                       int nWorkers,
+                                       int maxWorkers );
 }
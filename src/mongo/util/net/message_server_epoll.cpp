@@ -0,0 +1,549 @@
+// message_server_epoll.cpp
+
+/*    Copyright 2014 10gen Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/*
+  Event driven MessageServer.
+
+  One thread waits in epoll_wait on every idle connection and reads incoming bytes without
+  blocking until it has a whole Message.  Only then is the connection handed to a worker
+  thread, which processes the Message and hands the connection back to epoll.  Connections are
+  registered EPOLLONESHOT so at most one worker services a connection at a time, and its per
+  connection state (LastError plus whatever the MessageHandler binds to the thread) is moved
+  onto the worker for the duration.
+
+  When no worker is idle another thread is started, up to maxWorkers, which exits again once
+  it has been idle for a while.  Operations that block for long (awaitData getMores,
+  getLastError waiting for replication, writes queued behind fsyncLock) therefore hold a thread
+  only while they block and don't stall the other connections until maxWorkers threads are
+  busy.  Past that, work queues for the next free worker.
+
+  The poller never blocks on a connection: replies it can't frame as a Message (to an http GET
+  or the endian check) are sent from a worker.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/util/net/message.h"
+#include "mongo/util/net/message_port.h"
+#include "mongo/util/net/message_server.h"
+
+#ifdef __linux__
+
+#include <boost/function.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "mongo/db/lasterror.h"
+#include "mongo/db/stats/counters.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/concurrency/thread_name.h"
+#include "mongo/util/concurrency/ticketholder.h"
+#include "mongo/util/net/listen.h"
+
+namespace mongo {
+
+    namespace {
+
+        class EpollMessageServer : public MessageServer , public Listener {
+        public:
+            EpollMessageServer( const MessageServer::Options& opts,
+                                MessageHandler* handler,
+                                int nWorkers,
+                                int maxWorkers ) :
+                Listener( "" , opts.ipList, opts.port ),
+                _handler( handler ),
+                _epfd( -1 ),
+                _nWorkers( nWorkers ),
+                _maxWorkers( std::max( nWorkers, maxWorkers ) ),
+                _mutex( "EpollMessageServer" ),
+                _threads( 0 ),
+                _idle( 0 ) {
+            }
+
+            virtual ~EpollMessageServer() {
+                if ( _epfd >= 0 )
+                    ::close( _epfd );
+            }
+
+            virtual void acceptedMP( MessagingPort* p ) {
+                if ( ! Listener::globalTicketHolder.tryAcquire() ) {
+                    log() << "connection refused because too many open connections: "
+                          << Listener::globalTicketHolder.used() << endl;
+                    p->shutdown();
+                    delete p;
+                    sleepmillis(2); // otherwise we'll hard loop
+                    return;
+                }
+
+                Session* s = new Session( p, _handler->newConnectionThreadState() );
+                dispatch( boost::bind( &EpollMessageServer::connect, this, s ) );
+            }
+
+            virtual void setAsTimeTracker() {
+                Listener::setAsTimeTracker();
+            }
+
+            virtual void setupSockets() {
+                Listener::setupSockets();
+            }
+
+            void run() {
+                _epfd = epoll_create( 1024 ); // size is only a hint
+                if ( _epfd < 0 ) {
+                    error() << "epoll_create failed: " << errnoWithDescription() << endl;
+                    return;
+                }
+
+                {
+                    scoped_lock lk( _mutex );
+                    for ( int i = 0; i < _nWorkers; i++ )
+                        startWorker( lk );
+                }
+
+                boost::thread poller( boost::bind( &EpollMessageServer::poll, this ) );
+                initAndListen();
+            }
+
+            virtual bool useUnixSockets() const { return true; }
+
+        private:
+            typedef boost::function<void()> Task;
+
+            /**
+             * One connection.  Owned by the poller while registered with epoll and by the
+             * worker servicing it otherwise; EPOLLONESHOT guarantees it is never both.
+             */
+            struct Session {
+                Session( MessagingPort* port, ConnectionThreadState* state ) :
+                    port( port ), le( new LastError() ), state( state ),
+                    received( 0 ), md( NULL ), bytesIn( 0 ) {
+                }
+
+                ~Session() {
+                    delete le;
+                    free( md );
+                }
+
+                scoped_ptr<MessagingPort> port;
+                LastError* le; // owned while detached, by lastError while attached
+                scoped_ptr<ConnectionThreadState> state;
+                string otherSide;
+                string threadName;
+
+                // the message being read
+                MSGHEADER header;
+                int received;    // bytes of the message read so far
+                MsgData* md;     // allocated once the whole header is in
+                long long bytesIn;
+
+                Message message; // the complete message handed to a worker
+            };
+
+            enum ReadResult {
+                READ_INCOMPLETE, // wait for more bytes
+                READ_MESSAGE,    // s->message holds a whole message
+                READ_HTTP,       // the client sent an http GET
+                READ_ENDIAN,     // the client sent the endian check
+                READ_CLOSED      // the connection is closed or unusable
+            };
+
+            MessageHandler* _handler;
+            int _epfd;
+            const int _nWorkers;
+            const int _maxWorkers;
+
+            // workers
+            mongo::mutex _mutex;
+            boost::condition _taskReady;
+            std::deque<Task> _tasks;
+            int _threads; // running worker threads
+            int _idle;    // workers waiting for a task
+
+            /**
+             * runs task on an idle worker, or on a new thread if no worker is idle and there are
+             * fewer than _maxWorkers.  otherwise task waits for the next worker to free up.
+             */
+            void dispatch( const Task& task ) {
+                scoped_lock lk( _mutex );
+                _tasks.push_back( task );
+                if ( static_cast<int>( _tasks.size() ) > _idle && _threads < _maxWorkers )
+                    startWorker( lk );
+                else
+                    _taskReady.notify_one();
+            }
+
+            void startWorker( scoped_lock& lk ) {
+                boost::thread t( boost::bind( &EpollMessageServer::work, this,
+                                              _threads < _nWorkers ) );
+                _threads++;
+            }
+
+            /**
+             * The first _nWorkers threads run until shutdown; the rest exit after idling for
+             * a few seconds.
+             */
+            void work( bool core ) {
+                setThreadName( "connWorker" );
+
+                while ( true ) {
+                    Task task;
+                    {
+                        scoped_lock lk( _mutex );
+                        while ( _tasks.empty() ) {
+                            _idle++;
+                            bool woken = true;
+                            if ( core ) {
+                                _taskReady.wait( lk.boost() );
+                            }
+                            else {
+                                woken = _taskReady.timed_wait( lk.boost(),
+                                                               boost::posix_time::seconds(5) );
+                            }
+                            _idle--;
+                            if ( ! woken && _tasks.empty() ) {
+                                _threads--;
+                                return;
+                            }
+                        }
+                        task = _tasks.front();
+                        _tasks.pop_front();
+                    }
+                    task();
+                }
+            }
+
+            void poll() {
+                setThreadName( "connPoller" );
+
+                const int maxEvents = 256;
+                epoll_event events[maxEvents];
+
+                while ( ! inShutdown() ) {
+                    int n = epoll_wait( _epfd, events, maxEvents, 1000 );
+                    if ( n < 0 ) {
+                        if ( errno == EINTR )
+                            continue;
+                        error() << "epoll_wait failed: " << errnoWithDescription() << endl;
+                        dbexit( EXIT_UNCAUGHT );
+                    }
+
+                    for ( int i = 0; i < n; i++ ) {
+                        Session* s = static_cast<Session*>( events[i].data.ptr );
+                        switch ( readMessage( s ) ) {
+                        case READ_INCOMPLETE:
+                            if ( ! arm( s, EPOLL_CTL_MOD ) )
+                                dispatch( boost::bind( &EpollMessageServer::closed, this, s ) );
+                            break;
+                        case READ_MESSAGE:
+                            dispatch( boost::bind( &EpollMessageServer::service, this, s ) );
+                            break;
+                        case READ_HTTP:
+                            dispatch( boost::bind( &EpollMessageServer::replyHttp, this, s ) );
+                            break;
+                        case READ_ENDIAN:
+                            dispatch( boost::bind( &EpollMessageServer::replyEndian, this, s ) );
+                            break;
+                        case READ_CLOSED:
+                            dispatch( boost::bind( &EpollMessageServer::closed, this, s ) );
+                            break;
+                        }
+                    }
+                }
+            }
+
+            /**
+             * reads whatever bytes of s's next message have arrived without blocking.  the
+             * framing checks follow MessagingPort::recv.
+             */
+            ReadResult readMessage( Session* s ) {
+                MessagingPort* p = s->port.get();
+                const int headerLen = sizeof(MSGHEADER);
+
+                while ( true ) {
+                    char* buf;
+                    int want;
+                    if ( s->received < headerLen ) {
+                        buf = reinterpret_cast<char*>( &s->header ) + s->received;
+                        want = headerLen - s->received;
+                    }
+                    else {
+                        buf = reinterpret_cast<char*>( s->md ) + s->received;
+                        want = s->header.messageLength - s->received;
+                    }
+
+                    int got = ::recv( p->psock->rawFD(), buf, want, MSG_DONTWAIT );
+                    if ( got < 0 ) {
+                        if ( errno == EINTR )
+                            continue;
+                        if ( errno == EAGAIN || errno == EWOULDBLOCK )
+                            return READ_INCOMPLETE;
+                        LOG( p->psock->getLogLevel() ) << "recv from " << s->otherSide
+                                                       << " failed: " << errnoWithDescription()
+                                                       << endl;
+                        return READ_CLOSED;
+                    }
+                    if ( got == 0 )
+                        return READ_CLOSED;
+
+                    s->received += got;
+                    s->bytesIn += got;
+                    if ( s->received < headerLen )
+                        continue;
+
+                    if ( s->received == headerLen && ! s->md ) {
+                        int len = s->header.messageLength;
+                        if ( len == 542393671 ) {
+                            s->received = 0;
+                            return READ_HTTP;
+                        }
+                        if ( len == -1 ) {
+                            // endian check from the client, after connecting
+                            s->received = 0;
+                            return READ_ENDIAN;
+                        }
+                        if ( p->psock->isAwaitingHandshake() &&
+                             s->header.responseTo != 0 && s->header.responseTo != -1 ) {
+                            // SSL servers don't use this MessageServer
+                            LOG(0) << "SSL handshake requested from " << s->otherSide
+                                   << ", SSL is not available" << endl;
+                            return READ_CLOSED;
+                        }
+                        if ( len < headerLen || len > MaxMessageSizeBytes ) {
+                            LOG(0) << "recv(): message len " << len << " is invalid. "
+                                   << "Min " << headerLen << " Max: " << MaxMessageSizeBytes
+                                   << endl;
+                            return READ_CLOSED;
+                        }
+
+                        p->psock->setHandshakeReceived();
+                        int z = (len+1023)&0xfffffc00;
+                        verify(z>=len);
+                        s->md = static_cast<MsgData*>( malloc(z) );
+                        verify(s->md);
+                        memcpy( s->md, &s->header, headerLen );
+                    }
+
+                    if ( s->received == s->header.messageLength ) {
+                        s->message.setData( s->md, true );
+                        s->md = NULL;
+                        s->received = 0;
+                        return READ_MESSAGE;
+                    }
+                }
+            }
+
+            /** (re)registers s with epoll for the next incoming message */
+            bool arm( Session* s, int op ) {
+                epoll_event ev;
+                ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+                ev.data.ptr = s;
+                if ( epoll_ctl( _epfd, op, s->port->psock->rawFD(), &ev ) == 0 )
+                    return true;
+
+                log() << "epoll_ctl failed for " << s->otherSide << ", closing client connection: "
+                      << errnoWithDescription() << endl;
+                return false;
+            }
+
+            void attach( Session* s ) {
+                setThreadName( s->threadName.c_str() );
+                lastError.reset( s->le );
+                s->le = NULL;
+                if ( s->state )
+                    s->state->attach();
+            }
+
+            void detach( Session* s ) {
+                if ( s->state )
+                    s->state->detach();
+                s->le = lastError._get();
+                lastError.release();
+                setThreadName( "connWorker" );
+            }
+
+            void connect( Session* s ) {
+                MessagingPort* p = s->port.get();
+
+                s->threadName = "conn";
+                if ( p->connectionId() > 0 )
+                    s->threadName = str::stream() << s->threadName << p->connectionId();
+
+                p->psock->setLogLevel(logger::LogSeverity::Debug(1));
+
+                attach( s );
+                try {
+                    s->otherSide = p->psock->remoteString();
+                    _handler->connected( p );
+                }
+                catch ( const DBException& e ) {
+                    log() << "DBException accepting connection, closing client connection: "
+                          << e << endl;
+                    disconnect( s );
+                    return;
+                }
+                detach( s );
+
+                if ( ! arm( s, EPOLL_CTL_ADD ) ) {
+                    attach( s );
+                    disconnect( s );
+                }
+            }
+
+            /** processes the message the poller read for s */
+            void service( Session* s ) {
+                MessagingPort* p = s->port.get();
+
+                attach( s );
+                try {
+                    p->psock->clearCounters();
+                    _handler->process( s->message , p , lastError._get() );
+                    s->message.reset();
+                    networkCounter.hit( s->bytesIn , p->psock->getBytesOut() );
+                    s->bytesIn = 0;
+                }
+                catch ( AssertionException& e ) {
+                    log() << "AssertionException handling request, closing client connection: " << e << endl;
+                    disconnect( s );
+                    return;
+                }
+                catch ( SocketException& e ) {
+                    log() << "SocketException handling request, closing client connection: " << e << endl;
+                    disconnect( s );
+                    return;
+                }
+                catch ( const DBException& e ) { // must be right above std::exception to avoid catching subclasses
+                    log() << "DBException handling request, closing client connection: " << e << endl;
+                    disconnect( s );
+                    return;
+                }
+                catch ( std::exception &e ) {
+                    error() << "Uncaught std::exception: " << e.what() << ", terminating" << endl;
+                    dbexit( EXIT_UNCAUGHT );
+                }
+                catch ( ... ) {
+                    error() << "Uncaught exception, terminating" << endl;
+                    dbexit( EXIT_UNCAUGHT );
+                }
+                detach( s );
+
+                if ( inShutdown() || ! arm( s, EPOLL_CTL_MOD ) ) {
+                    attach( s );
+                    disconnect( s );
+                }
+            }
+
+            /** answers an http GET on the native driver port, and closes the connection */
+            void replyHttp( Session* s ) {
+                MessagingPort* p = s->port.get();
+                string msg = "It looks like you are trying to access MongoDB "
+                             "over HTTP on the native driver port.\n";
+                LOG( p->psock->getLogLevel() ) << msg << endl;
+                stringstream ss;
+                ss << "HTTP/1.0 200 OK\r\nConnection: close\r\n"
+                   << "Content-Type: text/plain\r\nContent-Length: "
+                   << msg.size() << "\r\n\r\n" << msg;
+                string reply = ss.str();
+                try {
+                    p->send( reply.c_str(), reply.size(), "http" );
+                }
+                catch ( const SocketException& e ) {
+                    LOG( p->psock->getLogLevel() ) << "SocketException: remote: "
+                                                   << s->otherSide << " error: " << e << endl;
+                }
+                closed( s );
+            }
+
+            /** answers the client's endian check and waits for its next message */
+            void replyEndian( Session* s ) {
+                MessagingPort* p = s->port.get();
+                try {
+                    unsigned foo = 0x10203040;
+                    p->send( (char *) &foo, 4, "endian" );
+                }
+                catch ( const SocketException& e ) {
+                    LOG( p->psock->getLogLevel() ) << "SocketException: remote: "
+                                                   << s->otherSide << " error: " << e << endl;
+                    closed( s );
+                    return;
+                }
+                p->psock->setHandshakeReceived();
+
+                if ( inShutdown() || ! arm( s, EPOLL_CTL_MOD ) ) {
+                    attach( s );
+                    disconnect( s );
+                }
+            }
+
+            /** the client went away, or sent something the poller couldn't frame */
+            void closed( Session* s ) {
+                attach( s );
+                if (!serverGlobalParams.quiet) {
+                    int conns = Listener::globalTicketHolder.used()-1;
+                    const char* word = (conns == 1 ? " connection" : " connections");
+                    log() << "end connection " << s->otherSide
+                          << " (" << conns << word << " now open)" << endl;
+                }
+                disconnect( s );
+            }
+
+            /**
+             * disconnects and deletes s.  must be called with s attached to this thread.
+             */
+            void disconnect( Session* s ) {
+                MessagingPort* p = s->port.get();
+
+                // closing the fd would drop it from the epoll set too, but only once every
+                // duplicate of the descriptor is closed
+                epoll_ctl( _epfd, EPOLL_CTL_DEL, p->psock->rawFD(), NULL );
+                p->shutdown();
+
+                _handler->disconnected( p );
+                detach( s );
+
+                delete s;
+                Listener::globalTicketHolder.release();
+            }
+        };
+
+    } // namespace
+
+    MessageServer * createEpollServer( const MessageServer::Options& opts,
+                                       MessageHandler * handler,
+                                       int nWorkers,
+                                       int maxWorkers ) {
+        return new EpollMessageServer( opts, handler, nWorkers, maxWorkers );
+    }
+
+} // namespace mongo
+
+#else
+
+namespace mongo {
+
+    MessageServer * createEpollServer( const MessageServer::Options& opts,
+                                       MessageHandler * handler,
+                                       int nWorkers,
+                                       int maxWorkers ) {
+        return NULL;
+    }
+
+} // namespace mongo
+
+#endif
@@ -23,6 +23,7 @@
 
 
 #include "mongo/db/lasterror.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/util/concurrency/ticketholder.h"
 #include "mongo/util/concurrency/thread_name.h"
@@ -38,6 +39,13 @@
 
 namespace mongo {
 
+    // 0 keeps the default of one thread per connection
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(messageServerWorkerThreads, int, 0);
+
+    // Most worker threads, counting the temporary ones started while every worker is busy.
+    // Never less than messageServerWorkerThreads.
+    MONGO_EXPORT_STARTUP_SERVER_PARAMETER(messageServerMaxWorkerThreads, int, 256);
+
     class PortMessageServer : public MessageServer , public Listener {
     public:
         /**
@@ -245,6 +253,31 @@ namespace mongo {
 
 
     MessageServer * createServer( const MessageServer::Options& opts , MessageHandler * handler ) {
+        if ( messageServerWorkerThreads > 0 ) {
+            MessageServer* server = NULL;
+            if ( ! handler->supportsWorkerPool() ) {
+                warning() << "messageServerWorkerThreads is not supported by this process, "
+                          << "using one thread per connection" << endl;
+            }
+#ifdef MONGO_SSL
+            else if ( getSSLManager() ) {
+                warning() << "messageServerWorkerThreads is not supported with SSL, "
+                          << "using one thread per connection" << endl;
+            }
+#endif
+            else if ( ! ( server = createEpollServer( opts, handler,
+                                                      messageServerWorkerThreads,
+                                                      messageServerMaxWorkerThreads ) ) ) {
+                warning() << "messageServerWorkerThreads is not supported on this platform, "
+                          << "using one thread per connection" << endl;
+            }
+
+            if ( server ) {
+                log() << "servicing connections with " << messageServerWorkerThreads
+                      << " worker threads" << endl;
+                return server;
+            }
+        }
         return new PortMessageServer( opts , handler );
     }
 
@@ -18,6 +18,10 @@
 
 #include "mongo/util/mmap.h"
 
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
 namespace mongo {
 
     char _touch_pages_char_reader; // goes in .bss
@@ -28,4 +32,13 @@ namespace mongo {
             _touch_pages_char_reader += buf[i];
         }
     }
+
+    void prefetch_pages( const char* buf, size_t length ) {
+#if !defined(_WIN32)
+        // madvise wants a page aligned start
+        const char* p = reinterpret_cast<const char*>(
+                reinterpret_cast<size_t>( buf ) & ~( g_minOSPageSizeBytes - 1 ) );
+        madvise( const_cast<char*>( p ), length + ( buf - p ), MADV_WILLNEED );
+#endif
+    }
 }
@@ -24,4 +24,8 @@ namespace mongo {
     // Takes a file descriptor, offset, and length, for Linux use.
     // Additionally takes an Extent pointer for use on other platforms.
     void touch_pages( const char* buf, size_t length );
+
+    // Ask the OS to start reading a range of pages in the background and return without waiting
+    // for them.  A hint only: it may do nothing, and does nothing on Windows.
+    void prefetch_pages( const char* buf, size_t length );
 }